@@ -561,6 +561,9 @@ alloc_socket(struct netconn *newconn, int accepted)
          after having marked it as used. */
       SYS_ARCH_UNPROTECT(lev);
       sockets[i].lastdata.pbuf = NULL;
+#if LWIP_SO_TIMESTAMPING
+      sockets[i].timestamping = 0;
+#endif /* LWIP_SO_TIMESTAMPING */
 #if LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL
       LWIP_ASSERT("sockets[i].select_waiting == 0", sockets[i].select_waiting == 0);
       sockets[i].rcvevent   = 0;
@@ -1196,6 +1199,9 @@ lwip_recvfrom_udp_raw(struct lwip_sock *sock, int flags, struct msghdr *msg, u16
 
   if (msg->msg_control) {
     u8_t wrote_msg = 0;
+#if LWIP_SO_TIMESTAMPING
+    socklen_t ctrl_space = msg->msg_controllen;
+#endif /* LWIP_SO_TIMESTAMPING */
 #if LWIP_NETBUF_RECVINFO
     /* Check if packet info was recorded */
     if (buf->flags & NETBUF_FLAG_DESTADDR) {
@@ -1218,6 +1224,29 @@ lwip_recvfrom_udp_raw(struct lwip_sock *sock, int flags, struct msghdr *msg, u16
       }
     }
 #endif /* LWIP_NETBUF_RECVINFO */
+#if LWIP_SO_TIMESTAMPING
+    /* Append the hardware timestamp the driver stored on the pbuf if the
+       socket asked for RX timestamps and for the raw hardware time */
+    if (((sock->timestamping & (SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE)) ==
+         (SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE)) &&
+        ((buf->p->ts_sec != 0) || (buf->p->ts_nsec != 0))) {
+      socklen_t used = wrote_msg ? msg->msg_controllen : 0;
+      if (ctrl_space - used >= CMSG_SPACE(sizeof(struct scm_timestamping))) {
+        struct cmsghdr *chdr = (struct cmsghdr *)(void *)((u8_t *)msg->msg_control + used);
+        struct scm_timestamping *tss = (struct scm_timestamping *)CMSG_DATA(chdr);
+        chdr->cmsg_level = SOL_SOCKET;
+        chdr->cmsg_type = SCM_TIMESTAMPING;
+        chdr->cmsg_len = CMSG_LEN(sizeof(struct scm_timestamping));
+        memset(tss, 0, sizeof(struct scm_timestamping));
+        tss->ts[2].tv_sec = (time_t)buf->p->ts_sec;
+        tss->ts[2].tv_nsec = (long)buf->p->ts_nsec;
+        msg->msg_controllen = used + CMSG_SPACE(sizeof(struct scm_timestamping));
+        wrote_msg = 1;
+      } else {
+        msg->msg_flags |= MSG_CTRUNC;
+      }
+    }
+#endif /* LWIP_SO_TIMESTAMPING */
 
     if (!wrote_msg) {
       msg->msg_controllen = 0;
@@ -3088,6 +3117,12 @@ lwip_getsockopt_impl(int s, int level, int optname, void *optval, socklen_t *opt
         }
         break;
 #endif /* LWIP_SO_LINGER */
+#if LWIP_SO_TIMESTAMPING
+        case SO_TIMESTAMPING:
+          LWIP_SOCKOPT_CHECK_OPTLEN_CONN(sock, *optlen, int);
+          *(int *)optval = sock->timestamping;
+          break;
+#endif /* LWIP_SO_TIMESTAMPING */
 #if LWIP_UDP
         case SO_NO_CHECK:
           LWIP_SOCKOPT_CHECK_OPTLEN_CONN_PCB_TYPE(sock, *optlen, int, NETCONN_UDP);
@@ -3493,6 +3528,24 @@ lwip_setsockopt_impl(int s, int level, int optname, const void *optval, socklen_
         }
         break;
 #endif /* LWIP_SO_LINGER */
+#if LWIP_SO_TIMESTAMPING
+        case SO_TIMESTAMPING:
+          LWIP_SOCKOPT_CHECK_OPTLEN_CONN(sock, optlen, int);
+          if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
+            /* byte streams have no per-datagram timestamps */
+            done_socket(sock);
+            return ENOPROTOOPT;
+          }
+          if (*(const int *)optval & SOF_TIMESTAMPING_TX_HARDWARE) {
+            /* TX timestamps never come back to the socket (no error queue);
+               the netif driver hands them out */
+            done_socket(sock);
+            return EINVAL;
+          }
+          sock->timestamping = (u16_t)(*(const int *)optval &
+                                       (SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE));
+          break;
+#endif /* LWIP_SO_TIMESTAMPING */
 #if LWIP_UDP
         case SO_NO_CHECK:
           LWIP_SOCKOPT_CHECK_OPTLEN_CONN_PCB_TYPE(sock, optlen, int, NETCONN_UDP);
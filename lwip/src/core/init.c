@@ -122,6 +122,9 @@ PACK_STRUCT_END
 #if (LWIP_IGMP && !LWIP_IPV4)
 #error "IGMP needs LWIP_IPV4 enabled in your lwipopts.h"
 #endif
+#if LWIP_SO_TIMESTAMPING && !LWIP_PBUF_TIMESTAMP
+#error "If you want to use SO_TIMESTAMPING, you have to define LWIP_PBUF_TIMESTAMP=1 in your lwipopts.h"
+#endif
 #if ((LWIP_NETCONN || LWIP_SOCKET) && (MEMP_NUM_TCPIP_MSG_API<=0))
 #error "If you want to use Sequential API, you have to define MEMP_NUM_TCPIP_MSG_API>=1 in your lwipopts.h"
 #endif
@@ -157,6 +160,18 @@ PACK_STRUCT_END
 #if (LWIP_TCP && (TCP_SND_QUEUELEN < 2))
 #error "TCP_SND_QUEUELEN must be at least 2 for no-copy TCP writes to work"
 #endif
+#if (LWIP_TCP_TSO && (!LWIP_TCP || !LWIP_SUPPORT_CUSTOM_PBUF))
+#error "LWIP_TCP_TSO needs LWIP_TCP and LWIP_SUPPORT_CUSTOM_PBUF enabled in your lwipopts.h"
+#endif
+#if (TCP_PCB_HASH && (((TCP_PCB_HASH_SIZE & (TCP_PCB_HASH_SIZE - 1)) != 0) || ((TCP_LISTEN_HASH_SIZE & (TCP_LISTEN_HASH_SIZE - 1)) != 0)))
+#error "TCP_PCB_HASH_SIZE and TCP_LISTEN_HASH_SIZE must be powers of two"
+#endif
+#if (UDP_PCB_HASH && ((UDP_PCB_HASH_SIZE & (UDP_PCB_HASH_SIZE - 1)) != 0))
+#error "UDP_PCB_HASH_SIZE must be a power of two"
+#endif
+#if (LWIP_VLAN_OFFLOAD && !ETHARP_SUPPORT_VLAN)
+#error "LWIP_VLAN_OFFLOAD needs ETHARP_SUPPORT_VLAN enabled in your lwipopts.h"
+#endif
 #if (LWIP_TCP && ((TCP_MAXRTX > 12) || (TCP_SYNMAXRTX > 12)))
 #error "If you want to use TCP, TCP_MAXRTX and TCP_SYNMAXRTX must less or equal to 12 (due to tcp_backoff table), so, you have to reduce them in your lwipopts.h"
 #endif
@@ -116,6 +116,10 @@ static netif_addr_idx_t etharp_cached_entry;
 #if ETHARP_SUPPORT_STATIC_ENTRIES
 #define ETHARP_FLAG_STATIC_ENTRY 4
 #endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
+#if ETHARP_LEARN_SOLICITED_ONLY
+/** Only update an entry we are waiting for an answer for */
+#define ETHARP_FLAG_SOLICITED    8
+#endif /* ETHARP_LEARN_SOLICITED_ONLY */
 
 #if LWIP_NETIF_HWADDRHINT
 #define ETHARP_SET_ADDRHINT(netif, addrhint)  do { if (((netif) != NULL) && ((netif)->hints != NULL)) { \
@@ -442,6 +446,17 @@ etharp_update_arp_entry(struct netif *netif, const ip4_addr_t *ipaddr, struct et
     return (err_t)i;
   }
 
+#if ETHARP_LEARN_SOLICITED_ONLY
+  if ((flags & ETHARP_FLAG_SOLICITED) &&
+      (arp_table[i].state != ETHARP_STATE_PENDING) &&
+      (arp_table[i].state != ETHARP_STATE_STABLE_REREQUESTING_1) &&
+      (arp_table[i].state != ETHARP_STATE_STABLE_REREQUESTING_2)) {
+    /* we did not ask: don't let it change the entry */
+    LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_update_arp_entry: unsolicited, entry %"S16_F" not updated\n", i));
+    return ERR_VAL;
+  }
+#endif /* ETHARP_LEARN_SOLICITED_ONLY */
+
 #if ETHARP_SUPPORT_STATIC_ENTRIES
   if (flags & ETHARP_FLAG_STATIC_ENTRY) {
     /* record static type */
@@ -694,6 +709,15 @@ etharp_input(struct pbuf *p, struct netif *netif)
     from_us = (u8_t)ip4_addr_eq(&sipaddr, netif_ip4_addr(netif));
   }
 
+#if ETHARP_LEARN_SOLICITED_ONLY
+  /* ARP reply directed to us?
+      -> update the entry if we asked for it, which sends the packets
+         queued on it. Everything else leaves the cache alone. */
+  if (for_us && (hdr->opcode == PP_HTONS(ARP_REPLY))) {
+    etharp_update_arp_entry(netif, &sipaddr, &(hdr->shwaddr),
+                            ETHARP_FLAG_FIND_ONLY | ETHARP_FLAG_SOLICITED);
+  }
+#else /* ETHARP_LEARN_SOLICITED_ONLY */
   /* ARP message directed to us?
       -> add IP address in ARP cache; assume requester wants to talk to us,
          can result in directly sending the queued packets for this host.
@@ -701,6 +725,7 @@ etharp_input(struct pbuf *p, struct netif *netif)
       ->  update the source IP address in the cache, if present */
   etharp_update_arp_entry(netif, &sipaddr, &(hdr->shwaddr),
                           for_us ? ETHARP_FLAG_TRY_HARD : ETHARP_FLAG_FIND_ONLY);
+#endif /* ETHARP_LEARN_SOLICITED_ONLY */
 
   /* now act on the message itself */
   switch (hdr->opcode) {
@@ -530,7 +530,7 @@ ip4_input(struct pbuf *p, struct netif *inp)
 
   /* verify checksum */
 #if CHECKSUM_CHECK_IP
-  IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_IP) {
+  IF__NETIF_CHECKSUM_CHECK(inp, p, NETIF_CHECKSUM_CHECK_IP) {
     if (inet_chksum(iphdr, iphdr_hlen) != 0) {
 
       LWIP_DEBUGF(IP_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
@@ -672,6 +672,10 @@ ip4_input(struct pbuf *p, struct netif *inp)
 #if IP_REASSEMBLY /* packet fragment reassembly code present? */
     LWIP_DEBUGF(IP_DEBUG, ("IP packet is a fragment (id=0x%04"X16_F" tot_len=%"U16_F" len=%"U16_F" MF=%"U16_F" offset=%"U16_F"), calling ip4_reass()\n",
                            lwip_ntohs(IPH_ID(iphdr)), p->tot_len, lwip_ntohs(IPH_LEN(iphdr)), (u16_t)!!(IPH_OFFSET(iphdr) & PP_HTONS(IP_MF)), (u16_t)((lwip_ntohs(IPH_OFFSET(iphdr)) & IP_OFFMASK) * 8)));
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+    /* the netif saw one fragment, not the datagram: check it in software */
+    p->chksum_verified = 0;
+#endif /* LWIP_CHECKSUM_CTRL_PER_NETIF */
     /* reassemble the packet*/
     p = ip4_reass(p);
     /* packet not fully reassembled yet? */
@@ -1032,7 +1036,12 @@ ip4_output_if_opt_src(struct pbuf *p, const ip4_addr_t *src, const ip4_addr_t *d
 #endif /* ENABLE_LOOPBACK */
 #if IP_FRAG
   /* don't fragment if interface has mtu set to 0 [loopif] */
-  if (netif->mtu && (p->tot_len > netif->mtu)) {
+  if (netif->mtu && (p->tot_len > netif->mtu)
+#if LWIP_TCP_TSO
+      /* TSO frames are cut into MSS-sized segments by the netif */
+      && (p->tso_mss == 0)
+#endif /* LWIP_TCP_TSO */
+     ) {
     return ip4_frag(p, netif, dest);
   }
 #endif /* IP_FRAG */
@@ -1005,6 +1005,10 @@ netif_found:
 #if LWIP_IPV6_REASS
         /* reassemble the packet */
         ip_data.current_ip_header_tot_len = hlen_tot;
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+        /* the netif saw one fragment, not the datagram: check it in software */
+        p->chksum_verified = 0;
+#endif /* LWIP_CHECKSUM_CTRL_PER_NETIF */
         p = ip6_reass(p);
         /* packet not fully reassembled yet? */
         if (p == NULL) {
@@ -1261,7 +1265,12 @@ ip6_output_if_src(struct pbuf *p, const ip6_addr_t *src, const ip6_addr_t *dest,
 #endif /* ENABLE_LOOPBACK */
 #if LWIP_IPV6_FRAG
   /* don't fragment if interface has mtu set to 0 [loopif] */
-  if (netif_mtu6(netif) && (p->tot_len > nd6_get_destination_mtu(dest, netif))) {
+  if (netif_mtu6(netif) && (p->tot_len > nd6_get_destination_mtu(dest, netif))
+#if LWIP_TCP_TSO
+      /* TSO frames are cut into MSS-sized segments by the netif */
+      && (p->tso_mss == 0)
+#endif /* LWIP_TCP_TSO */
+     ) {
     return ip6_frag(p, netif, dest);
   }
 #endif /* LWIP_IPV6_FRAG */
@@ -336,6 +336,13 @@ netif_add(struct netif *netif,
 #endif /* LWIP_IPV6 */
   NETIF_SET_CHECKSUM_CTRL(netif, NETIF_CHECKSUM_ENABLE_ALL);
   netif->mtu = 0;
+#if LWIP_TCP_TSO
+  netif->tso_max_size = 0;
+  netif->tso_max_bufs = 0;
+#endif /* LWIP_TCP_TSO */
+#if LWIP_VLAN_OFFLOAD
+  netif->vlan_offload = 0;
+#endif /* LWIP_VLAN_OFFLOAD */
   netif->flags = 0;
 #ifdef netif_get_client_data
   memset(netif->client_data, 0, sizeof(netif->client_data));
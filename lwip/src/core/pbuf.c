@@ -186,6 +186,19 @@ pbuf_init_alloced_pbuf(struct pbuf *p, void *payload, u16_t tot_len, u16_t len,
   p->flags = flags;
   p->ref = 1;
   p->if_idx = NETIF_NO_INDEX;
+#if LWIP_PBUF_TIMESTAMP
+  p->ts_sec = 0;
+  p->ts_nsec = 0;
+#endif /* LWIP_PBUF_TIMESTAMP */
+#if LWIP_TCP_TSO
+  p->tso_mss = 0;
+#endif /* LWIP_TCP_TSO */
+#if LWIP_VLAN_OFFLOAD
+  p->vlan_tci = 0;
+#endif /* LWIP_VLAN_OFFLOAD */
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+  p->chksum_verified = 0;
+#endif /* LWIP_CHECKSUM_CTRL_PER_NETIF */
 
   LWIP_PBUF_CUSTOM_DATA_INIT(p);
 }
@@ -1354,6 +1367,10 @@ pbuf_clone(pbuf_layer layer, pbuf_type type, struct pbuf *p)
   err = pbuf_copy(q, p);
   LWIP_UNUSED_ARG(err); /* in case of LWIP_NOASSERT */
   LWIP_ASSERT("pbuf_copy failed", err == ERR_OK);
+#if LWIP_TCP_TSO
+  /* a TSO frame queued for ARP resolution must stay one */
+  q->tso_mss = p->tso_mss;
+#endif /* LWIP_TCP_TSO */
   return q;
 }
 
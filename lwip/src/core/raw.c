@@ -62,8 +62,13 @@
 
 #include <string.h>
 
+#ifdef LWIP_HOOK_FILENAME
+#include LWIP_HOOK_FILENAME
+#endif
+
 /** The list of RAW PCBs */
-static struct raw_pcb *raw_pcbs;
+/* exported in raw.h (was static) */
+struct raw_pcb *raw_pcbs;
 
 static u8_t
 raw_input_local_match(struct raw_pcb *pcb, u8_t broadcast)
@@ -579,6 +584,9 @@ raw_remove(struct raw_pcb *pcb)
     }
   }
   memp_free(MEMP_RAW_PCB, pcb);
+#ifdef LWIP_HOOK_PCB_CHANGED
+  LWIP_HOOK_PCB_CHANGED();
+#endif
 }
 
 /**
@@ -613,6 +621,9 @@ raw_new(u8_t proto)
     pcb_tci_init(pcb);
     pcb->next = raw_pcbs;
     raw_pcbs = pcb;
+#ifdef LWIP_HOOK_PCB_CHANGED
+    LWIP_HOOK_PCB_CHANGED();
+#endif
   }
   return pcb;
 }
@@ -182,6 +182,13 @@ struct tcp_pcb **const tcp_pcb_lists[] = {&tcp_listen_pcbs.pcbs, &tcp_bound_pcbs
          &tcp_active_pcbs, &tcp_tw_pcbs
 };
 
+#if TCP_PCB_HASH
+/** Active and TIME-WAIT PCBs by 4-tuple (see tcp_conn_hash_idx()) */
+struct tcp_pcb *tcp_conn_hash[TCP_PCB_HASH_SIZE];
+/** Listening PCBs by local port */
+struct tcp_pcb_listen *tcp_listen_hash[TCP_LISTEN_HASH_SIZE];
+#endif /* TCP_PCB_HASH */
+
 u8_t tcp_active_pcbs_changed;
 
 /** Timer counter to handle calling slow-timer from tcp_tmr() */
@@ -1397,6 +1404,8 @@ tcp_slowtmr_start:
         LWIP_ASSERT("tcp_slowtmr: first pcb == tcp_active_pcbs", tcp_active_pcbs == pcb);
         tcp_active_pcbs = pcb->next;
       }
+      TCP_HASH_RMV(&tcp_active_pcbs, pcb);
+      TCP_PCB_CHANGED(&tcp_active_pcbs);
 
       if (pcb_reset) {
         tcp_rst(pcb, pcb->snd_nxt, pcb->rcv_nxt, &pcb->local_ip, &pcb->remote_ip,
@@ -1463,6 +1472,7 @@ tcp_slowtmr_start:
         LWIP_ASSERT("tcp_slowtmr: first pcb == tcp_tw_pcbs", tcp_tw_pcbs == pcb);
         tcp_tw_pcbs = pcb->next;
       }
+      TCP_HASH_RMV(&tcp_tw_pcbs, pcb);
       pcb2 = pcb;
       pcb = pcb->next;
       tcp_free(pcb2);
@@ -2177,6 +2187,92 @@ tcp_pcb_purge(struct tcp_pcb *pcb)
   }
 }
 
+#if TCP_PCB_HASH
+static u32_t
+tcp_hash_ip(const ip_addr_t *ip)
+{
+#if LWIP_IPV6
+  if (IP_IS_V6(ip)) {
+    const ip6_addr_t *ip6 = ip_2_ip6(ip);
+    return ip6->addr[0] ^ ip6->addr[1] ^ ip6->addr[2] ^ ip6->addr[3];
+  }
+#endif /* LWIP_IPV6 */
+#if LWIP_IPV4
+  return ip4_addr_get_u32(ip_2_ip4(ip));
+#else /* LWIP_IPV4 */
+  return 0;
+#endif /* LWIP_IPV4 */
+}
+
+/**
+ * Bucket in tcp_conn_hash for a connection. The local address is left out:
+ * it rarely differs between connections and is compared on lookup anyway.
+ */
+u32_t
+tcp_conn_hash_idx(u16_t local_port, u16_t remote_port, const ip_addr_t *remote_ip)
+{
+  u32_t h = (((u32_t)local_port << 16) | remote_port) ^ tcp_hash_ip(remote_ip);
+
+  /* Fibonacci hashing: the multiplication folds every input bit into the
+     upper half */
+  h *= 0x9E3779B1UL;
+  return (h >> 16) & (TCP_PCB_HASH_SIZE - 1);
+}
+
+/**
+ * Adds a PCB just registered with a list to the hash table for that list.
+ * Bound PCBs are not hashed: tcp_input() never looks them up.
+ */
+void
+tcp_pcb_hash_add(struct tcp_pcb **pcbs, struct tcp_pcb *pcb)
+{
+  if (pcbs == &tcp_listen_pcbs.pcbs) {
+    struct tcp_pcb_listen *lpcb = (struct tcp_pcb_listen *)pcb;
+    struct tcp_pcb_listen **bucket = &tcp_listen_hash[TCP_LISTEN_HASH_IDX(lpcb->local_port)];
+
+    lpcb->hash_next = *bucket;
+    *bucket = lpcb;
+  } else if ((pcbs == &tcp_active_pcbs) || (pcbs == &tcp_tw_pcbs)) {
+    struct tcp_pcb **bucket = &tcp_conn_hash[tcp_conn_hash_idx(pcb->local_port, pcb->remote_port, &pcb->remote_ip)];
+
+    pcb->hash_next = *bucket;
+    *bucket = pcb;
+  }
+}
+
+/**
+ * Removes a PCB from the hash table for the list it is being removed from.
+ */
+void
+tcp_pcb_hash_remove(struct tcp_pcb **pcbs, struct tcp_pcb *pcb)
+{
+  if (pcbs == &tcp_listen_pcbs.pcbs) {
+    struct tcp_pcb_listen *lpcb = (struct tcp_pcb_listen *)pcb;
+    struct tcp_pcb_listen **pp = &tcp_listen_hash[TCP_LISTEN_HASH_IDX(lpcb->local_port)];
+
+    while ((*pp != NULL) && (*pp != lpcb)) {
+      pp = &(*pp)->hash_next;
+    }
+    LWIP_ASSERT("tcp_pcb_hash_remove: listen pcb not hashed", *pp == lpcb);
+    if (*pp != NULL) {
+      *pp = lpcb->hash_next;
+    }
+    lpcb->hash_next = NULL;
+  } else if ((pcbs == &tcp_active_pcbs) || (pcbs == &tcp_tw_pcbs)) {
+    struct tcp_pcb **pp = &tcp_conn_hash[tcp_conn_hash_idx(pcb->local_port, pcb->remote_port, &pcb->remote_ip)];
+
+    while ((*pp != NULL) && (*pp != pcb)) {
+      pp = &(*pp)->hash_next;
+    }
+    LWIP_ASSERT("tcp_pcb_hash_remove: pcb not hashed", *pp == pcb);
+    if (*pp != NULL) {
+      *pp = pcb->hash_next;
+    }
+    pcb->hash_next = NULL;
+  }
+}
+#endif /* TCP_PCB_HASH */
+
 /**
  * Purges the PCB and removes it from a PCB list. Any delayed ACKs are sent first.
  *
@@ -117,10 +117,15 @@ static void tcp_remove_sacks_gt(struct tcp_pcb *pcb, u32_t seq);
 void
 tcp_input(struct pbuf *p, struct netif *inp)
 {
-  struct tcp_pcb *pcb, *prev;
+  struct tcp_pcb *pcb;
   struct tcp_pcb_listen *lpcb;
+#if !TCP_PCB_HASH
+  struct tcp_pcb *prev;
+#endif /* !TCP_PCB_HASH */
 #if SO_REUSE
+#if !TCP_PCB_HASH
   struct tcp_pcb *lpcb_prev = NULL;
+#endif /* !TCP_PCB_HASH */
   struct tcp_pcb_listen *lpcb_any = NULL;
 #endif /* SO_REUSE */
   u8_t hdrlen_bytes;
@@ -157,7 +162,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
   }
 
 #if CHECKSUM_CHECK_TCP
-  IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_TCP) {
+  IF__NETIF_CHECKSUM_CHECK(inp, p, NETIF_CHECKSUM_CHECK_TCP) {
     /* Verify TCP checksum. */
     u16_t chksum = ip_chksum_pseudo(p, IP_PROTO_TCP, p->tot_len,
                                     ip_current_src_addr(), ip_current_dest_addr());
@@ -245,6 +250,104 @@ tcp_input(struct pbuf *p, struct netif *inp)
 
   /* Demultiplex an incoming segment. First, we check if it is destined
      for an active connection. */
+#if TCP_PCB_HASH
+  /* The bucket holds active and TIME-WAIT PCBs with the same hash; an
+     active match is taken as is, a TIME-WAIT one goes to the code below */
+  {
+    struct tcp_pcb *tw_pcb = NULL;
+
+    for (pcb = tcp_conn_hash[tcp_conn_hash_idx(tcphdr->dest, tcphdr->src, ip_current_src_addr())];
+         pcb != NULL; pcb = pcb->hash_next) {
+      LWIP_ASSERT("tcp_input: hashed pcb->state != CLOSED", pcb->state != CLOSED);
+      LWIP_ASSERT("tcp_input: hashed pcb->state != LISTEN", pcb->state != LISTEN);
+
+      /* check if PCB is bound to specific netif */
+      if ((pcb->netif_idx != NETIF_NO_INDEX) &&
+          (pcb->netif_idx != netif_get_index(ip_data.current_input_netif))) {
+        continue;
+      }
+
+      if (pcb->remote_port == tcphdr->src &&
+          pcb->local_port == tcphdr->dest &&
+          ip_addr_eq(&pcb->remote_ip, ip_current_src_addr()) &&
+          ip_addr_eq(&pcb->local_ip, ip_current_dest_addr())) {
+        if (pcb->state != TIME_WAIT) {
+          break;
+        }
+        if (tw_pcb == NULL) {
+          tw_pcb = pcb;
+        }
+      }
+    }
+
+    if ((pcb == NULL) && (tw_pcb != NULL)) {
+      LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packed for TIME_WAITing connection.\n"));
+#ifdef LWIP_HOOK_TCP_INPACKET_PCB
+      if (LWIP_HOOK_TCP_INPACKET_PCB(tw_pcb, tcphdr, tcphdr_optlen, tcphdr_opt1len,
+                                     tcphdr_opt2, p) == ERR_OK)
+#endif
+      {
+        tcp_timewait_input(tw_pcb);
+      }
+      pbuf_free(p);
+      return;
+    }
+  }
+
+  if (pcb == NULL) {
+    /* No connection: look for a PCB LISTENing on the port, with the same
+       preference for an exact local address as the list walk below */
+    for (lpcb = tcp_listen_hash[TCP_LISTEN_HASH_IDX(tcphdr->dest)]; lpcb != NULL; lpcb = lpcb->hash_next) {
+      /* check if PCB is bound to specific netif */
+      if ((lpcb->netif_idx != NETIF_NO_INDEX) &&
+          (lpcb->netif_idx != netif_get_index(ip_data.current_input_netif))) {
+        continue;
+      }
+
+      if (lpcb->local_port == tcphdr->dest) {
+        if (IP_IS_ANY_TYPE_VAL(lpcb->local_ip)) {
+          /* found an ANY TYPE (IPv4/IPv6) match */
+#if SO_REUSE
+          lpcb_any = lpcb;
+#else /* SO_REUSE */
+          break;
+#endif /* SO_REUSE */
+        } else if (IP_ADDR_PCB_VERSION_MATCH_EXACT(lpcb, ip_current_dest_addr())) {
+          if (ip_addr_eq(&lpcb->local_ip, ip_current_dest_addr())) {
+            /* found an exact match */
+            break;
+          } else if (ip_addr_isany(&lpcb->local_ip)) {
+            /* found an ANY-match */
+#if SO_REUSE
+            lpcb_any = lpcb;
+#else /* SO_REUSE */
+            break;
+#endif /* SO_REUSE */
+          }
+        }
+      }
+    }
+#if SO_REUSE
+    /* first try specific local IP */
+    if (lpcb == NULL) {
+      /* only pass to ANY if no specific local IP has been found */
+      lpcb = lpcb_any;
+    }
+#endif /* SO_REUSE */
+    if (lpcb != NULL) {
+      LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packed for LISTENing connection.\n"));
+#ifdef LWIP_HOOK_TCP_INPACKET_PCB
+      if (LWIP_HOOK_TCP_INPACKET_PCB((struct tcp_pcb *)lpcb, tcphdr, tcphdr_optlen,
+                                     tcphdr_opt1len, tcphdr_opt2, p) == ERR_OK)
+#endif
+      {
+        tcp_listen_input(lpcb);
+      }
+      pbuf_free(p);
+      return;
+    }
+  }
+#else /* TCP_PCB_HASH */
   prev = NULL;
 
   for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
@@ -383,6 +486,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
       return;
     }
   }
+#endif /* TCP_PCB_HASH */
 
 #if TCP_INPUT_DEBUG
   LWIP_DEBUGF(TCP_INPUT_DEBUG, ("+-+-+-+-+-+-+-+-+-+-+-+-+-+- tcp_input: flags "));
@@ -126,6 +126,10 @@
 
 /* Forward declarations.*/
 static err_t tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif);
+#if LWIP_TCP_TSO
+static struct tcp_seg *tcp_tso_run(struct tcp_pcb *pcb, struct netif *netif, u32_t wnd);
+static err_t tcp_output_tso(struct tcp_seg *seg, struct tcp_seg *last, struct tcp_pcb *pcb, struct netif *netif);
+#endif /* LWIP_TCP_TSO */
 static err_t tcp_output_control_segment_netif(const struct tcp_pcb *pcb, struct pbuf *p,
                                               const ip_addr_t *src, const ip_addr_t *dst,
                                               struct netif *netif);
@@ -1240,9 +1244,10 @@ tcp_build_wnd_scale_option(u32_t *opts)
 err_t
 tcp_output(struct tcp_pcb *pcb)
 {
-  struct tcp_seg *seg, *useg;
+  struct tcp_seg *seg, *useg, *last;
   u32_t wnd, snd_nxt;
   err_t err;
+  int done;
   struct netif *netif;
 #if TCP_CWND_DEBUG
   s16_t i = 0;
@@ -1361,55 +1366,76 @@ tcp_output(struct tcp_pcb *pcb)
       TCPH_SET_FLAG(seg->tcphdr, TCP_ACK);
     }
 
-    err = tcp_output_segment(seg, pcb, netif);
+    last = seg;
+#if LWIP_TCP_TSO
+    /* Consecutive segments that may all go now leave as one TSO frame */
+    last = tcp_tso_run(pcb, netif, wnd);
+    if (last != NULL) {
+      err = tcp_output_tso(seg, last, pcb, netif);
+      if (err != ERR_OK) {
+        /* the netif refused the frame: fall back to this segment alone */
+        last = NULL;
+      }
+    }
+    if (last == NULL) {
+      last = seg;
+#else /* LWIP_TCP_TSO */
+    {
+#endif /* LWIP_TCP_TSO */
+      err = tcp_output_segment(seg, pcb, netif);
+    }
     if (err != ERR_OK) {
       /* segment could not be sent, for whatever reason */
       tcp_set_flags(pcb, TF_NAGLEMEMERR);
       return err;
     }
+    /* Queue every segment the frame carried as if sent on its own */
+    do {
+      done = (seg == last);
 #if TCP_OVERSIZE_DBGCHECK
-    seg->oversize_left = 0;
+      seg->oversize_left = 0;
 #endif /* TCP_OVERSIZE_DBGCHECK */
-    pcb->unsent = seg->next;
-    if (pcb->state != SYN_SENT) {
-      tcp_clear_flags(pcb, TF_ACK_DELAY | TF_ACK_NOW);
-    }
-    snd_nxt = lwip_ntohl(seg->tcphdr->seqno) + TCP_TCPLEN(seg);
-    if (TCP_SEQ_LT(pcb->snd_nxt, snd_nxt)) {
-      pcb->snd_nxt = snd_nxt;
-    }
-    /* put segment on unacknowledged list if length > 0 */
-    if (TCP_TCPLEN(seg) > 0) {
-      seg->next = NULL;
-      /* unacked list is empty? */
-      if (pcb->unacked == NULL) {
-        pcb->unacked = seg;
-        useg = seg;
-        /* unacked list is not empty? */
-      } else {
-        /* In the case of fast retransmit, the packet should not go to the tail
-         * of the unacked queue, but rather somewhere before it. We need to check for
-         * this case. -STJ Jul 27, 2004 */
-        if (TCP_SEQ_LT(lwip_ntohl(seg->tcphdr->seqno), lwip_ntohl(useg->tcphdr->seqno))) {
-          /* add segment to before tail of unacked list, keeping the list sorted */
-          struct tcp_seg **cur_seg = &(pcb->unacked);
-          while (*cur_seg &&
-                 TCP_SEQ_LT(lwip_ntohl((*cur_seg)->tcphdr->seqno), lwip_ntohl(seg->tcphdr->seqno))) {
-            cur_seg = &((*cur_seg)->next );
-          }
-          seg->next = (*cur_seg);
-          (*cur_seg) = seg;
+      pcb->unsent = seg->next;
+      if (pcb->state != SYN_SENT) {
+        tcp_clear_flags(pcb, TF_ACK_DELAY | TF_ACK_NOW);
+      }
+      snd_nxt = lwip_ntohl(seg->tcphdr->seqno) + TCP_TCPLEN(seg);
+      if (TCP_SEQ_LT(pcb->snd_nxt, snd_nxt)) {
+        pcb->snd_nxt = snd_nxt;
+      }
+      /* put segment on unacknowledged list if length > 0 */
+      if (TCP_TCPLEN(seg) > 0) {
+        seg->next = NULL;
+        /* unacked list is empty? */
+        if (pcb->unacked == NULL) {
+          pcb->unacked = seg;
+          useg = seg;
+          /* unacked list is not empty? */
         } else {
-          /* add segment to tail of unacked list */
-          useg->next = seg;
-          useg = useg->next;
+          /* In the case of fast retransmit, the packet should not go to the tail
+           * of the unacked queue, but rather somewhere before it. We need to check for
+           * this case. -STJ Jul 27, 2004 */
+          if (TCP_SEQ_LT(lwip_ntohl(seg->tcphdr->seqno), lwip_ntohl(useg->tcphdr->seqno))) {
+            /* add segment to before tail of unacked list, keeping the list sorted */
+            struct tcp_seg **cur_seg = &(pcb->unacked);
+            while (*cur_seg &&
+                   TCP_SEQ_LT(lwip_ntohl((*cur_seg)->tcphdr->seqno), lwip_ntohl(seg->tcphdr->seqno))) {
+              cur_seg = &((*cur_seg)->next );
+            }
+            seg->next = (*cur_seg);
+            (*cur_seg) = seg;
+          } else {
+            /* add segment to tail of unacked list */
+            useg->next = seg;
+            useg = useg->next;
+          }
         }
+        /* do not queue empty segments on the unacked list */
+      } else {
+        tcp_seg_free(seg);
       }
-      /* do not queue empty segments on the unacked list */
-    } else {
-      tcp_seg_free(seg);
-    }
-    seg = pcb->unsent;
+      seg = pcb->unsent;
+    } while (!done);
   }
 #if TCP_OVERSIZE
   if (pcb->unsent == NULL) {
@@ -1449,32 +1475,19 @@ tcp_output_segment_busy(const struct tcp_seg *seg)
 }
 
 /**
- * Called by tcp_output() to actually send a TCP segment over IP.
+ * Fill in the header fields of a segment about to be sent (ackno, window,
+ * options), start the RTO timer and RTT measurement, and strip the headers
+ * of a previous transmission so seg->p starts at the TCP header.
  *
  * @param seg the tcp_seg to send
  * @param pcb the tcp_pcb for the TCP connection used to send the segment
  * @param netif the netif used to send the segment
  */
-static err_t
-tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif)
+static void
+tcp_output_segment_prepare(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif)
 {
-  err_t err;
   u16_t len;
   u32_t *opts;
-#if TCP_CHECKSUM_ON_COPY
-  int seg_chksum_was_swapped = 0;
-#endif
-
-  LWIP_ASSERT("tcp_output_segment: invalid seg", seg != NULL);
-  LWIP_ASSERT("tcp_output_segment: invalid pcb", pcb != NULL);
-  LWIP_ASSERT("tcp_output_segment: invalid netif", netif != NULL);
-
-  if (tcp_output_segment_busy(seg)) {
-    /* This should not happen: rexmit functions should have checked this.
-       However, since this function modifies p->len, we must not continue in this case. */
-    LWIP_DEBUGF(TCP_RTO_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("tcp_output_segment: segment busy\n"));
-    return ERR_OK;
-  }
 
   /* The TCP header has already been constructed, but the ackno and
    wnd fields remain. */
@@ -1566,6 +1579,36 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif
   opts = LWIP_HOOK_TCP_OUT_ADD_TCPOPTS(seg->p, seg->tcphdr, pcb, opts);
 #endif
   LWIP_ASSERT("options not filled", (u8_t *)opts == ((u8_t *)(seg->tcphdr + 1)) + LWIP_TCP_OPT_LENGTH_SEGMENT(seg->flags, pcb));
+  LWIP_UNUSED_ARG(netif);
+}
+
+/**
+ * Called by tcp_output() to actually send a TCP segment over IP.
+ *
+ * @param seg the tcp_seg to send
+ * @param pcb the tcp_pcb for the TCP connection used to send the segment
+ * @param netif the netif used to send the segment
+ */
+static err_t
+tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif)
+{
+  err_t err;
+#if TCP_CHECKSUM_ON_COPY
+  int seg_chksum_was_swapped = 0;
+#endif
+
+  LWIP_ASSERT("tcp_output_segment: invalid seg", seg != NULL);
+  LWIP_ASSERT("tcp_output_segment: invalid pcb", pcb != NULL);
+  LWIP_ASSERT("tcp_output_segment: invalid netif", netif != NULL);
+
+  if (tcp_output_segment_busy(seg)) {
+    /* This should not happen: rexmit functions should have checked this.
+       However, since this function modifies p->len, we must not continue in this case. */
+    LWIP_DEBUGF(TCP_RTO_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("tcp_output_segment: segment busy\n"));
+    return ERR_OK;
+  }
+
+  tcp_output_segment_prepare(seg, pcb, netif);
 
 #if CHECKSUM_GEN_TCP
   IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_TCP) {
@@ -1624,6 +1667,185 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif
   return err;
 }
 
+#if LWIP_TCP_TSO
+/** Number of pbufs of a segment that carry payload (not only headers) */
+static u16_t
+tcp_tso_seg_bufs(const struct tcp_seg *seg)
+{
+  const struct pbuf *q;
+  u16_t off = (u16_t)((u8_t *)seg->tcphdr - (u8_t *)seg->p->payload) + TCPH_HDRLEN_BYTES(seg->tcphdr);
+  u16_t bufs = 0;
+
+  for (q = seg->p; q != NULL; q = q->next) {
+    if (off < q->len) {
+      bufs++;
+      off = 0;
+    } else {
+      off = (u16_t)(off - q->len);
+    }
+  }
+  return bufs;
+}
+
+/**
+ * Find the run of segments at the head of pcb->unsent that can leave as one
+ * TSO frame: consecutive data segments with the same options, all inside
+ * the send window, within the netif's tso_max_size and tso_max_bufs, and
+ * none still referenced by an earlier transmission. A short segment at the
+ * end of the queue is left out when the Nagle algorithm would hold it back.
+ *
+ * @param pcb the tcp_pcb whose pcb->unsent head is about to be sent
+ * @param netif the netif used to send the segments
+ * @param wnd the usable window (min of snd_wnd and cwnd)
+ * @return the last segment of the run, NULL if there is no run of two or
+ *         more segments
+ */
+static struct tcp_seg *
+tcp_tso_run(struct tcp_pcb *pcb, struct netif *netif, u32_t wnd)
+{
+  struct tcp_seg *seg = pcb->unsent;
+  struct tcp_seg *last = seg;
+  struct tcp_seg *next;
+  u32_t size;
+  u32_t bufs;
+  u16_t seg_mss;
+
+  if (netif->tso_max_size == 0) {
+    return NULL;
+  }
+#if CHECKSUM_GEN_TCP
+  /* the netif must compute the checksum of every segment it cuts */
+  IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_TCP) {
+    return NULL;
+  }
+#endif /* CHECKSUM_GEN_TCP */
+  if ((TCPH_FLAGS(seg->tcphdr) & (TCP_SYN | TCP_FIN | TCP_RST)) != 0 || seg->len == 0) {
+    return NULL;
+  }
+  size = seg->len;
+  bufs = tcp_tso_seg_bufs(seg);
+  seg_mss = (u16_t)(pcb->mss - LWIP_TCP_OPT_LENGTH_SEGMENT(seg->flags, pcb));
+
+  for (next = seg->next; next != NULL; next = next->next) {
+    if ((TCPH_FLAGS(next->tcphdr) & (TCP_SYN | TCP_FIN | TCP_RST)) != 0 || next->len == 0 ||
+        LWIP_TCP_OPT_LENGTH_SEGMENT(next->flags, pcb) != LWIP_TCP_OPT_LENGTH_SEGMENT(seg->flags, pcb) ||
+        lwip_ntohl(next->tcphdr->seqno) != lwip_ntohl(last->tcphdr->seqno) + last->len ||
+        lwip_ntohl(next->tcphdr->seqno) - pcb->lastack + next->len > wnd ||
+        size + next->len > netif->tso_max_size ||
+        bufs + tcp_tso_seg_bufs(next) > netif->tso_max_bufs ||
+        tcp_output_segment_busy(next)) {
+      break;
+    }
+    if (next->next == NULL && next->len < seg_mss &&
+        (pcb->flags & (TF_NODELAY | TF_INFR | TF_NAGLEMEMERR | TF_FIN)) == 0) {
+      break;
+    }
+    size += next->len;
+    bufs += tcp_tso_seg_bufs(next);
+    last = next;
+  }
+  return (last != seg) ? last : NULL;
+}
+
+/** Free-callback of the PBUF_REFs a TSO frame points into its segments with,
+ * called by pbuf_free once the netif is done with the frame */
+static void
+tcp_tso_free_ref(struct pbuf *p)
+{
+  struct tcp_tso_ref *ref = (struct tcp_tso_ref *)p;
+
+  LWIP_ASSERT("ref == p", (void *)ref == (void *)p);
+  pbuf_free(ref->original);
+  memp_free(MEMP_TCP_TSO_REF, ref);
+}
+
+/**
+ * Send the segments from seg to last as one TSO frame: a copy of seg's TCP
+ * header followed by PBUF_REFs into the payload of every segment. Each
+ * reference holds its segment's pbuf, which keeps the segment "busy" for
+ * the retransmission code until the netif has sent the frame.
+ *
+ * @param seg the first segment (head of pcb->unsent)
+ * @param last the last segment of the run found by tcp_tso_run()
+ * @param pcb the tcp_pcb for the TCP connection used to send the segments
+ * @param netif the netif used to send the segments
+ */
+static err_t
+tcp_output_tso(struct tcp_seg *seg, struct tcp_seg *last, struct tcp_pcb *pcb, struct netif *netif)
+{
+  struct pbuf *frame, *ref_p, *q;
+  struct tcp_tso_ref *ref;
+  struct tcp_seg *s;
+  struct tcp_hdr *tcphdr;
+  u16_t hdrlen, off;
+  err_t err;
+
+  LWIP_ASSERT("tcp_output_tso: invalid seg", seg != NULL && last != NULL);
+
+  if (tcp_output_segment_busy(seg)) {
+    return ERR_INPROGRESS;
+  }
+  tcp_output_segment_prepare(seg, pcb, netif);
+
+  hdrlen = TCPH_HDRLEN_BYTES(seg->tcphdr);
+  frame = pbuf_alloc(PBUF_IP, hdrlen, PBUF_RAM);
+  if (frame == NULL) {
+    return ERR_MEM;
+  }
+  SMEMCPY(frame->payload, seg->tcphdr, hdrlen);
+  tcphdr = (struct tcp_hdr *)frame->payload;
+  /* the netif computes the checksum of every segment it cuts */
+  tcphdr->chksum = 0;
+  /* the netif sets PSH on the last segment it cuts only; take it from ours */
+  TCPH_UNSET_FLAG(tcphdr, TCP_PSH);
+  if (TCPH_FLAGS(last->tcphdr) & TCP_PSH) {
+    TCPH_SET_FLAG(tcphdr, TCP_PSH);
+  }
+
+  for (s = seg; ; s = s->next) {
+    off = (u16_t)((u8_t *)s->tcphdr - (u8_t *)s->p->payload) + TCPH_HDRLEN_BYTES(s->tcphdr);
+    for (q = s->p; q != NULL; q = q->next) {
+      if (off >= q->len) {
+        off = (u16_t)(off - q->len);
+        continue;
+      }
+      ref = (struct tcp_tso_ref *)memp_malloc(MEMP_TCP_TSO_REF);
+      if (ref == NULL) {
+        pbuf_free(frame);
+        return ERR_MEM;
+      }
+      ref_p = pbuf_alloced_custom(PBUF_RAW, (u16_t)(q->len - off), PBUF_REF, &ref->pc,
+                                  (u8_t *)q->payload + off, (u16_t)(q->len - off));
+      LWIP_ASSERT("pbuf_alloced_custom failed", ref_p != NULL);
+      ref->pc.custom_free_function = tcp_tso_free_ref;
+      ref->original = s->p;
+      pbuf_ref(s->p);
+      pbuf_cat(frame, ref_p);
+      off = 0;
+    }
+    if (s != seg && s->p->payload == s->tcphdr) {
+      MIB2_STATS_INC(mib2.tcpoutsegs);
+    }
+    if (s == last) {
+      break;
+    }
+  }
+  /* segments are cut to the payload size tcp_write() fills them to */
+  frame->tso_mss = (u16_t)(pcb->mss - LWIP_TCP_OPT_LENGTH_SEGMENT(seg->flags, pcb));
+
+  TCP_STATS_INC(tcp.xmit);
+  LWIP_DEBUGF(TCP_OUTPUT_DEBUG, ("tcp_output_tso: %"U32_F":%"U32_F" mss %"U16_F"\n",
+                                 lwip_ntohl(seg->tcphdr->seqno), lwip_ntohl(last->tcphdr->seqno) + last->len,
+                                 frame->tso_mss));
+  NETIF_SET_HINTS(netif, &(pcb->netif_hints));
+  err = ip_output_if(frame, &pcb->local_ip, &pcb->remote_ip, pcb->ttl,
+                     pcb->tos, IP_PROTO_TCP, netif);
+  NETIF_RESET_HINTS(netif);
+  pbuf_free(frame);
+  return err;
+}
+#endif /* LWIP_TCP_TSO */
+
 /**
  * Requeue all unacked segments for retransmission
  *
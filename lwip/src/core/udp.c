@@ -62,9 +62,14 @@
 #include "lwip/stats.h"
 #include "lwip/snmp.h"
 #include "lwip/dhcp.h"
+#include "lwip/nd6.h"
 
 #include <string.h>
 
+#ifdef LWIP_HOOK_FILENAME
+#include LWIP_HOOK_FILENAME
+#endif
+
 #ifndef UDP_LOCAL_PORT_RANGE_START
 /* From http://www.iana.org/assignments/port-numbers:
    "The Dynamic and/or Private Ports are those from 49152 through 65535" */
@@ -80,6 +85,50 @@ static u16_t udp_port = UDP_LOCAL_PORT_RANGE_START;
 /* exported in udp.h (was static) */
 struct udp_pcb *udp_pcbs;
 
+#if UDP_PCB_HASH
+/* Bound PCBs by local port, chained through port_next */
+static struct udp_pcb *udp_port_hash[UDP_PCB_HASH_SIZE];
+/* Connected PCBs by local port, remote port and remote address, chained
+   through conn_next */
+static struct udp_pcb *udp_conn_hash[UDP_PCB_HASH_SIZE];
+
+#define UDP_PORT_HASH_IDX(port) ((((u32_t)(port) * 0x9E3779B1UL) >> 16) & (UDP_PCB_HASH_SIZE - 1))
+#endif /* UDP_PCB_HASH */
+
+#if CHECKSUM_GEN_UDP && LWIP_CHECKSUM_CTRL_PER_NETIF
+/**
+ * Check whether IP will fragment a datagram of this length on the way out.
+ * A netif that offloads NETIF_CHECKSUM_GEN_UDP cannot checksum fragments
+ * (the checksum covers the whole datagram), so these are done in software.
+ */
+static int
+udp_will_fragment(struct netif *netif, const struct pbuf *q, const ip_addr_t *dst_ip)
+{
+  if (netif == NULL) {
+    return 0;
+  }
+#if LWIP_IPV6 && LWIP_IPV6_FRAG
+  if (IP_IS_V6(dst_ip)) {
+    return netif_mtu6(netif) &&
+           ((u32_t)q->tot_len + IP6_HLEN > nd6_get_destination_mtu(ip_2_ip6(dst_ip), netif));
+  }
+#endif /* LWIP_IPV6 && LWIP_IPV6_FRAG */
+#if LWIP_IPV4 && IP_FRAG
+  if (!IP_IS_V6(dst_ip)) {
+    return netif->mtu && ((u32_t)q->tot_len + IP_HLEN > netif->mtu);
+  }
+#endif /* LWIP_IPV4 && IP_FRAG */
+  LWIP_UNUSED_ARG(q);
+  LWIP_UNUSED_ARG(dst_ip);
+  return 0;
+}
+
+#define UDP_CHKSUM_GEN(netif, q, dst_ip) \
+  if (NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_UDP) || udp_will_fragment(netif, q, dst_ip))
+#else /* CHECKSUM_GEN_UDP && LWIP_CHECKSUM_CTRL_PER_NETIF */
+#define UDP_CHKSUM_GEN(netif, q, dst_ip) IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_UDP)
+#endif /* CHECKSUM_GEN_UDP && LWIP_CHECKSUM_CTRL_PER_NETIF */
+
 /**
  * Initialize this module.
  */
@@ -118,6 +167,89 @@ again:
   return udp_port;
 }
 
+#if UDP_PCB_HASH
+static u32_t
+udp_hash_ip(const ip_addr_t *ip)
+{
+#if LWIP_IPV6
+  if (IP_IS_V6(ip)) {
+    const ip6_addr_t *ip6 = ip_2_ip6(ip);
+    return ip6->addr[0] ^ ip6->addr[1] ^ ip6->addr[2] ^ ip6->addr[3];
+  }
+#endif /* LWIP_IPV6 */
+#if LWIP_IPV4
+  return ip4_addr_get_u32(ip_2_ip4(ip));
+#else /* LWIP_IPV4 */
+  return 0;
+#endif /* LWIP_IPV4 */
+}
+
+static u32_t
+udp_conn_hash_idx(u16_t local_port, u16_t remote_port, const ip_addr_t *remote_ip)
+{
+  u32_t h = (((u32_t)local_port << 16) | remote_port) ^ udp_hash_ip(remote_ip);
+
+  h *= 0x9E3779B1UL;
+  return (h >> 16) & (UDP_PCB_HASH_SIZE - 1);
+}
+
+/** Adds a connected PCB to udp_conn_hash under its current addresses */
+static void
+udp_conn_hash_add(struct udp_pcb *pcb)
+{
+  struct udp_pcb **bucket = &udp_conn_hash[udp_conn_hash_idx(pcb->local_port, pcb->remote_port, &pcb->remote_ip)];
+
+  pcb->conn_next = *bucket;
+  *bucket = pcb;
+}
+
+/** Removes a PCB from udp_conn_hash; must run before its addresses change */
+static void
+udp_conn_hash_remove(struct udp_pcb *pcb)
+{
+  struct udp_pcb **pp = &udp_conn_hash[udp_conn_hash_idx(pcb->local_port, pcb->remote_port, &pcb->remote_ip)];
+
+  while ((*pp != NULL) && (*pp != pcb)) {
+    pp = &(*pp)->conn_next;
+  }
+  if (*pp != NULL) {
+    *pp = pcb->conn_next;
+  }
+  pcb->conn_next = NULL;
+}
+
+/** Adds a bound PCB to udp_port_hash, and to udp_conn_hash if connected */
+static void
+udp_pcb_hash_add(struct udp_pcb *pcb)
+{
+  struct udp_pcb **bucket = &udp_port_hash[UDP_PORT_HASH_IDX(pcb->local_port)];
+
+  pcb->port_next = *bucket;
+  *bucket = pcb;
+  if (pcb->flags & UDP_FLAGS_CONNECTED) {
+    udp_conn_hash_add(pcb);
+  }
+}
+
+/** Removes a PCB from both tables; nothing happens if it is in neither */
+static void
+udp_pcb_hash_remove(struct udp_pcb *pcb)
+{
+  struct udp_pcb **pp = &udp_port_hash[UDP_PORT_HASH_IDX(pcb->local_port)];
+
+  while ((*pp != NULL) && (*pp != pcb)) {
+    pp = &(*pp)->port_next;
+  }
+  if (*pp != NULL) {
+    *pp = pcb->port_next;
+  }
+  pcb->port_next = NULL;
+  if (pcb->flags & UDP_FLAGS_CONNECTED) {
+    udp_conn_hash_remove(pcb);
+  }
+}
+#endif /* UDP_PCB_HASH */
+
 /** Common code to see if the current input packet matches the pcb
  * (current input packet is accessed via ip(4/6)_current_* macros)
  *
@@ -194,7 +326,10 @@ void
 udp_input(struct pbuf *p, struct netif *inp)
 {
   struct udp_hdr *udphdr;
-  struct udp_pcb *pcb, *prev;
+  struct udp_pcb *pcb;
+#if !UDP_PCB_HASH
+  struct udp_pcb *prev;
+#endif /* !UDP_PCB_HASH */
   struct udp_pcb *uncon_pcb;
   u16_t src, dest;
   u8_t broadcast;
@@ -244,13 +379,29 @@ udp_input(struct pbuf *p, struct netif *inp)
   LWIP_DEBUGF(UDP_DEBUG, (", %"U16_F")\n", lwip_ntohs(udphdr->src)));
 
   pcb = NULL;
-  prev = NULL;
   uncon_pcb = NULL;
+#if UDP_PCB_HASH
+  /* A PCB connected to the sender's address and port takes the datagram
+     without looking any further */
+  for (pcb = udp_conn_hash[udp_conn_hash_idx(dest, src, ip_current_src_addr())]; pcb != NULL; pcb = pcb->conn_next) {
+    if ((pcb->local_port == dest) && (pcb->remote_port == src) &&
+        ip_addr_eq(&pcb->remote_ip, ip_current_src_addr()) &&
+        (udp_input_local_match(pcb, inp, broadcast) != 0)) {
+      break;
+    }
+  }
+  /* Otherwise the PCBs bound to the port, checked like the list below */
+  if (pcb == NULL) {
+  for (pcb = udp_port_hash[UDP_PORT_HASH_IDX(dest)]; pcb != NULL; pcb = pcb->port_next)
+#else /* UDP_PCB_HASH */
+  prev = NULL;
   /* Iterate through the UDP pcb list for a matching pcb.
    * 'Perfect match' pcbs (connected to the remote port & ip address) are
    * preferred. If no perfect match is found, the first unconnected pcb that
    * matches the local port and ip address gets the datagram. */
-  for (pcb = udp_pcbs; pcb != NULL; pcb = pcb->next) {
+  for (pcb = udp_pcbs; pcb != NULL; pcb = pcb->next)
+#endif /* UDP_PCB_HASH */
+  {
     /* print the PCB local and remote address */
     LWIP_DEBUGF(UDP_DEBUG, ("pcb ("));
     ip_addr_debug_print_val(UDP_DEBUG, pcb->local_ip);
@@ -290,6 +441,7 @@ udp_input(struct pbuf *p, struct netif *inp)
           (ip_addr_isany_val(pcb->remote_ip) ||
            ip_addr_eq(&pcb->remote_ip, ip_current_src_addr()))) {
         /* the first fully matching PCB */
+#if !UDP_PCB_HASH
         if (prev != NULL) {
           /* move the pcb to the front of udp_pcbs so that is
              found faster next time */
@@ -299,12 +451,18 @@ udp_input(struct pbuf *p, struct netif *inp)
         } else {
           UDP_STATS_INC(udp.cachehit);
         }
+#endif /* !UDP_PCB_HASH */
         break;
       }
     }
 
+#if !UDP_PCB_HASH
     prev = pcb;
+#endif /* !UDP_PCB_HASH */
   }
+#if UDP_PCB_HASH
+  } /* if (pcb == NULL) */
+#endif /* UDP_PCB_HASH */
   /* no fully matching pcb found? then look for an unconnected pcb */
   if (pcb == NULL) {
     pcb = uncon_pcb;
@@ -329,7 +487,7 @@ udp_input(struct pbuf *p, struct netif *inp)
   if (for_us) {
     LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE, ("udp_input: calculating checksum\n"));
 #if CHECKSUM_CHECK_UDP
-    IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_UDP) {
+    IF__NETIF_CHECKSUM_CHECK(inp, p, NETIF_CHECKSUM_CHECK_UDP) {
 #if LWIP_UDPLITE
       if (ip_current_header_proto() == IP_PROTO_UDPLITE) {
         /* Do the UDP Lite checksum */
@@ -819,7 +977,7 @@ udp_sendto_if_src_chksum(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *d
     udphdr->len = lwip_htons(chklen_hdr);
     /* calculate checksum */
 #if CHECKSUM_GEN_UDP
-    IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_UDP) {
+    UDP_CHKSUM_GEN(netif, q, dst_ip) {
 #if LWIP_CHECKSUM_ON_COPY
       if (have_chksum) {
         chklen = UDP_HLEN;
@@ -850,7 +1008,7 @@ udp_sendto_if_src_chksum(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *d
     udphdr->len = lwip_htons(q->tot_len);
     /* calculate checksum */
 #if CHECKSUM_GEN_UDP
-    IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_UDP) {
+    UDP_CHKSUM_GEN(netif, q, dst_ip) {
       /* Checksum is mandatory over IPv6. */
       if (IP_IS_V6(dst_ip) || (pcb->flags & UDP_FLAGS_NOCHKSUM) == 0) {
         u16_t udpchksum;
@@ -1014,6 +1172,11 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
     }
   }
 
+#if UDP_PCB_HASH
+  if (rebind) {
+    udp_pcb_hash_remove(pcb);
+  }
+#endif /* UDP_PCB_HASH */
   ip_addr_set_ipaddr(&pcb->local_ip, ipaddr);
 
   pcb->local_port = port;
@@ -1024,6 +1187,12 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
     pcb->next = udp_pcbs;
     udp_pcbs = pcb;
   }
+#if UDP_PCB_HASH
+  udp_pcb_hash_add(pcb);
+#endif /* UDP_PCB_HASH */
+#ifdef LWIP_HOOK_PCB_CHANGED
+  LWIP_HOOK_PCB_CHANGED();
+#endif
   LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, ("udp_bind: bound to "));
   ip_addr_debug_print_val(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, pcb->local_ip);
   LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, (", port %"U16_F")\n", pcb->local_port));
@@ -1088,6 +1257,11 @@ udp_connect(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
     }
   }
 
+#if UDP_PCB_HASH
+  if (pcb->flags & UDP_FLAGS_CONNECTED) {
+    udp_conn_hash_remove(pcb);
+  }
+#endif /* UDP_PCB_HASH */
   ip_addr_set_ipaddr(&pcb->remote_ip, ipaddr);
 #if LWIP_IPV6 && LWIP_IPV6_SCOPES
   /* If the given IP address should have a zone but doesn't, assign one now,
@@ -1110,12 +1284,24 @@ udp_connect(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
   for (ipcb = udp_pcbs; ipcb != NULL; ipcb = ipcb->next) {
     if (pcb == ipcb) {
       /* already on the list, just return */
+#if UDP_PCB_HASH
+      udp_conn_hash_add(pcb);
+#endif /* UDP_PCB_HASH */
+#ifdef LWIP_HOOK_PCB_CHANGED
+      LWIP_HOOK_PCB_CHANGED();
+#endif
       return ERR_OK;
     }
   }
   /* PCB not yet on the list, add PCB now */
   pcb->next = udp_pcbs;
   udp_pcbs = pcb;
+#if UDP_PCB_HASH
+  udp_pcb_hash_add(pcb);
+#endif /* UDP_PCB_HASH */
+#ifdef LWIP_HOOK_PCB_CHANGED
+  LWIP_HOOK_PCB_CHANGED();
+#endif
   return ERR_OK;
 }
 
@@ -1133,6 +1319,11 @@ udp_disconnect(struct udp_pcb *pcb)
 
   LWIP_ERROR("udp_disconnect: invalid pcb", pcb != NULL, return);
 
+#if UDP_PCB_HASH
+  if (pcb->flags & UDP_FLAGS_CONNECTED) {
+    udp_conn_hash_remove(pcb);
+  }
+#endif /* UDP_PCB_HASH */
   /* reset remote address association */
 #if LWIP_IPV4 && LWIP_IPV6
   if (IP_IS_ANY_TYPE_VAL(pcb->local_ip)) {
@@ -1147,6 +1338,9 @@ udp_disconnect(struct udp_pcb *pcb)
   pcb->netif_idx = NETIF_NO_INDEX;
   /* mark PCB as unconnected */
   udp_clear_flags(pcb, UDP_FLAGS_CONNECTED);
+#ifdef LWIP_HOOK_PCB_CHANGED
+  LWIP_HOOK_PCB_CHANGED();
+#endif
 }
 
 /**
@@ -1189,6 +1383,9 @@ udp_remove(struct udp_pcb *pcb)
   LWIP_ERROR("udp_remove: invalid pcb", pcb != NULL, return);
 
   mib2_udp_unbind(pcb);
+#if UDP_PCB_HASH
+  udp_pcb_hash_remove(pcb);
+#endif /* UDP_PCB_HASH */
   /* pcb to be removed is first in list? */
   if (udp_pcbs == pcb) {
     /* make list start at 2nd pcb */
@@ -1205,6 +1402,9 @@ udp_remove(struct udp_pcb *pcb)
     }
   }
   memp_free(MEMP_UDP_PCB, pcb);
+#ifdef LWIP_HOOK_PCB_CHANGED
+  LWIP_HOOK_PCB_CHANGED();
+#endif
 }
 
 /**
@@ -152,6 +152,13 @@ enum lwip_internal_netif_client_data_index
 #define NETIF_CHECKSUM_DISABLE_ALL  0x0000
 #endif /* LWIP_CHECKSUM_CTRL_PER_NETIF */
 
+#if LWIP_VLAN_OFFLOAD
+/** The netif inserts the 802.1Q tag given in pbuf->vlan_tci on transmit */
+#define NETIF_VLAN_OFFLOAD_TX       0x01U
+/** The netif strips 802.1Q tags into pbuf->vlan_tci and filters VLANs on receive */
+#define NETIF_VLAN_OFFLOAD_RX       0x02U
+#endif /* LWIP_VLAN_OFFLOAD */
+
 struct netif;
 
 /** MAC Filter Actions, these are passed to a netif's igmp_mac_filter or
@@ -346,6 +353,16 @@ struct netif {
   /** maximum transfer unit (in bytes), updated by RA */
   u16_t mtu6;
 #endif /* LWIP_IPV6 && LWIP_ND6_ALLOW_RA_UPDATES */
+#if LWIP_TCP_TSO
+  /** largest TCP payload the netif segments itself (TSO), 0 if it cannot */
+  u16_t tso_max_size;
+  /** most pbufs carrying TCP payload in one TSO frame */
+  u16_t tso_max_bufs;
+#endif /* LWIP_TCP_TSO */
+#if LWIP_VLAN_OFFLOAD
+  /** 802.1Q tag handling done by the netif, see @ref NETIF_VLAN_OFFLOAD_TX */
+  u8_t vlan_offload;
+#endif /* LWIP_VLAN_OFFLOAD */
   /** link level hardware address of this interface */
   u8_t hwaddr[NETIF_MAX_HWADDR_LEN];
   /** number of bytes used in hwaddr */
@@ -410,10 +427,15 @@ struct netif {
   (netif)->chksum_flags = chksumflags; } while(0)
 #define NETIF_CHECKSUM_ENABLED(netif, chksumflag) (((netif) == NULL) || (((netif)->chksum_flags & (chksumflag)) != 0))
 #define IF__NETIF_CHECKSUM_ENABLED(netif, chksumflag) if NETIF_CHECKSUM_ENABLED(netif, chksumflag)
+/* Like IF__NETIF_CHECKSUM_ENABLED() for a received packet, but also skips
+   the check if the netif verified it in hardware (p->chksum_verified) */
+#define IF__NETIF_CHECKSUM_CHECK(netif, p, chksumflag) \
+  if (NETIF_CHECKSUM_ENABLED(netif, chksumflag) && (((p)->chksum_verified & (chksumflag)) == 0))
 #else /* LWIP_CHECKSUM_CTRL_PER_NETIF */
 #define NETIF_CHECKSUM_ENABLED(netif, chksumflag) 0
 #define NETIF_SET_CHECKSUM_CTRL(netif, chksumflags)
 #define IF__NETIF_CHECKSUM_ENABLED(netif, chksumflag)
+#define IF__NETIF_CHECKSUM_CHECK(netif, p, chksumflag)
 #endif /* LWIP_CHECKSUM_CTRL_PER_NETIF */
 
 #if LWIP_SINGLE_NETIF
@@ -463,6 +463,15 @@
 #define MEMP_NUM_TCP_SEG                16
 #endif
 
+/**
+ * MEMP_NUM_TCP_TSO_REF: the number of segment payloads simultaneously
+ * referenced by TSO frames the netif has not finished sending yet.
+ * (requires the LWIP_TCP_TSO option)
+ */
+#if !defined MEMP_NUM_TCP_TSO_REF || defined __DOXYGEN__
+#define MEMP_NUM_TCP_TSO_REF            TCP_SND_QUEUELEN
+#endif
+
 /**
  * MEMP_NUM_ALTCP_PCB: the number of simultaneously active altcp layer pcbs.
  * (requires the LWIP_ALTCP option)
@@ -702,6 +711,19 @@
 #define LWIP_VLAN_PCP                   0
 #endif
 
+/**
+ * LWIP_VLAN_OFFLOAD==1: Let netifs insert and strip 802.1Q tags themselves.
+ * A netif that sets NETIF_VLAN_OFFLOAD_TX in netif->vlan_offload gets the tag
+ * chosen by LWIP_HOOK_VLAN_SET or LWIP_VLAN_PCP in pbuf->vlan_tci instead of
+ * in the ethernet header; one that sets NETIF_VLAN_OFFLOAD_RX delivers
+ * untagged frames with the stripped tag in pbuf->vlan_tci and drops frames
+ * of foreign VLANs before they reach ethernet_input().
+ * Requires ETHARP_SUPPORT_VLAN.
+ */
+#if !defined LWIP_VLAN_OFFLOAD || defined __DOXYGEN__
+#define LWIP_VLAN_OFFLOAD               0
+#endif
+
 /** LWIP_ETHERNET==1: enable ethernet support even though ARP might be disabled
  */
 #if !defined LWIP_ETHERNET || defined __DOXYGEN__
@@ -731,6 +753,17 @@
 #if !defined ETHARP_TABLE_MATCH_NETIF || defined __DOXYGEN__
 #define ETHARP_TABLE_MATCH_NETIF        !LWIP_SINGLE_NETIF
 #endif
+
+/** ETHARP_LEARN_SOLICITED_ONLY==1: Only ARP replies to a request of our own
+ * (an entry that is pending or being re-requested) update the ARP cache.
+ * Requests, gratuitous ARP and unsolicited replies are ignored, so a host
+ * that ARPs for us is resolved by our own request when we answer it. Meant
+ * for netifs whose MAC answers ARP requests itself and does not pass them
+ * up, and as a guard against ARP cache poisoning.
+ */
+#if !defined ETHARP_LEARN_SOLICITED_ONLY || defined __DOXYGEN__
+#define ETHARP_LEARN_SOLICITED_ONLY     0
+#endif
 /**
  * @}
  */
@@ -1260,6 +1293,26 @@
 #define UDP_TTL                         IP_DEFAULT_TTL
 #endif
 
+/**
+ * UDP_PCB_HASH==1: udp_input() finds the PCB for a datagram in hash tables
+ * instead of scanning udp_pcbs. Connected PCBs are looked up first by local
+ * port, remote port and remote address, and an exact match is taken as is;
+ * otherwise the PCBs bound to the destination port are checked as udp_pcbs
+ * would be. udp_bind(), udp_connect(), udp_disconnect() and udp_remove()
+ * keep the tables in sync. Costs two pointers per PCB plus the tables.
+ */
+#if !defined UDP_PCB_HASH || defined __DOXYGEN__
+#define UDP_PCB_HASH                    0
+#endif
+
+/**
+ * UDP_PCB_HASH_SIZE: number of buckets in each of the two UDP hash tables,
+ * a power of two. (requires the UDP_PCB_HASH option)
+ */
+#if !defined UDP_PCB_HASH_SIZE || defined __DOXYGEN__
+#define UDP_PCB_HASH_SIZE               32
+#endif
+
 /**
  * LWIP_NETBUF_RECVINFO==1: append destination addr and port to every netbuf.
  */
@@ -1495,6 +1548,48 @@
 #define TCP_OVERSIZE                    TCP_MSS
 #endif
 
+/**
+ * LWIP_TCP_TSO==1: TCP segmentation offload. When the outgoing netif sets
+ * tso_max_size, tcp_output() sends a run of consecutive unsent segments as one
+ * frame of up to tso_max_size payload bytes, with the MSS to cut it into in
+ * pbuf->tso_mss; the MAC replicates the headers for each segment. The
+ * segments stay MSS-sized on the unsent/unacked queues, so retransmission
+ * and window accounting are unchanged. The netif must generate the IP and TCP
+ * checksums. Requires LWIP_SUPPORT_CUSTOM_PBUF.
+ */
+#if !defined LWIP_TCP_TSO || defined __DOXYGEN__
+#define LWIP_TCP_TSO                    0
+#endif
+
+/**
+ * TCP_PCB_HASH==1: tcp_input() finds the PCB for a segment in hash tables
+ * instead of walking tcp_active_pcbs, tcp_tw_pcbs and tcp_listen_pcbs:
+ * active and TIME-WAIT PCBs are hashed by local port, remote port and
+ * remote address, listening PCBs by local port. The tables are updated
+ * together with the lists (TCP_REG/TCP_RMV), which stay as they are for
+ * everything else. Costs one pointer per PCB plus the two tables.
+ */
+#if !defined TCP_PCB_HASH || defined __DOXYGEN__
+#define TCP_PCB_HASH                    0
+#endif
+
+/**
+ * TCP_PCB_HASH_SIZE: number of buckets for active and TIME-WAIT PCBs, a
+ * power of two. Lookups stay constant-time while it is not much smaller
+ * than the number of connections. (requires the TCP_PCB_HASH option)
+ */
+#if !defined TCP_PCB_HASH_SIZE || defined __DOXYGEN__
+#define TCP_PCB_HASH_SIZE               64
+#endif
+
+/**
+ * TCP_LISTEN_HASH_SIZE: number of buckets for listening PCBs, a power of
+ * two. (requires the TCP_PCB_HASH option)
+ */
+#if !defined TCP_LISTEN_HASH_SIZE || defined __DOXYGEN__
+#define TCP_LISTEN_HASH_SIZE            16
+#endif
+
 /**
  * LWIP_TCP_TIMESTAMPS==1: support the TCP timestamp option.
  * The timestamp option is currently only used to help remote hosts, it is not
@@ -1641,6 +1736,15 @@
 #define LWIP_PBUF_CUSTOM_DATA
 #endif
 
+/**
+ * LWIP_PBUF_TIMESTAMP==1: Add a hardware timestamp (ts_sec/ts_nsec) to
+ * struct pbuf. Netif drivers with a timestamping MAC fill it in for received
+ * and transmitted frames; 0/0 means "not timestamped".
+ */
+#if !defined LWIP_PBUF_TIMESTAMP || defined __DOXYGEN__
+#define LWIP_PBUF_TIMESTAMP             0
+#endif
+
 /**
  * LWIP_PBUF_CUSTOM_DATA_INIT: Initialize private data on pbufs.
  * e.g. for the above example definition:
@@ -2115,6 +2219,18 @@
 #define LWIP_SO_RCVBUF                  0
 #endif
 
+/**
+ * LWIP_SO_TIMESTAMPING==1: Enable the SO_TIMESTAMPING option on UDP and RAW
+ * sockets. recvmsg() returns the hardware timestamp of a datagram in an
+ * SCM_TIMESTAMPING control message. TX timestamps are not delivered to
+ * sockets (SOF_TIMESTAMPING_TX_HARDWARE is rejected): a sender sets
+ * PBUF_FLAG_TX_TSTAMP on its pbuf through the raw API and reads the stamp
+ * back from the netif driver. Requires LWIP_PBUF_TIMESTAMP.
+ */
+#if !defined LWIP_SO_TIMESTAMPING || defined __DOXYGEN__
+#define LWIP_SO_TIMESTAMPING            0
+#endif
+
 /**
  * LWIP_SO_LINGER==1: Enable SO_LINGER processing.
  */
@@ -2371,7 +2487,9 @@
  */
 /**
  * LWIP_CHECKSUM_CTRL_PER_NETIF==1: Checksum generation/check can be enabled/disabled
- * per netif.
+ * per netif. A driver whose MAC verifies checksums on RX may also leave the
+ * checks enabled and set the NETIF_CHECKSUM_CHECK_* bits of pbuf->chksum_verified
+ * for the packets it verified; only those checks are skipped.
  * ATTENTION: if enabled, the CHECKSUM_GEN_* and CHECKSUM_CHECK_* defines must be enabled!
  */
 #if !defined LWIP_CHECKSUM_CTRL_PER_NETIF || defined __DOXYGEN__
@@ -3153,6 +3271,21 @@
 #define LWIP_HOOK_MEMP_AVAILABLE(memp_t_type)
 #endif
 
+/**
+ * LWIP_HOOK_PCB_CHANGED():
+ * Called (tcpip core locked) after the set of PCBs that receive changed: a
+ * UDP PCB was bound, connected, disconnected or removed, a TCP PCB entered
+ * or left the listen or active list, or a raw PCB was created or removed.
+ * Lets a netif that filters received packets in hardware follow the PCBs.
+ * The PCB lists may be walked, but not changed, from the hook.
+ * Signature:\code{.c}
+ *   void my_hook(void);
+ * \endcode
+ */
+#ifdef __DOXYGEN__
+#define LWIP_HOOK_PCB_CHANGED()
+#endif
+
 /**
  * LWIP_HOOK_UNKNOWN_ETH_PROTOCOL(pbuf, netif):
  * Called from ethernet_input() when an unknown eth type is encountered.
@@ -52,7 +52,7 @@ extern "C" {
  * Currently, the pbuf_custom code is only needed for one specific configuration
  * of IP_FRAG, unless required by external driver/application code. */
 #ifndef LWIP_SUPPORT_CUSTOM_PBUF
-#define LWIP_SUPPORT_CUSTOM_PBUF ((IP_FRAG && !LWIP_NETIF_TX_SINGLE_PBUF) || (LWIP_IPV6 && LWIP_IPV6_FRAG))
+#define LWIP_SUPPORT_CUSTOM_PBUF ((IP_FRAG && !LWIP_NETIF_TX_SINGLE_PBUF) || (LWIP_IPV6 && LWIP_IPV6_FRAG) || LWIP_TCP_TSO)
 #endif
 
 /** @ingroup pbuf
@@ -181,6 +181,11 @@ typedef enum {
 #define PBUF_FLAG_LLMCAST   0x10U
 /** indicates this pbuf includes a TCP FIN flag */
 #define PBUF_FLAG_TCP_FIN   0x20U
+/** indicates the netif driver should record the TX timestamp of this packet */
+#define PBUF_FLAG_TX_TSTAMP 0x40U
+/** indicates the 802.1Q tag of this packet is in pbuf->vlan_tci rather than
+    in its ethernet header (VLAN offload) */
+#define PBUF_FLAG_VLAN      0x80U
 
 /** Main packet buffer struct */
 struct pbuf {
@@ -220,6 +225,31 @@ struct pbuf {
   /** For incoming packets, this contains the input netif's index */
   u8_t if_idx;
 
+#if LWIP_PBUF_TIMESTAMP
+  /** hardware timestamp of the frame (seconds and nanoseconds), 0/0 if none */
+  u32_t ts_sec;
+  u32_t ts_nsec;
+#endif /* LWIP_PBUF_TIMESTAMP */
+
+#if LWIP_TCP_TSO
+  /** TSO frame: TCP payload bytes per segment the netif cuts it into, 0 if
+      this is an ordinary packet (only meaningful on the first pbuf) */
+  u16_t tso_mss;
+#endif /* LWIP_TCP_TSO */
+
+#if LWIP_VLAN_OFFLOAD
+  /** 802.1Q tag control information (PCP, DEI, VID) in host byte order,
+      valid if PBUF_FLAG_VLAN is set */
+  u16_t vlan_tci;
+#endif /* LWIP_VLAN_OFFLOAD */
+
+#if LWIP_CHECKSUM_CTRL_PER_NETIF
+  /** NETIF_CHECKSUM_CHECK_* bits the input netif already verified in
+      hardware for this packet; the stack skips only those checks (only
+      meaningful on the first pbuf, cleared for fragments) */
+  u16_t chksum_verified;
+#endif /* LWIP_CHECKSUM_CTRL_PER_NETIF */
+
   /** In case the user needs to store data custom data on a pbuf */
   LWIP_PBUF_CUSTOM_DATA
 };
@@ -89,6 +89,10 @@ struct lwip_sock {
 #define LWIP_SOCK_FD_FREE_TCP  1
 #define LWIP_SOCK_FD_FREE_FREE 2
 #endif
+#if LWIP_SO_TIMESTAMPING
+  /** SOF_TIMESTAMPING_* flags set through SO_TIMESTAMPING */
+  u16_t timestamping;
+#endif /* LWIP_SO_TIMESTAMPING */
 };
 
 #ifndef set_errno
@@ -270,6 +270,15 @@ struct tcp_seg {
   struct tcp_hdr *tcphdr;  /* the TCP header */
 };
 
+#if LWIP_TCP_TSO
+/* A PBUF_REF into the payload of a queued segment, sent as part of a TSO
+   frame; holds a reference on the segment's pbuf until the netif is done */
+struct tcp_tso_ref {
+  struct pbuf_custom pc;
+  struct pbuf *original;
+};
+#endif /* LWIP_TCP_TSO */
+
 #define LWIP_TCP_OPT_EOL        0
 #define LWIP_TCP_OPT_NOP        1
 #define LWIP_TCP_OPT_MSS        2
@@ -340,6 +349,34 @@ extern struct tcp_pcb *tcp_tw_pcbs;      /* List of all TCP PCBs in TIME-WAIT. *
 #define NUM_TCP_PCB_LISTS               4
 extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
 
+#if TCP_PCB_HASH
+/* Active and TIME-WAIT PCBs by local port, remote port and remote address,
+   listening PCBs by local port, each bucket chained through hash_next. */
+extern struct tcp_pcb *tcp_conn_hash[TCP_PCB_HASH_SIZE];
+extern struct tcp_pcb_listen *tcp_listen_hash[TCP_LISTEN_HASH_SIZE];
+
+u32_t tcp_conn_hash_idx(u16_t local_port, u16_t remote_port, const ip_addr_t *remote_ip);
+#define TCP_LISTEN_HASH_IDX(port) ((((u32_t)(port) * 0x9E3779B1UL) >> 16) & (TCP_LISTEN_HASH_SIZE - 1))
+void tcp_pcb_hash_add(struct tcp_pcb **pcbs, struct tcp_pcb *pcb);
+void tcp_pcb_hash_remove(struct tcp_pcb **pcbs, struct tcp_pcb *pcb);
+#define TCP_HASH_ADD(pcbs, npcb) tcp_pcb_hash_add(pcbs, npcb)
+#define TCP_HASH_RMV(pcbs, npcb) tcp_pcb_hash_remove(pcbs, npcb)
+#else /* TCP_PCB_HASH */
+#define TCP_HASH_ADD(pcbs, npcb)
+#define TCP_HASH_RMV(pcbs, npcb)
+#endif /* TCP_PCB_HASH */
+
+#ifdef LWIP_HOOK_PCB_CHANGED
+/* Only the listen and active lists hold PCBs that receive new packets */
+#define TCP_PCB_CHANGED(list) do { \
+    if (((list) == &tcp_active_pcbs) || ((list) == &tcp_listen_pcbs.pcbs)) { \
+      LWIP_HOOK_PCB_CHANGED(); \
+    } \
+  } while (0)
+#else /* LWIP_HOOK_PCB_CHANGED */
+#define TCP_PCB_CHANGED(list)
+#endif /* LWIP_HOOK_PCB_CHANGED */
+
 /* Axioms about the above lists:
    1) Every TCP PCB that is not CLOSED is in one of the lists.
    2) A PCB is only in one of the lists.
@@ -364,13 +401,16 @@ extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
                             (npcb)->next = *(pcbs); \
                             LWIP_ASSERT("TCP_REG: npcb->next != npcb", (npcb)->next != (npcb)); \
                             *(pcbs) = (npcb); \
+                            TCP_HASH_ADD(pcbs, npcb); \
                             LWIP_ASSERT("TCP_REG: tcp_pcbs sane", tcp_pcbs_sane()); \
+                            TCP_PCB_CHANGED(pcbs); \
               tcp_timer_needed(); \
                             } while(0)
 #define TCP_RMV(pcbs, npcb) do { \
                             struct tcp_pcb *tcp_tmp_pcb; \
                             LWIP_ASSERT("TCP_RMV: pcbs != NULL", *(pcbs) != NULL); \
                             LWIP_DEBUGF(TCP_DEBUG, ("TCP_RMV: removing %p from %p\n", (void *)(npcb), (void *)(*(pcbs)))); \
+                            TCP_HASH_RMV(pcbs, npcb); \
                             if(*(pcbs) == (npcb)) { \
                                *(pcbs) = (*pcbs)->next; \
                             } else for (tcp_tmp_pcb = *(pcbs); tcp_tmp_pcb != NULL; tcp_tmp_pcb = tcp_tmp_pcb->next) { \
@@ -382,6 +422,7 @@ extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
                             (npcb)->next = NULL; \
                             LWIP_ASSERT("TCP_RMV: tcp_pcbs sane", tcp_pcbs_sane()); \
                             LWIP_DEBUGF(TCP_DEBUG, ("TCP_RMV: removed %p from %p\n", (void *)(npcb), (void *)(*(pcbs)))); \
+                            TCP_PCB_CHANGED(pcbs); \
                             } while(0)
 
 #else /* LWIP_DEBUG */
@@ -390,11 +431,14 @@ extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
   do {                                             \
     (npcb)->next = *pcbs;                          \
     *(pcbs) = (npcb);                              \
+    TCP_HASH_ADD(pcbs, npcb);                      \
+    TCP_PCB_CHANGED(pcbs);                         \
     tcp_timer_needed();                            \
   } while (0)
 
 #define TCP_RMV(pcbs, npcb)                        \
   do {                                             \
+    TCP_HASH_RMV(pcbs, npcb);                      \
     if(*(pcbs) == (npcb)) {                        \
       (*(pcbs)) = (*pcbs)->next;                   \
     }                                              \
@@ -410,6 +454,7 @@ extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
       }                                            \
     }                                              \
     (npcb)->next = NULL;                           \
+    TCP_PCB_CHANGED(pcbs);                         \
   } while(0)
 
 #endif /* LWIP_DEBUG */
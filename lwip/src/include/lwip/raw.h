@@ -99,6 +99,9 @@ struct raw_pcb {
 #endif
 };
 
+/* raw_pcbs export for external reference (e.g. a netif filtering by protocol) */
+extern struct raw_pcb *raw_pcbs;
+
 /* The following functions is the application layer interface to the
    RAW code. */
 struct raw_pcb * raw_new        (u8_t proto);
@@ -71,6 +71,9 @@
 #include "lwip/errno.h"
 
 #include <string.h>
+#if LWIP_SO_TIMESTAMPING
+#include <time.h>
+#endif /* LWIP_SO_TIMESTAMPING */
 
 #ifdef __cplusplus
 extern "C" {
@@ -253,6 +256,20 @@ struct ifreq {
 #endif /* __rtems__ */
 #define SO_NO_CHECK     0x100a /* don't create UDP checksum */
 #define SO_BINDTODEVICE 0x100b /* bind to device */
+#define SO_TIMESTAMPING 0x100c /* hardware timestamps, see SOF_TIMESTAMPING_* */
+
+#if LWIP_SO_TIMESTAMPING
+/* SO_TIMESTAMPING option flags */
+#define SOF_TIMESTAMPING_TX_HARDWARE  0x0001 /* not supported: SO_TIMESTAMPING fails with EINVAL */
+#define SOF_TIMESTAMPING_RX_HARDWARE  0x0004 /* timestamp received datagrams in the MAC */
+#define SOF_TIMESTAMPING_RAW_HARDWARE 0x0040 /* report the MAC timestamps */
+
+/* Control message carrying the timestamps, ts[2] holds the raw hardware one */
+#define SCM_TIMESTAMPING SO_TIMESTAMPING
+struct scm_timestamping {
+  struct timespec ts[3];
+};
+#endif /* LWIP_SO_TIMESTAMPING */
 
 #ifndef __rtems__
 
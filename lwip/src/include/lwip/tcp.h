@@ -206,11 +206,18 @@ struct tcp_pcb_ext_args {
 typedef u16_t tcpflags_t;
 #define TCP_ALLFLAGS 0xffffU
 
+#if TCP_PCB_HASH
+#define TCP_PCB_HASH_NEXT(type) type *hash_next; /* for the hash bucket */
+#else
+#define TCP_PCB_HASH_NEXT(type)
+#endif
+
 /**
  * members common to struct tcp_pcb and struct tcp_listen_pcb
  */
 #define TCP_PCB_COMMON(type) \
   type *next; /* for the linked list */ \
+  TCP_PCB_HASH_NEXT(type) \
   void *callback_arg; \
   TCP_PCB_EXTARGS \
   enum tcp_state state; /* TCP state */ \
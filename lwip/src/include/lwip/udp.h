@@ -85,6 +85,12 @@ struct udp_pcb {
 /* Protocol specific PCB members */
 
   struct udp_pcb *next;
+#if UDP_PCB_HASH
+  /** bucket chains for udp_input(): by local port, and if connected by
+      local port, remote port and remote address */
+  struct udp_pcb *port_next;
+  struct udp_pcb *conn_next;
+#endif /* UDP_PCB_HASH */
 
   u8_t flags;
   /** ports are in host byte order */
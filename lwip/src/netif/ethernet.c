@@ -63,6 +63,27 @@
 const struct eth_addr ethbroadcast = {{0xff, 0xff, 0xff, 0xff, 0xff, 0xff}};
 const struct eth_addr ethzero = {{0, 0, 0, 0, 0, 0}};
 
+#if ETHARP_SUPPORT_VLAN && (defined(LWIP_HOOK_VLAN_CHECK) || defined(ETHARP_VLAN_CHECK) || defined(ETHARP_VLAN_CHECK_FN)) /* if not, allow all VLANs */
+#define ETHERNET_VLAN_CHECK 1
+/** Check whether a frame of the VLAN in vlan is for us */
+static int
+ethernet_vlan_accept(struct netif *netif, struct eth_hdr *ethhdr, struct eth_vlan_hdr *vlan)
+{
+#ifdef LWIP_HOOK_VLAN_CHECK
+  return LWIP_HOOK_VLAN_CHECK(netif, ethhdr, vlan);
+#elif defined(ETHARP_VLAN_CHECK_FN)
+  LWIP_UNUSED_ARG(netif);
+  return ETHARP_VLAN_CHECK_FN(ethhdr, vlan);
+#else
+  LWIP_UNUSED_ARG(netif);
+  LWIP_UNUSED_ARG(ethhdr);
+  return VLAN_ID(vlan) == ETHARP_VLAN_CHECK;
+#endif
+}
+#else
+#define ETHERNET_VLAN_CHECK 0
+#endif
+
 /**
  * @ingroup lwip_nosys
  * Process received ethernet frames. Using this function instead of directly
@@ -118,21 +139,27 @@ ethernet_input(struct pbuf *p, struct netif *netif)
       MIB2_STATS_NETIF_INC(netif, ifinerrors);
       goto free_and_return;
     }
-#if defined(LWIP_HOOK_VLAN_CHECK) || defined(ETHARP_VLAN_CHECK) || defined(ETHARP_VLAN_CHECK_FN) /* if not, allow all VLANs */
-#ifdef LWIP_HOOK_VLAN_CHECK
-    if (!LWIP_HOOK_VLAN_CHECK(netif, ethhdr, vlan)) {
-#elif defined(ETHARP_VLAN_CHECK_FN)
-    if (!ETHARP_VLAN_CHECK_FN(ethhdr, vlan)) {
-#elif defined(ETHARP_VLAN_CHECK)
-    if (VLAN_ID(vlan) != ETHARP_VLAN_CHECK) {
-#endif
+#if ETHERNET_VLAN_CHECK
+    if (!ethernet_vlan_accept(netif, ethhdr, vlan)) {
       /* silently ignore this packet: not for our VLAN */
       pbuf_free(p);
       return ERR_OK;
     }
-#endif /* defined(LWIP_HOOK_VLAN_CHECK) || defined(ETHARP_VLAN_CHECK) || defined(ETHARP_VLAN_CHECK_FN) */
+#endif /* ETHERNET_VLAN_CHECK */
     type = vlan->tpid;
   }
+#if LWIP_VLAN_OFFLOAD && ETHERNET_VLAN_CHECK
+  else if (p->flags & PBUF_FLAG_VLAN) {
+    /* the netif stripped the tag: check it as if it were still inline */
+    struct eth_vlan_hdr vlan;
+    vlan.prio_vid = lwip_htons(p->vlan_tci);
+    vlan.tpid = type;
+    if (!ethernet_vlan_accept(netif, ethhdr, &vlan)) {
+      pbuf_free(p);
+      return ERR_OK;
+    }
+  }
+#endif /* LWIP_VLAN_OFFLOAD && ETHERNET_VLAN_CHECK */
 #endif /* ETHARP_SUPPORT_VLAN */
 
 #if LWIP_ARP_FILTER_NETIF
@@ -275,6 +302,13 @@ ethernet_output(struct netif * netif, struct pbuf * p,
 
 #if ETHARP_SUPPORT_VLAN && (defined(LWIP_HOOK_VLAN_SET) || LWIP_VLAN_PCP)
   s32_t vlan_prio_vid;
+#endif
+#if LWIP_VLAN_OFFLOAD
+  /* the pbuf may carry a tag from an earlier send or from input (e.g. a TCP
+     retransmission or an ICMP echo reply built in the request's pbuf) */
+  p->flags = (u8_t)(p->flags & ~PBUF_FLAG_VLAN);
+#endif /* LWIP_VLAN_OFFLOAD */
+#if ETHARP_SUPPORT_VLAN && (defined(LWIP_HOOK_VLAN_SET) || LWIP_VLAN_PCP)
 #ifdef LWIP_HOOK_VLAN_SET
   vlan_prio_vid = LWIP_HOOK_VLAN_SET(netif, p, src, dst, eth_type);
 #elif LWIP_VLAN_PCP
@@ -283,6 +317,15 @@ ethernet_output(struct netif * netif, struct pbuf * p,
     vlan_prio_vid = (u16_t)netif->hints->tci;
   }
 #endif
+#if LWIP_VLAN_OFFLOAD
+  if ((vlan_prio_vid >= 0) && (netif->vlan_offload & NETIF_VLAN_OFFLOAD_TX)) {
+    /* the netif inserts the tag, pass it beside the frame */
+    LWIP_ASSERT("prio_vid must be <= 0xFFFF", vlan_prio_vid <= 0xFFFF);
+    p->vlan_tci = (u16_t)vlan_prio_vid;
+    p->flags |= PBUF_FLAG_VLAN;
+    vlan_prio_vid = -1;
+  }
+#endif /* LWIP_VLAN_OFFLOAD */
   if (vlan_prio_vid >= 0) {
     struct eth_vlan_hdr *vlanhdr;
 
@@ -0,0 +1,131 @@
+/*
+ * MEMCPY/SMEMCPY/MEMMOVE for lwIP (see lwipopts.h).
+ *
+ * Every word access is naturally aligned, so nothing here depends on the
+ * core allowing unaligned LDR/STR (Cortex-M7 with UNALIGN_TRP, Cortex-R
+ * without SCTLR.A clear, Device memory) and LDRD/LDM/STM, which always
+ * need word alignment, are fine. The destination is brought to a word
+ * boundary byte by byte; a source with the same alignment is then copied
+ * eight words per iteration, any other source is read in aligned words and
+ * each destination word is merged from two of them. The few bytes such a
+ * read fetches outside the source lie in its first and last word and so
+ * never in another memory region.
+ *
+ * The library is built at -O0, which would leave these loops no faster
+ * than the byte loop they replace, so they ask GCC for -O2. Loop pattern
+ * distribution stays off: it would turn them back into a memcpy() call.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lwip/arch.h"
+
+#if defined(__GNUC__) && !defined(__clang__)
+#define RTEMS_LWIP_COPY_FN \
+  __attribute__((optimize("O2", "no-tree-loop-distribute-patterns")))
+#else
+#define RTEMS_LWIP_COPY_FN
+#endif
+
+/* Word access that may alias whatever type the buffers hold */
+typedef uint32_t __attribute__((may_alias)) copy_word_t;
+
+/* Copies shorter than this are not worth the alignment work */
+#define COPY_WORD_MIN 16U
+
+#if BYTE_ORDER == LITTLE_ENDIAN
+#define MERGE(lo, hi, sh) (((lo) >> (sh)) | ((hi) << (32U - (sh))))
+#else
+#define MERGE(lo, hi, sh) (((lo) << (sh)) | ((hi) >> (32U - (sh))))
+#endif
+
+RTEMS_LWIP_COPY_FN
+static void copy_forward(uint8_t *d, const uint8_t *s, size_t len)
+{
+  if (len >= COPY_WORD_MIN) {
+    while (((uintptr_t)d & 3U) != 0U) {
+      *d++ = *s++;
+      len--;
+    }
+    copy_word_t *dw = (copy_word_t *)d;
+    uint32_t off = (uintptr_t)s & 3U;
+
+    if (off == 0U) {
+      const copy_word_t *sw = (const copy_word_t *)s;
+
+      for (; len >= 32U; len -= 32U) {
+        uint32_t w0 = sw[0], w1 = sw[1], w2 = sw[2], w3 = sw[3];
+        uint32_t w4 = sw[4], w5 = sw[5], w6 = sw[6], w7 = sw[7];
+        dw[0] = w0; dw[1] = w1; dw[2] = w2; dw[3] = w3;
+        dw[4] = w4; dw[5] = w5; dw[6] = w6; dw[7] = w7;
+        sw += 8;
+        dw += 8;
+      }
+      for (; len >= 4U; len -= 4U) {
+        *dw++ = *sw++;
+      }
+      s = (const uint8_t *)sw;
+    } else {
+      const copy_word_t *sw = (const copy_word_t *)(s - off);
+      uint32_t sh = off * 8U;
+      uint32_t lo = *sw++;
+
+      for (; len >= 4U; len -= 4U) {
+        uint32_t hi = *sw++;
+        *dw++ = MERGE(lo, hi, sh);
+        lo = hi;
+        s += 4;
+      }
+    }
+    d = (uint8_t *)dw;
+  }
+  while (len-- > 0U) {
+    *d++ = *s++;
+  }
+}
+
+/* From the end down, for a destination overlapping the source from above */
+RTEMS_LWIP_COPY_FN
+static void copy_backward(uint8_t *d, const uint8_t *s, size_t len)
+{
+  d += len;
+  s += len;
+  if ((len >= COPY_WORD_MIN) && ((((uintptr_t)d ^ (uintptr_t)s) & 3U) == 0U)) {
+    while (((uintptr_t)d & 3U) != 0U) {
+      *--d = *--s;
+      len--;
+    }
+    copy_word_t *dw = (copy_word_t *)d;
+    const copy_word_t *sw = (const copy_word_t *)s;
+
+    for (; len >= 4U; len -= 4U) {
+      *--dw = *--sw;
+    }
+    d = (uint8_t *)dw;
+    s = (const uint8_t *)sw;
+  }
+  while (len-- > 0U) {
+    *--d = *--s;
+  }
+}
+
+void *rtems_lwip_memcpy(void *dst, const void *src, size_t len)
+{
+  copy_forward((uint8_t *)dst, (const uint8_t *)src, len);
+  return dst;
+}
+
+void *rtems_lwip_memmove(void *dst, const void *src, size_t len)
+{
+  uint8_t *d = (uint8_t *)dst;
+  const uint8_t *s = (const uint8_t *)src;
+
+  /* Forward is safe unless the destination starts inside the source */
+  if ((d <= s) || (d >= s + len)) {
+    copy_forward(d, s, len);
+  } else {
+    copy_backward(d, s, len);
+  }
+  return dst;
+}
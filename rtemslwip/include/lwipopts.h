@@ -44,22 +44,18 @@
 #define LWIP_COMPAT_MUTEX 0
 #define LWIP_ALLOW_MEM_FREE_FROM_OTHER_CONTEXT 1
 
-/* Strictly byte-by-byte MEMCPY for STM32H7 to avoid all hardware traps.
- * Optimized memcpy can use ldrh/strh which fault on unaligned D2/D1 SRAM.
+/* Alignment-safe copies (rtemslwip/common/rtems_lwip_memcpy.c): word moves
+ * only on aligned addresses, so no unaligned LDRH/LDRD/LDM can fault on any
+ * core or memory type. MEMMOVE handles overlap in either direction.
  */
 #include <string.h>
 #include <stdint.h>
 #include <stddef.h>
-static inline void stm32h7_byte_memcpy(void *dst, const void *src, size_t len) {
-    uint8_t *d = (uint8_t *)dst;
-    const uint8_t *s = (const uint8_t *)src;
-    while (len--) {
-        *d++ = *s++;
-    }
-}
-#define MEMCPY(dst, src, len)  stm32h7_byte_memcpy(dst, src, len)
-#define SMEMCPY(dst, src, len) stm32h7_byte_memcpy(dst, src, len)
-#define MEMMOVE(dst, src, len) stm32h7_byte_memcpy(dst, src, len)
+void *rtems_lwip_memcpy(void *dst, const void *src, size_t len);
+void *rtems_lwip_memmove(void *dst, const void *src, size_t len);
+#define MEMCPY(dst, src, len)  rtems_lwip_memcpy(dst, src, len)
+#define SMEMCPY(dst, src, len) rtems_lwip_memcpy(dst, src, len)
+#define MEMMOVE(dst, src, len) rtems_lwip_memmove(dst, src, len)
 
 /* CRITICAL: Force 4-byte alignment to prevent unaligned access faults */
 #define MEM_ALIGNMENT 4
@@ -292,6 +288,10 @@ static inline void stm32h7_byte_memcpy(void *dst, const void *src, size_t len) {
 #define TCP_OVERSIZE TCP_MSS
 #endif
 
+#ifndef TCP_PCB_HASH
+#define TCP_PCB_HASH 1
+#endif
+
 #ifndef TCP_QUEUE_OOSEQ
 #define TCP_QUEUE_OOSEQ 1
 #endif
@@ -324,6 +324,10 @@ static inline void stm32h7_byte_memcpy(void *dst, const void *src, size_t len) {
 #define TCP_WND (8 * TCP_MSS)
 #endif
 
+#ifndef UDP_PCB_HASH
+#define UDP_PCB_HASH 1
+#endif
+
 #ifndef UDP_TTL
 #define UDP_TTL 255
 #endif
@@ -2,10 +2,91 @@
 #define __LWIPBSPOPTS_H__
 
 #define CHECKSUM_BY_HARDWARE 1
+/* Lets the STM32H7 driver turn off software checksums on its netif only */
+#define LWIP_CHECKSUM_CTRL_PER_NETIF 1
 #define ETH_RX_BUFFER_SIZE 1536
 #define MEM_SIZE (256 * 1024)
 #define PBUF_POOL_SIZE 64
 
+/* STM32H7 Ethernet ring and buffer sizing (D2 SRAM). The driver owns its
+ * descriptor rings, so these do not depend on the ETH_RX_DESC_CNT /
+ * ETH_TX_DESC_CNT compiled into the BSP's HAL. Each can be overridden from the
+ * command line (test/stm32h7_sim sweeps the ring depth). */
+#ifndef ETH_RX_RING_SIZE
+#define ETH_RX_RING_SIZE 64
+#endif
+#ifndef ETH_TX_RING_SIZE
+#define ETH_TX_RING_SIZE 32
+#endif
+#ifndef ETH_RX_BUFFER_CNT
+#define ETH_RX_BUFFER_CNT 96
+#endif
+/* One TX bounce slot per descriptor */
+#ifndef ETH_TX_BOUNCE_CNT
+#define ETH_TX_BOUNCE_CNT ETH_TX_RING_SIZE
+#endif
+/* Descriptor rings in a non-cacheable MPU region, no per-descriptor cache
+ * ops. Only run in the simulator so far, not on hardware: opt in. */
+#ifndef ETH_DESC_NONCACHEABLE
+#define ETH_DESC_NONCACHEABLE 0
+#endif
+/* Frames up to this size are copied so their RX buffer stays on the ring */
+#ifndef ETH_RX_COPYBREAK
+#define ETH_RX_COPYBREAK 256
+#endif
+/* TCP/UDP headers and payload in separate RX buffers, payload cache-line
+ * aligned. Off: it costs ETH_RX_RING_SIZE full-size header buffers of D2
+ * SRAM (96 KB for 64 descriptors) and copies every frame the MAC does not
+ * split. */
+#ifndef ETH_RX_SPLIT_HEADER
+#define ETH_RX_SPLIT_HEADER 0
+#endif
+/* RX descriptors harvested per pass, one DMA tail pointer write per batch */
+#ifndef ETH_RX_BATCH_SIZE
+#define ETH_RX_BATCH_SIZE 16
+#endif
+/* Adapt RX IOC spacing and the DMACRIWTR watchdog to the packet rate */
+#define ETH_RX_COALESCE_ADAPTIVE 1
+/* RX descriptors handled per poll pass before the RX thread yields */
+#define ETH_RX_POLL_BUDGET 64
+/* Multicast MAC addresses held in the perfect/hash filters before all-multicast */
+#define ETH_MAC_FILTER_CNT 16
+/* IEEE 1588 hardware timestamps in pbufs, reported through SO_TIMESTAMPING */
+#define ETH_PTP_ENABLE 1
+#define LWIP_PBUF_TIMESTAMP 1
+#define LWIP_SO_TIMESTAMPING 1
+/* tcp_output() hands runs of queued segments to the ETH DMA as one TSO frame */
+#define LWIP_TCP_TSO 1
+/* Send buffer deep enough for TSO frames of several segments */
+#define TCP_SND_BUF (16 * TCP_MSS)
+/* Payload references held by TSO frames, at most two per TX descriptor */
+#define MEMP_NUM_TCP_TSO_REF (2 * ETH_TX_RING_SIZE)
+/* 802.1Q tags inserted, stripped and filtered by the MAC (stm32h7_eth_set_vlan_filter) */
+#define ETHARP_SUPPORT_VLAN 1
+#define LWIP_VLAN_OFFLOAD 1
+/* Per-PCB outgoing tags (pcb_tci_set()) */
+#define LWIP_VLAN_PCP 1
+/* The MAC answers ARP for our address; etharp.c only learns from its own
+ * requests. Off: a peer that ARPs for us no longer lands in the ARP cache,
+ * so enable both together where that is acceptable. */
+#ifndef ETH_ARP_OFFLOAD
+#define ETH_ARP_OFFLOAD 0
+#endif
+#ifndef ETHARP_LEARN_SOLICITED_ONLY
+#define ETHARP_LEARN_SOLICITED_ONLY 0
+#endif
+#define LWIP_NETIF_EXT_STATUS_CALLBACK 1
+/* IPv4 whitelist in the MAC's L3/L4 filters (stm32h7_eth_add_l34_filter()),
+ * in the automatic mode rebuilt whenever a PCB is bound or closed */
+#define ETH_L34_FILTER 1
+#define LWIP_HOOK_FILENAME "stm32h7_lwip_hooks.h"
+#define LWIP_HOOK_PCB_CHANGED() stm32h7_eth_l34_refresh()
+/* Per-packet driver events into the binary trace ring (stm32h7_eth_trace.h),
+ * enabled for debugging */
+#ifndef ETH_TRACE_ENABLE
+#define ETH_TRACE_ENABLE 0
+#endif
+
 #define LWIP_DEBUG 1
 #define IP_DEBUG LWIP_DBG_ON
 #define ETHARP_DEBUG LWIP_DBG_ON
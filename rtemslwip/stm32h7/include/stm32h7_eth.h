@@ -41,5 +41,145 @@ void Error_Handler(void);
 
 /* USER CODE BEGIN 1 */
 
+/* Snapshot of the driver-owned RX/TX descriptor ring indices */
+typedef struct {
+  uint32_t rx_read_idx;     /* next RX descriptor the driver reads */
+  uint32_t rx_build_idx;    /* next RX descriptor the driver refills */
+  uint32_t rx_build_cnt;    /* RX descriptors handed to the DMA */
+  uint32_t tx_head;         /* next TX descriptor handed to the DMA */
+  uint32_t tx_tail;         /* oldest TX descriptor not yet reclaimed */
+  uint32_t tx_in_flight;    /* TX descriptors owned by the DMA */
+} stm32h7_eth_ring_state_t;
+
+void stm32h7_eth_get_ring_state(stm32h7_eth_ring_state_t *state);
+
+/* RX interrupt moderation currently programmed into the DMA */
+typedef struct {
+  uint32_t level;           /* index into the driver's moderation table */
+  uint32_t frames;          /* IOC is set on every n-th RX descriptor */
+  uint32_t rwt;             /* DMACRIWTR value, units of 256 HCLK cycles */
+  uint32_t rwt_us;          /* nominal watchdog delay in microseconds */
+  uint32_t rx_pps;          /* RX rate measured over the last period */
+} stm32h7_eth_rx_coalesce_t;
+
+void stm32h7_eth_get_rx_coalesce(stm32h7_eth_rx_coalesce_t *coal);
+
+/* Receive address filtering; NORMAL filters multicast on the IGMP/MLD groups */
+typedef enum {
+  STM32H7_ETH_RX_FILTER_NORMAL = 0,
+  STM32H7_ETH_RX_FILTER_ALLMULTI,
+  STM32H7_ETH_RX_FILTER_PROMISC
+} stm32h7_eth_rx_filter_mode_t;
+
+void stm32h7_eth_set_rx_filter_mode(stm32h7_eth_rx_filter_mode_t mode);
+
+/* VLAN tag filter (LWIP_VLAN_OFFLOAD): tagged frames are only received for
+ * these VLAN IDs, cnt 0 accepts every VLAN. Tags are always stripped. */
+err_t stm32h7_eth_set_vlan_filter(const uint16_t *vids, uint32_t cnt);
+
+/* L3/L4 receive filters (ETH_L34_FILTER): once one is set, the MAC drops
+ * every IPv4 packet that matches none of them, as well as IPv6 and other
+ * IP packets (ICMP, IGMP). Zero fields match anything; ports need a proto.
+ * Port filters also drop IPv4 fragments after the first.
+ * The automatic mode derives the filters from the bound UDP/TCP PCBs. It
+ * turns filtering off while the netif has an IPv6 address, an IGMP group
+ * or a raw PCB is in use, or the PCBs need more filters than the MAC has;
+ * rx_l34_filters in the statistics shows whether it is on. Applications
+ * that receive UDP datagrams over the MTU, or want ping answered, should
+ * leave it off. */
+#define STM32H7_ETH_L34_FILTER_CNT    2U
+
+typedef struct {
+  uint8_t proto;              /* IP_PROTO_UDP or IP_PROTO_TCP */
+  uint8_t src_prefix;         /* leading bits of src compared, 0: any source */
+  uint16_t src_port;
+  uint16_t dst_port;          /* our port */
+  ip4_addr_t src;
+} stm32h7_eth_l34_filter_t;
+
+err_t stm32h7_eth_add_l34_filter(const stm32h7_eth_l34_filter_t *filter);
+void stm32h7_eth_clear_l34_filters(void);
+void stm32h7_eth_set_l34_auto(int enable);
+
+/* PHY link state machine and its timing of the last link-up */
+typedef struct {
+  uint32_t state;             /* 0 down, 1 negotiating, 2 up */
+  uint32_t speed_mbps;        /* 10 or 100, 0 while not up */
+  uint32_t full_duplex;
+  uint32_t up_count;
+  uint32_t down_count;
+  uint32_t carrier_to_up_ms;  /* first PHY energy/link sign -> netif link up */
+  uint32_t up_to_first_rx_ms; /* netif link up -> first received frame */
+} stm32h7_eth_link_stats_t;
+
+void stm32h7_eth_get_link_stats(stm32h7_eth_link_stats_t *link);
+
+/* Driver and MAC statistics, a snapshot that never locks out the data path
+ * (stm32h7_eth_get_stats, takes the tcpip core lock) */
+typedef struct {
+  uint32_t irq;               /* ETH interrupts */
+  uint32_t rx_irq;            /* RX completion interrupts */
+  uint32_t tx_irq;            /* TX completion interrupts */
+  uint32_t rx_buf_unavail;    /* DMA RX buffer unavailable events */
+  uint32_t dma_error;         /* DMA error callbacks */
+  uint32_t irqs_per_kpkt;     /* interrupts per 1000 frames RX + TX */
+
+  uint32_t rx_packets;
+  uint32_t rx_polls;          /* RX thread wake-ups */
+  uint32_t rx_ring_size;
+  uint32_t rx_ring_hwm;       /* most descriptors harvested in one poll pass */
+  uint32_t rx_pool_empty;     /* RX_POOL allocation failures */
+  uint32_t rx_alloc_error;    /* RX_POOL currently exhausted */
+  uint32_t rx_pool_hwm;       /* RX_POOL buffers in use at peak (MEMP_STATS) */
+  uint32_t rx_copybreak;      /* frames delivered as a copy */
+  uint32_t rx_split;          /* frames whose headers the MAC split from the payload */
+  uint32_t rx_csum_drop;      /* frames dropped on a hardware checksum error */
+  uint32_t rx_fifo_overflow;  /* frames dropped by the MTL RX FIFO */
+  uint32_t rx_missed;         /* frames the DMA had no descriptor for */
+  uint32_t rx_vlan;           /* frames whose 802.1Q tag the MAC stripped */
+  uint32_t rx_arp_dropped;    /* ARP requests answered by the MAC or not for us */
+  uint32_t rx_l34_updates;    /* L3/L4 filter reprogrammings */
+  uint32_t rx_l34_overflow;   /* PCBs needed more L3/L4 filters than the MAC has */
+  uint32_t rx_l34_filters;    /* L3/L4 filters in force, 0: IP traffic not filtered */
+
+  uint32_t tx_packets;
+  uint32_t tx_timeouts;       /* frames dropped waiting for a descriptor */
+  uint32_t tx_bounced;        /* frames copied through a bounce slot */
+  uint32_t tx_ring_size;
+  uint32_t tx_ring_hwm;       /* most descriptors in flight */
+  uint32_t tx_bounce_size;
+  uint32_t tx_bounce_hwm;     /* most bounce slots in use */
+  uint32_t tx_tso;            /* TSO frames (counted once in tx_packets) */
+  uint32_t tx_tso_segs;       /* TCP segments the MAC cut them into */
+  uint32_t tx_vlan;           /* frames the MAC inserted an 802.1Q tag into */
+
+  uint32_t mmc_rx_unicast;    /* MAC MMC counters, since reset */
+  uint32_t mmc_rx_crc_error;
+  uint32_t mmc_rx_align_error;
+  uint32_t mmc_tx_packets;
+  uint32_t mmc_tx_single_col;
+  uint32_t mmc_tx_multi_col;
+} stm32h7_eth_stats_t;
+
+void stm32h7_eth_get_stats(stm32h7_eth_stats_t *st);
+
+/* IEEE 1588 system time of the MAC (ETH_PTP_ENABLE) */
+typedef struct {
+  uint32_t sec;
+  uint32_t nsec;
+} stm32h7_eth_ptp_time_t;
+
+/* Clock servo: returns the frequency correction in ppb for a measured
+ * offset (local minus master, in ns) taken `interval_ms` after the last */
+typedef int32_t (*stm32h7_eth_ptp_servo_fn)(int64_t offset_ns, uint32_t interval_ms);
+
+void stm32h7_eth_ptp_get_time(stm32h7_eth_ptp_time_t *ts);
+void stm32h7_eth_ptp_set_time(const stm32h7_eth_ptp_time_t *ts);
+void stm32h7_eth_ptp_adjust_time(int64_t offset_ns);
+void stm32h7_eth_ptp_adjust_freq(int32_t ppb);
+uint32_t stm32h7_eth_ptp_get_tx_timestamp(stm32h7_eth_ptp_time_t *ts);
+void stm32h7_eth_ptp_set_servo(stm32h7_eth_ptp_servo_fn servo);
+void stm32h7_eth_ptp_servo_sample(int64_t offset_ns, uint32_t interval_ms);
+
 /* USER CODE END 1 */
 #endif
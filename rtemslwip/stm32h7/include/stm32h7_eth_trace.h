@@ -0,0 +1,140 @@
+/**
+  ******************************************************************************
+  * @file    stm32h7_eth_trace.h
+  * @brief   Binary event trace for the STM32H7 Ethernet driver.
+  ******************************************************************************
+  * @attention
+  *
+  * An event is a compile-time ID, up to four 32-bit arguments and the DWT
+  * cycle counter, written into a RAM ring with no formatting and no lock.
+  * The cost is a few dozen cycles, so tracing can stay enabled at line rate.
+  * The ring is read back with stm32h7_eth_trace_dump() or a debugger memory
+  * dump of EthTraceRing and turned into text on the host with
+  * test/eth_trace_decode.py, which takes the format strings from the
+  * ETH_TRACE_EVENTS table below.
+  *
+  ******************************************************************************
+  */
+
+#ifndef STM32H7_ETH_TRACE_H
+#define STM32H7_ETH_TRACE_H
+
+#include <stdint.h>
+#include "lwip/opt.h"
+
+/* Record events into the trace ring */
+#ifndef ETH_TRACE_ENABLE
+#define ETH_TRACE_ENABLE              0
+#endif
+
+/* Records per CPU ring, a power of two; each record is 32 bytes */
+#ifndef ETH_TRACE_RING_SIZE
+#define ETH_TRACE_RING_SIZE           512U
+#endif
+
+/* One ring per CPU so writers on different CPUs never share a cache line */
+#ifndef ETH_TRACE_CPU_COUNT
+#define ETH_TRACE_CPU_COUNT           1U
+#endif
+
+#if (ETH_TRACE_RING_SIZE < 16) || ((ETH_TRACE_RING_SIZE & (ETH_TRACE_RING_SIZE - 1)) != 0)
+#error "ETH_TRACE_RING_SIZE must be a power of two and at least 16"
+#endif
+#if ETH_TRACE_CPU_COUNT < 1
+#error "ETH_TRACE_CPU_COUNT must be at least 1"
+#endif
+
+/* Event table: X(name, host-side format of the arguments).
+ * Append new events at the end; the ID is the position in this table and
+ * old dumps are decoded against the table they were recorded with. */
+#define ETH_TRACE_EVENTS(X) \
+  X(TX_START,        "TX: frame p=0x%08lx tot_len=%lu") \
+  X(TX_DESC,         "TX: desc %lu DESC2=0x%08lx DESC3=0x%08lx") \
+  X(TX_BOUNCE,       "TX: payload 0x%08lx not DMA reachable, bounced %lu bytes") \
+  X(TX_FLATTEN,      "TX: flattened %lu bytes into one slot") \
+  X(TX_RING_FULL,    "TX: ring full, %lu in flight, %lu bounce slots free") \
+  X(TX_TIMEOUT,      "TX: descriptor %lu timeout, frame dropped") \
+  X(TX_KICK,         "TX: tail=0x%08lx, %lu desc(s), in flight=%lu") \
+  X(TX_RECLAIM,      "TX: reclaimed desc %lu DESC3=0x%08lx") \
+  X(TX_FREE,         "TX: free callback buff=0x%08lx") \
+  X(RX_PKT,          "RX: desc %lu completes pbuf 0x%08lx len=%lu") \
+  X(RX_BATCH,        "RX: batch of %lu descriptors, %lu packets, RxDescIdx=%lu") \
+  X(RX_NONPKT,       "RX: non-packet descriptor DESC3=0x%08lx recycled") \
+  X(RX_TRUNC,        "RX: incomplete frame of %lu bytes dropped") \
+  X(RX_CSUM_ERR,     "RX: HW checksum error RDES1=0x%08lx") \
+  X(RX_POOL_EMPTY,   "RX: RX_POOL empty, desc %lu left for later") \
+  X(RX_REFILL,       "RX: desc %lu refilled addr=0x%08lx DESC3=0x%08lx") \
+  X(RX_REFILL_FAIL,  "RX: no buffer for desc %lu") \
+  X(RX_RECYCLE,      "RX: desc %lu reuses buffer 0x%08lx") \
+  X(RX_INPUT_ERR,    "RX: netif->input failed for pbuf 0x%08lx") \
+  X(RX_ALLOC,        "RX: allocated pbuf_custom 0x%08lx") \
+  X(RX_ALLOC_FAIL,   "RX: RX_POOL exhausted") \
+  X(RX_FREE,         "RX: pbuf 0x%08lx back to RX_POOL, alloc error was %lu") \
+  X(RX_COALESCE,     "RX: coalesce level %lu, IOC every %lu frames, RWT=%lu, %lu pps") \
+  X(IRQ_RBU,         "IRQ: receive buffer unavailable, DMACSR=0x%08lx") \
+  X(IRQ_DMA_ERROR,   "IRQ: DMA error 0x%08lx, DMACSR=0x%08lx, RxIdx=%lu") \
+  X(LINK_UP,         "LINK: up, %lu Mbps, full duplex %lu, %lu ms after carrier") \
+  X(LINK_DOWN,       "LINK: down") \
+  X(PHY_LINK,        "PHY: link detected, BSR=0x%04lx") \
+  X(PHY_LINK_DOWN,   "PHY: link down, BSR=0x%04lx ISFR=0x%04lx") \
+  X(PHY_AN_TIMEOUT,  "PHY: autonegotiation not done, forcing 100M full duplex")
+
+#define ETH_TRACE_ID(name, fmt) ETH_EV_##name,
+typedef enum {
+  ETH_TRACE_EVENTS(ETH_TRACE_ID)
+  ETH_EV_COUNT
+} stm32h7_eth_trace_event_t;
+#undef ETH_TRACE_ID
+
+/* One trace record. `seq` is written last: a record whose seq does not
+ * match its slot was being overwritten when the ring was read. */
+typedef struct {
+  uint32_t seq;               /* running record number on this CPU */
+  uint32_t cycles;            /* DWT CYCCNT when the event was recorded */
+  uint16_t id;                /* stm32h7_eth_trace_event_t */
+  uint8_t nargs;
+  uint8_t ctx;                /* IPSR: 0 thread, else the exception number */
+  uint32_t arg[4];
+  uint32_t reserved;
+} stm32h7_eth_trace_rec_t;
+
+/* Ring header, followed by the records; the layout is what the decoder reads */
+#define ETH_TRACE_MAGIC               0x45545452U   /* "ETTR" */
+
+typedef struct {
+  uint32_t magic;
+  uint32_t rec_size;
+  uint32_t ring_size;
+  uint32_t cpu_hz;            /* cycle counter frequency */
+  volatile uint32_t head;     /* records ever reserved on this CPU */
+  uint32_t reserved[3];
+  stm32h7_eth_trace_rec_t rec[ETH_TRACE_RING_SIZE];
+} stm32h7_eth_trace_ring_t;
+
+extern stm32h7_eth_trace_ring_t EthTraceRing[ETH_TRACE_CPU_COUNT];
+
+void stm32h7_eth_trace_init(void);
+void stm32h7_eth_trace_record(uint32_t id, uint32_t nargs,
+                              uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+void stm32h7_eth_trace_dump(void);
+
+#define ETH_TRACE_ARG(x)              ((uint32_t)(uintptr_t)(x))
+
+#if ETH_TRACE_ENABLE
+#define ETH_TRACE0(ev)                stm32h7_eth_trace_record(ETH_EV_##ev, 0, 0, 0, 0, 0)
+#define ETH_TRACE1(ev, a)             stm32h7_eth_trace_record(ETH_EV_##ev, 1, ETH_TRACE_ARG(a), 0, 0, 0)
+#define ETH_TRACE2(ev, a, b)          stm32h7_eth_trace_record(ETH_EV_##ev, 2, ETH_TRACE_ARG(a), \
+                                                               ETH_TRACE_ARG(b), 0, 0)
+#define ETH_TRACE3(ev, a, b, c)       stm32h7_eth_trace_record(ETH_EV_##ev, 3, ETH_TRACE_ARG(a), \
+                                                               ETH_TRACE_ARG(b), ETH_TRACE_ARG(c), 0)
+#define ETH_TRACE4(ev, a, b, c, d)    stm32h7_eth_trace_record(ETH_EV_##ev, 4, ETH_TRACE_ARG(a), \
+                                                               ETH_TRACE_ARG(b), ETH_TRACE_ARG(c), ETH_TRACE_ARG(d))
+#else
+#define ETH_TRACE0(ev)                do { } while (0)
+#define ETH_TRACE1(ev, a)             do { } while (0)
+#define ETH_TRACE2(ev, a, b)          do { } while (0)
+#define ETH_TRACE3(ev, a, b, c)       do { } while (0)
+#define ETH_TRACE4(ev, a, b, c, d)    do { } while (0)
+#endif
+
+#endif /* STM32H7_ETH_TRACE_H */
@@ -0,0 +1,31 @@
+/**
+  ******************************************************************************
+  * @file    stm32h7_lwip_hooks.h
+  * @brief   lwIP hooks of the STM32H7 Ethernet driver (LWIP_HOOK_FILENAME).
+  ******************************************************************************
+  * @attention
+  *
+  * Included by the lwIP core files that call hooks. The hook macros
+  * themselves are set in lwipbspopts.h, so every lwIP header sees them;
+  * this file only declares the driver functions they expand to.
+  *
+  ******************************************************************************
+  */
+
+#ifndef STM32H7_LWIP_HOOKS_H
+#define STM32H7_LWIP_HOOKS_H
+
+#include "lwip/opt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* LWIP_HOOK_PCB_CHANGED(): rebuild the automatic L3/L4 filters */
+void stm32h7_eth_l34_refresh(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STM32H7_LWIP_HOOKS_H */
@@ -220,8 +220,11 @@
 #define  USE_HAL_WWDG_REGISTER_CALLBACKS    0U /* WWDG register callback disabled    */
 
 /* ########################### Ethernet Configuration ######################### */
+/* These must match the values the BSP's precompiled HAL was built with, since
+ * they size ETH_HandleTypeDef. The STM32H7 driver owns its own rings; their
+ * depth is ETH_RX_RING_SIZE / ETH_TX_RING_SIZE in lwipbspopts.h. */
 #define ETH_TX_DESC_CNT         4  /* number of Ethernet Tx DMA descriptors */
-#define ETH_RX_DESC_CNT         16  /* number of Ethernet Rx DMA descriptors */
+#define ETH_RX_DESC_CNT         4  /* number of Ethernet Rx DMA descriptors */
 
 #define ETH_MAC_ADDR0    (0x02UL)
 #define ETH_MAC_ADDR1    (0x00UL)
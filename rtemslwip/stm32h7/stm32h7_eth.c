@@ -23,15 +23,22 @@
 #include <stm32h7xx_hal.h>
 #include "lwip/opt.h"
 #include "lwip/timeouts.h"
+#include "lwip/stats.h"
 #include "netif/ethernet.h"
 #include "netif/etharp.h"
 #include "lwip/ethip6.h"
 #include "stm32h7_eth.h"
 #include "stm32h7_lan8742.h"
+#include "stm32h7_eth_trace.h"
+#include "stm32h7_lwip_hooks.h"
 #include <string.h>
 #include <stddef.h>
 #include "lwip/sys.h"
 #include "lwip/tcpip.h"
+#include "lwip/udp.h"
+#include "lwip/raw.h"
+#include "lwip/igmp.h"
+#include "lwip/priv/tcp_priv.h"
 #include <rtems/irq-extension.h>
 #include "../test/stm32h7_test/trace_config.h"
 
@@ -63,7 +70,7 @@
 
 /* ETH Setting  */
 #define ETH_DMA_TRANSMIT_TIMEOUT               ( 20U )
-#define ETH_TX_BUFFER_MAX             ((ETH_TX_DESC_CNT) * 2U)
+#define ETH_TX_BUFFER_MAX             ((ETH_TX_RING_SIZE) * 2U)
 /* ETH_RX_BUFFER_SIZE parameter is defined in lwipopts.h */
 
 /* USER CODE BEGIN 1 */
@@ -79,14 +86,14 @@
           then passed to ETH HAL driver.
 
 @Notes:
-  1.a. ETH DMA Rx descriptors must be contiguous, the default count is 4,
-       to customize it please redefine ETH_RX_DESC_CNT in ETH GUI (Rx Descriptor Length)
-       so that updated value will be generated in stm32xxxx_hal_conf.h
-  1.b. ETH DMA Tx descriptors must be contiguous, the default count is 4,
-       to customize it please redefine ETH_TX_DESC_CNT in ETH GUI (Tx Descriptor Length)
-       so that updated value will be generated in stm32xxxx_hal_conf.h
-
-  2.a. Rx Buffers number must be between ETH_RX_DESC_CNT and 2*ETH_RX_DESC_CNT
+  1.a. ETH DMA Rx descriptors must be contiguous. The driver owns the ring, its
+       size is ETH_RX_RING_SIZE in lwipbspopts.h. ETH_RX_DESC_CNT in
+       stm32xxxx_hal_conf.h must stay at the value the BSP's HAL was built with.
+  1.b. ETH DMA Tx descriptors must be contiguous. The driver owns the ring, its
+       size is ETH_TX_RING_SIZE in lwipbspopts.h. ETH_TX_DESC_CNT in
+       stm32xxxx_hal_conf.h must stay at the value the BSP's HAL was built with.
+
+  2.a. Rx Buffers number (ETH_RX_BUFFER_CNT) must be at least ETH_RX_RING_SIZE
   2.b. Rx Buffers must have the same size: ETH_RX_BUFFER_SIZE, this value must
        passed to ETH DMA in the init field (heth.Init.RxBuffLen)
   2.c  The RX Ruffers addresses and sizes must be properly defined to be aligned
@@ -101,22 +108,201 @@ typedef enum
 } RxAllocStatusTypeDef;
 
 /* ETH_CODE: Ensure RxBuff_t is aligned to 32 bytes for DMA compatibility.
- * The struct includes pbuf_custom (16 bytes on ARM) + 32-byte aligned buffer.
+ * The struct includes pbuf_custom (16 bytes on ARM) + 32-byte aligned buffer,
+ * so the pbuf header never shares a cache line with DMA-written data.
  * Total size must be multiple of 32 for proper memory pool alignment. */
 typedef struct __attribute__((aligned(32)))
 {
   struct pbuf_custom pbuf_custom;
-  uint32_t align_placeholder; /* Forces 'buff' to start at a 4-byte boundary */
-  uint8_t buff[ETH_RX_BUFFER_SIZE];
+  uint8_t buff[(ETH_RX_BUFFER_SIZE + 31) & ~31] __attribute__((aligned(32)));
 } RxBuff_t;
 
-/* Memory Pool Manual Declaration (points to D2 SRAM) */
-#define ETH_RX_BUFFER_CNT             64U
-#define RX_POOL_BASE_ADDR             0x30000600
+/* ETH_CODE: Ring and pool sizes. The driver owns its descriptor rings, so
+ * these come from lwipbspopts.h and are independent of the ETH_RX_DESC_CNT /
+ * ETH_TX_DESC_CNT the BSP's precompiled HAL was built with. */
+#ifndef ETH_RX_RING_SIZE
+#define ETH_RX_RING_SIZE              64U
+#endif
+#ifndef ETH_TX_RING_SIZE
+#define ETH_TX_RING_SIZE              32U
+#endif
+#ifndef ETH_RX_BUFFER_CNT
+#define ETH_RX_BUFFER_CNT             (ETH_RX_RING_SIZE + (ETH_RX_RING_SIZE / 2U))
+#endif
+/* One TX bounce slot per descriptor: a frame never waits for a slot while
+ * the ring has room for it */
+#ifndef ETH_TX_BOUNCE_CNT
+#define ETH_TX_BOUNCE_CNT             ETH_TX_RING_SIZE
+#endif
+/* Multicast MAC addresses tracked for the perfect/hash RX filters */
+#ifndef ETH_MAC_FILTER_CNT
+#define ETH_MAC_FILTER_CNT            16U
+#endif
+/* VLAN IDs accepted by the VLAN tag filter (with LWIP_VLAN_OFFLOAD) */
+#ifndef ETH_VLAN_FILTER_CNT
+#define ETH_VLAN_FILTER_CNT           16U
+#endif
+/* Adaptive RX interrupt moderation and its rate sampling period */
+#ifndef ETH_RX_COALESCE_ADAPTIVE
+#define ETH_RX_COALESCE_ADAPTIVE      1
+#endif
+#ifndef ETH_RX_COALESCE_PERIOD_MS
+#define ETH_RX_COALESCE_PERIOD_MS     100U
+#endif
+/* NAPI-style polling: descriptors handled per poll pass before yielding,
+ * and ticks to sleep between passes (0 = yield to equal priority only) */
+#ifndef ETH_RX_POLL_BUDGET
+#define ETH_RX_POLL_BUDGET            64U
+#endif
+#ifndef ETH_RX_POLL_YIELD_TICKS
+#define ETH_RX_POLL_YIELD_TICKS       0U
+#endif
+/* Descriptors harvested per RX pass before the tail pointer is advanced */
+#ifndef ETH_RX_BATCH_SIZE
+#define ETH_RX_BATCH_SIZE             16U
+#endif
+/* Frames up to this length are copied into a PBUF_RAM pbuf and their RX
+ * buffer reused in place (0 = always zero-copy) */
+#ifndef ETH_RX_COPYBREAK
+#define ETH_RX_COPYBREAK              0
+#endif
+/* Split-header RX: the MAC writes TCP/UDP headers to buffer 1 and the
+ * payload to a cache-line-aligned RX_POOL buffer 2. Costs a full-size
+ * header buffer per RX descriptor in D2 SRAM (see ETH_RX_HDR_BUFFER_SIZE). */
+#ifndef ETH_RX_SPLIT_HEADER
+#define ETH_RX_SPLIT_HEADER           0
+#endif
+/* PHY link polling interval and how long to wait for autonegotiation
+ * before falling back to 100M full duplex */
+#ifndef ETH_LINK_POLL_MS
+#define ETH_LINK_POLL_MS              50U
+#endif
+#ifndef ETH_LINK_AUTONEG_TIMEOUT_MS
+#define ETH_LINK_AUTONEG_TIMEOUT_MS   3000U
+#endif
+/* Map the descriptor rings non-cacheable through the MPU so descriptor
+ * accesses need no D-cache maintenance (data buffers stay cacheable) */
+#ifndef ETH_DESC_NONCACHEABLE
+#define ETH_DESC_NONCACHEABLE         0
+#endif
+/* IEEE 1588 hardware timestamping; with ETH_PTP_RX_TIMESTAMP_ALL every
+ * received frame is stamped, otherwise only PTP event messages */
+#ifndef ETH_PTP_ENABLE
+#define ETH_PTP_ENABLE                0
+#endif
+#ifndef ETH_PTP_RX_TIMESTAMP_ALL
+#define ETH_PTP_RX_TIMESTAMP_ALL      1
+#endif
+/* PTP servo: offsets above this are stepped, below it slewed (max ppb) */
+#ifndef ETH_PTP_STEP_THRESHOLD_NS
+#define ETH_PTP_STEP_THRESHOLD_NS     1000000
+#endif
+#ifndef ETH_PTP_MAX_PPB
+#define ETH_PTP_MAX_PPB               500000
+#endif
+/* The MAC answers ARP requests for the netif's IPv4 address; ARP requests
+ * lwIP has no use for are dropped in the driver */
+#ifndef ETH_ARP_OFFLOAD
+#define ETH_ARP_OFFLOAD               0
+#endif
+/* IPv4 receive whitelist in the MAC's two L3/L4 filters, set by the
+ * application or derived from the bound UDP/TCP PCBs */
+#ifndef ETH_L34_FILTER
+#define ETH_L34_FILTER                0
+#endif
+
+/* HAL_ETH_Init() still clears ETH_RX_DESC_CNT/ETH_TX_DESC_CNT descriptors,
+ * and DMACRDRLR/DMACTDRLR hold at most 1024 entries. */
+#if (ETH_RX_RING_SIZE < ETH_RX_DESC_CNT) || (ETH_RX_RING_SIZE > 1024)
+#error "ETH_RX_RING_SIZE must be between ETH_RX_DESC_CNT and 1024"
+#endif
+#if (ETH_TX_RING_SIZE < ETH_TX_DESC_CNT) || (ETH_TX_RING_SIZE > 1024)
+#error "ETH_TX_RING_SIZE must be between ETH_TX_DESC_CNT and 1024"
+#endif
+#if (ETH_RX_BUFFER_SIZE - ETH_PAD_SIZE) < 64
+#error "ETH_RX_BUFFER_SIZE is too small for an RX DMA buffer"
+#endif
+#if ETH_RX_BUFFER_CNT < ETH_RX_RING_SIZE
+#error "ETH_RX_BUFFER_CNT must be at least ETH_RX_RING_SIZE"
+#endif
+#if (ETH_RX_BATCH_SIZE < 1) || (ETH_RX_BATCH_SIZE > ETH_RX_RING_SIZE)
+#error "ETH_RX_BATCH_SIZE must be between 1 and ETH_RX_RING_SIZE"
+#endif
+#if ETH_RX_POLL_BUDGET < 1
+#error "ETH_RX_POLL_BUDGET must be at least 1"
+#endif
+#if CHECKSUM_BY_HARDWARE && !LWIP_CHECKSUM_CTRL_PER_NETIF
+#error "CHECKSUM_BY_HARDWARE needs LWIP_CHECKSUM_CTRL_PER_NETIF to mark verified pbufs"
+#endif
+#if ETH_PTP_ENABLE && !LWIP_PBUF_TIMESTAMP
+#error "ETH_PTP_ENABLE needs LWIP_PBUF_TIMESTAMP to carry timestamps in pbufs"
+#endif
+#if ETH_ARP_OFFLOAD && !(LWIP_NETIF_EXT_STATUS_CALLBACK && ETHARP_LEARN_SOLICITED_ONLY)
+#error "ETH_ARP_OFFLOAD needs LWIP_NETIF_EXT_STATUS_CALLBACK and ETHARP_LEARN_SOLICITED_ONLY"
+#endif
+#if ETH_L34_FILTER && !(defined(LWIP_HOOK_PCB_CHANGED) && (LWIP_NETIF_EXT_STATUS_CALLBACK || !LWIP_IPV6))
+#error "ETH_L34_FILTER needs LWIP_HOOK_PCB_CHANGED() calling stm32h7_eth_l34_refresh(), and LWIP_NETIF_EXT_STATUS_CALLBACK with IPv6"
+#endif
 
-/* ETH_CODE: Define TX Bounce Buffer in D2 SRAM to ensure DMA accessibility */
-#define ETH_TX_BUFFER_ADDR            0x30020000
+/* ETH_CODE: D2 SRAM layout, everything back to back from 0x30000000:
+ *   RX descriptors | TX descriptors | RX buffer pool | TX bounce pool */
+#define ETH_D2_ALIGN32(addr)          (((addr) + 31U) & ~31U)
+#define ETH_DMA_DESC_SIZE             16U
+#define ETH_RX_DESC_ADDR              0x30000000U
+#define ETH_TX_DESC_ADDR              (ETH_RX_DESC_ADDR + (ETH_RX_RING_SIZE * ETH_DMA_DESC_SIZE))
+#define ETH_DESC_END_ADDR             (ETH_TX_DESC_ADDR + (ETH_TX_RING_SIZE * ETH_DMA_DESC_SIZE))
+#if ETH_DESC_NONCACHEABLE
+/* MPU regions are a power of two in size and aligned to it: round the two
+ * rings up to one and keep the RX pool (cacheable) out of it. */
+#define ETH_DESC_BYTES                (ETH_DESC_END_ADDR - ETH_RX_DESC_ADDR)
+#define ETH_DESC_REGION_SIZE          ((ETH_DESC_BYTES <=   256U) ?   256U : \
+                                       (ETH_DESC_BYTES <=   512U) ?   512U : \
+                                       (ETH_DESC_BYTES <=  1024U) ?  1024U : \
+                                       (ETH_DESC_BYTES <=  2048U) ?  2048U : \
+                                       (ETH_DESC_BYTES <=  4096U) ?  4096U : \
+                                       (ETH_DESC_BYTES <=  8192U) ?  8192U : \
+                                       (ETH_DESC_BYTES <= 16384U) ? 16384U : 32768U)
+#define RX_POOL_BASE_ADDR             (ETH_RX_DESC_ADDR + ETH_DESC_REGION_SIZE)
+#else
+#define RX_POOL_BASE_ADDR             ETH_D2_ALIGN32(ETH_DESC_END_ADDR)
+#endif
+#define RX_POOL_SIZE                  (ETH_RX_BUFFER_CNT * LWIP_MEM_ALIGN_SIZE(sizeof(RxBuff_t)))
+
+/* ETH_CODE: Define the TX Bounce Pool in D2 SRAM to ensure DMA accessibility.
+ * Data the DMA cannot reference in place (pbufs in DTCM, over-long chains) is
+ * staged in a 1536-byte slot taken from this pool. A slot is attached to the
+ * descriptor that uses it and returned when that descriptor is reclaimed, so
+ * several frames can be staged and in flight at once. */
+#define ETH_TX_BUFFER_ADDR            ETH_D2_ALIGN32(RX_POOL_BASE_ADDR + RX_POOL_SIZE)
 #define ETH_TX_BUFFER_MAX_SIZE        1536
+#define ETH_TX_BOUNCE_SLOT(slot)      ((uint8_t *)ETH_TX_BUFFER_ADDR + ((slot) * ETH_TX_BUFFER_MAX_SIZE))
+#define ETH_TX_NO_SLOT                0xFFFFU
+
+#if (ETH_TX_BOUNCE_CNT < 1) || (ETH_TX_BOUNCE_CNT >= ETH_TX_NO_SLOT)
+#error "ETH_TX_BOUNCE_CNT must be between 1 and 0xFFFE"
+#endif
+#if (ETH_TX_BUFFER_MAX_SIZE % 32) != 0
+#error "TX bounce slots must be a multiple of the 32-byte cache line"
+#endif
+
+/* ETH_CODE: Split-header RX buffers in D2 SRAM. Buffer 1 of each RX
+ * descriptor is its own fixed buffer here and never leaves the ring: the
+ * MAC writes the headers of a split frame into it, or the start of a frame
+ * it did not split. The DMA has one buffer size (DMACRCR RBSZ) for both
+ * buffers and fills buffer 1 of an unsplit frame before buffer 2, so a
+ * header buffer cannot be cut down to HDSMS: each takes ETH_RX_BUFFER_SIZE
+ * bytes of D2 SRAM. The driver copies buffer 1 out; the payload in buffer 2
+ * is passed up zero-copy. */
+#if ETH_RX_SPLIT_HEADER
+#define ETH_RX_HDR_BUFFER_ADDR        ETH_D2_ALIGN32(ETH_TX_BUFFER_ADDR + (ETH_TX_BOUNCE_CNT * ETH_TX_BUFFER_MAX_SIZE))
+#define ETH_RX_HDR_BUFFER_SIZE        ((ETH_RX_BUFFER_SIZE + 31U) & ~31U)
+#define ETH_RX_HDR_BUFFER(idx)        (ETH_RX_HDR_BUFFER_ADDR + ((idx) * ETH_RX_HDR_BUFFER_SIZE))
+#define ETH_D2_END_ADDR               (ETH_RX_HDR_BUFFER_ADDR + (ETH_RX_RING_SIZE * ETH_RX_HDR_BUFFER_SIZE))
+#else
+#define ETH_D2_END_ADDR               (ETH_TX_BUFFER_ADDR + (ETH_TX_BOUNCE_CNT * ETH_TX_BUFFER_MAX_SIZE))
+#endif
+_Static_assert(ETH_D2_END_ADDR <= 0x30048000U,
+               "Ethernet rings and pools do not fit in D2 SRAM");
 
 #if MEMP_STATS
 static struct stats_mem memp_stats_RX_POOL;
@@ -147,19 +333,183 @@ typedef struct __attribute__((packed))
   __IO uint32_t DESC3;
 } ETH_DMADescTypeDef_Shadow;
 
+/* ETH_CODE: D-cache maintenance for descriptors. With ETH_DESC_NONCACHEABLE
+ * the rings live in an MPU region the CPU does not cache, so reads see what
+ * the DMA wrote and writes go straight to SRAM; only the barrier is kept to
+ * order descriptor writes before the tail pointer / poll demand write. */
+#if ETH_DESC_NONCACHEABLE
+#define ETH_DESC_CACHE_INVALIDATE(addr, size)  do { (void)(addr); (void)(size); } while (0)
+#define ETH_DESC_CACHE_CLEAN(addr, size)       __DMB()
+#else
+#define ETH_DESC_CACHE_INVALIDATE(addr, size)  SCB_InvalidateDCache_by_Addr((uint32_t *)(addr), (int32_t)(size))
+#define ETH_DESC_CACHE_CLEAN(addr, size)       SCB_CleanDCache_by_Addr((uint32_t *)(addr), (int32_t)(size))
+#endif
+
 /* Separate array to store backup buffer addresses (DMA overwrites DESC0 on completion) */
-static uint32_t DMARxDscrBackup[ETH_RX_DESC_CNT];
-static uint32_t DMATxDscrBackup[ETH_TX_DESC_CNT] __attribute__((unused));
+static uint32_t DMARxDscrBackup[ETH_RX_RING_SIZE];
+static uint32_t DMATxDscrBackup[ETH_TX_RING_SIZE];
+#if ETH_RX_SPLIT_HEADER
+/* Buffer 2 (RDES2) of each RX descriptor, an RX_POOL data area; buffer 1
+ * (DMARxDscrBackup) is the descriptor's header buffer */
+static uint32_t DMARxDscrBackup2[ETH_RX_RING_SIZE];
+#define ETH_RX_DESC_EMPTY(idx)        (DMARxDscrBackup2[idx] == 0)
+#else
+#define ETH_RX_DESC_EMPTY(idx)        (DMARxDscrBackup[idx] == 0)
+#endif
+
+/* ETH_CODE: RX ring state, owned by the driver rather than heth.RxDescList
+ * (whose layout is fixed by the precompiled HAL's ETH_RX_DESC_CNT).
+ * RxDescIdx is the next descriptor to read, RxBuildDescIdx the next one to
+ * refill and RxBuildDescCnt the number of descriptors handed to the DMA. */
+static uint32_t RxDescIdx = 0;
+static uint32_t RxBuildDescIdx = 0;
+static uint32_t RxBuildDescCnt = 0;
+
+/* ETH_CODE: TX ring state, owned by the driver rather than heth.TxDescList.
+ * TxDescHead is the next descriptor handed to the DMA, TxDescTail the oldest
+ * one not yet reclaimed. One slot is always left empty so the tail pointer
+ * (DMACTDTPR) never lands on a descriptor the DMA has not processed yet. */
+static uint32_t TxDescHead = 0;
+static uint32_t TxDescTail = 0;
+static uint32_t TxDescInFlight = 0;
+#define ETH_TX_RING_USABLE            ((ETH_TX_RING_SIZE) - 1U)
+
+/* pbuf referenced by a zero-copy frame, stored on the frame's last descriptor
+ * and released through HAL_ETH_TxFreeCallback() once the DMA is done. */
+static struct pbuf *TxPbufTab[ETH_TX_RING_SIZE];
+
+/* Bounce slot attached to each descriptor (ETH_TX_NO_SLOT if none), and the
+ * stack of free slot numbers. */
+static uint16_t TxDescSlot[ETH_TX_RING_SIZE];
+static uint16_t TxBounceFree[ETH_TX_BOUNCE_CNT];
+static uint32_t TxBounceFreeCnt = 0;
+
+#if LWIP_TCP_TSO
+/* ETH_CODE: TCP segmentation offload. A TSO frame carries at most what fits
+ * the 16-bit IP length lwIP writes into its header. The DMA keeps the MSS of
+ * the last context descriptor, so one is queued only when the MSS changes
+ * or the TX DMA has been reset (TxTsoMss 0). */
+#define ETH_TSO_MAX_SIZE              0xFF00U
+#define ETH_TX_DESC_BUF_MAX           0x3FFFU /* B1L/B2L are 14 bits */
+static uint32_t TxTsoMss = 0;
+#endif /* LWIP_TCP_TSO */
+
+/* ETH_CODE: 802.1Q tag insertion. MACVIR VLTI lets TDES2 VTIR choose per
+ * frame whether the tag of the last context descriptor (VLTV) is inserted,
+ * so a context descriptor is queued only when the tag changes.
+ * ETH_VLAN_TAG_NONE: untagged frame, or no tag loaded since the TX DMA was
+ * reset. */
+#define ETH_VLAN_TAG_NONE             0xFFFFFFFFU
+#if LWIP_VLAN_OFFLOAD
+static uint32_t TxVlanTag = ETH_VLAN_TAG_NONE;
+#endif /* LWIP_VLAN_OFFLOAD */
+
+/* ETH_CODE: Memory the Ethernet DMA (AHB master in D2) can read from.
+ * DTCM/ITCM are CPU-private, so pbufs living there must be bounce copied. */
+#define ETH_DMA_D1_SRAM_START         0x24000000U
+#define ETH_DMA_D1_SRAM_END           0x24080000U /* AXI SRAM, 512 KB */
+#define ETH_DMA_D2_SRAM_START         0x30000000U
+#define ETH_DMA_D2_SRAM_END           0x30048000U /* SRAM1-3, 288 KB */
 
 __IO uint32_t TxPkt = 0;
 __IO uint32_t RxPkt = 0;
 
-ETH_DMADescTypeDef_Shadow *DMARxDscrTab = (ETH_DMADescTypeDef_Shadow *)0x30000000; /* Ethernet Rx DMA Descriptors */
-ETH_DMADescTypeDef_Shadow *DMATxDscrTab = (ETH_DMADescTypeDef_Shadow *)0x30000400; /* Ethernet Tx DMA Descriptors (move away to avoid overlap) */
+ETH_DMADescTypeDef_Shadow *DMARxDscrTab = (ETH_DMADescTypeDef_Shadow *)ETH_RX_DESC_ADDR; /* Ethernet Rx DMA Descriptors */
+ETH_DMADescTypeDef_Shadow *DMATxDscrTab = (ETH_DMADescTypeDef_Shadow *)ETH_TX_DESC_ADDR; /* Ethernet Tx DMA Descriptors (right after the Rx ring) */
 
 __IO uint32_t EthIrqCount = 0;
 __IO uint32_t RxIrqCount = 0;
 
+/* ETH_CODE: Driver statistics.
+ * Counters are grouped by the one context that writes them: the ETH
+ * interrupt, the RX thread, the TX path and the control path (link
+ * restarts, L3/L4 filter updates). The last two run under the tcpip core
+ * lock, which serializes their writers; a counter that more than one
+ * context bumps is split, one copy per group, and summed by the reader.
+ * Each group has its own sequence counter, odd while an update is in
+ * progress, so stm32h7_eth_get_stats() copies a consistent snapshot of a
+ * group without any lock by retrying when the sequence moved under it. */
+typedef struct {
+  uint32_t irq;
+  uint32_t rx_irq;
+  uint32_t tx_irq;
+  uint32_t rbu;
+  uint32_t dma_error;
+} EthIsrStats_t;
+
+typedef struct {
+  uint32_t packets;
+  uint32_t polls;             /* RX thread wake-ups */
+  uint32_t ring_hwm;          /* most descriptors harvested in one poll pass */
+  uint32_t pool_empty;        /* RX_POOL allocation failures */
+  uint32_t copybreak;         /* frames delivered as a copy */
+  uint32_t split;             /* frames whose headers the MAC split off */
+  uint32_t csum_drop;         /* frames dropped on a hardware checksum error */
+  uint32_t fifo_overflow;     /* MTLRQMPOCR OVFPKTCNT */
+  uint32_t missed;            /* MTLRQMPOCR MISPKTCNT */
+  uint32_t vlan;              /* frames whose tag the MAC stripped */
+  uint32_t arp_dropped;       /* ARP requests not passed to lwIP */
+} EthRxStats_t;
+
+typedef struct {
+  uint32_t packets;
+  uint32_t timeouts;          /* frames dropped waiting for a free descriptor */
+  uint32_t bounced;           /* frames that needed a bounce slot */
+  uint32_t ring_hwm;          /* most descriptors in flight */
+  uint32_t bounce_hwm;        /* most bounce slots in use */
+  uint32_t tso;               /* TSO frames */
+  uint32_t tso_segs;          /* TCP segments the MAC cut them into */
+  uint32_t vlan;              /* frames tagged by the MAC */
+} EthTxStats_t;
+
+typedef struct {
+  uint32_t pool_empty;        /* RX_POOL allocation failures refilling the ring at link up */
+  uint32_t l34_updates;       /* L3/L4 filter reprogrammings */
+  uint32_t l34_overflow;      /* automatic mode needed more than two filters */
+} EthCtlStats_t;
+
+enum {
+  ETH_STATS_ISR = 0,
+  ETH_STATS_RX,
+  ETH_STATS_TX,
+  ETH_STATS_CTL,
+  ETH_STATS_GROUPS
+};
+
+static volatile uint32_t EthStatsSeq[ETH_STATS_GROUPS];
+static EthIsrStats_t EthIsrStats;
+static EthRxStats_t EthRxStats;
+static EthTxStats_t EthTxStats;
+static EthCtlStats_t EthCtlStats;
+
+#define ETH_STATS_BEGIN(group)  do { EthStatsSeq[group]++; __DMB(); } while (0)
+#define ETH_STATS_END(group)    do { __DMB(); EthStatsSeq[group]++; } while (0)
+
+/* ETH_CODE: Link state machine.
+ * The Nucleo board strap uses the LAN8742 nINT pin as REFCLKO, so the PHY
+ * interrupt cannot reach the MCU. ethernet_link_thread() polls instead every
+ * ETH_LINK_POLL_MS. It reads the latched ISFR flags (ENERGYON, link down,
+ * autonegotiation complete), so short events between two polls are not lost.
+ * DOWN -> NEGOTIATING when the PHY reports link, NEGOTIATING -> UP once the
+ * resolved speed/duplex is known (or ETH_LINK_AUTONEG_TIMEOUT_MS passed),
+ * at which point the MAC is reprogrammed and the rings restarted. */
+typedef enum {
+  ETH_LINK_STATE_DOWN = 0,
+  ETH_LINK_STATE_NEGOTIATING,
+  ETH_LINK_STATE_UP
+} EthLinkState_t;
+
+static EthLinkState_t LinkState = ETH_LINK_STATE_DOWN;
+static uint32_t LinkSpeed;           /* ETH_SPEED_10M / ETH_SPEED_100M */
+static uint32_t LinkDuplex;          /* ETH_FULLDUPLEX_MODE / ETH_HALFDUPLEX_MODE */
+static uint32_t LinkUpCount;
+static uint32_t LinkDownCount;
+static uint32_t LinkCarrierTick;     /* first sign of a partner, 0 = none */
+static uint32_t LinkUpTick;
+static uint32_t LinkCarrierToUpMs;
+static uint32_t LinkUpToFirstRxMs;
+static volatile uint8_t LinkFirstRxPending;
+
 /* USER CODE END 2 */
 
 sys_sem_t RxPktSemaphore;   /* Semaphore to signal incoming packets */
@@ -190,22 +540,27 @@ lan8742_IOCtx_t  LAN8742_IOCtx = {ETH_PHY_IO_Init,
 
 /* Private functions ---------------------------------------------------------*/
 void pbuf_free_custom(struct pbuf *p);
-static void ethernetif_rebuild_rx_descriptors(void);
-static void stm32h7_recycle_rx_descriptor(uint32_t idx);
+static uint8_t stm32h7_recycle_rx_descriptor(uint32_t idx);
+static void stm32h7_eth_reclaim_tx(void);
+static void stm32h7_eth_reset_tx_ring(void);
+static void stm32h7_eth_tx_bounce_init(void);
+static void stm32h7_eth_reset_rx_ring(void);
+static uint8_t *stm32h7_eth_rx_buffer_alloc_ctl(void);
+static void stm32h7_eth_stop(void);
 
 /* Helper to kick the RX DMA tail pointer correctly for a ring */
 static void stm32h7_eth_kick_rx_dma(void)
 {
     // printf("\n========== KICK_RX_DMA ==========\n");
     // printf("KICK: Setting DMACRDTPR to 0x%08lx (last desc)\n",
-    //        (unsigned long)&DMARxDscrTab[ETH_RX_DESC_CNT - 1]);
+    //        (unsigned long)&DMARxDscrTab[ETH_RX_RING_SIZE - 1]);
     
     /* ETH_CODE: FIX - The tail pointer must point AFTER the last descriptor.
      * In Ring mode, the DMA processes descriptors up to (but not including)
      * the address in the Tail Pointer. Pointing to the last descriptor (N-1)
      * causes the DMA to stop before processing it.
      */
-    heth.Instance->DMACRDTPR = (uint32_t)(DMARxDscrTab + ETH_RX_DESC_CNT);
+    heth.Instance->DMACRDTPR = (uint32_t)(DMARxDscrTab + ETH_RX_RING_SIZE);
     __DSB();
     
     /* Write Poll Demand to force immediate re-fetch of descriptors */
@@ -214,15 +569,139 @@ static void stm32h7_eth_kick_rx_dma(void)
     // printf("KICK: Poll demand written, DMACRDTPR now 0x%08lx\n",
     //        (unsigned long)heth.Instance->DMACRDTPR);
     // printf("KICK: RxDescIdx=%lu, RxBuildDescIdx=%lu, RxBuildDescCnt=%lu\n",
-    //        (unsigned long)heth.RxDescList.RxDescIdx,
-    //        (unsigned long)heth.RxDescList.RxBuildDescIdx,
-    //        (unsigned long)heth.RxDescList.RxBuildDescCnt);
+    //        (unsigned long)RxDescIdx,
+    //        (unsigned long)RxBuildDescIdx,
+    //        (unsigned long)RxBuildDescCnt);
     // printf("========== KICK_RX_DMA END ==========\n\n");
 }
 
+/* ETH_CODE: Adaptive RX interrupt moderation.
+ * Only every `frames`-th RX descriptor is armed with IOC; frames landing in
+ * the other descriptors raise RI when the RX interrupt watchdog (DMACRIWTR,
+ * counted in units of 256 HCLK cycles) expires. The level is re-evaluated
+ * from the measured packet rate every ETH_RX_COALESCE_PERIOD_MS: an idle
+ * link interrupts on every frame, a busy one takes one IRQ per batch. */
+typedef struct {
+  uint32_t min_pps;     /* rate at which this level is entered */
+  uint16_t frames;      /* IOC on every n-th RX descriptor */
+  uint16_t rwt_us;      /* watchdog delay for the unarmed descriptors */
+} RxCoalesceLevel_t;
+
+static const RxCoalesceLevel_t RxCoalesceTab[] = {
+  {     0U,  1U,   0U },
+  {  4000U,  4U,  20U },
+  { 16000U, 16U,  60U },
+  { 48000U, 32U, 150U },
+};
+#define RX_COALESCE_LEVELS  (sizeof(RxCoalesceTab) / sizeof(RxCoalesceTab[0]))
+
+/* Frame being assembled from several RX descriptors (FD ... LD) */
+static struct pbuf *RxChainHead;
+static struct pbuf *RxChainTail;
+static uint32_t RxChainLen;
+#if ETH_PTP_ENABLE
+/* Completed frame whose timestamp follows in the next (context) descriptor */
+static uint8_t RxChainTsPending;
+#endif
+
+static uint32_t RxCoalesceLevel;
+static uint32_t RxCoalesceFrames = 1U;
+static uint32_t RxCoalesceRwt = 1U;
+static uint32_t RxCoalescePps;
+static uint32_t RxCoalescePkts;
+static uint32_t RxCoalesceWindowStart;
+
+/* DESC3 read format for a descriptor handed (back) to the RX DMA */
+static inline uint32_t stm32h7_eth_rx_desc3(uint32_t idx)
+{
+  uint32_t desc3 = 0x80000000 | 0x01000000;     /* OWN + BUF1V */
+#if ETH_RX_SPLIT_HEADER
+  desc3 |= 0x02000000;                          /* BUF2V */
+#endif
+  if (((idx + 1U) % RxCoalesceFrames) == 0U) {
+    desc3 |= 0x40000000;                        /* IOC */
+  }
+  return desc3;
+}
+
+/* Write descriptor idx back in read format with the buffers it owns */
+static inline void stm32h7_eth_rx_desc_fill(ETH_DMADescTypeDef_Shadow *d, uint32_t idx)
+{
+  d->DESC0 = DMARxDscrBackup[idx];
+  d->DESC1 = 0;
+#if ETH_RX_SPLIT_HEADER
+  d->DESC2 = DMARxDscrBackup2[idx];             /* BUF2AP */
+#else
+  d->DESC2 = (heth.Init.RxBuffLen & 0x3FFF);
+#endif
+  d->DESC3 = stm32h7_eth_rx_desc3(idx);
+}
+
+/* Switch to a moderation level and program the RX watchdog accordingly.
+ * The watchdog is never disabled: descriptors refilled under a higher level
+ * may still be unarmed and rely on it to raise RI. */
+static void stm32h7_eth_rx_coalesce_apply(uint32_t level)
+{
+  uint32_t hclk_mhz = HAL_RCC_GetHCLKFreq() / 1000000U;
+  uint32_t rwt = (RxCoalesceTab[level].rwt_us * hclk_mhz + 255U) / 256U;
+
+  if (rwt < 1U) {
+    rwt = 1U;
+  } else if (rwt > 0xFFU) {
+    rwt = 0xFFU;
+  }
+
+  RxCoalesceLevel = level;
+  RxCoalesceFrames = RxCoalesceTab[level].frames;
+  if (RxCoalesceFrames > ETH_RX_RING_SIZE) {
+    RxCoalesceFrames = ETH_RX_RING_SIZE;
+  }
+  RxCoalesceRwt = rwt;
+  heth.Instance->DMACRIWTR = rwt;
+
+  ETH_TRACE4(RX_COALESCE, level, RxCoalesceFrames, rwt, RxCoalescePps);
+}
+
+/* Account for `pkts` received frames and adapt the moderation level once
+ * per sampling period. Runs in the RX thread only. */
+static void stm32h7_eth_rx_coalesce_update(uint32_t pkts)
+{
+#if ETH_RX_COALESCE_ADAPTIVE
+  uint32_t now = sys_now();
+  uint32_t elapsed = now - RxCoalesceWindowStart;
+  uint32_t level = RxCoalesceLevel;
+
+  RxCoalescePkts += pkts;
+  if (elapsed < ETH_RX_COALESCE_PERIOD_MS) {
+    return;
+  }
+
+  RxCoalescePps = (uint32_t)(((uint64_t)RxCoalescePkts * 1000U) / elapsed);
+  RxCoalescePkts = 0;
+  RxCoalesceWindowStart = now;
+
+  /* Step up as soon as the next threshold is reached, step down only once
+   * the rate falls below half of the current one (hysteresis). */
+  while ((level + 1U < RX_COALESCE_LEVELS) && (RxCoalescePps >= RxCoalesceTab[level + 1U].min_pps)) {
+    level++;
+  }
+  while ((level > 0U) && (RxCoalescePps < RxCoalesceTab[level].min_pps / 2U)) {
+    level--;
+  }
+  if (level != RxCoalesceLevel) {
+    stm32h7_eth_rx_coalesce_apply(level);
+  }
+#else
+  (void)pkts;
+#endif
+}
+
 static void stm32h7_eth_interrupt_handler(void *arg)
 {
   EthIrqCount++;
+  ETH_STATS_BEGIN(ETH_STATS_ISR);
+  EthIsrStats.irq++;
+  ETH_STATS_END(ETH_STATS_ISR);
   // printf("\n========== ETH IRQ START ==========\n");
   // printf("ETH IRQ: EthIrqCount=%lu\n", (unsigned long)EthIrqCount);
   
@@ -234,13 +713,13 @@ static void stm32h7_eth_interrupt_handler(void *arg)
   
   /* Dump descriptor indices */
   // printf("ETH IRQ: RxDescIdx=%lu, RxBuildDescIdx=%lu, RxBuildDescCnt=%lu\n",
-  //        (unsigned long)heth.RxDescList.RxDescIdx,
-  //        (unsigned long)heth.RxDescList.RxBuildDescIdx,
-  //        (unsigned long)heth.RxDescList.RxBuildDescCnt);
+  //        (unsigned long)RxDescIdx,
+  //        (unsigned long)RxBuildDescIdx,
+  //        (unsigned long)RxBuildDescCnt);
   
   /* Dump all RX descriptors */
   // printf("ETH IRQ: RX Descriptors state:\n");
-  // for(int i=0; i<ETH_RX_DESC_CNT; i++) {
+  // for(int i=0; i<ETH_RX_RING_SIZE; i++) {
   //   ETH_DMADescTypeDef_Shadow *d = &DMARxDscrTab[i];
   //   printf("  Desc[%d]: DESC0=0x%08lx, DESC1=0x%08lx, DESC2=0x%08lx, DESC3=0x%08lx\n", i,
   //          (unsigned long)d->DESC0, (unsigned long)d->DESC1,
@@ -250,7 +729,7 @@ static void stm32h7_eth_interrupt_handler(void *arg)
   /* Dump DMA tail pointer */
   // printf("ETH IRQ: DMACRDTPR=0x%08lx (should be 0x%08lx)\n",
   //        (unsigned long)heth.Instance->DMACRDTPR,
-  //        (unsigned long)&DMARxDscrTab[ETH_RX_DESC_CNT - 1]);
+  //        (unsigned long)&DMARxDscrTab[ETH_RX_RING_SIZE - 1]);
   
   HAL_ETH_IRQHandler(&heth);
    
@@ -261,15 +740,18 @@ static void stm32h7_eth_interrupt_handler(void *arg)
   
   if (dmacsr & ETH_DMACSR_RBU) {
       /* RBU bit is sticky. Clear it manually to allow the DMA to resume. */
-      TRACE_PRINTF("ETH IRQ: RBU detected! Clearing and resuming DMA...\n");
+      ETH_TRACE1(IRQ_RBU, dmacsr);
+      ETH_STATS_BEGIN(ETH_STATS_ISR);
+      EthIsrStats.rbu++;
+      ETH_STATS_END(ETH_STATS_ISR);
       heth.Instance->DMACSR = (ETH_DMACSR_RBU | ETH_DMACSR_AIS);
       stm32h7_eth_kick_rx_dma();
-      TRACE_PRINTF("ETH IRQ: RBU Cleared & DMA Resumed\n");
-  }
   
-  /* Signal RX semaphore to process any received packets */
-  // printf("ETH IRQ: Signaling RxPktSemaphore\n");
-  sys_sem_signal(&RxPktSemaphore);
+      /* The RX thread has to drain the ring before the DMA can make progress */
+      sys_sem_signal(&RxPktSemaphore);
+  }
+  /* ETH_CODE: Normal RX completions are signalled once, from
+   * HAL_ETH_RxCpltCallback(); TX-only interrupts no longer wake the RX thread. */
   // printf("========== ETH IRQ END ==========\n\n");
 }
 
@@ -281,20 +763,26 @@ static void stm32h7_eth_interrupt_handler(void *arg)
 void HAL_ETH_RxCpltCallback(ETH_HandleTypeDef *handlerEth)
 {
   RxIrqCount++;
+  ETH_STATS_BEGIN(ETH_STATS_ISR);
+  EthIsrStats.rx_irq++;
+  ETH_STATS_END(ETH_STATS_ISR);
   // printf("\n========== ETH RX COMPLETE CALLBACK ==========\n");
   // printf("ETH RX Callback: RxIrqCount=%lu\n", (unsigned long)RxIrqCount);
   // printf("ETH RX Callback: RxDescIdx=%lu, RxBuildDescIdx=%lu, RxBuildDescCnt=%lu\n",
-  //        (unsigned long)handlerEth->RxDescList.RxDescIdx,
-  //        (unsigned long)handlerEth->RxDescList.RxBuildDescIdx,
-  //        (unsigned long)handlerEth->RxDescList.RxBuildDescCnt);
+  //        (unsigned long)RxDescIdx,
+  //        (unsigned long)RxBuildDescIdx,
+  //        (unsigned long)RxBuildDescCnt);
   
   /* Dump descriptor at current index */
-  // uint32_t idx = handlerEth->RxDescList.RxDescIdx;
+  // uint32_t idx = RxDescIdx;
   // ETH_DMADescTypeDef_Shadow *d = &DMARxDscrTab[idx];
   // printf("ETH RX Callback: Desc[%lu] DESC0=0x%08lx, DESC1=0x%08lx, DESC2=0x%08lx, DESC3=0x%08lx\n",
   //        (unsigned long)idx, (unsigned long)d->DESC0, (unsigned long)d->DESC1,
   //        (unsigned long)d->DESC2, (unsigned long)d->DESC3);
   
+  /* ETH_CODE: Switch to polling: the RX thread keeps RI masked until it
+   * finds the ring empty, so a flood cannot turn into an interrupt storm. */
+  handlerEth->Instance->DMACIER &= ~ETH_DMACIER_RIE;
   sys_sem_signal(&RxPktSemaphore);
   // printf("========== ETH RX COMPLETE CALLBACK END ==========\n\n");
 }
@@ -305,10 +793,18 @@ void HAL_ETH_RxCpltCallback(ETH_HandleTypeDef *handlerEth)
   */
 void HAL_ETH_TxCpltCallback(ETH_HandleTypeDef *handlerEth)
 {
+  ETH_STATS_BEGIN(ETH_STATS_ISR);
+  EthIsrStats.tx_irq++;
+  ETH_STATS_END(ETH_STATS_ISR);
   // printf("\n========== ETH TX COMPLETE CALLBACK ==========\n");
   // printf("ETH TX Callback: Tx complete\n");
   // printf("ETH TX Callback: CurTxDesc=%lu\n", (unsigned long)handlerEth->TxDescList.CurTxDesc);
   sys_sem_signal(&TxPktSemaphore);
+  /* A finished frame may hold RX buffers the empty RX_POOL is waiting for:
+   * let the RX thread reclaim it */
+  if (RxAllocStatus == RX_ALLOC_ERROR) {
+    sys_sem_signal(&RxPktSemaphore);
+  }
   // printf("========== ETH TX COMPLETE CALLBACK END ==========\n\n");
 }
 /**
@@ -319,56 +815,22 @@ void HAL_ETH_TxCpltCallback(ETH_HandleTypeDef *handlerEth)
 void HAL_ETH_ErrorCallback(ETH_HandleTypeDef *handlerEth)
 {
   uint32_t dma_err = HAL_ETH_GetDMAError(handlerEth);
-  TRACE_PRINTF("\n========== ETH ERROR CALLBACK ==========\n");
-  TRACE_PRINTF("ETH Error Callback: DMA Error=0x%08lx\n", (unsigned long)dma_err);
-  
-  /* Decode error bits */
-  if (dma_err & ETH_DMACSR_RBU) TRACE_PRINTF("  - RBU: Receive Buffer Unavailable\n");
-  if (dma_err & ETH_DMACSR_RPS) TRACE_PRINTF("  - RPS: Receive Process Stopped\n");
-  if (dma_err & ETH_DMACSR_RWT) TRACE_PRINTF("  - RWT: Receive Watchdog Timeout\n");
-  if (dma_err & ETH_DMACSR_ETI) TRACE_PRINTF("  - ETI: Early Transmit Interrupt\n");
-  if (dma_err & ETH_DMACSR_FBE) TRACE_PRINTF("  - FBE: Fatal Bus Error\n");
-  if (dma_err & ETH_DMACSR_ERI) TRACE_PRINTF("  - ERI: Early Receive Interrupt\n");
-  if (dma_err & ETH_DMACSR_AIS) TRACE_PRINTF("  - AIS: Abnormal Interrupt Summary\n");
-  if (dma_err & ETH_DMACSR_NIS) TRACE_PRINTF("  - NIS: Normal Interrupt Summary\n");
-  
-  /* Diagnostic: Dump descriptor and HAL state on error */
-  TRACE_PRINTF("ETH Error: RxIdx=%lu, RxBuildIdx=%lu, RxBuildCnt=%lu\n",
-         (unsigned long)handlerEth->RxDescList.RxDescIdx,
-         (unsigned long)handlerEth->RxDescList.RxBuildDescIdx,
-         (unsigned long)handlerEth->RxDescList.RxBuildDescCnt);
-  
-  TRACE_PRINTF("ETH Error: DMACSR=0x%08lx, DMACRDTPR=0x%08lx\n",
-         (unsigned long)handlerEth->Instance->DMACSR,
-         (unsigned long)handlerEth->Instance->DMACRDTPR);
-  
-  for(int i=0; i<ETH_RX_DESC_CNT; i++) {
-    ETH_DMADescTypeDef_Shadow *d = &DMARxDscrTab[i];
-    (void)d;
-    TRACE_PRINTF("RX Desc %d [0x%08lx]: 0x%08lx 0x%08lx 0x%08lx 0x%08lx\n", i,
-           (unsigned long)d,
-           (unsigned long)d->DESC0,
-           (unsigned long)d->DESC1,
-           (unsigned long)d->DESC2,
-           (unsigned long)d->DESC3);
-  }
-  TRACE_PRINTF("========== ETH ERROR CALLBACK END ==========\n\n");
+  ETH_STATS_BEGIN(ETH_STATS_ISR);
+  EthIsrStats.dma_error++;
+  ETH_STATS_END(ETH_STATS_ISR);
+  ETH_TRACE3(IRQ_DMA_ERROR, dma_err, handlerEth->Instance->DMACSR, RxDescIdx);
 
   if((dma_err & ETH_DMACSR_RBU) == ETH_DMACSR_RBU)
   {
-     TRACE_PRINTF("ETH Error: Receive Buffer Unavailable\n");
-     
      /* ETH_CODE: Properly handle RBU by recycling the current descriptor.
       * The DMA has written back a descriptor but we need to recycle it. */
      
      /* Check if we have a CPU-owned descriptor to recycle */
-     uint32_t idx = handlerEth->RxDescList.RxDescIdx;
+     uint32_t idx = RxDescIdx;
      ETH_DMADescTypeDef_Shadow *d = &DMARxDscrTab[idx];
      
      /* Invalidate cache to read actual RAM value */
-     SCB_InvalidateDCache_by_Addr((uint32_t *)d, sizeof(ETH_DMADescTypeDef_Shadow));
-     
-     TRACE_PRINTF("ETH RBU: Recycle Idx=%lu, DESC3=0x%08lx\n", (unsigned long)idx, (unsigned long)d->DESC3);
+     ETH_DESC_CACHE_INVALIDATE(d, sizeof(ETH_DMADescTypeDef_Shadow));
      
      /* ETH_CODE: Check if the descriptor is owned by CPU (Bit 31 = 0) */
      if ((d->DESC3 & 0x80000000) == 0) {
@@ -376,14 +838,10 @@ void HAL_ETH_ErrorCallback(ETH_HandleTypeDef *handlerEth)
         /* H7 RDES3: Bit 31: OWN, Bit 30: CTXT */
         if ((d->DESC3 & 0x40000000) != 0) {
              /* It is a context descriptor (CTXT=1), safe to recycle. */
-              TRACE_PRINTF("ETH RBU: Context descriptor detected at %lu, recycling...\n", (unsigned long)idx);
         } else {
              /* Normal Packet Descriptor (CTXT=0) with OWN=0. 
               * This contains a VALID packet waiting for the stack. 
               * DO NOT RECYCLE! Just signal the thread to come and get it. */
-             TRACE_PRINTF("ETH RBU: Valid packet at %lu (DESC3=0x%08lx). Deferring to thread.\n", 
-                    (unsigned long)idx, (unsigned long)d->DESC3);
-             
              /* Clear RBU flag to move on. */
              handlerEth->Instance->DMACSR = (ETH_DMACSR_RBU | ETH_DMACSR_AIS);
              sys_sem_signal(&RxPktSemaphore);
@@ -392,7 +850,6 @@ void HAL_ETH_ErrorCallback(ETH_HandleTypeDef *handlerEth)
      } else {
         /* OWN=1: Descriptor is ready for DMA. The hardware just needs a kick. 
          * This can happen if the hardware reached the tail pointer. */
-        TRACE_PRINTF("ETH RBU: Descriptor %lu is DMA owned (ready). Kicking DMA.\n", (unsigned long)idx);
      }
      
      /* Clear flags */
@@ -401,8 +858,6 @@ void HAL_ETH_ErrorCallback(ETH_HandleTypeDef *handlerEth)
      /* Kick the DMA using dynamic tail pointer */
      stm32h7_eth_kick_rx_dma();
      
-     TRACE_PRINTF("ETH RBU: DMA kicked, ReadIdx=%lu\n", (unsigned long)idx);
-     
      /* Signal the input task to check if it missed anything */
      sys_sem_signal(&RxPktSemaphore);
   }
@@ -410,154 +865,958 @@ void HAL_ETH_ErrorCallback(ETH_HandleTypeDef *handlerEth)
 
 /* USER CODE BEGIN 4 */
 
-/* USER CODE END 4 */
-
-/*******************************************************************************
-                       LL Driver Interface ( LwIP stack --> ETH)
-*******************************************************************************/
-/**
- * @brief In this function, the hardware should be initialized.
- * Called from ethernetif_init().
- *
- * @param netif the already initialized lwip network interface structure
- *        for this ethernetif
- */
-static void low_level_init(struct netif *netif)
+/* ETH_CODE: Hardware receive address filtering.
+ * Multicast MAC addresses requested by IGMP/MLD are kept in MacFilterTab
+ * with a reference count (several groups can map onto one MAC address).
+ * The first three go into the perfect filters MACA1..MACA3, the rest into
+ * the 64-bit hash table (MACHT0R/MACHT1R); the MAC then passes a multicast
+ * frame if either matches (MACPFR HPF). A full table falls back to
+ * all-multicast; promiscuous and all-multicast can also be forced through
+ * stm32h7_eth_set_rx_filter_mode(). */
+typedef struct {
+  uint8_t addr[ETH_HWADDR_LEN];
+  uint16_t refs;
+} MacFilterEntry_t;
+
+#define ETH_MAC_PERFECT_CNT  3U
+
+static MacFilterEntry_t MacFilterTab[ETH_MAC_FILTER_CNT];
+static stm32h7_eth_rx_filter_mode_t MacFilterMode = STM32H7_ETH_RX_FILTER_NORMAL;
+static uint32_t MacFilterOverflow;   /* references that did not fit */
+
+/* Hash table bit of a MAC address: upper 6 bits of the bit-reversed CRC-32 */
+static uint32_t stm32h7_eth_mac_hash(const uint8_t *addr)
 {
-  HAL_StatusTypeDef hal_eth_init_status = HAL_OK;
-
-//  uint32_t duplex, speed = 0;
-//  int32_t PHYLinkState = 0;
-//  ETH_MACConfigTypeDef MACConf = {0};
-  /* Start ETH HAL Init */
-  MPU_Config();
-
-  /* DEBUG: Verify structure layout to confirm mismatch */
-  TRACE_PRINTF("DEBUG: sizeof(ETH_HandleTypeDef) = %u\n", (unsigned int)sizeof(ETH_HandleTypeDef));
-  TRACE_PRINTF("DEBUG: ETH_RX_DESC_CNT (Local Define) = %u\n", ETH_RX_DESC_CNT);
-  TRACE_PRINTF("DEBUG: offsetof(RxDescList) = %u\n", (unsigned int)offsetof(ETH_HandleTypeDef, RxDescList));
-  TRACE_PRINTF("DEBUG: offsetof(RxDescIdx) = %u\n", (unsigned int)offsetof(ETH_HandleTypeDef, RxDescList.RxDescIdx));
-
-   static uint8_t MACAddr[6] ;
-  heth.Instance = ETH;
-  MACAddr[0] = 0x00;
-  MACAddr[1] = 0x80;
-  MACAddr[2] = 0xE1;
-  MACAddr[3] = 0x00;
-  MACAddr[4] = 0x00;
-  MACAddr[5] = 0x00;
-  heth.Init.MACAddr = &MACAddr[0];
- heth.Init.MediaInterface = HAL_ETH_RMII_MODE;
- /* Suppress warning about packed structure pointer conversion */
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Waddress-of-packed-member"
- heth.Init.TxDesc = (ETH_DMADescTypeDef *)DMATxDscrTab;
- heth.Init.RxDesc = (ETH_DMADescTypeDef *)DMARxDscrTab;
-#pragma GCC diagnostic pop
- heth.Init.RxBuffLen = 1536;
-
- /* USER CODE END MACADDRESS */
- 
- /* Disable ETH interrupt before installing handler */
- HAL_NVIC_DisableIRQ(ETH_IRQn);
-
- TRACE_PRINTF("Ethernet MAC: %02x:%02x:%02x:%02x:%02x:%02x\n",
-         MACAddr[0], MACAddr[1], MACAddr[2], MACAddr[3], MACAddr[4], MACAddr[5]);
-
-  /* ETH_CODE: Zero out descriptor and RX pool memory before use */
-  memset(DMARxDscrTab, 0, ETH_RX_DESC_CNT * sizeof(ETH_DMADescTypeDef_Shadow));
-  memset(DMATxDscrTab, 0, ETH_TX_DESC_CNT * sizeof(ETH_DMADescTypeDef_Shadow));
-  memset((void *)RX_POOL_BASE_ADDR, 0, ETH_RX_BUFFER_CNT * (sizeof(RxBuff_t)));
+  uint32_t crc = 0xFFFFFFFFU;
+  uint32_t i, bit;
 
-  /* ETH_CODE: Initialize the RX POOL before calling HAL_ETH_Init */
-  TRACE_PRINTF("Initializing RX pool at 0x%08lx...\n", (unsigned long)RX_POOL_BASE_ADDR);
-  LWIP_MEMPOOL_INIT(RX_POOL);
+  for (i = 0; i < ETH_HWADDR_LEN; i++) {
+    crc ^= addr[i];
+    for (bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+    }
+  }
+  return __RBIT(~crc) >> 26;
+}
 
-  hal_eth_init_status = HAL_ETH_Init(&heth);
-  
-  if (hal_eth_init_status == HAL_OK) {
-    /* Register callbacks required for HAL_ETH_ReadData and Transmit */
-    HAL_ETH_RegisterRxAllocateCallback(&heth, HAL_ETH_RxAllocateCallback);
-    HAL_ETH_RegisterTxFreeCallback(&heth, HAL_ETH_TxFreeCallback);
-    HAL_ETH_RegisterRxLinkCallback(&heth, HAL_ETH_RxLinkCallback);
+/* Write MacFilterTab and MacFilterMode to the MAC filter registers */
+static void stm32h7_eth_apply_mac_filter(void)
+{
+  __IO uint32_t *perfect[ETH_MAC_PERFECT_CNT][2] = {
+    { &heth.Instance->MACA1HR, &heth.Instance->MACA1LR },
+    { &heth.Instance->MACA2HR, &heth.Instance->MACA2LR },
+    { &heth.Instance->MACA3HR, &heth.Instance->MACA3LR },
+  };
+  uint32_t hash[2] = {0, 0};
+  uint32_t pfr = heth.Instance->MACPFR;
+  uint32_t used = 0;
+  uint32_t i;
+
+  for (i = 0; i < ETH_MAC_PERFECT_CNT; i++) {
+    *perfect[i][0] = 0;   /* AE cleared: slot unused */
+  }
 
-    /* ETH_CODE: Manually commit descriptor list addresses and lengths to hardware registers.
-     * This is critical because the HAL version in this environment lacks 
-     * HAL_ETH_DMARxDescListInit and doesn't appear to commit them in HAL_ETH_Init. */
-    heth.Instance->DMACRDLAR = (uint32_t)heth.Init.RxDesc;
-    heth.Instance->DMACRDRLR = ETH_RX_DESC_CNT - 1; /* Ring Length (N-1) */
-    
-    heth.Instance->DMACTDLAR = (uint32_t)heth.Init.TxDesc;
-    heth.Instance->DMACTDRLR = ETH_TX_DESC_CNT - 1; /* Ring Length (N-1) */
-    
-    __DSB();
+  for (i = 0; i < ETH_MAC_FILTER_CNT; i++) {
+    const uint8_t *a = MacFilterTab[i].addr;
+    if (MacFilterTab[i].refs == 0) {
+      continue;
+    }
+    if (used < ETH_MAC_PERFECT_CNT) {
+      *perfect[used][1] = ((uint32_t)a[3] << 24) | ((uint32_t)a[2] << 16) |
+                          ((uint32_t)a[1] << 8) | a[0];
+      *perfect[used][0] = 0x80000000 | ((uint32_t)a[5] << 8) | a[4];   /* AE */
+    } else {
+      uint32_t h = stm32h7_eth_mac_hash(a);
+      hash[h >> 5] |= 1U << (h & 31U);
+    }
+    used++;
+  }
+  heth.Instance->MACHT0R = hash[0];
+  heth.Instance->MACHT1R = hash[1];
+
+  pfr &= ~(ETH_MACPFR_RA | ETH_MACPFR_PR | ETH_MACPFR_PM | ETH_MACPFR_HMC | ETH_MACPFR_HPF);
+  if (MacFilterMode == STM32H7_ETH_RX_FILTER_PROMISC) {
+    pfr |= ETH_MACPFR_PR;
+  } else if ((MacFilterMode == STM32H7_ETH_RX_FILTER_ALLMULTI) || MacFilterOverflow) {
+    pfr |= ETH_MACPFR_PM;
+  } else if (used > ETH_MAC_PERFECT_CNT) {
+    pfr |= ETH_MACPFR_HMC | ETH_MACPFR_HPF;
+  }
+  heth.Instance->MACPFR = pfr;
+  __DSB();
 
-    /* ETH_CODE: Manually initialize the internal HAL descriptor list wrappers.
-     * The H7 HAL uses these trackers for ReadData/Transmit operations. 
-     * We must populate build indices as well for HAL_ETH_ReadData to function. */
-     memset(&heth.RxDescList, 0, sizeof(ETH_RxDescListTypeDef));
-     
-     /* ETH_CODE: Initialize Start and End pointers for RxDescList 
-      * This is crucial for DMACRDTPR (Tail Pointer) updates to work correctly! */
-     heth.RxDescList.pRxStart = (ETH_DMADescTypeDef *)DMARxDscrTab;
-     heth.RxDescList.pRxEnd   = (ETH_DMADescTypeDef *)&DMARxDscrTab[ETH_RX_DESC_CNT - 1];
-     
-     heth.RxDescList.RxDescCnt = ETH_RX_DESC_CNT;
-     heth.RxDescList.RxDescIdx = 0;
-     heth.RxDescList.RxBuildDescIdx = 0;
-    heth.RxDescList.RxBuildDescCnt = 0; /* Will be incremented during buffer allocation */
+  TRACE_PRINTF("ETH: MAC filter: %lu groups, MACPFR=0x%08lx, HT=0x%08lx%08lx\n",
+         (unsigned long)used, (unsigned long)pfr,
+         (unsigned long)hash[1], (unsigned long)hash[0]);
+}
 
-    for(int i = 0; i < ETH_RX_DESC_CNT; i++) {
-        heth.RxDescList.RxDesc[i] = (uint32_t)&DMARxDscrTab[i];
+/* Add or drop one reference to a multicast MAC address */
+static err_t stm32h7_eth_update_mac_filter(const uint8_t *addr, enum netif_mac_filter_action action)
+{
+  MacFilterEntry_t *free_entry = NULL;
+  uint32_t i;
+
+  for (i = 0; i < ETH_MAC_FILTER_CNT; i++) {
+    MacFilterEntry_t *e = &MacFilterTab[i];
+    if (e->refs == 0) {
+      if (free_entry == NULL) {
+        free_entry = e;
+      }
+      continue;
     }
-    
-    memset(&heth.TxDescList, 0, sizeof(ETH_TxDescListTypeDef));
-    heth.TxDescList.CurTxDesc = 0;
-    for(int i = 0; i < ETH_TX_DESC_CNT; i++) {
-        heth.TxDescList.TxDesc[i] = (uint32_t)&DMATxDscrTab[i];
+    if (memcmp(e->addr, addr, ETH_HWADDR_LEN) == 0) {
+      if (action == NETIF_ADD_MAC_FILTER) {
+        e->refs++;
+        return ERR_OK;
+      }
+      if (--e->refs == 0) {
+        stm32h7_eth_apply_mac_filter();
+      }
+      return ERR_OK;
     }
+  }
 
+  if (action != NETIF_ADD_MAC_FILTER) {
+    /* Not in the table: it was one of the overflow addresses */
+    if ((MacFilterOverflow > 0) && (--MacFilterOverflow == 0)) {
+      stm32h7_eth_apply_mac_filter();
+    }
+    return ERR_OK;
+  }
+  if (free_entry == NULL) {
+    /* Table full: accept all multicast rather than lose a group */
+    TRACE_PRINTF("ETH: MAC filter table full, falling back to all-multicast\n");
+    MacFilterOverflow++;
+  } else {
+    memcpy(free_entry->addr, addr, ETH_HWADDR_LEN);
+    free_entry->refs = 1;
+  }
+  stm32h7_eth_apply_mac_filter();
+  return ERR_OK;
+}
 
+#if LWIP_IGMP
+static err_t stm32h7_eth_igmp_mac_filter(struct netif *netif, const ip4_addr_t *group,
+                                         enum netif_mac_filter_action action)
+{
+  uint8_t addr[ETH_HWADDR_LEN] = { 0x01, 0x00, 0x5E, 0, 0, 0 };
+  err_t err;
+
+  (void)netif;
+  addr[3] = ip4_addr2(group) & 0x7F;
+  addr[4] = ip4_addr3(group);
+  addr[5] = ip4_addr4(group);
+  err = stm32h7_eth_update_mac_filter(addr, action);
+#if ETH_L34_FILTER
+  /* IGMP queries for the groups joined must get through */
+  stm32h7_eth_l34_refresh();
+#endif
+  return err;
+}
+#endif /* LWIP_IGMP */
 
+#if LWIP_IPV6 && LWIP_IPV6_MLD
+static err_t stm32h7_eth_mld_mac_filter(struct netif *netif, const ip6_addr_t *group,
+                                        enum netif_mac_filter_action action)
+{
+  const uint8_t *a = (const uint8_t *)&group->addr[3];
+  uint8_t addr[ETH_HWADDR_LEN] = { 0x33, 0x33, a[0], a[1], a[2], a[3] };
 
-    TRACE_PRINTF("ETH: DMA Descriptors committed to hardware: RXaddr=0x%08lx, RXlen=%lu, TXaddr=0x%08lx, TXlen=%lu\n",
-           (unsigned long)heth.Instance->DMACRDLAR, (unsigned long)(heth.Instance->DMACRDRLR + 1),
-           (unsigned long)heth.Instance->DMACTDLAR, (unsigned long)(heth.Instance->DMACTDRLR + 1));
+  (void)netif;
+  return stm32h7_eth_update_mac_filter(addr, action);
+}
+#endif /* LWIP_IPV6 && LWIP_IPV6_MLD */
 
+/**
+ * Force the MAC into promiscuous or all-multicast mode, or return it to
+ * filtering on the addresses requested through IGMP/MLD.
+ */
+void stm32h7_eth_set_rx_filter_mode(stm32h7_eth_rx_filter_mode_t mode)
+{
+  LOCK_TCPIP_CORE();
+  MacFilterMode = mode;
+  stm32h7_eth_apply_mac_filter();
+  UNLOCK_TCPIP_CORE();
+}
 
-    TRACE_PRINTF("Installing ETH interrupt handler for vector %lu...\n", (unsigned long)ETH_IRQn);
-    rtems_status_code sc = rtems_interrupt_handler_install(
-      ETH_IRQn,
-      "ETH",
-      RTEMS_INTERRUPT_UNIQUE,
-      stm32h7_eth_interrupt_handler,
-      NULL
-    );
-    if (sc != RTEMS_SUCCESSFUL) {
-      TRACE_PRINTF("ERROR: Failed to install ETH interrupt handler: %d\n", (int)sc);
-      hal_eth_init_status = HAL_ERROR;
-    } else {
-      TRACE_PRINTF("ETH interrupt handler installed successfully\n");
-      /* ETH_CODE: Explicitly enable the interrupt vector in RTEMS */
-      rtems_interrupt_vector_enable(ETH_IRQn);
+#if LWIP_VLAN_OFFLOAD
+/* ETH_CODE: VLAN tag filter.
+ * The MAC strips the tag of every tagged frame into RDES0 (EVLS, EVLRXS)
+ * and, with MACPFR VTFE, drops tagged frames of VLANs not in VlanFilterTab:
+ * one VLAN is matched exactly (MACVTR VL), several through the 16-bin
+ * MACVHTR hash (VTHM). Untagged frames are not affected. */
+static uint16_t VlanFilterTab[ETH_VLAN_FILTER_CNT];
+static uint32_t VlanFilterCnt;
+
+/* MACVHTR bin of a VLAN ID: upper 4 bits of the bit-reversed CRC-32 of its
+ * 12 bits (ETV), least significant bit first */
+static uint32_t stm32h7_eth_vlan_hash(uint16_t vid)
+{
+  uint32_t crc = 0xFFFFFFFFU;
+  uint32_t bit;
 
-      /* Enable ETH interrupt after successful handler installation */
-      HAL_NVIC_SetPriority(ETH_IRQn, 0x5, 0); /* Slightly higher priority */
-      HAL_NVIC_EnableIRQ(ETH_IRQn);
-      
-      /* diagnostic: check if IRQ is enabled */
-      TRACE_PRINTF("ETH: IRQ %lu enabled in NVIC\n", (unsigned long)ETH_IRQn);
-    }
+  for (bit = 0; bit < 12U; bit++) {
+    crc = ((crc ^ (vid >> bit)) & 1U) ? (crc >> 1) ^ 0xEDB88320U : crc >> 1;
   }
+  return __RBIT(~crc) >> 28;
+}
 
-  memset(&TxConfig, 0 , sizeof(ETH_TxPacketConfig));
-  TxConfig.Attributes = ETH_TX_PACKETS_FEATURES_CSUM | ETH_TX_PACKETS_FEATURES_CRCPAD;
-  TxConfig.ChecksumCtrl = ETH_CHECKSUM_IPHDR_PAYLOAD_INSERT_PHDR_CALC;
-  TxConfig.CRCPadCtrl = ETH_CRC_PAD_INSERT;
+/* Write VlanFilterTab to MACVTR/MACVHTR and the transmit tag control */
+static void stm32h7_eth_apply_vlan_filter(void)
+{
+  uint32_t vtr = ETH_MACVTR_EVLS_ALWAYSSTRIP | ETH_MACVTR_EVLRXS | ETH_MACVTR_ETV;
+  uint32_t hash = 0;
+  uint32_t i;
+
+  if (VlanFilterCnt == 1U) {
+    vtr |= VlanFilterTab[0] & 0x0FFFU;
+  } else if (VlanFilterCnt > 1U) {
+    for (i = 0; i < VlanFilterCnt; i++) {
+      hash |= 1U << stm32h7_eth_vlan_hash(VlanFilterTab[i]);
+    }
+    vtr |= ETH_MACVTR_VTHM;
+  }
+  heth.Instance->MACVHTR = hash;
+  heth.Instance->MACVTR = vtr;
+  heth.Instance->MACVIR = ETH_MACVIR_VLTI;
+  if (VlanFilterCnt > 0U) {
+    SET_BIT(heth.Instance->MACPFR, ETH_MACPFR_VTFE);
+  } else {
+    CLEAR_BIT(heth.Instance->MACPFR, ETH_MACPFR_VTFE);
+  }
+  __DSB();
+}
 
-  /* End ETH HAL Init */
+/**
+ * Receive tagged frames only for the given VLAN IDs (cnt 0: all VLANs).
+ *
+ * @return ERR_VAL if there are more than ETH_VLAN_FILTER_CNT IDs
+ */
+err_t stm32h7_eth_set_vlan_filter(const uint16_t *vids, uint32_t cnt)
+{
+  if (cnt > ETH_VLAN_FILTER_CNT) {
+    return ERR_VAL;
+  }
+  LOCK_TCPIP_CORE();
+  for (uint32_t i = 0; i < cnt; i++) {
+    VlanFilterTab[i] = vids[i] & 0x0FFFU;
+  }
+  VlanFilterCnt = cnt;
+  stm32h7_eth_apply_vlan_filter();
+  UNLOCK_TCPIP_CORE();
+  return ERR_OK;
+}
+#endif /* LWIP_VLAN_OFFLOAD */
+
+#if ETH_ARP_OFFLOAD
+/* ETH_CODE: ARP offload.
+ * With MACCR ARP set the MAC replies to ARP requests whose target is
+ * MACARPAR (first address byte in [31:24]) on its own. The request is still
+ * written to the ring (RDES3 LT = 011), and since etharp.c learns nothing
+ * from requests (ETHARP_LEARN_SOLICITED_ONLY) low_level_input() drops it
+ * there, with the broadcast requests for other hosts. Two kinds still go up:
+ * one the MAC did not answer (RDES2 ARPNR, a reply was still in progress)
+ * and one whose sender is our own address, for ACD conflict detection.
+ * The address follows netif_set_ipaddr() through an ext status callback;
+ * while the netif has no address the offload is off. */
+static struct netif *ArpOffloadNetif;
+static uint32_t ArpOffloadAddr;   /* 0: offload off */
+NETIF_DECLARE_EXT_CALLBACK(ArpOffloadCallback)
+
+static void stm32h7_eth_apply_arp_offload(void)
+{
+  ArpOffloadAddr = lwip_ntohl(ip4_addr_get_u32(netif_ip4_addr(ArpOffloadNetif)));
+  heth.Instance->MACARPAR = ArpOffloadAddr;
+  if (ArpOffloadAddr != 0U) {
+    SET_BIT(heth.Instance->MACCR, ETH_MACCR_ARP);
+  } else {
+    CLEAR_BIT(heth.Instance->MACCR, ETH_MACCR_ARP);
+  }
+  __DSB();
+}
 
-  /* ETH_CODE: RX pool initialization moved before HAL_ETH_Init */
+static void stm32h7_eth_arp_offload_status(struct netif *netif, netif_nsc_reason_t reason,
+                                           const netif_ext_callback_args_t *args)
+{
+  (void)args;
+  if ((netif == ArpOffloadNetif) && (reason & LWIP_NSC_IPV4_ADDRESS_CHANGED)) {
+    stm32h7_eth_apply_arp_offload();
+  }
+}
+
+/**
+ * Check whether a received descriptor holds an ARP request lwIP does not
+ * need to see (see above). Only single-descriptor frames qualify.
+ */
+static int stm32h7_eth_rx_arp_drop(const ETH_DMADescTypeDef_Shadow *d, uint32_t idx)
+{
+  const uint8_t *frame = (const uint8_t *)DMARxDscrBackup[idx];
+  uint32_t start = (uint32_t)frame & ~31U;
+  uint32_t end = ((uint32_t)frame + 42U + 31U) & ~31U;
+  uint32_t sip, tip;
+
+  /* FD + LD, no error summary (ES), LT = 011 (ARP request) */
+  if ((ArpOffloadAddr == 0U) || ((d->DESC3 & 0x30078000) != 0x30030000) ||
+      ((d->DESC3 & 0x00007FFF) < 42U)) {
+    return 0;
+  }
+  SCB_InvalidateDCache_by_Addr((uint32_t *)start, (int32_t)(end - start));
+  sip = ((uint32_t)frame[28] << 24) | ((uint32_t)frame[29] << 16) | ((uint32_t)frame[30] << 8) | frame[31];
+  tip = ((uint32_t)frame[38] << 24) | ((uint32_t)frame[39] << 16) | ((uint32_t)frame[40] << 8) | frame[41];
+  if (sip == ArpOffloadAddr) {
+    return 0;
+  }
+  /* RS2V (bit 27) + ARPNR (RDES2 bit 10): the MAC did not reply */
+  if ((tip == ArpOffloadAddr) && (d->DESC3 & 0x08000000) && (d->DESC2 & 0x00000400)) {
+    return 0;
+  }
+  ETH_STATS_BEGIN(ETH_STATS_RX);
+  EthRxStats.arp_dropped++;
+  ETH_STATS_END(ETH_STATS_RX);
+  return 1;
+}
+#endif /* ETH_ARP_OFFLOAD */
+
+#if ETH_L34_FILTER
+/* ETH_CODE: L3/L4 receive filters.
+ * Each of the two filters matches IPv4 packets on a source address prefix
+ * (MACL3A0xR, L3SAM with L3HSBM low bits ignored) and/or the TCP or UDP
+ * (L4PEN) source and destination ports (MACL4AxR, L4SPM/L4DPM). With MACPFR
+ * IPFE the MAC drops every IP packet that matches none of them before it
+ * reaches the RX FIFO; non-IP frames such as ARP are not affected. With port
+ * filters in the table, that is exactly:
+ *   - IPv4 TCP and UDP packets to other ports, or from other peers for a
+ *     filter narrowed to one,
+ *   - IPv4 fragments other than the first, which carry no ports,
+ *   - every other IPv4 protocol, ICMP (ping, errors) and IGMP included,
+ *   - all of IPv6: ND, MLD, ICMPv6 and TCP/UDP over IPv6.
+ * With no filter in the table IPFE is off and everything is received.
+ * In the automatic mode the table holds one filter per local port of the
+ * bound UDP PCBs, listening and active TCP PCBs (narrowed to the peer for
+ * connected ones). LWIP_HOOK_PCB_CHANGED() rebuilds it when a PCB is bound,
+ * connected or closed, before the PCB sends anything, so the reply to a new
+ * connection is never filtered. Filtering stays off while the stack needs
+ * traffic from the list above: while the netif has an IPv6 address, has
+ * joined an IGMP group besides all-systems or a raw PCB exists, and while
+ * the PCBs need more than two filters. Fragmented datagrams and ping are
+ * still dropped while it is on. */
+static stm32h7_eth_l34_filter_t L34FilterTab[STM32H7_ETH_L34_FILTER_CNT];
+static uint32_t L34FilterCnt;
+static uint8_t L34Auto;
+static struct netif *L34Netif;
+#if LWIP_IPV6
+NETIF_DECLARE_EXT_CALLBACK(L34Callback)
+#endif
+
+static void stm32h7_eth_apply_l34_filter(void)
+{
+  __IO uint32_t *ctrl[STM32H7_ETH_L34_FILTER_CNT] = { &heth.Instance->MACL3L4C0R, &heth.Instance->MACL3L4C1R };
+  __IO uint32_t *l4[STM32H7_ETH_L34_FILTER_CNT] = { &heth.Instance->MACL4A0R, &heth.Instance->MACL4A1R };
+  __IO uint32_t *l3[STM32H7_ETH_L34_FILTER_CNT] = { &heth.Instance->MACL3A00R, &heth.Instance->MACL3A01R };
+  uint32_t i;
+
+  for (i = 0; i < STM32H7_ETH_L34_FILTER_CNT; i++) {
+    const stm32h7_eth_l34_filter_t *f = &L34FilterTab[i];
+    uint32_t c = 0;
+
+    if (i < L34FilterCnt) {
+      if (f->src_prefix != 0U) {
+        c |= 0x00000004 | ((32U - f->src_prefix) << 6);  /* L3SAM, L3HSBM */
+      }
+      if (f->proto == IP_PROTO_UDP) {
+        c |= 0x00010000;                                  /* L4PEN: UDP */
+      }
+      if (f->src_port != 0U) {
+        c |= 0x00040000;                                  /* L4SPM */
+      }
+      if (f->dst_port != 0U) {
+        c |= 0x00100000;                                  /* L4DPM */
+      }
+      *l3[i] = lwip_ntohl(ip4_addr_get_u32(&f->src));
+      *l4[i] = f->src_port | ((uint32_t)f->dst_port << 16);
+    }
+    *ctrl[i] = c;
+  }
+  if (L34FilterCnt > 0U) {
+    SET_BIT(heth.Instance->MACPFR, ETH_MACPFR_IPFE);
+  } else {
+    CLEAR_BIT(heth.Instance->MACPFR, ETH_MACPFR_IPFE);
+  }
+  __DSB();
+  ETH_STATS_BEGIN(ETH_STATS_CTL);
+  EthCtlStats.l34_updates++;
+  ETH_STATS_END(ETH_STATS_CTL);
+}
+
+/**
+ * Add the flow to a local port to tab, unless a filter for the port from
+ * any source is already there.
+ *
+ * @return 0 if tab is full
+ */
+static int stm32h7_eth_l34_add_flow(stm32h7_eth_l34_filter_t *tab, uint32_t *cnt, uint8_t proto,
+                                    const ip_addr_t *remote, uint16_t remote_port, uint16_t local_port)
+{
+  stm32h7_eth_l34_filter_t f = { proto, 0, 0, local_port, { 0 } };
+  uint32_t i;
+
+  if ((remote != NULL) && IP_IS_V4(remote) && !ip_addr_isany(remote)) {
+    f.src = *ip_2_ip4(remote);
+    f.src_prefix = 32;
+    f.src_port = remote_port;
+  }
+  for (i = 0; i < *cnt; i++) {
+    if ((tab[i].proto == proto) && (tab[i].dst_port == local_port)) {
+      if (tab[i].src_prefix == 0U) {
+        return 1;
+      }
+      if ((f.src_prefix == 0U) ||
+          ((tab[i].src_port == f.src_port) && ip4_addr_eq(&tab[i].src, &f.src))) {
+        tab[i] = f;
+        return 1;
+      }
+    }
+  }
+  if (*cnt == STM32H7_ETH_L34_FILTER_CNT) {
+    return 0;
+  }
+  tab[(*cnt)++] = f;
+  return 1;
+}
+
+/* Whether the stack needs IP traffic the filters cannot express */
+static int stm32h7_eth_l34_unfilterable(void)
+{
+  if (L34Netif == NULL) {
+    return 0;
+  }
+#if LWIP_IPV6
+  for (uint32_t i = 0; i < LWIP_IPV6_NUM_ADDRESSES; i++) {
+    if (!ip6_addr_isinvalid(netif_ip6_addr_state(L34Netif, i))) {
+      return 1;
+    }
+  }
+#endif
+#if LWIP_IGMP
+  /* all-systems is always first; its queries only matter for other groups */
+  if ((netif_igmp_data(L34Netif) != NULL) && (netif_igmp_data(L34Netif)->next != NULL)) {
+    return 1;
+  }
+#endif
+#if LWIP_RAW
+  if (raw_pcbs != NULL) {
+    return 1;
+  }
+#endif
+  return 0;
+}
+
+/* Rebuild the table from the PCBs (automatic mode), tcpip core locked */
+static void stm32h7_eth_l34_auto_update(void)
+{
+  stm32h7_eth_l34_filter_t tab[STM32H7_ETH_L34_FILTER_CNT];
+  uint32_t cnt = 0;
+  int fits = 1;
+  struct udp_pcb *u;
+  struct tcp_pcb *t;
+  struct tcp_pcb_listen *l;
+
+  if (!stm32h7_eth_l34_unfilterable()) {
+    for (u = udp_pcbs; fits && (u != NULL); u = u->next) {
+      if ((u->local_port != 0U) && !IP_IS_V6_VAL(u->local_ip)) {
+        fits = stm32h7_eth_l34_add_flow(tab, &cnt, IP_PROTO_UDP,
+                                        (u->flags & UDP_FLAGS_CONNECTED) ? &u->remote_ip : NULL,
+                                        u->remote_port, u->local_port);
+      }
+    }
+    for (l = tcp_listen_pcbs.listen_pcbs; fits && (l != NULL); l = l->next) {
+      if (!IP_IS_V6_VAL(l->local_ip)) {
+        fits = stm32h7_eth_l34_add_flow(tab, &cnt, IP_PROTO_TCP, NULL, 0, l->local_port);
+      }
+    }
+    for (t = tcp_active_pcbs; fits && (t != NULL); t = t->next) {
+      if (!IP_IS_V6_VAL(t->local_ip)) {
+        fits = stm32h7_eth_l34_add_flow(tab, &cnt, IP_PROTO_TCP, &t->remote_ip, t->remote_port, t->local_port);
+      }
+    }
+  }
+  if (!fits) {
+    if (L34FilterCnt != 0U) {
+      ETH_STATS_BEGIN(ETH_STATS_CTL);
+      EthCtlStats.l34_overflow++;
+      ETH_STATS_END(ETH_STATS_CTL);
+    }
+    cnt = 0;
+  }
+  if ((cnt != L34FilterCnt) || (memcmp(tab, L34FilterTab, cnt * sizeof(tab[0])) != 0)) {
+    memcpy(L34FilterTab, tab, cnt * sizeof(tab[0]));
+    L34FilterCnt = cnt;
+    stm32h7_eth_apply_l34_filter();
+  }
+}
+
+/**
+ * Follow the PCBs, IPv6 addresses and IGMP groups in the automatic mode.
+ * Called through LWIP_HOOK_PCB_CHANGED() and the netif callbacks, tcpip
+ * core locked.
+ */
+void stm32h7_eth_l34_refresh(void)
+{
+  if (L34Auto) {
+    stm32h7_eth_l34_auto_update();
+  }
+}
+
+#if LWIP_IPV6
+static void stm32h7_eth_l34_status(struct netif *netif, netif_nsc_reason_t reason,
+                                   const netif_ext_callback_args_t *args)
+{
+  (void)args;
+  if ((netif == L34Netif) && (reason & (LWIP_NSC_IPV6_SET | LWIP_NSC_IPV6_ADDR_STATE_CHANGED))) {
+    stm32h7_eth_l34_refresh();
+  }
+}
+#endif /* LWIP_IPV6 */
+
+/**
+ * Receive only IPv4 packets matching one of the filters added so far.
+ *
+ * @return ERR_MEM if both hardware filters are in use, ERR_VAL for a filter
+ *         that matches everything or has ports but no protocol, ERR_USE
+ *         while the automatic mode is on
+ */
+err_t stm32h7_eth_add_l34_filter(const stm32h7_eth_l34_filter_t *filter)
+{
+  err_t err = ERR_OK;
+
+  if ((filter->src_prefix > 32U) ||
+      ((filter->src_prefix == 0U) && (filter->src_port == 0U) && (filter->dst_port == 0U)) ||
+      (((filter->src_port != 0U) || (filter->dst_port != 0U)) &&
+       (filter->proto != IP_PROTO_UDP) && (filter->proto != IP_PROTO_TCP))) {
+    return ERR_VAL;
+  }
+  LOCK_TCPIP_CORE();
+  if (L34Auto) {
+    err = ERR_USE;
+  } else if (L34FilterCnt == STM32H7_ETH_L34_FILTER_CNT) {
+    err = ERR_MEM;
+  } else {
+    L34FilterTab[L34FilterCnt++] = *filter;
+    stm32h7_eth_apply_l34_filter();
+  }
+  UNLOCK_TCPIP_CORE();
+  return err;
+}
+
+/* Remove every filter (the automatic mode stays as it is) */
+void stm32h7_eth_clear_l34_filters(void)
+{
+  LOCK_TCPIP_CORE();
+  L34FilterCnt = 0;
+  stm32h7_eth_apply_l34_filter();
+  UNLOCK_TCPIP_CORE();
+}
+
+/* Derive the filters from the bound PCBs (enable) or stop doing so */
+void stm32h7_eth_set_l34_auto(int enable)
+{
+  LOCK_TCPIP_CORE();
+  L34Auto = (enable != 0);
+  L34FilterCnt = 0;
+  if (L34Auto) {
+    stm32h7_eth_l34_auto_update();
+  }
+  stm32h7_eth_apply_l34_filter();
+  UNLOCK_TCPIP_CORE();
+}
+#endif /* ETH_L34_FILTER */
+
+#if ETH_PTP_ENABLE
+/* ETH_CODE: IEEE 1588 system time.
+ * The MAC runs its PTP clock from HCLK using the fine update method: each
+ * HCLK cycle adds MACTSAR to a 32-bit accumulator and every overflow
+ * advances the nanoseconds counter by ETH_PTP_SSINC_NS, giving a nominal
+ * ETH_PTP_CLOCK_HZ clock whose rate is trimmed by rewriting the addend.
+ * Nanoseconds roll over at 10^9 (TSCTRLSSR), so RX/TX timestamps and
+ * MACSTSR/MACSTNR read directly as seconds and nanoseconds. */
+#define ETH_PTP_CLOCK_HZ              50000000U
+#define ETH_PTP_SSINC_NS              (1000000000U / ETH_PTP_CLOCK_HZ)
+#define ETH_PTP_NSEC_PER_SEC          1000000000
+#define ETH_PTP_REG_TIMEOUT           100000U
+
+static uint32_t PtpAddendBase;         /* addend for 0 ppb */
+static stm32h7_eth_ptp_time_t PtpTxTs; /* last TX timestamp */
+static uint32_t PtpTxTsSeq;            /* bumped for every TX timestamp */
+static stm32h7_eth_ptp_servo_fn PtpServo;
+static int64_t PtpServoIntegral;       /* ppb */
+
+/* Set a self-clearing MACTSCR command bit and wait for the MAC to take it */
+static void stm32h7_eth_ptp_cmd(uint32_t bit)
+{
+  uint32_t timeout = ETH_PTP_REG_TIMEOUT;
+
+  heth.Instance->MACTSCR |= bit;
+  while ((heth.Instance->MACTSCR & bit) && --timeout) {
+  }
+  if (timeout == 0) {
+    TRACE_PRINTF("ETH: PTP command 0x%08lx timed out\n", (unsigned long)bit);
+  }
+}
+
+/* Enable the timestamp unit and start the system time from zero */
+static void stm32h7_eth_ptp_init(void)
+{
+  uint32_t tscr = ETH_MACTSCR_TSENA | ETH_MACTSCR_TSCFUPDT | ETH_MACTSCR_TSCTRLSSR;
+
+#if ETH_PTP_RX_TIMESTAMP_ALL
+  tscr |= ETH_MACTSCR_TSENALL;
+#else
+  /* PTPv2 event messages over Ethernet, UDP/IPv4 and UDP/IPv6 */
+  tscr |= ETH_MACTSCR_TSVER2ENA | ETH_MACTSCR_TSIPENA | ETH_MACTSCR_TSIPV4ENA |
+          ETH_MACTSCR_TSIPV6ENA | ETH_MACTSCR_TSEVNTENA;
+#endif
+  heth.Instance->MACTSCR = tscr;
+  heth.Instance->MACSSIR = ETH_PTP_SSINC_NS << 16;   /* SSINC [23:16] */
+
+  /* addend = 2^32 * ETH_PTP_CLOCK_HZ / HCLK, HCLK must exceed the PTP clock */
+  PtpAddendBase = (uint32_t)(((uint64_t)ETH_PTP_CLOCK_HZ << 32) / HAL_RCC_GetHCLKFreq());
+  heth.Instance->MACTSAR = PtpAddendBase;
+  stm32h7_eth_ptp_cmd(ETH_MACTSCR_TSADDREG);
+
+  heth.Instance->MACSTSUR = 0;
+  heth.Instance->MACSTNUR = 0;
+  stm32h7_eth_ptp_cmd(ETH_MACTSCR_TSINIT);
+
+  TRACE_PRINTF("ETH: PTP clock %lu Hz, SSINC=%lu ns, addend=0x%08lx, MACTSCR=0x%08lx\n",
+         (unsigned long)ETH_PTP_CLOCK_HZ, (unsigned long)ETH_PTP_SSINC_NS,
+         (unsigned long)PtpAddendBase, (unsigned long)heth.Instance->MACTSCR);
+}
+
+/**
+ * Read the current system time. The seconds register is sampled on both
+ * sides of the nanoseconds so a rollover in between is not torn.
+ */
+void stm32h7_eth_ptp_get_time(stm32h7_eth_ptp_time_t *ts)
+{
+  uint32_t sec, nsec;
+
+  do {
+    sec = heth.Instance->MACSTSR;
+    nsec = heth.Instance->MACSTNR;
+  } while (sec != heth.Instance->MACSTSR);
+  ts->sec = sec;
+  ts->nsec = nsec;
+}
+
+/**
+ * Load a new system time, e.g. from the master's first Sync.
+ */
+void stm32h7_eth_ptp_set_time(const stm32h7_eth_ptp_time_t *ts)
+{
+  LOCK_TCPIP_CORE();
+  heth.Instance->MACSTSUR = ts->sec;
+  heth.Instance->MACSTNUR = ts->nsec % ETH_PTP_NSEC_PER_SEC;
+  stm32h7_eth_ptp_cmd(ETH_MACTSCR_TSINIT);
+  UNLOCK_TCPIP_CORE();
+}
+
+/**
+ * Step the system time by `offset_ns`. The MAC subtracts when ADDSUB is
+ * set; with digital rollover the operands are then the two's complement of
+ * the seconds and 10^9 minus the nanoseconds.
+ */
+void stm32h7_eth_ptp_adjust_time(int64_t offset_ns)
+{
+  uint64_t mag = (offset_ns < 0) ? (uint64_t)(-offset_ns) : (uint64_t)offset_ns;
+  uint32_t sec = (uint32_t)(mag / ETH_PTP_NSEC_PER_SEC);
+  uint32_t nsec = (uint32_t)(mag % ETH_PTP_NSEC_PER_SEC);
+
+  LOCK_TCPIP_CORE();
+  if (offset_ns < 0) {
+    heth.Instance->MACSTSUR = 0U - sec;
+    heth.Instance->MACSTNUR = 0x80000000 | (nsec ? (ETH_PTP_NSEC_PER_SEC - nsec) : 0U);   /* ADDSUB */
+  } else {
+    heth.Instance->MACSTSUR = sec;
+    heth.Instance->MACSTNUR = nsec;
+  }
+  stm32h7_eth_ptp_cmd(ETH_MACTSCR_TSUPDT);
+  UNLOCK_TCPIP_CORE();
+}
+
+/**
+ * Trim the clock rate by `ppb` parts per billion (clamped to
+ * +/-ETH_PTP_MAX_PPB) relative to the nominal addend.
+ */
+void stm32h7_eth_ptp_adjust_freq(int32_t ppb)
+{
+  if (ppb > ETH_PTP_MAX_PPB) {
+    ppb = ETH_PTP_MAX_PPB;
+  } else if (ppb < -ETH_PTP_MAX_PPB) {
+    ppb = -ETH_PTP_MAX_PPB;
+  }
+
+  LOCK_TCPIP_CORE();
+  heth.Instance->MACTSAR = (uint32_t)((int64_t)PtpAddendBase +
+                                      ((int64_t)PtpAddendBase * ppb) / ETH_PTP_NSEC_PER_SEC);
+  stm32h7_eth_ptp_cmd(ETH_MACTSCR_TSADDREG);
+  UNLOCK_TCPIP_CORE();
+}
+
+/**
+ * Fetch the timestamp of the most recent frame transmitted with
+ * PBUF_FLAG_TX_TSTAMP set on one of its pbufs. This is the only way to read
+ * TX timestamps; sockets do not deliver them.
+ *
+ * @return sequence number of that timestamp, 0 if none was taken yet;
+ *         compare it before and after a send to match the two up
+ */
+uint32_t stm32h7_eth_ptp_get_tx_timestamp(stm32h7_eth_ptp_time_t *ts)
+{
+  uint32_t seq;
+
+  LOCK_TCPIP_CORE();
+  stm32h7_eth_reclaim_tx();
+  *ts = PtpTxTs;
+  seq = PtpTxTsSeq;
+  UNLOCK_TCPIP_CORE();
+  return seq;
+}
+
+/* Built-in PI servo. A correction of offset * 1000 / interval_ms ppb would
+ * remove the offset within one interval; take 70% of it proportionally and
+ * accumulate 30% in the integral term, which converges on the oscillator's
+ * static frequency error. */
+static int32_t stm32h7_eth_ptp_pi_servo(int64_t offset_ns, uint32_t interval_ms)
+{
+  int64_t ppb;
+
+  PtpServoIntegral += (offset_ns * 300) / interval_ms;
+  if (PtpServoIntegral > ETH_PTP_MAX_PPB) {
+    PtpServoIntegral = ETH_PTP_MAX_PPB;
+  } else if (PtpServoIntegral < -ETH_PTP_MAX_PPB) {
+    PtpServoIntegral = -ETH_PTP_MAX_PPB;
+  }
+  ppb = (offset_ns * 700) / interval_ms + PtpServoIntegral;
+
+  /* Running ahead of the master (positive offset) means slowing down */
+  if (ppb > ETH_PTP_MAX_PPB) {
+    ppb = ETH_PTP_MAX_PPB;
+  } else if (ppb < -ETH_PTP_MAX_PPB) {
+    ppb = -ETH_PTP_MAX_PPB;
+  }
+  return (int32_t)-ppb;
+}
+
+/**
+ * Install the servo used by stm32h7_eth_ptp_servo_sample(); NULL restores
+ * the built-in PI servo.
+ */
+void stm32h7_eth_ptp_set_servo(stm32h7_eth_ptp_servo_fn servo)
+{
+  PtpServo = servo;
+  PtpServoIntegral = 0;
+}
+
+/**
+ * Feed one offset measurement (local minus master, from the PTP stack's
+ * Sync/Delay_Req exchange) to the servo. Offsets beyond
+ * ETH_PTP_STEP_THRESHOLD_NS step the clock, smaller ones slew it.
+ */
+void stm32h7_eth_ptp_servo_sample(int64_t offset_ns, uint32_t interval_ms)
+{
+  if (interval_ms == 0) {
+    interval_ms = 1000;
+  }
+
+  if ((offset_ns > ETH_PTP_STEP_THRESHOLD_NS) || (offset_ns < -ETH_PTP_STEP_THRESHOLD_NS)) {
+    stm32h7_eth_ptp_adjust_time(-offset_ns);
+    PtpServoIntegral = 0;
+    return;
+  }
+
+  stm32h7_eth_ptp_adjust_freq(PtpServo != NULL ? PtpServo(offset_ns, interval_ms) :
+                              stm32h7_eth_ptp_pi_servo(offset_ns, interval_ms));
+}
+#endif /* ETH_PTP_ENABLE */
+
+/* USER CODE END 4 */
+
+/*******************************************************************************
+                       LL Driver Interface ( LwIP stack --> ETH)
+*******************************************************************************/
+/**
+ * @brief In this function, the hardware should be initialized.
+ * Called from ethernetif_init().
+ *
+ * @param netif the already initialized lwip network interface structure
+ *        for this ethernetif
+ */
+static void low_level_init(struct netif *netif)
+{
+  HAL_StatusTypeDef hal_eth_init_status = HAL_OK;
+
+//  uint32_t duplex, speed = 0;
+//  int32_t PHYLinkState = 0;
+//  ETH_MACConfigTypeDef MACConf = {0};
+  /* Start ETH HAL Init */
+  MPU_Config();
+
+  /* ETH_CODE: Hot-path events go to the binary trace ring, not the console */
+  stm32h7_eth_trace_init();
+
+  TRACE_PRINTF("DEBUG: RX ring %u, TX ring %u, RX buffers %u, TX bounce slots %u (HAL ETH_RX_DESC_CNT %u)\n",
+         (unsigned int)ETH_RX_RING_SIZE, (unsigned int)ETH_TX_RING_SIZE,
+         (unsigned int)ETH_RX_BUFFER_CNT, (unsigned int)ETH_TX_BOUNCE_CNT, (unsigned int)ETH_RX_DESC_CNT);
+  TRACE_PRINTF("DEBUG: RX desc 0x%08lx, TX desc 0x%08lx, RX pool 0x%08lx, TX bounce 0x%08lx\n",
+         (unsigned long)ETH_RX_DESC_ADDR, (unsigned long)ETH_TX_DESC_ADDR,
+         (unsigned long)RX_POOL_BASE_ADDR, (unsigned long)ETH_TX_BUFFER_ADDR);
+
+   static uint8_t MACAddr[6] ;
+  heth.Instance = ETH;
+  MACAddr[0] = 0x00;
+  MACAddr[1] = 0x80;
+  MACAddr[2] = 0xE1;
+  MACAddr[3] = 0x00;
+  MACAddr[4] = 0x00;
+  MACAddr[5] = 0x00;
+  heth.Init.MACAddr = &MACAddr[0];
+ heth.Init.MediaInterface = HAL_ETH_RMII_MODE;
+ /* Suppress warning about packed structure pointer conversion */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Waddress-of-packed-member"
+ heth.Init.TxDesc = (ETH_DMADescTypeDef *)DMATxDscrTab;
+ heth.Init.RxDesc = (ETH_DMADescTypeDef *)DMARxDscrTab;
+#pragma GCC diagnostic pop
+ /* ETH_CODE: The DMA writes from buff + ETH_PAD_SIZE, and RBSZ must be a
+  * multiple of 4. Frames longer than this span several descriptors. */
+ heth.Init.RxBuffLen = (ETH_RX_BUFFER_SIZE - ETH_PAD_SIZE) & ~3U;
+
+ /* USER CODE END MACADDRESS */
+ 
+ /* Disable ETH interrupt before installing handler */
+ HAL_NVIC_DisableIRQ(ETH_IRQn);
+
+ TRACE_PRINTF("Ethernet MAC: %02x:%02x:%02x:%02x:%02x:%02x\n",
+         MACAddr[0], MACAddr[1], MACAddr[2], MACAddr[3], MACAddr[4], MACAddr[5]);
+
+  /* ETH_CODE: Zero out descriptor and RX pool memory before use */
+  memset(DMARxDscrTab, 0, ETH_RX_RING_SIZE * sizeof(ETH_DMADescTypeDef_Shadow));
+  memset(DMATxDscrTab, 0, ETH_TX_RING_SIZE * sizeof(ETH_DMADescTypeDef_Shadow));
+  memset((void *)RX_POOL_BASE_ADDR, 0, RX_POOL_SIZE);
+
+  /* ETH_CODE: Initialize the RX POOL before calling HAL_ETH_Init */
+  TRACE_PRINTF("Initializing RX pool at 0x%08lx...\n", (unsigned long)RX_POOL_BASE_ADDR);
+  LWIP_MEMPOOL_INIT(RX_POOL);
+
+  /* ETH_CODE: All TX bounce slots start out free */
+  stm32h7_eth_tx_bounce_init();
+
+  hal_eth_init_status = HAL_ETH_Init(&heth);
+  
+  if (hal_eth_init_status == HAL_OK) {
+    /* Register callbacks required for HAL_ETH_ReadData and Transmit */
+    HAL_ETH_RegisterRxAllocateCallback(&heth, HAL_ETH_RxAllocateCallback);
+    HAL_ETH_RegisterTxFreeCallback(&heth, HAL_ETH_TxFreeCallback);
+    HAL_ETH_RegisterRxLinkCallback(&heth, HAL_ETH_RxLinkCallback);
+
+    /* ETH_CODE: Manually commit descriptor list addresses and lengths to hardware registers.
+     * This is critical because the HAL version in this environment lacks 
+     * HAL_ETH_DMARxDescListInit and doesn't appear to commit them in HAL_ETH_Init. */
+    heth.Instance->DMACRDLAR = (uint32_t)heth.Init.RxDesc;
+    heth.Instance->DMACRDRLR = ETH_RX_RING_SIZE - 1; /* Ring Length (N-1) */
+    
+    heth.Instance->DMACTDLAR = (uint32_t)heth.Init.TxDesc;
+    heth.Instance->DMACTDRLR = ETH_TX_RING_SIZE - 1; /* Ring Length (N-1) */
+    
+    __DSB();
+
+#if ETH_PTP_ENABLE
+    stm32h7_eth_ptp_init();
+#endif
+
+    /* ETH_CODE: The driver tracks both rings itself (RxDescIdx/RxBuildDescIdx,
+     * TxDescHead/TxDescTail). heth.RxDescList/TxDescList are sized by the
+     * precompiled HAL and are deliberately left untouched. */
+    RxDescIdx = 0;
+    RxBuildDescIdx = 0;
+    RxBuildDescCnt = 0; /* Will be incremented during buffer allocation */
+
+    TRACE_PRINTF("ETH: DMA Descriptors committed to hardware: RXaddr=0x%08lx, RXlen=%lu, TXaddr=0x%08lx, TXlen=%lu\n",
+           (unsigned long)heth.Instance->DMACRDLAR, (unsigned long)(heth.Instance->DMACRDRLR + 1),
+           (unsigned long)heth.Instance->DMACTDLAR, (unsigned long)(heth.Instance->DMACTDRLR + 1));
+
+
+    TRACE_PRINTF("Installing ETH interrupt handler for vector %lu...\n", (unsigned long)ETH_IRQn);
+    rtems_status_code sc = rtems_interrupt_handler_install(
+      ETH_IRQn,
+      "ETH",
+      RTEMS_INTERRUPT_UNIQUE,
+      stm32h7_eth_interrupt_handler,
+      NULL
+    );
+    if (sc != RTEMS_SUCCESSFUL) {
+      TRACE_PRINTF("ERROR: Failed to install ETH interrupt handler: %d\n", (int)sc);
+      hal_eth_init_status = HAL_ERROR;
+    } else {
+      TRACE_PRINTF("ETH interrupt handler installed successfully\n");
+      /* ETH_CODE: Explicitly enable the interrupt vector in RTEMS */
+      rtems_interrupt_vector_enable(ETH_IRQn);
+
+      /* Enable ETH interrupt after successful handler installation */
+      HAL_NVIC_SetPriority(ETH_IRQn, 0x5, 0); /* Slightly higher priority */
+      HAL_NVIC_EnableIRQ(ETH_IRQn);
+      
+      /* diagnostic: check if IRQ is enabled */
+      TRACE_PRINTF("ETH: IRQ %lu enabled in NVIC\n", (unsigned long)ETH_IRQn);
+    }
+  }
+
+  memset(&TxConfig, 0 , sizeof(ETH_TxPacketConfig));
+  TxConfig.Attributes = ETH_TX_PACKETS_FEATURES_CSUM | ETH_TX_PACKETS_FEATURES_CRCPAD;
+  TxConfig.ChecksumCtrl = ETH_CHECKSUM_IPHDR_PAYLOAD_INSERT_PHDR_CALC;
+  TxConfig.CRCPadCtrl = ETH_CRC_PAD_INSERT;
+
+  /* End ETH HAL Init */
+
+#if CHECKSUM_BY_HARDWARE
+  /* ETH_CODE: The MAC inserts the IPv4 header and TCP/UDP checksums on TX
+   * (DESC3 CIC), so lwIP skips that work on this netif. ICMP/ICMPv6 stay in
+   * software, and so do UDP datagrams that IP will fragment: the MAC does
+   * not insert a checksum into fragments, so udp_sendto_if_src() computes
+   * it instead. On RX the MAC verifies checksums too (MACCR IPC, reported in
+   * RDES1), but not for every frame: the checks stay on and lwIP skips only
+   * those stm32h7_eth_rx_csum_verified() reports for a pbuf. */
+  NETIF_SET_CHECKSUM_CTRL(netif, NETIF_CHECKSUM_GEN_ICMP | NETIF_CHECKSUM_GEN_ICMP6 |
+                                 NETIF_CHECKSUM_CHECK_IP | NETIF_CHECKSUM_CHECK_UDP |
+                                 NETIF_CHECKSUM_CHECK_TCP | NETIF_CHECKSUM_CHECK_ICMP |
+                                 NETIF_CHECKSUM_CHECK_ICMP6);
+#if LWIP_TCP_TSO
+  /* ETH_CODE: The DMA cuts TCP frames of up to ETH_TSO_MAX_SIZE payload
+   * bytes into MSS-sized segments and checksums each one. A TSO frame must
+   * fit the TX ring with its context descriptor even if every buffer ends
+   * up in a descriptor of its own. */
+  netif->tso_max_size = ETH_TSO_MAX_SIZE;
+  netif->tso_max_bufs = ETH_TX_RING_USABLE - 2U;
+#endif /* LWIP_TCP_TSO */
+#endif /* CHECKSUM_BY_HARDWARE */
+#if LWIP_VLAN_OFFLOAD
+  /* ETH_CODE: The MAC inserts, strips and filters 802.1Q tags */
+  netif->vlan_offload = NETIF_VLAN_OFFLOAD_TX | NETIF_VLAN_OFFLOAD_RX;
+#endif
+#if ETH_ARP_OFFLOAD
+  /* ETH_CODE: MACARPAR follows the netif address, programmed at link up */
+  ArpOffloadNetif = netif;
+  netif_add_ext_callback(&ArpOffloadCallback, stm32h7_eth_arp_offload_status);
+#endif
+#if ETH_L34_FILTER
+  /* ETH_CODE: The automatic L3/L4 filters stand down while IPv6 is in use */
+  L34Netif = netif;
+#if LWIP_IPV6
+  netif_add_ext_callback(&L34Callback, stm32h7_eth_l34_status);
+#endif
+#endif
+
+  /* ETH_CODE: RX pool initialization moved before HAL_ETH_Init */
 
 #if LWIP_ARP || LWIP_ETHERNET
 
@@ -576,102 +1835,623 @@ static void low_level_init(struct netif *netif)
   /* maximum transfer unit */
   netif->mtu = ETH_MAX_PAYLOAD;
 
-  /* Accept broadcast address and ARP traffic */
-  /* don't set NETIF_FLAG_ETHARP if this device is not an ethernet one */
-  #if LWIP_ARP
-    netif->flags |= NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP;
-  #else
-    netif->flags |= NETIF_FLAG_BROADCAST;
-  #endif /* LWIP_ARP */
+  /* Accept broadcast address and ARP traffic */
+  /* don't set NETIF_FLAG_ETHARP if this device is not an ethernet one */
+  #if LWIP_ARP
+    netif->flags |= NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP;
+  #else
+    netif->flags |= NETIF_FLAG_BROADCAST;
+  #endif /* LWIP_ARP */
+
+  /* Multicast groups are filtered by the MAC, lwIP tells us which ones */
+  #if LWIP_IGMP
+    netif->flags |= NETIF_FLAG_IGMP;
+    netif_set_igmp_mac_filter(netif, stm32h7_eth_igmp_mac_filter);
+  #endif /* LWIP_IGMP */
+  #if LWIP_IPV6 && LWIP_IPV6_MLD
+    netif->flags |= NETIF_FLAG_MLD6;
+    netif_set_mld_mac_filter(netif, stm32h7_eth_mld_mac_filter);
+    {
+      /* All-nodes (ff02::1) is never joined through MLD but must be received */
+      const uint8_t all_nodes[ETH_HWADDR_LEN] = { 0x33, 0x33, 0x00, 0x00, 0x00, 0x01 };
+      stm32h7_eth_update_mac_filter(all_nodes, NETIF_ADD_MAC_FILTER);
+    }
+  #endif /* LWIP_IPV6 && LWIP_IPV6_MLD */
+
+  TRACE_PRINTF("Creating RxPktSemaphore...\n");
+  /* create a binary semaphore used for informing ethernetif of frame reception */
+  if (sys_sem_new(&RxPktSemaphore, 0) != ERR_OK) {
+        /* Handle error */
+        TRACE_PRINTF("ERROR: Failed to create RxPktSemaphore\n");
+  }
+
+  TRACE_PRINTF("Creating TxPktSemaphore...\n");
+  /* create a binary semaphore used for informing ethernetif of frame transmission */
+  if (sys_sem_new(&TxPktSemaphore, 0) != ERR_OK) {
+        /* Handle error */
+        TRACE_PRINTF("ERROR: Failed to create TxPktSemaphore\n");
+  }
+
+  /* NOTE: Ethernet threads will be created AFTER PHY init to avoid race conditions */
+
+/* USER CODE BEGIN PHY_PRE_CONFIG */
+
+/* USER CODE END PHY_PRE_CONFIG */
+  TRACE_PRINTF("Registering PHY IO...\n");
+  TRACE_PRINTF("LAN8742 object at: 0x%p\n", &LAN8742);
+  TRACE_PRINTF("IOCtx at: 0x%p\n", &LAN8742_IOCtx);
+  TRACE_PRINTF("IOCtx.Init = 0x%p\n", LAN8742_IOCtx.Init);
+  TRACE_PRINTF("IOCtx.DeInit = 0x%p\n", LAN8742_IOCtx.DeInit);
+  TRACE_PRINTF("IOCtx.WriteReg = 0x%p\n", LAN8742_IOCtx.WriteReg);
+  TRACE_PRINTF("IOCtx.ReadReg = 0x%p\n", LAN8742_IOCtx.ReadReg);
+  TRACE_PRINTF("IOCtx.GetTick = 0x%p\n", LAN8742_IOCtx.GetTick);
+  
+  /* Test HAL_GetTick before PHY init */
+  TRACE_PRINTF("Testing HAL_GetTick: %lu\n", (unsigned long)HAL_GetTick());
+  rtems_task_wake_after(RTEMS_MILLISECONDS_TO_TICKS(100));
+  TRACE_PRINTF("After 100ms delay, HAL_GetTick: %lu\n", (unsigned long)HAL_GetTick());
+  
+  /* Set PHY IO functions  */
+  LAN8742.DevAddr = 0;
+  LAN8742.Is_Initialized = 0;
+  LAN8742_RegisterBusIO(&LAN8742, &LAN8742_IOCtx);
+  LAN8742_Init(&LAN8742);
+
+  if (hal_eth_init_status != HAL_OK)
+  {
+    Error_Handler();
+  }
+#endif /* LWIP_ARP || LWIP_ETHERNET */
+
+/* USER CODE BEGIN LOW_LEVEL_INIT */
+  
+  /* Create the Ethernet threads. Hardware will be started by EthLink thread. */
+  TRACE_PRINTF("Creating Ethernet threads...\n");
+  sys_thread_new("EthIf", ethernetif_input, netif, INTERFACE_THREAD_STACK_SIZE, TCPIP_THREAD_PRIO);
+  sys_thread_new("EthLink", ethernet_link_thread, netif, INTERFACE_THREAD_STACK_SIZE, TCPIP_THREAD_PRIO);
+
+/* USER CODE END LOW_LEVEL_INIT */
+}
+
+/**
+ * This function should do the actual transmission of the packet. The packet is
+ * contained in the pbuf that is passed to the function. This pbuf
+ * might be chained.
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ * @param p the MAC packet to send (e.g. IP packet including MAC addresses and type)
+ * @return ERR_OK if the packet could be sent
+ *         an err_t value if the packet couldn't be sent
+ *
+ * @note Returning ERR_MEM here if a DMA queue of your MAC is full can lead to
+ *       strange results. You might consider waiting for space in the DMA queue
+ *       to become available since the stack doesn't retry to send a packet
+ *       dropped because of memory failure (except for the TCP timers).
+ */
+
+/**
+ * Check whether a buffer lies entirely in memory the ETH DMA can fetch from.
+ */
+static int stm32h7_eth_dma_reachable(const void *addr, uint32_t len)
+{
+  uint32_t start = (uint32_t)addr;
+  uint32_t end = start + len;
+
+  if (start >= ETH_DMA_D1_SRAM_START && end <= ETH_DMA_D1_SRAM_END) {
+    return 1;
+  }
+  if (start >= ETH_DMA_D2_SRAM_START && end <= ETH_DMA_D2_SRAM_END) {
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * Clean every cache line overlapped by [addr, addr + len). pbuf payloads are
+ * not cache-line aligned, so round the range out to whole lines.
+ */
+static void stm32h7_eth_clean_dcache(const void *addr, uint32_t len)
+{
+  uint32_t start = (uint32_t)addr & ~31U;
+  uint32_t end = ((uint32_t)addr + len + 31U) & ~31U;
+
+  SCB_CleanDCache_by_Addr((uint32_t *)start, (int32_t)(end - start));
+}
+
+/**
+ * Rebuild the free list of the TX bounce pool with every slot available.
+ */
+static void stm32h7_eth_tx_bounce_init(void)
+{
+  for (uint32_t i = 0; i < ETH_TX_BOUNCE_CNT; i++) {
+    TxBounceFree[i] = (uint16_t)(ETH_TX_BOUNCE_CNT - 1 - i);
+  }
+  TxBounceFreeCnt = ETH_TX_BOUNCE_CNT;
+
+  for (uint32_t i = 0; i < ETH_TX_RING_SIZE; i++) {
+    TxDescSlot[i] = ETH_TX_NO_SLOT;
+  }
+}
+
+/**
+ * Take a bounce slot from the pool and attach it to TX descriptor idx.
+ * The caller has already made sure a slot is free.
+ */
+static uint8_t *stm32h7_eth_tx_bounce_alloc(uint32_t idx)
+{
+  LWIP_ASSERT("TX bounce pool empty", TxBounceFreeCnt > 0);
+
+  uint16_t slot = TxBounceFree[--TxBounceFreeCnt];
+  TxDescSlot[idx] = slot;
+  return ETH_TX_BOUNCE_SLOT(slot);
+}
+
+/**
+ * Return the bounce slot attached to TX descriptor idx, if any, to the pool.
+ */
+static void stm32h7_eth_tx_bounce_release(uint32_t idx)
+{
+  if (TxDescSlot[idx] != ETH_TX_NO_SLOT) {
+    TxBounceFree[TxBounceFreeCnt++] = TxDescSlot[idx];
+    TxDescSlot[idx] = ETH_TX_NO_SLOT;
+  }
+}
+
+/**
+ * Walk the TX ring from TxDescTail and hand back every descriptor the DMA
+ * has finished with (OWN=0). The ETH IRQ only signals TxPktSemaphore; the
+ * actual reclaim runs here in thread context, serialized with
+ * low_level_output() by the tcpip core lock.
+ */
+static void stm32h7_eth_reclaim_tx(void)
+{
+  while (TxDescInFlight > 0) {
+    ETH_DMADescTypeDef_Shadow *d = &DMATxDscrTab[TxDescTail];
+
+    ETH_DESC_CACHE_INVALIDATE(d, sizeof(ETH_DMADescTypeDef_Shadow));
+    if ((d->DESC3 & 0x80000000) != 0) {
+      /* Still owned by DMA, everything after it is too */
+      break;
+    }
+
+    ETH_TRACE2(TX_RECLAIM, TxDescTail, d->DESC3);
+#if ETH_PTP_ENABLE
+    /* Write-back of a Last Desc with TTSS (bit 17): TDES0 = ns, TDES1 = s */
+    if ((d->DESC3 & (0x10000000 | 0x00020000)) == (0x10000000 | 0x00020000)) {
+      PtpTxTs.nsec = d->DESC0;
+      PtpTxTs.sec = d->DESC1;
+      PtpTxTsSeq = (PtpTxTsSeq + 1 == 0) ? 1 : PtpTxTsSeq + 1;
+      if (TxPbufTab[TxDescTail] != NULL) {
+        TxPbufTab[TxDescTail]->ts_sec = PtpTxTs.sec;
+        TxPbufTab[TxDescTail]->ts_nsec = PtpTxTs.nsec;
+      }
+    }
+#endif
+    if (TxPbufTab[TxDescTail] != NULL) {
+      HAL_ETH_TxFreeCallback((uint32_t *)TxPbufTab[TxDescTail]);
+      TxPbufTab[TxDescTail] = NULL;
+    }
+    stm32h7_eth_tx_bounce_release(TxDescTail);
+    DMATxDscrBackup[TxDescTail] = 0;
+    TxDescTail = (TxDescTail + 1) % ETH_TX_RING_SIZE;
+    TxDescInFlight--;
+  }
+}
+
+/**
+ * Put the TX ring back into its power-on state. Must only be called while
+ * the TX DMA is stopped, since it rewrites the descriptor list address.
+ */
+static void stm32h7_eth_reset_tx_ring(void)
+{
+  for (uint32_t i = 0; i < ETH_TX_RING_SIZE; i++) {
+    if (TxPbufTab[i] != NULL) {
+      HAL_ETH_TxFreeCallback((uint32_t *)TxPbufTab[i]);
+      TxPbufTab[i] = NULL;
+    }
+  }
+
+  memset(DMATxDscrTab, 0, ETH_TX_RING_SIZE * sizeof(ETH_DMADescTypeDef_Shadow));
+  ETH_DESC_CACHE_CLEAN(DMATxDscrTab, ETH_TX_RING_SIZE * sizeof(ETH_DMADescTypeDef_Shadow));
+  memset(DMATxDscrBackup, 0, sizeof(DMATxDscrBackup));
+  stm32h7_eth_tx_bounce_init();
+
+  TxDescHead = 0;
+  TxDescTail = 0;
+  TxDescInFlight = 0;
+#if LWIP_TCP_TSO
+  TxTsoMss = 0;
+#endif
+#if LWIP_VLAN_OFFLOAD
+  TxVlanTag = ETH_VLAN_TAG_NONE;
+#endif
+
+  /* Rewriting the list address also resets the DMA's current descriptor */
+  heth.Instance->DMACTDLAR = (uint32_t)DMATxDscrTab;
+  heth.Instance->DMACTDRLR = ETH_TX_RING_SIZE - 1;
+  __DSB();
+}
+
+/**
+ * Reclaim completed descriptors and only block if the ring or the bounce
+ * pool still cannot take desc_cnt descriptors and bounce_cnt slots.
+ * TxPktSemaphore is signalled from HAL_ETH_TxCpltCallback.
+ */
+static err_t stm32h7_eth_tx_wait(uint32_t desc_cnt, uint32_t bounce_cnt)
+{
+  stm32h7_eth_reclaim_tx();
+  while (TxDescInFlight + desc_cnt > ETH_TX_RING_USABLE || bounce_cnt > TxBounceFreeCnt) {
+    ETH_TRACE2(TX_RING_FULL, TxDescInFlight, TxBounceFreeCnt);
+    uint32_t waited = sys_arch_sem_wait(&TxPktSemaphore, ETH_DMA_TRANSMIT_TIMEOUT);
+    stm32h7_eth_reclaim_tx();
+    if (waited == SYS_ARCH_TIMEOUT &&
+        (TxDescInFlight + desc_cnt > ETH_TX_RING_USABLE || bounce_cnt > TxBounceFreeCnt)) {
+      ETH_TRACE1(TX_TIMEOUT, TxDescTail);
+      ETH_STATS_BEGIN(ETH_STATS_TX);
+      EthTxStats.timeouts++;
+      ETH_STATS_END(ETH_STATS_TX);
+      return ERR_TIMEOUT;
+    }
+  }
+  return ERR_OK;
+}
+
+#if LWIP_TCP_TSO || LWIP_VLAN_OFFLOAD
+/**
+ * Fill a TX context descriptor, which the DMA keeps applying to the frames
+ * that follow it.
+ * DESC2: MSS [13:0]
+ * DESC3: OWN | CTXT (bit 30) | TCMSSV (bit 26, MSS valid) |
+ *        VLTV (bit 16, VT valid) | VT [15:0] (802.1Q tag)
+ *
+ * @param mss the TSO segment size, 0 to keep the current one
+ * @param tag the VLAN tag to insert, ETH_VLAN_TAG_NONE to keep the current one
+ */
+static void stm32h7_eth_fill_ctx_desc(uint32_t idx, uint32_t mss, uint32_t tag)
+{
+  ETH_DMADescTypeDef_Shadow *ctxdesc = &DMATxDscrTab[idx];
+  uint32_t desc3 = 0x80000000 | 0x40000000;
+
+  if (mss != 0) {
+    desc3 |= 0x04000000;
+  }
+  if (tag <= 0xFFFFU) {
+    desc3 |= 0x00010000 | tag;
+  }
+  ctxdesc->DESC0 = 0;
+  ctxdesc->DESC1 = 0;
+  ctxdesc->DESC2 = mss & 0x3FFF;
+  DMATxDscrBackup[idx] = 0;
+  ctxdesc->DESC3 = desc3;
+  ETH_DESC_CACHE_CLEAN(ctxdesc, sizeof(ETH_DMADescTypeDef_Shadow));
+
+  ETH_TRACE3(TX_DESC, idx, ctxdesc->DESC2, desc3);
+}
+#endif /* LWIP_TCP_TSO || LWIP_VLAN_OFFLOAD */
+
+/* The 802.1Q tag lwIP asks the MAC to insert into p, ETH_VLAN_TAG_NONE if none */
+static inline uint32_t stm32h7_eth_tx_vlan_tag(const struct pbuf *p)
+{
+#if LWIP_VLAN_OFFLOAD
+  if (p->flags & PBUF_FLAG_VLAN) {
+    return p->vlan_tci;
+  }
+#else
+  (void)p;
+#endif
+  return ETH_VLAN_TAG_NONE;
+}
+
+/**
+ * Fill one TX descriptor with up to two buffers.
+ * DESC2: bit 31 (IOC) on the last descriptor only, B2L [29:16], B1L [13:0];
+ *        `ctrl2` adds per-frame bits (TTSE, bit 30; VTIR [15:14]) on the
+ *        first descriptor.
+ * DESC3: OWN | FD (first) | LD (last) | CPC=00 (CRC + pad insertion),
+ *        FL [14:0] holds the frame length and `ctrl` the per-frame control
+ *        bits (CIC [17:16], or TSE/THL/TPL for TSO) on the first descriptor.
+ */
+static void stm32h7_eth_fill_tx_desc(uint32_t idx, uint32_t buf1, uint32_t len1,
+                                     uint32_t buf2, uint32_t len2,
+                                     uint32_t first, uint32_t last, uint32_t frame_len,
+                                     uint32_t ctrl, uint32_t ctrl2)
+{
+  ETH_DMADescTypeDef_Shadow *txdesc = &DMATxDscrTab[idx];
+  uint32_t desc2 = (len1 & 0x3FFF) | ((len2 & 0x3FFF) << 16);
+  uint32_t desc3 = 0x80000000;
+
+  if (last) {
+    desc2 |= 0x80000000;
+    desc3 |= 0x10000000;
+  }
+  if (first) {
+    desc2 |= ctrl2;
+    desc3 |= 0x20000000 | ctrl | (frame_len & 0x7FFF);
+  }
+
+  txdesc->DESC0 = buf1;
+  DMATxDscrBackup[idx] = buf1;
+  txdesc->DESC1 = buf2;
+  txdesc->DESC2 = desc2;
+  txdesc->DESC3 = desc3;
+  ETH_DESC_CACHE_CLEAN(txdesc, sizeof(ETH_DMADescTypeDef_Shadow));
+
+  ETH_TRACE3(TX_DESC, idx, desc2, desc3);
+}
+
+#if LWIP_TCP_TSO
+/**
+ * Lay the buffers of a TSO frame out on TX descriptors starting at idx, or
+ * only count them (fill 0). The first hlen bytes of the first pbuf are the
+ * Ethernet, IP and TCP headers, which the DMA repeats in front of every
+ * segment; they go alone into buffer 1 of the first descriptor. tcp_output()
+ * builds them as a pbuf of their own, but a frame etharp queued is a single
+ * pbuf_clone() copy with the payload right behind them. Payload follows two
+ * buffers per descriptor, split at the 14-bit buffer length. Buffers the DMA cannot
+ * reach are copied into the descriptor's bounce slot in chunks of at most
+ * one slot, and only share a descriptor while the slot has room.
+ *
+ * @return number of descriptors; *bounce_cnt receives the slots used
+ */
+static uint32_t stm32h7_eth_tso_map(struct pbuf *p, uint32_t hlen, uint32_t idx, uint32_t ctrl,
+                                    uint32_t ctrl2, uint32_t fill, uint32_t *bounce_cnt)
+{
+  struct pbuf *q;
+  uint32_t buf[2] = {0, 0};
+  uint32_t len[2] = {0, 0};
+  uint32_t nbuf = 0;
+  uint32_t desc_cnt = 0;
+  uint8_t *slot_base = NULL;
+  uint32_t slot_off = 0;
+
+  *bounce_cnt = 0;
+  for (q = p; q != NULL; q = q->next) {
+    uint32_t off = 0;
+
+    while (off < q->len) {
+      uint8_t *addr = (uint8_t *)q->payload + off;
+      uint32_t chunk = q->len - off;
+      int reachable = stm32h7_eth_dma_reachable(addr, chunk);
+      uint32_t chunk_max = reachable ? ETH_TX_DESC_BUF_MAX : ETH_TX_BUFFER_MAX_SIZE;
+
+      if ((q == p) && (off < hlen)) {
+        chunk_max = hlen - off;
+      }
+      if (chunk > chunk_max) {
+        chunk = chunk_max;
+      }
+      if (nbuf == 2 || (nbuf == 1 && !reachable && slot_off + chunk > ETH_TX_BUFFER_MAX_SIZE)) {
+        if (fill) {
+          stm32h7_eth_fill_tx_desc(idx, buf[0], len[0], buf[1], len[1], desc_cnt == 0, 0, 0, ctrl, ctrl2);
+        }
+        idx = (idx + 1) % ETH_TX_RING_SIZE;
+        desc_cnt++;
+        buf[0] = buf[1] = 0;
+        len[0] = len[1] = 0;
+        nbuf = 0;
+        slot_base = NULL;
+        slot_off = 0;
+      }
+
+      if (reachable) {
+        if (fill) {
+          stm32h7_eth_clean_dcache(addr, chunk);
+        }
+      } else {
+        if (slot_off == 0) {
+          (*bounce_cnt)++;
+        }
+        if (fill) {
+          if (slot_base == NULL) {
+            slot_base = stm32h7_eth_tx_bounce_alloc(idx);
+          }
+          memcpy(slot_base + slot_off, addr, chunk);
+          stm32h7_eth_clean_dcache(slot_base + slot_off, chunk);
+          ETH_TRACE2(TX_BOUNCE, addr, chunk);
+          addr = slot_base + slot_off;
+        }
+        slot_off += chunk;
+      }
+      buf[nbuf] = (uint32_t)addr;
+      len[nbuf] = chunk;
+      nbuf++;
+      off += chunk;
+    }
+  }
+
+  if (fill) {
+    stm32h7_eth_fill_tx_desc(idx, buf[0], len[0], buf[1], len[1], desc_cnt == 0, 1, 0, ctrl, ctrl2);
+  }
+  return desc_cnt + 1U;
+}
+
+/**
+ * Queue a TCP frame the stack built for segmentation (p->tso_mss != 0).
+ * The first descriptor carries TSE, the TCP header length and the payload
+ * length; the DMA then sends MSS-sized segments with their own IP length
+ * and ID, sequence number, flags and checksums.
+ */
+static err_t stm32h7_eth_output_tso(struct pbuf *p)
+{
+  const uint8_t *hdr;
+  uint32_t mss = p->tso_mss;
+  uint32_t tag = stm32h7_eth_tx_vlan_tag(p);
+  uint32_t ctrl2 = 0;
+  uint32_t l4_off;
+  uint32_t thl = 0;
+  uint32_t hlen;
+  uint32_t tpl;
+  uint32_t ctrl;
+  uint32_t ctx;
+  uint32_t desc_cnt;
+  uint32_t bounce_cnt;
+  uint32_t idx;
+  err_t err = ERR_OK;
+
+#if defined(ETH_PAD_SIZE) && (ETH_PAD_SIZE > 0)
+  pbuf_header(p, -ETH_PAD_SIZE);
+#endif
 
-  TRACE_PRINTF("Creating RxPktSemaphore...\n");
-  /* create a binary semaphore used for informing ethernetif of frame reception */
-  if (sys_sem_new(&RxPktSemaphore, 0) != ERR_OK) {
-        /* Handle error */
-        TRACE_PRINTF("ERROR: Failed to create RxPktSemaphore\n");
+  /* ETH_CODE: Locate the TCP header behind an IPv4 (IHL) or IPv6 header;
+   * lwIP sends TCP without IPv6 extension headers. */
+  hdr = (const uint8_t *)p->payload;
+  l4_off = p->len;
+  if (p->len >= 34U && hdr[12] == 0x08 && hdr[13] == 0x00) {
+    l4_off = 14U + (hdr[14] & 0x0FU) * 4U;
+  } else if (p->len >= 54U && hdr[12] == 0x86 && hdr[13] == 0xDD) {
+    l4_off = 14U + 40U;
   }
+  if (l4_off + 20U <= p->len) {
+    thl = hdr[l4_off + 12U] >> 4;
+  }
+  hlen = l4_off + thl * 4U;
+  if (thl < 5U || hlen > p->len || p->tot_len == hlen ||
+      p->tot_len - hlen > 0x3FFFFU || mss == 0U) {
+    err = ERR_VAL;
+    goto out;
+  }
+  tpl = p->tot_len - hlen;
 
-  TRACE_PRINTF("Creating TxPktSemaphore...\n");
-  /* create a binary semaphore used for informing ethernetif of frame transmission */
-  if (sys_sem_new(&TxPktSemaphore, 0) != ERR_OK) {
-        /* Handle error */
-        TRACE_PRINTF("ERROR: Failed to create TxPktSemaphore\n");
+  /* DESC3 of the first descriptor: TSE (bit 18), THL [22:19] in 32-bit
+   * words, TPL [17:0] */
+  ctrl = 0x00040000 | (thl << 19) | tpl;
+
+  ctx = (mss != TxTsoMss) ? 1U : 0U;
+#if LWIP_VLAN_OFFLOAD
+  if (tag != ETH_VLAN_TAG_NONE) {
+    ctrl2 = 0x00008000;   /* VTIR = 10: insert the context descriptor's tag */
+    ctx |= (tag != TxVlanTag) ? 1U : 0U;
+  }
+#endif
+  desc_cnt = stm32h7_eth_tso_map(p, hlen, 0, ctrl, ctrl2, 0, &bounce_cnt) + ctx;
+  if (desc_cnt > ETH_TX_RING_USABLE || bounce_cnt > ETH_TX_BOUNCE_CNT) {
+    err = ERR_BUF;
+    goto out;
+  }
+  err = stm32h7_eth_tx_wait(desc_cnt, bounce_cnt);
+  if (err != ERR_OK) {
+    goto out;
   }
 
-  /* NOTE: Ethernet threads will be created AFTER PHY init to avoid race conditions */
+  idx = TxDescHead;
+  if (ctx) {
+    /* ETH_CODE: One context descriptor carries both the MSS and the tag */
+    stm32h7_eth_fill_ctx_desc(idx, mss, tag);
+    TxTsoMss = mss;
+#if LWIP_VLAN_OFFLOAD
+    if (tag != ETH_VLAN_TAG_NONE) {
+      TxVlanTag = tag;
+    }
+#endif
+    idx = (idx + 1) % ETH_TX_RING_SIZE;
+  }
+  idx = (idx + stm32h7_eth_tso_map(p, hlen, idx, ctrl, ctrl2, 1, &bounce_cnt) - 1U) % ETH_TX_RING_SIZE;
 
-/* USER CODE BEGIN PHY_PRE_CONFIG */
+  /* Payload pbufs are DMA'd in place: hold the frame until the last
+   * descriptor is reclaimed */
+  pbuf_ref(p);
+  TxPbufTab[idx] = p;
+  __DSB();
 
-/* USER CODE END PHY_PRE_CONFIG */
-  TRACE_PRINTF("Registering PHY IO...\n");
-  TRACE_PRINTF("LAN8742 object at: 0x%p\n", &LAN8742);
-  TRACE_PRINTF("IOCtx at: 0x%p\n", &LAN8742_IOCtx);
-  TRACE_PRINTF("IOCtx.Init = 0x%p\n", LAN8742_IOCtx.Init);
-  TRACE_PRINTF("IOCtx.DeInit = 0x%p\n", LAN8742_IOCtx.DeInit);
-  TRACE_PRINTF("IOCtx.WriteReg = 0x%p\n", LAN8742_IOCtx.WriteReg);
-  TRACE_PRINTF("IOCtx.ReadReg = 0x%p\n", LAN8742_IOCtx.ReadReg);
-  TRACE_PRINTF("IOCtx.GetTick = 0x%p\n", LAN8742_IOCtx.GetTick);
-  
-  /* Test HAL_GetTick before PHY init */
-  TRACE_PRINTF("Testing HAL_GetTick: %lu\n", (unsigned long)HAL_GetTick());
-  rtems_task_wake_after(RTEMS_MILLISECONDS_TO_TICKS(100));
-  TRACE_PRINTF("After 100ms delay, HAL_GetTick: %lu\n", (unsigned long)HAL_GetTick());
-  
-  /* Set PHY IO functions  */
-  LAN8742.DevAddr = 0;
-  LAN8742.Is_Initialized = 0;
-  LAN8742_RegisterBusIO(&LAN8742, &LAN8742_IOCtx);
-  LAN8742_Init(&LAN8742);
+  TxDescHead = (idx + 1) % ETH_TX_RING_SIZE;
+  TxDescInFlight += desc_cnt;
 
-  if (hal_eth_init_status != HAL_OK)
-  {
-    Error_Handler();
+  ETH_STATS_BEGIN(ETH_STATS_TX);
+  EthTxStats.packets++;
+  EthTxStats.tso++;
+  EthTxStats.tso_segs += (tpl + mss - 1U) / mss;
+  if (tag != ETH_VLAN_TAG_NONE) {
+    EthTxStats.vlan++;
   }
-#endif /* LWIP_ARP || LWIP_ETHERNET */
+  if (bounce_cnt > 0) {
+    EthTxStats.bounced++;
+  }
+  if (TxDescInFlight > EthTxStats.ring_hwm) {
+    EthTxStats.ring_hwm = TxDescInFlight;
+  }
+  if (ETH_TX_BOUNCE_CNT - TxBounceFreeCnt > EthTxStats.bounce_hwm) {
+    EthTxStats.bounce_hwm = ETH_TX_BOUNCE_CNT - TxBounceFreeCnt;
+  }
+  ETH_STATS_END(ETH_STATS_TX);
 
-/* USER CODE BEGIN LOW_LEVEL_INIT */
-  
-  /* Create the Ethernet threads. Hardware will be started by EthLink thread. */
-  TRACE_PRINTF("Creating Ethernet threads...\n");
-  sys_thread_new("EthIf", ethernetif_input, netif, INTERFACE_THREAD_STACK_SIZE, TCPIP_THREAD_PRIO);
-  sys_thread_new("EthLink", ethernet_link_thread, netif, INTERFACE_THREAD_STACK_SIZE, TCPIP_THREAD_PRIO);
+  heth.Instance->DMACTDTPR = (uint32_t)(&DMATxDscrTab[TxDescHead]);
+  __DSB();
 
-/* USER CODE END LOW_LEVEL_INIT */
-}
+  ETH_TRACE3(TX_KICK, &DMATxDscrTab[TxDescHead], desc_cnt, TxDescInFlight);
 
-/**
- * This function should do the actual transmission of the packet. The packet is
- * contained in the pbuf that is passed to the function. This pbuf
- * might be chained.
- *
- * @param netif the lwip network interface structure for this ethernetif
- * @param p the MAC packet to send (e.g. IP packet including MAC addresses and type)
- * @return ERR_OK if the packet could be sent
- *         an err_t value if the packet couldn't be sent
- *
- * @note Returning ERR_MEM here if a DMA queue of your MAC is full can lead to
- *       strange results. You might consider waiting for space in the DMA queue
- *       to become available since the stack doesn't retry to send a packet
- *       dropped because of memory failure (except for the TCP timers).
- */
+out:
+#if defined(ETH_PAD_SIZE) && (ETH_PAD_SIZE > 0)
+  pbuf_header(p, ETH_PAD_SIZE);
+#endif
+  return err;
+}
+#endif /* LWIP_TCP_TSO */
 
 static err_t low_level_output(struct netif *netif, struct pbuf *p)
 {
   struct pbuf *q = NULL;
-  err_t errval = ERR_OK;
-  ETH_BufferTypeDef Txbuffer[ETH_TX_DESC_CNT];
-  uint8_t *tx_bounce_buffer = (uint8_t *)ETH_TX_BUFFER_ADDR;
-  uint32_t total_len = 0;
+  uint32_t seg_cnt = 0;
+  uint32_t desc_cnt;
+  uint32_t bounce_cnt = 0;
+  uint32_t desc_bounce = 0;
+  uint32_t flatten = 0;
+  uint32_t zero_copy = 0;
+  uint32_t ctrl = 0;
+  uint32_t ctrl2 = 0;
+  uint32_t tag = stm32h7_eth_tx_vlan_tag(p);
+#if LWIP_VLAN_OFFLOAD
+  uint32_t ctx = 0;
+#endif
 
-  TRACE_PRINTF("\n========== TX START ==========\n");
-  TRACE_PRINTF("TX: low_level_output called, p=0x%p, tot_len=%u\n", p, (unsigned int)p->tot_len);
+  ETH_TRACE2(TX_START, p, p->tot_len);
+
+#if LWIP_TCP_TSO
+  if (p->tso_mss != 0) {
+    return stm32h7_eth_output_tso(p);
+  }
+#endif
   
   if (p->tot_len > ETH_TX_BUFFER_MAX_SIZE) {
       TRACE_PRINTF("TX ERROR: Packet too large for bounce buffer (%u > %u)\n", (unsigned int)p->tot_len, ETH_TX_BUFFER_MAX_SIZE);
       return ERR_BUF;
   }
 
-  memset(Txbuffer, 0 , ETH_TX_DESC_CNT*sizeof(ETH_BufferTypeDef));
+  /* ETH_CODE: Every descriptor carries two buffers, so a chain of N non-empty
+   * pbufs needs (N + 1) / 2 descriptors, plus one bounce slot for each
+   * descriptor holding a pbuf the DMA cannot reach. Chains longer than the
+   * ring or the bounce pool can hold are flattened into a single slot. */
+  for (q = p; q != NULL; q = q->next) {
+    if (q->len == 0) {
+      continue;
+    }
+    if (!stm32h7_eth_dma_reachable(q->payload, q->len)) {
+      desc_bounce = 1;
+    }
+    if ((++seg_cnt % 2) == 0) {
+      bounce_cnt += desc_bounce;
+      desc_bounce = 0;
+    }
+  }
+  bounce_cnt += desc_bounce;
+  desc_cnt = (seg_cnt + 1) / 2;
+  if (desc_cnt == 0 || desc_cnt > ETH_TX_RING_USABLE || bounce_cnt > ETH_TX_BOUNCE_CNT) {
+    desc_cnt = 1;
+    bounce_cnt = 1;
+    flatten = 1;
+  }
+
+#if LWIP_VLAN_OFFLOAD
+  /* A changed tag goes to the MAC in a context descriptor ahead of the frame */
+  if (tag != ETH_VLAN_TAG_NONE) {
+    ctrl2 |= 0x00008000;   /* VTIR = 10: insert the context descriptor's tag */
+    ctx = (tag != TxVlanTag) ? 1U : 0U;
+    desc_cnt += ctx;
+  }
+#endif
+
+  if (stm32h7_eth_tx_wait(desc_cnt, bounce_cnt) != ERR_OK) {
+    return ERR_TIMEOUT;
+  }
 
   /* ETH_CODE: Remove padding before transmission if ETH_PAD_SIZE is defined.
    * LwIP adds padding to the pbuf payload, which we must skip for the MAC. */
@@ -679,413 +2459,773 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p)
   pbuf_header(p, -ETH_PAD_SIZE);
 #endif
 
-  /* ETH_CODE: Flatten pbuf chain into D2 SRAM bounce buffer */
-  for(q = p; q != NULL; q = q->next)
-  {
-    memcpy(tx_bounce_buffer + total_len, q->payload, q->len);
-    TRACE_PRINTF("TX: Copied %u bytes from 0x%p to 0x%p (Offset %lu)\n", 
-           (unsigned int)q->len, q->payload, (tx_bounce_buffer + total_len), (unsigned long)total_len);
-    total_len += q->len;
+#if CHECKSUM_BY_HARDWARE
+  /* Let the MAC fill in the checksums lwIP leaves to it on this netif */
+  if ((TxConfig.Attributes & ETH_TX_PACKETS_FEATURES_CSUM) &&
+      (!NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_IP) ||
+       !NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_UDP) ||
+       !NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_TCP))) {
+    ctrl = TxConfig.ChecksumCtrl;
   }
+#endif
 
-  /* ETH_CODE: Insane Logging - Hex Dump of Bounce Buffer */
-  TRACE_PRINTF("TX DATA DUMP (%lu bytes):\n", (unsigned long)total_len);
-  for(uint32_t k=0; k<total_len; k++) {
-       if(k%16 == 0) TRACE_PRINTF("\n  %04x: ", (unsigned int)k);
-       TRACE_PRINTF("%02x ", tx_bounce_buffer[k]);
+#if ETH_PTP_ENABLE
+  /* Timestamp the frame (TTSE) if the sender asked for it on any of its pbufs */
+  for (q = p; q != NULL; q = q->next) {
+    if (q->flags & PBUF_FLAG_TX_TSTAMP) {
+      ctrl2 |= 0x40000000;
+      break;
+    }
   }
-  TRACE_PRINTF("\n\n");
+#endif
 
-  /* ETH_CODE: Setup TxConfig to use the single bounce buffer */
-  Txbuffer[0].buffer = tx_bounce_buffer;
-  Txbuffer[0].len = total_len;
-  Txbuffer[0].next = NULL;
+  uint32_t frame_len = p->tot_len;
+  uint32_t first_idx = TxDescHead;
+  uint32_t idx;
 
-  TxConfig.Length = total_len;
-  TxConfig.TxBuffer = Txbuffer;
-  TxConfig.pData = p;
+#if LWIP_VLAN_OFFLOAD
+  if (ctx) {
+    stm32h7_eth_fill_ctx_desc(first_idx, 0, tag);
+    TxVlanTag = tag;
+    first_idx = (first_idx + 1) % ETH_TX_RING_SIZE;
+  }
+#endif
+  idx = first_idx;
 
-  pbuf_ref(p);
+  if (flatten) {
+    /* ETH_CODE: Flatten pbuf chain into a D2 SRAM bounce slot */
+    uint8_t *tx_bounce_buffer = stm32h7_eth_tx_bounce_alloc(idx);
+    uint32_t total_len = 0;
 
-  /* ETH_CODE: Clean D2 Cache for the bounce buffer to ensure DMA sees the data */
-  SCB_CleanDCache_by_Addr((uint32_t *)tx_bounce_buffer, total_len);
+    for (q = p; q != NULL; q = q->next) {
+      memcpy(tx_bounce_buffer + total_len, q->payload, q->len);
+      total_len += q->len;
+    }
+    stm32h7_eth_clean_dcache(tx_bounce_buffer, total_len);
+    ETH_TRACE1(TX_FLATTEN, total_len);
 
-  /* ========== MANUAL TX DESCRIPTOR MANAGEMENT ========== */
-  /* Get current TX descriptor index */
-  static uint32_t tx_desc_idx = 0;
-  ETH_DMADescTypeDef_Shadow *txdesc = &DMATxDscrTab[tx_desc_idx];
-  
-  TRACE_PRINTF("TX: Using descriptor %lu\n", (unsigned long)tx_desc_idx);
-  
-  /* Wait for descriptor to be free (OWN bit = 0) with timeout */
-  uint32_t timeout = 1000;
-  while ((txdesc->DESC3 & 0x80000000) && timeout > 0) {
-    rtems_task_wake_after(1);
-    SCB_InvalidateDCache_by_Addr((uint32_t *)txdesc, sizeof(ETH_DMADescTypeDef_Shadow));
-    timeout--;
-  }
-  
-  if (timeout == 0) {
-    TRACE_PRINTF("TX ERROR: Descriptor %lu timeout\n", (unsigned long)tx_desc_idx);
-    errval = ERR_TIMEOUT;
-    goto tx_cleanup;
-  }
-  
-  TRACE_PRINTF("TX: Descriptor %lu is free\n", (unsigned long)tx_desc_idx);
-  
-  /* Ensure minimum Ethernet frame size (60 bytes without FCS) */
-  uint32_t tx_len = total_len;
-  if (tx_len < 60) {
-    memset(tx_bounce_buffer + tx_len, 0, 60 - tx_len); /* Pad with zeros */
-    tx_len = 60;
-    TRACE_PRINTF("TX: Padded from %lu to 60 bytes\n", (unsigned long)total_len);
-  }
-  
-  /* Setup TX descriptor manually */
-  txdesc->DESC0 = (uint32_t)tx_bounce_buffer;
-  txdesc->DESC1 = 0;
-  txdesc->DESC2 = tx_len & 0x3FFF;
-  txdesc->DESC3 = 0x80000000 | 0x30000000 | 0x04000000; /* OWN | FD+LD | IC */
-  
-  SCB_CleanDCache_by_Addr((uint32_t *)txdesc, sizeof(ETH_DMADescTypeDef_Shadow));
-  __DSB();
-  
-  TRACE_PRINTF("TX: Descriptor setup: DESC0=0x%08lx DESC2=0x%08lx DESC3=0x%08lx\n",
-         (unsigned long)txdesc->DESC0, (unsigned long)txdesc->DESC2, (unsigned long)txdesc->DESC3);
-  
-  /* Kick TX DMA */
-  uint32_t next_desc_idx = (tx_desc_idx + 1) % ETH_TX_DESC_CNT;
-  heth.Instance->DMACTDTPR = (uint32_t)(&DMATxDscrTab[next_desc_idx]);
-  __DSB();
-  
-  TRACE_PRINTF("TX: Kicked DMA, tail=0x%08lx\n", (unsigned long)heth.Instance->DMACTDTPR);
-  
-  /* Poll for completion */
-  timeout = 10000;
-  while ((txdesc->DESC3 & 0x80000000) && timeout > 0) {
-    SCB_InvalidateDCache_by_Addr((uint32_t *)txdesc, sizeof(ETH_DMADescTypeDef_Shadow));
-    rtems_task_wake_after(1); /* Yield to allow other tasks to run */
-    timeout--;
-  }
-  
-  if (timeout == 0) {
-    TRACE_PRINTF("TX ERROR: Transmission timeout\n");
-    errval = ERR_TIMEOUT;
+    stm32h7_eth_fill_tx_desc(idx, (uint32_t)tx_bounce_buffer, total_len, 0, 0, 1, 1, frame_len, ctrl, ctrl2);
   } else {
-    TRACE_PRINTF("TX: Complete, DESC3=0x%08lx\n", (unsigned long)txdesc->DESC3);
+    /* ETH_CODE: Scatter-gather. Each pbuf is handed to the DMA in place when
+     * it is DMA-reachable; only pbufs in DTCM (or other CPU-private memory)
+     * are copied, into a bounce slot attached to the descriptor carrying them.
+     * A frame is at most 1536 bytes, so both buffers of a descriptor fit. */
+    uint32_t buf[2] = {0, 0};
+    uint32_t len[2] = {0, 0};
+    uint32_t nbuf = 0;
+    uint8_t *slot_base = NULL;
+    uint32_t slot_off = 0;
+    uint32_t seg = 0;
+
+    for (q = p; q != NULL; q = q->next) {
+      if (q->len == 0) {
+        continue;
+      }
+
+      if (stm32h7_eth_dma_reachable(q->payload, q->len)) {
+        stm32h7_eth_clean_dcache(q->payload, q->len);
+        buf[nbuf] = (uint32_t)q->payload;
+        zero_copy = 1;
+      } else {
+        if (slot_base == NULL) {
+          slot_base = stm32h7_eth_tx_bounce_alloc(idx);
+        }
+        uint8_t *slot = slot_base + slot_off;
+        memcpy(slot, q->payload, q->len);
+        stm32h7_eth_clean_dcache(slot, q->len);
+        buf[nbuf] = (uint32_t)slot;
+        slot_off += q->len;
+        ETH_TRACE2(TX_BOUNCE, q->payload, q->len);
+      }
+      len[nbuf] = q->len;
+      nbuf++;
+      seg++;
+
+      if (nbuf == 2 || seg == seg_cnt) {
+        stm32h7_eth_fill_tx_desc(idx, buf[0], len[0], buf[1], len[1],
+                                 idx == first_idx, seg == seg_cnt, frame_len, ctrl, ctrl2);
+        buf[0] = buf[1] = 0;
+        len[0] = len[1] = 0;
+        nbuf = 0;
+        slot_base = NULL;
+        slot_off = 0;
+        if (seg != seg_cnt) {
+          idx = (idx + 1) % ETH_TX_RING_SIZE;
+        }
+      }
+    }
   }
-  
-  /* Advance to next descriptor */
-  tx_desc_idx = next_desc_idx;
-  heth.TxDescList.CurTxDesc = tx_desc_idx;
-  
-  TRACE_PRINTF("TX: Advanced to descriptor %lu\n", (unsigned long)tx_desc_idx);
 
-tx_cleanup:
-  /* ETH_CODE: Restore padding so LwIP can free the pbuf correctly */
+  /* ETH_CODE: Restore padding so the pbuf is handed back (or freed later)
+   * exactly as LwIP gave it to us. */
 #if defined(ETH_PAD_SIZE) && (ETH_PAD_SIZE > 0)
   pbuf_header(p, ETH_PAD_SIZE);
 #endif
 
-  pbuf_free(p);
-  TRACE_PRINTF("========== TX END ==========\n\n");
+  /* Keep zero-copy payloads alive until the DMA has read them. The reference
+   * is dropped by HAL_ETH_TxFreeCallback() when the last descriptor is
+   * reclaimed. */
+  if (zero_copy) {
+    pbuf_ref(p);
+    TxPbufTab[idx] = p;
+  }
+  __DSB();
+
+  /* Advance the ring and kick TX DMA; completion is reclaimed later */
+  TxDescHead = (idx + 1) % ETH_TX_RING_SIZE;
+  TxDescInFlight += desc_cnt;
 
-  return errval;
+  ETH_STATS_BEGIN(ETH_STATS_TX);
+  EthTxStats.packets++;
+  if (flatten || bounce_cnt > 0) {
+    EthTxStats.bounced++;
+  }
+  if (tag != ETH_VLAN_TAG_NONE) {
+    EthTxStats.vlan++;
+  }
+  if (TxDescInFlight > EthTxStats.ring_hwm) {
+    EthTxStats.ring_hwm = TxDescInFlight;
+  }
+  if (ETH_TX_BOUNCE_CNT - TxBounceFreeCnt > EthTxStats.bounce_hwm) {
+    EthTxStats.bounce_hwm = ETH_TX_BOUNCE_CNT - TxBounceFreeCnt;
+  }
+  ETH_STATS_END(ETH_STATS_TX);
+
+  heth.Instance->DMACTDTPR = (uint32_t)(&DMATxDscrTab[TxDescHead]);
+  __DSB();
+  
+  ETH_TRACE3(TX_KICK, &DMATxDscrTab[TxDescHead], desc_cnt, TxDescInFlight);
+
+  return ERR_OK;
 }
 
 /**
- * Should allocate a pbuf and transfer the bytes of the incoming
- * packet from the interface into the pbuf.
- *
- * @param netif the lwip network interface structure for this ethernetif
- * @return a pbuf filled with the received packet (including MAC header)
- *         NULL on memory error
-   */
-/* ETH_CODE: Function to rebuild RX descriptors and return them to DMA
- * This is critical for preventing "Receive Buffer Unavailable" errors.
- * After HAL_ETH_ReadData processes a packet, the descriptor must be
- * returned to the DMA with a new buffer and OWN bit set. */
-static void __attribute__((unused)) ethernetif_rebuild_rx_descriptors(void)
-{
-  /* Use RxBuildDescIdx (Refill Pointer) to start searching for empty descriptors.
-   * Using RxDescIdx (Read Pointer) is wrong because passing the read pointer
-   * skips the descriptor we just consumed! */
-  uint32_t idx = heth.RxDescList.RxBuildDescIdx;
-  
-  TRACE_PRINTF("Rebuild Loop: Start Idx=%lu\n", (unsigned long)idx);
-  
-  /* Rebuild descriptors that have been processed (OWN=0) */
-  while (1) {
-    /* ETH_CODE: Invalidate Cache to ensure we read actual RAM value */
-    SCB_InvalidateDCache_by_Addr((uint32_t *)&DMARxDscrTab[idx], sizeof(ETH_DMADescTypeDef_Shadow));
-    
-    if ((DMARxDscrTab[idx].DESC3 & 0x80000000) != 0) {
-      /* Descriptor is still owned by DMA (OWN=1). We caught up. */
-       TRACE_PRINTF("Rebuild: Idx=%lu is DMA owned (DESC3=0x%08lx). Stop.\n",
-              (unsigned long)idx, (unsigned long)DMARxDscrTab[idx].DESC3);
-       break;
-    }
-    
-    /* ETH_CODE: Handle Context Descriptors (CTXT=1)
-     * Context descriptors don't have packet data and should be recycled directly.
-     * They have OWN=0 and CTXT=1 but don't have FD (First Desc) or LD (Last Desc) set
-     * for packet data. */
-    if ((DMARxDscrTab[idx].DESC3 & 0x40000000) != 0) {
-        TRACE_PRINTF("Rebuild: Idx=%lu is Context Descriptor (CTXT=1), recycling...\n", (unsigned long)idx);
-        /* Allocate a new buffer and recycle this descriptor */
-        uint8_t *ptr = NULL;
-        HAL_ETH_RxAllocateCallback(&ptr);
-        if (ptr) {
-            DMARxDscrTab[idx].DESC0 = (uint32_t)ptr;
-            DMARxDscrBackup[idx] = (uint32_t)ptr;
-            DMARxDscrTab[idx].DESC2 = (heth.Init.RxBuffLen & 0x3FFF);
-            DMARxDscrTab[idx].DESC3 = 0x80000000 | 0x40000000 | 0x01000000; /* OWN + IOC + BUF1V */
-            SCB_CleanDCache_by_Addr((uint32_t *)&DMARxDscrTab[idx], sizeof(ETH_DMADescTypeDef_Shadow));
-            __DSB();
-            heth.RxDescList.RxBuildDescCnt++;
-            heth.RxDescList.RxBuildDescIdx = (idx + 1) % ETH_RX_DESC_CNT;
+ * Helper function to hand a descriptor that carried no deliverable packet
+ * (context descriptor, fragment or error frame) straight back to the DMA.
+ * The buffer still recorded in DMARxDscrBackup was never passed to the stack,
+ * so it is reused as is. Cache maintenance and the tail pointer update are
+ * left to the caller, which does both once per harvested batch.
+ */
+static uint8_t stm32h7_recycle_rx_descriptor(uint32_t idx)
+{
+    ETH_DMADescTypeDef_Shadow *d = &DMARxDscrTab[idx];
+
+    ETH_TRACE2(RX_RECYCLE, idx, DMARxDscrBackup[idx]);
+
+    /* A descriptor left empty by an earlier allocation failure needs a fresh buffer */
+    if (ETH_RX_DESC_EMPTY(idx)) {
+        uint8_t *new_ptr = NULL;
+        HAL_ETH_RxAllocateCallback(&new_ptr);
+        if (new_ptr == NULL) {
+            ETH_TRACE1(RX_REFILL_FAIL, idx);
+            return 0;
         }
-        idx = (idx + 1) % ETH_RX_DESC_CNT;
-        if (idx == heth.RxDescList.RxBuildDescIdx) break;
-        continue;
+#if ETH_RX_SPLIT_HEADER
+        DMARxDscrBackup2[idx] = (uint32_t)new_ptr - ETH_PAD_SIZE;
+#else
+        DMARxDscrBackup[idx] = (uint32_t)new_ptr;
+#endif
     }
 
-    uint8_t *ptr = NULL;
-    
-    /* Allocate a new buffer for this descriptor */
-    HAL_ETH_RxAllocateCallback(&ptr);
-    
-    if (ptr != NULL) {
-      /* Set the new buffer address */
-      DMARxDscrTab[idx].DESC0 = (uint32_t)ptr;
-      DMARxDscrBackup[idx] = (uint32_t)ptr;
-      
-      /* Set buffer length */
-      DMARxDscrTab[idx].DESC2 = (heth.Init.RxBuffLen & 0x3FFF);
-      
-      /* Return descriptor to DMA: set OWN and BUF1V bits */
-      DMARxDscrTab[idx].DESC3 = 0x80000000 | 0x01000000;
-      
-      /* Ensure memory write is visible to DMA */
-      SCB_CleanDCache_by_Addr((uint32_t *)&DMARxDscrTab[idx], sizeof(ETH_DMADescTypeDef_Shadow));
-      __DSB();
-      
-      /* Update HAL tracking (cap at descriptor count) */
-      if (heth.RxDescList.RxBuildDescCnt < ETH_RX_DESC_CNT) {
-          heth.RxDescList.RxBuildDescCnt++;
+    /* Ownership back to DMA + BUF1V, IOC as the moderation level dictates */
+    stm32h7_eth_rx_desc_fill(d, idx);
+    return 1;
+}
+
+/**
+ * Hand every RX descriptor to the DMA and rewind the driver's ring indices.
+ * Descriptors that still own a buffer (from before a link drop) keep it, so
+ * restarting the link does not leak RX_POOL entries. Must only be called
+ * while the RX DMA is stopped, since it rewrites the descriptor list address.
+ */
+static void stm32h7_eth_reset_rx_ring(void)
+{
+  TRACE_PRINTF("ETH: Manually initializing RX descriptors...\n");
+
+  /* A frame cut off by the link drop will never see its Last Desc */
+  if (RxChainHead != NULL) {
+    pbuf_free(RxChainHead);
+    RxChainHead = RxChainTail = NULL;
+    RxChainLen = 0;
+  }
+#if ETH_PTP_ENABLE
+  RxChainTsPending = 0;
+#endif
+
+  /* ETH_CODE: Reset software descriptor trackers to match hardware reset.
+   * The hardware DMA will start reading from the base address (Descriptor 0).
+   * We must ensure our software read pointer (RxDescIdx) matches. */
+  RxDescIdx = 0;
+  RxBuildDescIdx = 0;
+  RxBuildDescCnt = 0;
+
+  for (uint32_t i = 0; i < ETH_RX_RING_SIZE; i++) {
+#if ETH_RX_SPLIT_HEADER
+    /* Buffer 1 is the descriptor's header buffer, buffer 2 from RX_POOL */
+    uint8_t *ptr = (uint8_t *)DMARxDscrBackup2[i];
+    if (ptr == NULL) {
+      ptr = stm32h7_eth_rx_buffer_alloc_ctl();
+      if (ptr) {
+        DMARxDscrBackup2[i] = (uint32_t)ptr - ETH_PAD_SIZE;
       }
-      heth.RxDescList.RxBuildDescIdx = (idx + 1) % ETH_RX_DESC_CNT;
-      
-      TRACE_PRINTF("Rebuilt RX desc %lu: addr=0x%08lx, DESC3=0x%08lx (Cnt=%lu)\n",
-             (unsigned long)idx, (unsigned long)DMARxDscrTab[idx].DESC0,
-             (unsigned long)DMARxDscrTab[idx].DESC3, 
-             (unsigned long)heth.RxDescList.RxBuildDescCnt);
+    }
+    if (ptr) {
+      ptr = (uint8_t *)ETH_RX_HDR_BUFFER(i);
+    }
+#else
+    uint8_t *ptr = (uint8_t *)DMARxDscrBackup[i];
+    if (ptr == NULL) {
+      ptr = stm32h7_eth_rx_buffer_alloc_ctl();
+    }
+#endif
+    if (ptr) {
+      /* ETH_CODE: Store buffer address in separate backup array.
+       * DMA overwrites DESC0 on completion, so we need separate storage.
+       * ptr already includes +2 offset from HAL_ETH_RxAllocateCallback. */
+      DMARxDscrBackup[i] = (uint32_t)ptr;
+
+      /* Set bits:
+       * 31 (OWN): DMA owns the descriptor
+       * 30 (IOC): Interrupt On Completion
+       * 24 (BUF1V): Buffer 1 is valid (25, BUF2V, with split headers) */
+      stm32h7_eth_rx_desc_fill(&DMARxDscrTab[i], i);
+
+      TRACE_PRINTF("RX Init Desc %lu: addr=0x%08lx, len=%lu, DESC3=0x%08lx\n",
+             (unsigned long)i, (unsigned long)DMARxDscrTab[i].DESC0,
+             (unsigned long)DMARxDscrTab[i].DESC2, (unsigned long)DMARxDscrTab[i].DESC3);
+
+      RxBuildDescCnt++;
+      RxBuildDescIdx = (RxBuildDescIdx + 1) % ETH_RX_RING_SIZE;
     } else {
-      TRACE_PRINTF("ERROR: Failed to allocate buffer for RX descriptor rebuild %lu\n", (unsigned long)idx);
-      RxAllocStatus = RX_ALLOC_ERROR;
-      break;
+      TRACE_PRINTF("ERROR: Failed to allocate buffer for RX descriptor %lu!\n", (unsigned long)i);
+      DMARxDscrTab[i].DESC0 = 0;
+      DMARxDscrTab[i].DESC3 = 0;
     }
-    
-    /* Move to next descriptor */
-    idx = (idx + 1) % ETH_RX_DESC_CNT;
-    
-    /* Safety check involved in 'while(1)' loop */
-    if (idx == heth.RxDescList.RxBuildDescIdx) break; 
   }
-  
-  /* Update Tail Pointer to point behind current read pointer */
-  stm32h7_eth_kick_rx_dma();
+
+  /* ETH_CODE: Clean DCache once for the whole ring to ensure DMA sees these values in RAM! */
+  ETH_DESC_CACHE_CLEAN(DMARxDscrTab, ETH_RX_RING_SIZE * sizeof(ETH_DMADescTypeDef_Shadow));
+
+  /* Rewriting the list address also resets the DMA's current descriptor */
+  heth.Instance->DMACRDLAR = (uint32_t)DMARxDscrTab;
+  heth.Instance->DMACRDRLR = ETH_RX_RING_SIZE - 1;
+  __DSB();
+}
+
+/**
+ * Stop MAC and DMA by hand. HAL_ETH_Stop_IT() cannot be used: it walks
+ * heth.RxDescList, which the driver no longer maintains.
+ */
+static void stm32h7_eth_stop(void)
+{
+  __HAL_ETH_DMA_DISABLE_IT(&heth, ETH_DMA_NORMAL_IT | ETH_DMA_RX_IT | ETH_DMA_TX_IT);
+  __HAL_ETH_MAC_DISABLE_IT(&heth, ETH_MAC_RX_STATUS_IT | ETH_MAC_TX_STATUS_IT);
+
+  /* Stop DMA transmission and reception first, then the MAC */
+  CLEAR_BIT(heth.Instance->DMACTCR, ETH_DMACTCR_ST);
+  CLEAR_BIT(heth.Instance->DMACRCR, ETH_DMACRCR_SR);
+  CLEAR_BIT(heth.Instance->MACCR, ETH_MACCR_RE);
+
+  /* Flush the transmit FIFO before disabling the transmitter */
+  SET_BIT(heth.Instance->MTLTQOMR, ETH_MTLTQOMR_FTQ);
+  CLEAR_BIT(heth.Instance->MACCR, ETH_MACCR_TE);
+
+  heth.gState = HAL_ETH_STATE_READY;
+}
+
+/* Helper function to safely get pbuf from buffer address */
+static struct pbuf *stm32h7_get_pbuf_from_buff(uint8_t *buff)
+{
+    /* Calculate pbuf address: buff is at offsetof(RxBuff_t, buff) within RxBuff_t */
+    struct pbuf *p = (struct pbuf *)((uint8_t *)buff - offsetof(RxBuff_t, buff));
+    return p;
+}
+
+/* Apply a D-cache operation to `cnt` RX descriptors starting at `first`,
+ * splitting the range in two when it wraps past the end of the ring. */
+static void stm32h7_eth_rx_desc_cache(uint32_t first, uint32_t cnt, uint8_t clean)
+{
+#if ETH_DESC_NONCACHEABLE
+  if (clean && cnt > 0) {
+    __DMB();
+  }
+  (void)first;
+#else
+  while (cnt > 0) {
+    uint32_t run = ETH_RX_RING_SIZE - first;
+    if (run > cnt) {
+      run = cnt;
+    }
+    uint32_t start = (uint32_t)&DMARxDscrTab[first] & ~31U;
+    uint32_t end = ((uint32_t)&DMARxDscrTab[first + run] + 31U) & ~31U;
+    if (clean) {
+      SCB_CleanDCache_by_Addr((uint32_t *)start, (int32_t)(end - start));
+    } else {
+      SCB_InvalidateDCache_by_Addr((uint32_t *)start, (int32_t)(end - start));
+    }
+    cnt -= run;
+    first = 0;
+  }
+#endif
+}
+
+/**
+ * Check the checksum status the MAC wrote back for a received frame.
+ * RDES1 is valid when RS1V (RDES3 bit 26) is set; IPHE (bit 3) flags a bad
+ * IPv4 header checksum, IPCE (bit 7) a bad TCP/UDP/ICMP checksum. Frames the
+ * MAC bypassed (IPCB, IP fragments, non-IP) carry neither bit.
+ *
+ * @return 1 if the frame must be dropped
+ */
+static inline uint8_t stm32h7_eth_rx_csum_error(ETH_DMADescTypeDef_Shadow *d)
+{
+#if CHECKSUM_BY_HARDWARE
+  if ((d->DESC3 & 0x04000000) && (d->DESC1 & (0x00000008 | 0x00000080))) {
+    ETH_TRACE1(RX_CSUM_ERR, d->DESC1);
+    LINK_STATS_INC(link.chkerr);
+    ETH_STATS_BEGIN(ETH_STATS_RX);
+    EthRxStats.csum_drop++;
+    ETH_STATS_END(ETH_STATS_RX);
+    return 1;
+  }
+#else
+  (void)d;
+#endif
+  return 0;
+}
+
+#if CHECKSUM_BY_HARDWARE
+/**
+ * The checksums the MAC verified in a received frame, as
+ * NETIF_CHECKSUM_CHECK_* bits for pbuf->chksum_verified (a frame that fails
+ * them is dropped by stm32h7_eth_rx_csum_error()). None unless RS1V is set and the checksum engine
+ * was not bypassed (IPCB, bit 6); the IPv4 header if IPV4 (bit 4) is set;
+ * the payload if PT [2:0] is UDP (1), TCP (2) or ICMP (3). IP fragments
+ * report no payload type, so they and their reassembled datagram are
+ * checked by lwIP.
+ */
+static inline u16_t stm32h7_eth_rx_csum_verified(ETH_DMADescTypeDef_Shadow *d)
+{
+  uint32_t rdes1 = d->DESC1;
+  u16_t verified = 0;
+
+  if (!(d->DESC3 & 0x04000000) || (rdes1 & 0x00000040)) {
+    return 0;
+  }
+  if (rdes1 & 0x00000010) {
+    verified |= NETIF_CHECKSUM_CHECK_IP;
+  }
+  switch (rdes1 & 0x00000007) {
+    case 1:
+      verified |= NETIF_CHECKSUM_CHECK_UDP;
+      break;
+    case 2:
+      verified |= NETIF_CHECKSUM_CHECK_TCP;
+      break;
+    case 3:
+      verified |= (rdes1 & 0x00000010) ? NETIF_CHECKSUM_CHECK_ICMP : NETIF_CHECKSUM_CHECK_ICMP6;
+      break;
+    default:
+      break;
+  }
+  return verified;
+}
+#endif /* CHECKSUM_BY_HARDWARE */
+
+#if ETH_RX_COPYBREAK > 0
+/**
+ * Copy a small received frame out of its DMA buffer into a PBUF_RAM pbuf
+ * sized to fit, so the RX_POOL buffer can go straight back to the DMA.
+ * The copy keeps ETH_PAD_SIZE bytes of headroom like the zero-copy pbufs.
+ *
+ * @return the pbuf, or NULL if the heap is exhausted (the caller then falls
+ *         back to zero-copy)
+ */
+static struct pbuf *stm32h7_eth_rx_copy(const uint8_t *buff, uint32_t len)
+{
+  struct pbuf *p = pbuf_alloc(PBUF_RAW, (u16_t)(len + ETH_PAD_SIZE), PBUF_RAM);
+  uint32_t start = (uint32_t)buff & ~31U;
+  uint32_t end = ((uint32_t)buff + len + 31U) & ~31U;
+
+  if (p == NULL) {
+    return NULL;
+  }
+  /* Drop lines left over from the previous frame in this buffer */
+  SCB_InvalidateDCache_by_Addr((uint32_t *)start, (int32_t)(end - start));
+  memcpy((uint8_t *)p->payload + ETH_PAD_SIZE, buff, len);
+  ETH_STATS_BEGIN(ETH_STATS_RX);
+  EthRxStats.copybreak++;
+  ETH_STATS_END(ETH_STATS_RX);
+  return p;
 }
+#endif /* ETH_RX_COPYBREAK > 0 */
 
+#if ETH_RX_SPLIT_HEADER
 /**
- * Helper function to process/advance past a descriptor (packet or context)
- * This is called when we have a CPU-owned descriptor that needs recycling
+ * Add the buffers of one split-header RX descriptor to the open frame.
+ *
+ * Buffer 1 (RDES0) only holds data in the First Desc (FD): the HL header
+ * bytes (RDES2 [9:0]) of a frame the MAC split, or the start of one it did
+ * not (non-TCP/UDP, IP fragments, headers over 128 bytes). They are copied
+ * into a PBUF_RAM pbuf with ETH_PAD_SIZE headroom that heads the chain.
+ * Buffer 2 (RDES2) holds the rest and is linked behind it zero-copy, so the
+ * payload starts on a cache line; a frame up to ETH_RX_COPYBREAK is copied
+ * whole instead. A frame made of headers only (a pure ACK) leaves buffer 2
+ * on the descriptor.
+ *
+ * If the heap cannot take the header copy, the frame is dropped and
+ * RxChainHead stays NULL, so its remaining descriptors are recycled.
+ *
+ * @return 0 if no RX_POOL buffer was available to replace buffer 2; the
+ *         descriptor is then left untouched
  */
-static void stm32h7_recycle_rx_descriptor(uint32_t idx)
+static uint8_t stm32h7_eth_rx_split(ETH_DMADescTypeDef_Shadow *d, uint32_t idx)
 {
-    TRACE_PRINTF("\n========== RECYCLE RX DESC %lu ==========\n", (unsigned long)idx);
-    ETH_DMADescTypeDef_Shadow *d = &DMARxDscrTab[idx];
-    
-    TRACE_PRINTF("RECYCLE: Before - DESC0=0x%08lx, DESC1=0x%08lx, DESC2=0x%08lx, DESC3=0x%08lx\n",
-           (unsigned long)d->DESC0, (unsigned long)d->DESC1,
-           (unsigned long)d->DESC2, (unsigned long)d->DESC3);
-    TRACE_PRINTF("RECYCLE: RxDescIdx=%lu, RxBuildDescIdx=%lu, RxBuildDescCnt=%lu\n",
-           (unsigned long)heth.RxDescList.RxDescIdx,
-           (unsigned long)heth.RxDescList.RxBuildDescIdx,
-           (unsigned long)heth.RxDescList.RxBuildDescCnt);
-    
-    /* Allocate new buffer for this descriptor */
-    uint8_t *new_ptr = NULL;
-    HAL_ETH_RxAllocateCallback(&new_ptr);
-    
-    if (new_ptr) {
-        TRACE_PRINTF("RECYCLE: Allocated new buffer at 0x%08lx\n", (unsigned long)new_ptr);
-        /* Update Descriptor */
-        d->DESC0 = (uint32_t)new_ptr;
-        DMARxDscrBackup[idx] = (uint32_t)new_ptr;
-        d->DESC2 = (heth.Init.RxBuffLen & 0x3FFF);
-        
-        /* Ownership back to DMA + IOC + BUF1V */
-        d->DESC3 = 0x80000000 | 0x40000000 | 0x01000000;
-        
-        TRACE_PRINTF("RECYCLE: After - DESC0=0x%08lx, DESC1=0x%08lx, DESC2=0x%08lx, DESC3=0x%08lx\n",
-               (unsigned long)d->DESC0, (unsigned long)d->DESC1,
-               (unsigned long)d->DESC2, (unsigned long)d->DESC3);
-        
-        /* Flush Cache */
-        SCB_CleanDCache_by_Addr((uint32_t *)d, sizeof(ETH_DMADescTypeDef_Shadow));
-        __DSB();
-        
-        /* Update HAL counters */
-        if (heth.RxDescList.RxBuildDescCnt < ETH_RX_DESC_CNT) {
-            heth.RxDescList.RxBuildDescCnt++;
-        }
-        heth.RxDescList.RxBuildDescIdx = (idx + 1) % ETH_RX_DESC_CNT;
-        heth.RxDescList.RxDescIdx = (idx + 1) % ETH_RX_DESC_CNT;
-        
-        TRACE_PRINTF("RECYCLE: After update - RxDescIdx=%lu, RxBuildDescIdx=%lu, RxBuildDescCnt=%lu\n",
-               (unsigned long)heth.RxDescList.RxDescIdx,
-               (unsigned long)heth.RxDescList.RxBuildDescIdx,
-               (unsigned long)heth.RxDescList.RxBuildDescCnt);
-        
-        /* Kick DMA Tail Pointer */
-        stm32h7_eth_kick_rx_dma();
-        TRACE_PRINTF("========== RECYCLE RX DESC END ==========\n\n");
+  const uint8_t *buf1 = (const uint8_t *)DMARxDscrBackup[idx];
+  uint8_t *buf2 = (uint8_t *)DMARxDscrBackup2[idx];
+  uint32_t len1 = 0;
+  uint32_t len2 = heth.Init.RxBuffLen;
+  uint32_t copy2 = 0;
+  uint8_t *new_ptr = NULL;
+  struct pbuf *p = NULL;
+
+  if (d->DESC3 & 0x20000000) {                  /* FD */
+    len1 = d->DESC2 & 0x000003FF;               /* HL */
+    if (len1 == 0U) {
+      len1 = heth.Init.RxBuffLen;
+      if ((d->DESC3 & 0x10000000) && ((d->DESC3 & 0x00007FFF) < len1)) {
+        len1 = d->DESC3 & 0x00007FFF;
+      }
     } else {
-        TRACE_PRINTF("CRITICAL: Failed to recycle RX descriptor %lu\n", (unsigned long)idx);
-        TRACE_PRINTF("========== RECYCLE RX DESC END (FAILED) ==========\n\n");
+      ETH_STATS_BEGIN(ETH_STATS_RX);
+      EthRxStats.split++;
+      ETH_STATS_END(ETH_STATS_RX);
     }
-}
+  }
+  if (d->DESC3 & 0x10000000) {                  /* LD: PL is the whole frame */
+    len2 = (d->DESC3 & 0x00007FFF) - RxChainLen - len1;
+  }
+#if ETH_RX_COPYBREAK > 0
+  if (((d->DESC3 & 0x30000000) == 0x30000000) && ((d->DESC3 & 0x00007FFF) <= ETH_RX_COPYBREAK)) {
+    copy2 = len2;
+  }
+#endif
 
-/* Helper function to safely get pbuf from buffer address */
-static struct pbuf *stm32h7_get_pbuf_from_buff(uint8_t *buff)
-{
-    /* Calculate pbuf address: buff is at offsetof(RxBuff_t, buff) within RxBuff_t */
-    struct pbuf *p = (struct pbuf *)((uint8_t *)buff - offsetof(RxBuff_t, buff));
-    return p;
+  if (len1 > 0U) {
+    p = pbuf_alloc(PBUF_RAW, (u16_t)(len1 + copy2 + ETH_PAD_SIZE), PBUF_RAM);
+    if (p == NULL) {
+      ETH_TRACE1(RX_TRUNC, len1);
+      LINK_STATS_INC(link.memerr);
+      return 1;
+    }
+  }
+  if (len2 > copy2) {
+    HAL_ETH_RxAllocateCallback(&new_ptr);
+    if (new_ptr == NULL) {
+      if (p != NULL) {
+        pbuf_free(p);
+      }
+      return 0;
+    }
+  }
+
+  if (p != NULL) {
+    SCB_InvalidateDCache_by_Addr((uint32_t *)((uint32_t)buf1 & ~31U),
+                                 (int32_t)((((uint32_t)buf1 + len1 + 31U) & ~31U) - ((uint32_t)buf1 & ~31U)));
+    memcpy((uint8_t *)p->payload + ETH_PAD_SIZE, buf1, len1);
+    if (copy2 > 0U) {
+      SCB_InvalidateDCache_by_Addr((uint32_t *)buf2, (int32_t)((copy2 + 31U) & ~31U));
+      memcpy((uint8_t *)p->payload + ETH_PAD_SIZE + len1, buf2, copy2);
+      ETH_STATS_BEGIN(ETH_STATS_RX);
+      EthRxStats.copybreak++;
+      ETH_STATS_END(ETH_STATS_RX);
+    }
+    RxChainHead = RxChainTail = p;
+  }
+  if (new_ptr != NULL) {
+    struct pbuf_custom *pc = (struct pbuf_custom *)stm32h7_get_pbuf_from_buff(buf2);
+
+    SCB_InvalidateDCache_by_Addr((uint32_t *)buf2, (int32_t)((len2 + 31U) & ~31U));
+    p = pbuf_alloced_custom(PBUF_RAW, (u16_t)len2, PBUF_REF, pc, buf2, ETH_RX_BUFFER_SIZE);
+    RxChainTail->next = p;
+    for (struct pbuf *q = RxChainHead; q != p; q = q->next) {
+      q->tot_len += len2;
+    }
+    RxChainTail = p;
+    DMARxDscrBackup2[idx] = (uint32_t)new_ptr - ETH_PAD_SIZE;
+  }
+  RxChainLen += len1 + len2;
+  return 1;
 }
+#endif /* ETH_RX_SPLIT_HEADER */
 
-static struct pbuf * low_level_input(struct netif *netif)
+/**
+ * Harvest up to `max` (at most ETH_RX_BATCH_SIZE) completed RX descriptors.
+ *
+ * The descriptor window is invalidated once, every CPU-owned descriptor is
+ * turned into a pbuf (or recycled if it carries no deliverable frame), the
+ * refilled descriptors are cleaned together and the DMA tail pointer is
+ * written once at the end, instead of once per packet.
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ * @param batch receives the pbufs of the complete frames that were found
+ * @param max descriptor limit for this call
+ * @param pkt_cnt receives the number of entries stored in batch
+ * @return the number of descriptors consumed; 0 once the ring is drained
+ *         (or no replacement buffer could be allocated)
+ */
+static uint32_t low_level_input(struct netif *netif, struct pbuf **batch, uint32_t max, uint32_t *pkt_cnt)
 {
-  struct pbuf *p = NULL;
+  uint32_t first = RxDescIdx;
+  uint32_t harvested = 0;
 
-  /* ETH_CODE: Loop to skip non-packet descriptors (Context/Strange)
-   * and find the next valid packet. Returning NULL prematurely causes
-   * the input thread to sleep even if valid packets follow.
-   */
-  while (1) {
-      uint32_t idx = heth.RxDescList.RxDescIdx;
-      ETH_DMADescTypeDef_Shadow *d = &DMARxDscrTab[idx];
+  (void)netif;
+  *pkt_cnt = 0;
+
+  /* ETH_CODE: Invalidate the whole window BEFORE reading any descriptor */
+  if (max > ETH_RX_BATCH_SIZE) {
+      max = ETH_RX_BATCH_SIZE;
+  }
+  stm32h7_eth_rx_desc_cache(first, max, 0);
 
-      /* ETH_CODE: Invalidate Cache BEFORE reading the descriptor! */
-      SCB_InvalidateDCache_by_Addr((uint32_t *)d, sizeof(ETH_DMADescTypeDef_Shadow));
+  while (harvested < max) {
+      uint32_t idx = RxDescIdx;
+      ETH_DMADescTypeDef_Shadow *d = &DMARxDscrTab[idx];
 
-      /* Check if the descriptor is owned by CPU (Bit 31 = 0) */
+      /* Descriptor is DMA-owned (OWN=1), no more packets available */
       if ((d->DESC3 & 0x80000000) != 0) {
-          /* Descriptor is DMA-owned (OWN=1), no more packets available */
-          return NULL;
+          break;
       }
 
-      /* Handle Context Descriptors (CTXT=1, Bit 30) */
-      if ((d->DESC3 & 0x40000000) != 0) {
-          TRACE_PRINTF("LLI: Context Descriptor detected (CTXT=1), recycling...\n");
-          stm32h7_recycle_rx_descriptor(idx);
-          /* Continue loop to check next descriptor immediately */
-          continue;
+#if ETH_PTP_ENABLE
+      /* The frame completed last is waiting for its timestamp, which the DMA
+       * writes into the following context descriptor (CTXT, bit 30) as
+       * RDES0 = nanoseconds, RDES1 = seconds (all ones if it is corrupt).
+       * The context descriptor itself is then recycled below. */
+      if (RxChainTsPending) {
+          if ((d->DESC3 & 0x40000000) &&
+              !((d->DESC0 == 0xFFFFFFFF) && (d->DESC1 == 0xFFFFFFFF))) {
+              RxChainHead->ts_nsec = d->DESC0;
+              RxChainHead->ts_sec = d->DESC1;
+          }
+          RxChainTsPending = 0;
+          batch[(*pkt_cnt)++] = RxChainHead;
+          RxChainHead = RxChainTail = NULL;
+          RxChainLen = 0;
       }
+#endif
 
-      /* CPU owned + Normal Descriptor */
-      if ((d->DESC3 & 0x20000000) && (d->DESC3 & 0x10000000)) {
-           /* First Desc (FD) + Last Desc (LD) set -> Single packet */
-           uint32_t pkt_len = (d->DESC3 & 0x00007FFF);
-           TRACE_PRINTF("LLI: Single packet detected, len=%lu bytes\n", (unsigned long)pkt_len);
-
-           /* Get the pbuf from the back-up address */
-           if (DMARxDscrBackup[idx] != 0) {
-               uint8_t *buff_with_offset = (uint8_t *)DMARxDscrBackup[idx];
-               uint8_t *actual_buff = buff_with_offset - ETH_PAD_SIZE;
-               TRACE_PRINTF("LLI: Buffer address: backup=0x%08lx, actual=0x%08lx\n",
-                      (unsigned long)DMARxDscrBackup[idx], (unsigned long)actual_buff);
-
-               struct pbuf *p_manual = stm32h7_get_pbuf_from_buff(actual_buff);
-               struct pbuf_custom *p_custom = (struct pbuf_custom *)p_manual;
-
-               /* ETH_CODE: Use pbuf_alloced_custom with actual buffer start.
-                * We include ETH_PAD_SIZE in the length so LwIP can strip it if needed.
-                * Note: We do NOT manually adjust p->payload here. LwIP's ethernet_input
-                * will do pbuf_header(p, -ETH_PAD_SIZE) to skip the padding if ETH_PAD_SIZE > 0. */
-               p_custom->custom_free_function = pbuf_free_custom;
-               p = pbuf_alloced_custom(PBUF_RAW, pkt_len + ETH_PAD_SIZE, PBUF_REF, p_custom, actual_buff, ETH_RX_BUFFER_SIZE);
-
-               if (p != NULL) {
-                   SCB_InvalidateDCache_by_Addr((uint32_t *)actual_buff, pkt_len);
-                   TRACE_PRINTF("LLI: pbuf created successfully, p=0x%p, payload=0x%p (Padding included)\n", p, p->payload);
-                   
-                   /* Dump packet content */
-                   TRACE_PRINTF("PKT DUMP (%lu bytes):", (unsigned long)pkt_len);
-                   /* ETH_CODE: Skip padding for dump visualization */
-                   uint8_t *pd = (uint8_t *)p->payload + 2;
-                   (void)pd;
-                   for(uint32_t k=0; k<pkt_len; k++) {
-                       if(k%16 == 0) TRACE_PRINTF("\n  %04x: ", (unsigned int)k);
-                       TRACE_PRINTF("%02x ", pd[k]);
-                   }
-                   TRACE_PRINTF("\n");
-
-                   uint8_t *eth_hdr = (uint8_t *)p->payload + 2;
-                   (void)eth_hdr;
-                   TRACE_PRINTF("LLI: Ethernet Header: %02x:%02x:%02x:%02x:%02x:%02x -> %02x:%02x:%02x:%02x:%02x:%02x, type=0x%02x%02x\n",
-                          eth_hdr[0], eth_hdr[1], eth_hdr[2], eth_hdr[3], eth_hdr[4], eth_hdr[5],
-                          eth_hdr[6], eth_hdr[7], eth_hdr[8], eth_hdr[9], eth_hdr[10], eth_hdr[11],
-                          eth_hdr[12], eth_hdr[13]);
-               } else {
-                   TRACE_PRINTF("CRITICAL: pbuf_alloced_custom failed! Dropping packet.\n");
-               }
+      /* Context descriptors (CTXT=1, Bit 30), descriptors without a buffer,
+       * continuation descriptors whose First Desc (FD) was lost and ARP
+       * requests the MAC took care of go back as is */
+      if ((d->DESC3 & 0x40000000) || ETH_RX_DESC_EMPTY(idx) ||
+          (!(d->DESC3 & 0x20000000) && (RxChainHead == NULL))
+#if ETH_ARP_OFFLOAD
+          || ((RxChainHead == NULL) && stm32h7_eth_rx_arp_drop(d, idx))
+#endif
+          ) {
+           ETH_TRACE1(RX_NONPKT, d->DESC3);
+           if (!stm32h7_recycle_rx_descriptor(idx)) {
+               break;
+           }
+      } else {
+#if !ETH_RX_SPLIT_HEADER
+           uint8_t *new_ptr = NULL;
+#endif
 
-               /* Refill descriptor */
-               uint8_t *new_ptr = NULL;
+           /* A new First Desc (FD) while a chain is open: its Last Desc was lost */
+           if ((d->DESC3 & 0x20000000) && (RxChainHead != NULL)) {
+               ETH_TRACE1(RX_TRUNC, RxChainLen);
+               LINK_STATS_INC(link.drop);
+               pbuf_free(RxChainHead);
+               RxChainHead = RxChainTail = NULL;
+               RxChainLen = 0;
+           }
+
+#if ETH_RX_SPLIT_HEADER
+           if (!stm32h7_eth_rx_split(d, idx)) {
+               ETH_TRACE1(RX_POOL_EMPTY, idx);
+               break;
+           }
+#else
+#if ETH_RX_COPYBREAK > 0
+           /* Small single-descriptor frames (FD + LD) are copied out and the
+            * DMA buffer stays on the descriptor */
+           struct pbuf *copy = NULL;
+           if (((d->DESC3 & 0x30000000) == 0x30000000) &&
+               ((d->DESC3 & 0x00007FFF) <= ETH_RX_COPYBREAK)) {
+               copy = stm32h7_eth_rx_copy((const uint8_t *)DMARxDscrBackup[idx], d->DESC3 & 0x00007FFF);
+           }
+           if (copy != NULL) {
+               RxChainHead = RxChainTail = copy;
+               RxChainLen = d->DESC3 & 0x00007FFF;
+           } else
+#endif
+           {
+               /* Refill first: if no buffer is available the frame stays in the
+                * descriptor and is picked up again once pbuf_free_custom()
+                * returns a buffer to RX_POOL and signals RxPktSemaphore. */
                HAL_ETH_RxAllocateCallback(&new_ptr);
+               if (new_ptr == NULL) {
+                   ETH_TRACE1(RX_POOL_EMPTY, idx);
+                   break;
+               }
 
-               if (new_ptr) {
-                   TRACE_PRINTF("LLI: Refilling descriptor %lu with new buffer 0x%08lx\n",
-                          (unsigned long)idx, (unsigned long)new_ptr);
-                   d->DESC0 = (uint32_t)new_ptr;
-                   DMARxDscrBackup[idx] = (uint32_t)new_ptr;
-                   d->DESC2 = (heth.Init.RxBuffLen & 0x3FFF);
-                   d->DESC3 = 0x80000000 | 0x40000000 | 0x01000000;
-                   SCB_CleanDCache_by_Addr((uint32_t *)d, sizeof(ETH_DMADescTypeDef_Shadow));
-                   __DSB();
-
-                   if (heth.RxDescList.RxBuildDescCnt < ETH_RX_DESC_CNT) {
-                       heth.RxDescList.RxBuildDescCnt++;
-                   }
-                   heth.RxDescList.RxBuildDescIdx = (idx + 1) % ETH_RX_DESC_CNT;
-                   
-                   TRACE_PRINTF("LLI: After refill - RxDescIdx=%lu, RxBuildDescIdx=%lu, RxBuildDescCnt=%lu\n",
-                          (unsigned long)heth.RxDescList.RxDescIdx,
-                          (unsigned long)heth.RxDescList.RxBuildDescIdx,
-                          (unsigned long)heth.RxDescList.RxBuildDescCnt);
-                   
-                   stm32h7_eth_kick_rx_dma();
-               } else {
-                   TRACE_PRINTF("CRITICAL: Failed to refill Rx Desc %lu\n", (unsigned long)idx);
+               /* PL [14:0] is the length of the whole frame and only valid in the
+                * Last Desc (LD); every earlier buffer of the frame is full. */
+               uint32_t len = heth.Init.RxBuffLen;
+               if (d->DESC3 & 0x10000000) {
+                   len = (d->DESC3 & 0x00007FFF) - RxChainLen;
+               }
+               HAL_ETH_RxLinkCallback((void **)&RxChainHead, (void **)&RxChainTail,
+                                      (uint8_t *)DMARxDscrBackup[idx], (uint16_t)len);
+               RxChainLen += len;
+           }
+#endif /* ETH_RX_SPLIT_HEADER */
+
+           /* No chain at the Last Desc: the frame was dropped on the way */
+           if ((d->DESC3 & 0x10000000) && (RxChainHead != NULL)) {
+#if LWIP_VLAN_OFFLOAD
+               /* RS0V (bit 25): the MAC stripped the outer tag into RDES0 OVT [15:0] */
+               if (d->DESC3 & 0x02000000) {
+                   RxChainHead->flags |= PBUF_FLAG_VLAN;
+                   RxChainHead->vlan_tci = (u16_t)(d->DESC0 & 0xFFFF);
+                   ETH_STATS_BEGIN(ETH_STATS_RX);
+                   EthRxStats.vlan++;
+                   ETH_STATS_END(ETH_STATS_RX);
+               }
+#endif
+#if CHECKSUM_BY_HARDWARE
+               RxChainHead->chksum_verified = stm32h7_eth_rx_csum_verified(d);
+#endif
+               if (stm32h7_eth_rx_csum_error(d)) {
+                   pbuf_free(RxChainHead);
+               }
+#if ETH_PTP_ENABLE
+               else if ((d->DESC3 & 0x04000000) && (d->DESC1 & 0x00004000)) {
+                   /* RS1V + TSA: hold the frame until its context descriptor */
+                   RxChainTsPending = 1;
+               }
+#endif
+               else {
+                   batch[(*pkt_cnt)++] = RxChainHead;
+                   ETH_TRACE3(RX_PKT, idx, RxChainHead, RxChainLen);
+               }
+#if ETH_PTP_ENABLE
+               if (!RxChainTsPending)
+#endif
+               {
+                   RxChainHead = RxChainTail = NULL;
+                   RxChainLen = 0;
                }
+           }
 
-               /* Update HAL Read Index to next descriptor */
-               heth.RxDescList.RxDescIdx = (idx + 1) % ETH_RX_DESC_CNT;
-               
-               /* Return the packet we found */
-               return p;
+#if !ETH_RX_SPLIT_HEADER
+           /* A copied frame left its buffer in place, so no pool round-trip */
+           if (new_ptr != NULL) {
+               DMARxDscrBackup[idx] = (uint32_t)new_ptr;
            }
-      } else {
-           /* Multi-fragment packet or strange state. Recycling. */
-           TRACE_PRINTF("LLI: Fragmented/Strange packet (DESC3=0x%08lx). Recycling.\n", (unsigned long)d->DESC3);
-           stm32h7_recycle_rx_descriptor(idx);
-           /* Continue loop to check next descriptor */
-           continue;
+#endif
+           stm32h7_eth_rx_desc_fill(d, idx);
       }
+
+      RxDescIdx = (idx + 1) % ETH_RX_RING_SIZE;
+      RxBuildDescIdx = RxDescIdx;
+      harvested++;
   }
-  return p;
+
+  if (harvested > 0) {
+      /* Publish all refilled descriptors with one clean and one tail pointer write */
+      stm32h7_eth_rx_desc_cache(first, harvested, 1);
+      stm32h7_eth_kick_rx_dma();
+      ETH_TRACE3(RX_BATCH, harvested, *pkt_cnt, RxDescIdx);
+  }
+
+  return harvested;
+}
+
+/**
+ * Pass a harvested batch up to the stack as one unit. With core locking the
+ * tcpip core lock is taken once for the whole batch and the frames are fed
+ * straight to ethernet_input(), the same dispatch tcpip_input() performs,
+ * instead of posting one tcpip mbox message per frame.
+ */
+static void stm32h7_eth_input_batch(struct netif *netif, struct pbuf **batch, uint32_t cnt)
+{
+  uint32_t i;
+
+#if LWIP_TCPIP_CORE_LOCKING
+  LOCK_TCPIP_CORE();
+  for (i = 0; i < cnt; i++) {
+    if (ethernet_input(batch[i], netif) != ERR_OK) {
+      ETH_TRACE1(RX_INPUT_ERR, batch[i]);
+      pbuf_free(batch[i]);
+    }
+  }
+  UNLOCK_TCPIP_CORE();
+#else
+  for (i = 0; i < cnt; i++) {
+    if (netif->input(batch[i], netif) != ERR_OK) {
+      ETH_TRACE1(RX_INPUT_ERR, batch[i]);
+      pbuf_free(batch[i]);
+    }
+  }
+#endif
+}
+
+/**
+ * Account for one RX poll pass: frames delivered, descriptors consumed (the
+ * backlog found on the ring) and the MTL RX queue drop counters, which
+ * clear on read.
+ */
+static void stm32h7_eth_rx_stats_pass(uint32_t pkts, uint32_t descs)
+{
+  uint32_t mpocr = heth.Instance->MTLRQMPOCR;
+
+  ETH_STATS_BEGIN(ETH_STATS_RX);
+  EthRxStats.packets += pkts;
+  if (descs > EthRxStats.ring_hwm) {
+    EthRxStats.ring_hwm = descs;
+  }
+  EthRxStats.fifo_overflow += mpocr & 0x7FF;             /* OVFPKTCNT [10:0] */
+  EthRxStats.missed += (mpocr >> 16) & 0x7FF;            /* MISPKTCNT [26:16] */
+  ETH_STATS_END(ETH_STATS_RX);
+}
+
+/**
+ * Leave polling mode: clear a stale RI, unmask the RX interrupt and look at
+ * the next descriptor once more, since a frame completed between the last
+ * harvest and the unmask would not raise a new interrupt.
+ *
+ * @return 1 if a frame is already waiting (RI is masked again and the
+ *         caller keeps polling), 0 if the driver is back in interrupt mode
+ */
+static uint8_t stm32h7_eth_rx_irq_rearm(void)
+{
+  rtems_interrupt_level level;
+  ETH_DMADescTypeDef_Shadow *d = &DMARxDscrTab[RxDescIdx];
+
+  heth.Instance->DMACSR = ETH_DMACSR_RI;
+  rtems_interrupt_local_disable(level);
+  heth.Instance->DMACIER |= ETH_DMACIER_RIE;
+  rtems_interrupt_local_enable(level);
+  __DSB();
+
+  /* With RX_POOL exhausted the frame stays put until pbuf_free_custom()
+   * signals, so there is nothing to gain from polling it. */
+  if (RxAllocStatus == RX_ALLOC_ERROR) {
+    return 0;
+  }
+
+  ETH_DESC_CACHE_INVALIDATE(d, sizeof(ETH_DMADescTypeDef_Shadow));
+  if ((d->DESC3 & 0x80000000) != 0) {
+    return 0;
+  }
+
+  rtems_interrupt_local_disable(level);
+  heth.Instance->DMACIER &= ~ETH_DMACIER_RIE;
+  rtems_interrupt_local_enable(level);
+  return 1;
 }
 
 /**
@@ -1099,7 +3239,12 @@ static struct pbuf * low_level_input(struct netif *netif)
  */
 void ethernetif_input(void* argument)
 {
-  struct pbuf *p = NULL;
+  /* One extra slot: a frame held for its timestamp is delivered in the
+   * pass that finds the context descriptor, next to that pass's frames */
+  struct pbuf *batch[ETH_RX_BATCH_SIZE + 1];
+  uint32_t pkt_cnt;
+  uint32_t harvested;
+  uint32_t budget;
   struct netif *netif = (struct netif *) argument;
 
   TRACE_PRINTF("ethernetif_input thread started, netif=0x%p\n", netif);
@@ -1108,23 +3253,57 @@ void ethernetif_input(void* argument)
   {
     if (sys_arch_sem_wait(&RxPktSemaphore, TIME_WAITING_FOR_INPUT) != SYS_ARCH_TIMEOUT)
     {
-      // printf("\n========== ETHERNETIF_INPUT: SEMAPHORE SIGNALED ==========\n");
-      do
+      /* RI is masked by HAL_ETH_RxCpltCallback(); poll in passes of at most
+       * ETH_RX_POLL_BUDGET descriptors until a pass finds the ring empty. */
+      ETH_STATS_BEGIN(ETH_STATS_RX);
+      EthRxStats.polls++;
+      ETH_STATS_END(ETH_STATS_RX);
+      for (;;)
       {
-        p = low_level_input( netif );
-        if (p != NULL)
+        uint32_t rx_pkts = 0;
+
+        budget = ETH_RX_POLL_BUDGET;
+        do
         {
-          TRACE_PRINTF("ETHERNETIF_INPUT: Got packet %u bytes, passing to netif->input\n", (unsigned int)p->tot_len);
-          if (netif->input( p, netif) != ERR_OK )
+          harvested = low_level_input(netif, batch, budget, &pkt_cnt);
+          if (pkt_cnt > 0)
           {
-            TRACE_PRINTF("ETHERNETIF_INPUT: netif->input failed, freeing pbuf\n");
-            pbuf_free(p);
-          } else {
-            TRACE_PRINTF("ETHERNETIF_INPUT: netif->input succeeded\n");
+            if (LinkFirstRxPending)
+            {
+              /* First frame since the link came up */
+              LinkUpToFirstRxMs = sys_now() - LinkUpTick;
+              LinkFirstRxPending = 0;
+            }
+            stm32h7_eth_input_batch(netif, batch, pkt_cnt);
           }
+          rx_pkts += pkt_cnt;
+          budget -= harvested;
+        } while ((harvested > 0) && (budget > 0));
+        stm32h7_eth_rx_coalesce_update(rx_pkts);
+        stm32h7_eth_rx_stats_pass(rx_pkts, ETH_RX_POLL_BUDGET - budget);
+
+        /* RX_POOL ran dry. Frames sent zero-copy from RX buffers (echoes,
+         * forwarding) keep them until their TX descriptors are reclaimed,
+         * which otherwise only the next send does: with RX stalled there
+         * may be none. Buffers returned here signal RxPktSemaphore. */
+        if (RxAllocStatus == RX_ALLOC_ERROR)
+        {
+          LOCK_TCPIP_CORE();
+          stm32h7_eth_reclaim_tx();
+          UNLOCK_TCPIP_CORE();
+        }
+
+        if ((harvested == 0) && !stm32h7_eth_rx_irq_rearm())
+        {
+          /* Ring drained and RI re-enabled: back to interrupt mode */
+          break;
         }
-      } while(p!=NULL);
-      // printf("========== ETHERNETIF_INPUT: PROCESSING COMPLETE ==========\n\n");
+
+        /* Budget used up (or a frame raced the re-arm): let the tcpip
+         * thread and other tasks run before the next pass. */
+        rtems_task_wake_after(ETH_RX_POLL_YIELD_TICKS == 0 ?
+                              RTEMS_YIELD_PROCESSOR : ETH_RX_POLL_YIELD_TICKS);
+      }
     }
   }
 }
@@ -1215,10 +3394,8 @@ err_t ethernetif_init(struct netif *netif)
   */
 void pbuf_free_custom(struct pbuf *p)
 {
-  TRACE_PRINTF("\n========== PBUF_FREE_CUSTOM ==========\n");
-  TRACE_PRINTF("PBUF_FREE: p=0x%p, ref=%u, tot_len=%u\n", p, (unsigned int)p->ref, (unsigned int)p->tot_len);
   struct pbuf_custom* custom_pbuf = (struct pbuf_custom*)p;
-  TRACE_PRINTF("PBUF_FREE: custom_pbuf=0x%p, freeing to RX_POOL\n", custom_pbuf);
+  ETH_TRACE2(RX_FREE, p, RxAllocStatus == RX_ALLOC_ERROR);
   LWIP_MEMPOOL_FREE(RX_POOL, custom_pbuf);
 
   /* If the Rx Buffer Pool was exhausted, signal the ethernetif_input task to
@@ -1226,11 +3403,9 @@ void pbuf_free_custom(struct pbuf *p)
 
   if (RxAllocStatus == RX_ALLOC_ERROR)
   {
-    TRACE_PRINTF("PBUF_FREE: RxAllocStatus was ERROR, signaling semaphore\n");
     RxAllocStatus = RX_ALLOC_OK;
     sys_sem_signal(&RxPktSemaphore);
   }
-  TRACE_PRINTF("========== PBUF_FREE_CUSTOM END ==========\n\n");
 }
 
 /* USER CODE BEGIN 6 */
@@ -1439,6 +3614,181 @@ int32_t ETH_PHY_IO_GetTick(void)
   return HAL_GetTick();
 }
 
+/* Map LAN8742_GetLinkState() onto MAC speed/duplex; 0 if not resolved yet */
+static uint8_t stm32h7_eth_link_resolve(int32_t link_state, uint32_t *speed, uint32_t *duplex)
+{
+  switch (link_state) {
+    case LAN8742_STATUS_100MBITS_FULLDUPLEX:
+      *speed = ETH_SPEED_100M;
+      *duplex = ETH_FULLDUPLEX_MODE;
+      return 1;
+    case LAN8742_STATUS_100MBITS_HALFDUPLEX:
+      *speed = ETH_SPEED_100M;
+      *duplex = ETH_HALFDUPLEX_MODE;
+      return 1;
+    case LAN8742_STATUS_10MBITS_FULLDUPLEX:
+      *speed = ETH_SPEED_10M;
+      *duplex = ETH_FULLDUPLEX_MODE;
+      return 1;
+    case LAN8742_STATUS_10MBITS_HALFDUPLEX:
+      *speed = ETH_SPEED_10M;
+      *duplex = ETH_HALFDUPLEX_MODE;
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * Program the negotiated speed/duplex into the MAC, restart both rings and
+ * the DMA, and report the link up to lwIP.
+ */
+static void stm32h7_eth_link_up(struct netif *netif, uint32_t speed, uint32_t duplex)
+{
+  ETH_MACConfigTypeDef MACConf = {0};
+
+  TRACE_PRINTF("PHY: Link up, %s Mbps %s duplex\n",
+         (speed == ETH_SPEED_100M) ? "100" : "10",
+         (duplex == ETH_FULLDUPLEX_MODE) ? "full" : "half");
+
+  LOCK_TCPIP_CORE();
+  HAL_ETH_GetMACConfig(&heth, &MACConf);
+  MACConf.DuplexMode = duplex;
+  MACConf.Speed = speed;
+#if CHECKSUM_BY_HARDWARE
+  /* MACCR IPC: verify IPv4 header and TCP/UDP/ICMP checksums on RX */
+  MACConf.ChecksumOffload = ENABLE;
+#endif
+  HAL_ETH_SetMACConfig(&heth, &MACConf);
+#if ETH_RX_SPLIT_HEADER
+  /* Split TCP/UDP headers of up to 128 bytes (HDSMS = 001) into buffer 1 */
+  MODIFY_REG(heth.Instance->MACECR, ETH_MACECR_HDSMS, ETH_MACECR_HDSMS_0);
+  SET_BIT(heth.Instance->DMACCR, ETH_DMACCR_SPH);
+#endif
+  
+  /* Restart interrupt moderation from the low-latency level */
+  RxCoalescePkts = 0;
+  RxCoalesceWindowStart = sys_now();
+  stm32h7_eth_rx_coalesce_apply(0);
+
+  /* ETH_CODE: Manually populate and set BUF1V/OWN bits in RX descriptors
+   * BEFORE starting the DMA. This ensures the hardware sees "Ready"
+   * descriptors immediately upon activation. */
+  stm32h7_eth_reset_rx_ring();
+
+  /* ETH_CODE: Bypass HAL_ETH_Start_IT because it works on heth.RxDescList,
+   * which the precompiled HAL sizes with its own ETH_RX_DESC_CNT while the
+   * driver runs ETH_RX_RING_SIZE descriptors. Manually start the Ethernet
+   * DMA instead. */
+  TRACE_PRINTF("ETH: Manually starting Ethernet (bypassing HAL_ETH_Start_IT)...\n");
+  
+  /* ETH_CODE: Start the TX ring from descriptor 0 with nothing in flight.
+   * Frames queued before a link drop are discarded here. */
+  stm32h7_eth_reset_tx_ring();
+
+  /* Enable MAC transmission and reception */
+  SET_BIT(heth.Instance->MACCR, ETH_MACCR_TE | ETH_MACCR_RE);
+  
+  /* Enable DMA transmission and reception (STM32H7 uses separate control registers) */
+#if LWIP_TCP_TSO
+  SET_BIT(heth.Instance->DMACTCR, ETH_DMACTCR_TSE); /* TCP segmentation for TSE descriptors */
+#endif
+  SET_BIT(heth.Instance->DMACTCR, ETH_DMACTCR_ST);  /* Start Transmission */
+  SET_BIT(heth.Instance->DMACRCR, ETH_DMACRCR_SR);  /* Start Reception */
+  
+  /* Set the Ethernet state to started */
+  heth.gState = HAL_ETH_STATE_STARTED;
+  
+  /* Kick the RX DMA tail pointer */
+  heth.Instance->DMACRDTPR = (uint32_t)(DMARxDscrTab + ETH_RX_RING_SIZE);
+  
+  /* TX ring is empty: tail == head, the DMA suspends until the first frame */
+  heth.Instance->DMACTDTPR = (uint32_t)(&DMATxDscrTab[TxDescHead]);
+  
+  TRACE_PRINTF("ETH: Manual start complete\n");
+  
+  /* ETH_CODE: Manually enable DMA interrupts to ensure they are properly configured
+   * This is needed because HAL_ETH_Start_IT() might not enable all required
+   * interrupts in the RTEMS environment. */
+  TRACE_PRINTF("ETH: Enabling DMA interrupts...\n");
+  /* Enable RX DMA interrupts */
+  __HAL_ETH_DMA_ENABLE_IT(&heth, ETH_DMA_RX_IT | ETH_DMA_NORMAL_IT);
+  /* Enable TX DMA interrupts */
+  __HAL_ETH_DMA_ENABLE_IT(&heth, ETH_DMA_TX_IT | ETH_DMA_NORMAL_IT);
+  /* Enable MAC interrupts */
+  __HAL_ETH_MAC_ENABLE_IT(&heth, ETH_MAC_RX_STATUS_IT | ETH_MAC_TX_STATUS_IT);
+  TRACE_PRINTF("ETH: DMACIER = 0x%08lx, MACIER = 0x%08lx\n",
+         (unsigned long)heth.Instance->DMACIER, (unsigned long)heth.Instance->MACIER);
+  TRACE_PRINTF("ETH: DMACSR  = 0x%08lx\n", (unsigned long)heth.Instance->DMACSR);
+  TRACE_PRINTF("ETH: SYSCFG_PMCR = 0x%08lx\n", (unsigned long)SYSCFG->PMCR);
+  TRACE_PRINTF("ETH: MACCR = 0x%08lx\n", (unsigned long)heth.Instance->MACCR);
+  TRACE_PRINTF("RX Desc 0: 0x%08lx 0x%08lx 0x%08lx 0x%08lx\n",
+         (unsigned long)DMARxDscrTab[0].DESC0,
+         (unsigned long)DMARxDscrTab[0].DESC1,
+         (unsigned long)DMARxDscrTab[0].DESC2,
+         (unsigned long)DMARxDscrTab[0].DESC3);
+  
+  /* ETH_CODE: Program the perfect/hash multicast filters from the
+   * groups lwIP has joined instead of receiving everything. */
+  stm32h7_eth_apply_mac_filter();
+  
+  /* ETH_CODE: Explicitly disable advanced features that could trigger Context Descriptors
+   * (Timestamps, VLANs) to ensure the DMA only produces Normal descriptors.
+   * With ETH_PTP_ENABLE the timestamp unit stays as stm32h7_eth_ptp_init()
+   * left it and low_level_input() consumes the timestamp context descriptors. */
+#if !ETH_PTP_ENABLE
+  heth.Instance->MACTSCR = 0; /* Clear ALL timestamp settings to prevent CTXT descriptors */
+#endif
+#if LWIP_VLAN_OFFLOAD
+  stm32h7_eth_apply_vlan_filter(); /* Stripped tags go to RDES0, not a context descriptor */
+#else
+  heth.Instance->MACVTR = 0;  /* Disable VLAN tagging */
+#endif
+#if ETH_ARP_OFFLOAD
+  stm32h7_eth_apply_arp_offload(); /* after HAL_ETH_SetMACConfig() rewrote MACCR */
+#endif
+#if ETH_L34_FILTER
+  stm32h7_eth_apply_l34_filter();
+#endif
+
+  TRACE_PRINTF("ETH: MACCR = 0x%08lx, MACPFR = 0x%08lx, MACTSCR = 0x%08lx\n", 
+         (unsigned long)heth.Instance->MACCR, 
+         (unsigned long)heth.Instance->MACPFR,
+         (unsigned long)heth.Instance->MACTSCR);
+
+  LinkSpeed = speed;
+  LinkDuplex = duplex;
+  LinkState = ETH_LINK_STATE_UP;
+  LinkUpCount++;
+  LinkUpTick = sys_now();
+  LinkCarrierToUpMs = LinkUpTick - LinkCarrierTick;
+  LinkFirstRxPending = 1;
+
+  netif_set_up(netif);
+  netif_set_link_up(netif);
+  UNLOCK_TCPIP_CORE();
+  ETH_TRACE3(LINK_UP, (speed == ETH_SPEED_100M) ? 100U : 10U,
+             duplex == ETH_FULLDUPLEX_MODE, LinkCarrierToUpMs);
+}
+
+/**
+ * Stop MAC and DMA and report the link down to lwIP.
+ */
+static void stm32h7_eth_link_down(struct netif *netif)
+{
+  LOCK_TCPIP_CORE();
+  stm32h7_eth_stop();
+  netif_set_link_down(netif);
+  netif_set_down(netif);
+  UNLOCK_TCPIP_CORE();
+
+  LinkState = ETH_LINK_STATE_DOWN;
+  LinkDownCount++;
+  LinkCarrierTick = 0;
+  LinkFirstRxPending = 0;
+  ETH_TRACE0(LINK_DOWN);
+}
+
 /**
   * @brief  Check the ETH link state then update ETH driver and netif link accordingly.
   * @param  argument: netif
@@ -1446,240 +3796,155 @@ int32_t ETH_PHY_IO_GetTick(void)
   */
 void ethernet_link_thread(void* argument)
 {
-  ETH_MACConfigTypeDef MACConf = {0};
-//  int32_t PHYLinkState = 0;
-//  uint32_t linkchanged = 0U, speed = 0U, duplex = 0U;
-    uint32_t speed = 0U, duplex = 0U;
   struct netif *netif = (struct netif *) argument;
+  uint32_t speed = 0U, duplex = 0U;
 
   TRACE_PRINTF("Ethernet link thread started\n");
 
-  /* Initialize PHY asynchronously to avoid blocking the main task */
-  TRACE_PRINTF("PHY: Resetting...\n");
-  ETH_PHY_IO_WriteReg(0, 0, 0x8000); /* Soft reset */
-  sys_msleep(100);
-  
-  TRACE_PRINTF("PHY: Enabling auto-negotiation...\n");
-  ETH_PHY_IO_WriteReg(0, 0, 0x1200); /* Auto-neg + Restart */
-  
-  LAN8742.Is_Initialized = 1;
+  if (!LAN8742.Is_Initialized) {
+    /* LAN8742_Init() could not find the PHY: reset it at address 0 */
+    TRACE_PRINTF("PHY: Resetting...\n");
+    ETH_PHY_IO_WriteReg(0, LAN8742_BCR, LAN8742_BCR_SOFT_RESET);
+    sys_msleep(100);
+    LAN8742.Is_Initialized = 1;
+  }
+
+  /* Autonegotiation is on after reset; only restart it if it was turned off */
+  uint32_t bcr = 0;
+  ETH_PHY_IO_ReadReg(LAN8742.DevAddr, LAN8742_BCR, &bcr);
+  if ((bcr & LAN8742_BCR_AUTONEGO_EN) == 0) {
+    TRACE_PRINTF("PHY: Enabling auto-negotiation...\n");
+    LAN8742_StartAutoNego(&LAN8742);
+  }
+
+  /* Latch the events of interest in ISFR (and raise nINT where it is wired) */
+  LAN8742_EnableIT(&LAN8742, LAN8742_ENERGYON_IT | LAN8742_AUTONEGO_COMPLETE_IT | LAN8742_LINK_DOWN_IT);
 
   for(;;)
   {
-    /* Use direct BSR read while LAN8742_GetLinkState might be unreliable */
+    uint32_t isfr = 0;
+    uint32_t bsr_latched = 0;
     uint32_t bsr = 0;
-    ETH_PHY_IO_ReadReg(0, 1, &bsr);
-    
-    if (bsr & 0x0004) {
-      /* Link is Up according to hardware */
-      if (!netif_is_link_up(netif)) {
-        TRACE_PRINTF("PHY: Link Up detected (BSR=0x%04lx)\n", (unsigned long)bsr);
-
-        /* Get negotiated speed and duplex */
-        int32_t linkState = LAN8742_GetLinkState(&LAN8742);
-        switch (linkState) {
-          case LAN8742_STATUS_100MBITS_FULLDUPLEX:
-            speed = ETH_SPEED_100M;
-            duplex = ETH_FULLDUPLEX_MODE;
-            TRACE_PRINTF("Negotiated: 100Mbps Full Duplex\n");
-            break;
-          case LAN8742_STATUS_100MBITS_HALFDUPLEX:
-            speed = ETH_SPEED_100M;
-            duplex = ETH_HALFDUPLEX_MODE;
-            TRACE_PRINTF("Negotiated: 100Mbps Half Duplex\n");
-            break;
-          case LAN8742_STATUS_10MBITS_FULLDUPLEX:
-            speed = ETH_SPEED_10M;
-            duplex = ETH_FULLDUPLEX_MODE;
-            TRACE_PRINTF("Negotiated: 10Mbps Full Duplex\n");
-            break;
-          case LAN8742_STATUS_10MBITS_HALFDUPLEX:
-            speed = ETH_SPEED_10M;
-            duplex = ETH_HALFDUPLEX_MODE;
-            TRACE_PRINTF("Negotiated: 10Mbps Half Duplex\n");
-            break;
-          case LAN8742_STATUS_AUTONEGO_NOTDONE:
-            TRACE_PRINTF("Auto-negotiation not done yet\n");
-            /* Fall back to 100M Full Duplex */
-            speed = ETH_SPEED_100M;
-            duplex = ETH_FULLDUPLEX_MODE;
-            break;
-          default:
-            TRACE_PRINTF("Unknown link state: %ld, using 100M Full Duplex\n", (long)linkState);
-            speed = ETH_SPEED_100M;
-            duplex = ETH_FULLDUPLEX_MODE;
-            break;
-        }
-        
-        LOCK_TCPIP_CORE();
-        HAL_ETH_GetMACConfig(&heth, &MACConf);
-        MACConf.DuplexMode = duplex;
-        MACConf.Speed = speed;
-        HAL_ETH_SetMACConfig(&heth, &MACConf);
-        
-        /* ETH_CODE: Manually populate and set BUF1V/OWN bits in RX descriptors
-         * BEFORE starting the DMA. This ensures the hardware sees "Ready"
-         * descriptors immediately upon activation. */
-        TRACE_PRINTF("ETH: Manually initializing RX descriptors...\n");
-
-        /* ETH_CODE: Reset software descriptor trackers to match hardware reset.
-         * The hardware DMA will start reading from the base address (Descriptor 0).
-         * We must ensure our software read pointer (RxDescIdx) matches. */
-        heth.RxDescList.RxDescIdx = 0;
-        heth.RxDescList.RxBuildDescIdx = 0;
-        heth.RxDescList.RxBuildDescCnt = 0;
-
-        for (uint32_t i = 0; i < ETH_RX_DESC_CNT; i++) {
-          uint8_t *ptr = NULL;
-          HAL_ETH_RxAllocateCallback(&ptr);
-          if (ptr) {
-            /* ptr already includes +2 offset from HAL_ETH_RxAllocateCallback */
-            DMARxDscrTab[i].DESC0 = (uint32_t)ptr;
-            /* ETH_CODE: Store buffer address in separate backup array.
-             * DMA overwrites DESC0 on completion, so we need separate storage. */
-            DMARxDscrBackup[i] = (uint32_t)ptr;
-
-            /* DESC2 bitfields for H7:
-             * [13:0]: Buffer 1 Length
-             * [30:16]: Buffer 2 Length
-             */
-            DMARxDscrTab[i].DESC2 = (heth.Init.RxBuffLen & 0x3FFF);
-            /* Set bits: 
-             * 31 (OWN): DMA owns the descriptor
-             * 30 (IOC): Interrupt On Completion  
-             * 24 (BUF1V): Buffer 1 is valid */
-            DMARxDscrTab[i].DESC3 = 0x80000000 | 0x40000000 | 0x01000000;
-            
-            /* ETH_CODE: Clean DCache to ensure DMA sees these values in RAM! */
-            SCB_CleanDCache_by_Addr((uint32_t *)&DMARxDscrTab[i], sizeof(ETH_DMADescTypeDef_Shadow));
-            
-            /* Ensure memory write is complete */
-            __DSB();
-            
-            TRACE_PRINTF("RX Init Desc %lu: addr=0x%08lx, bkup=0x%08lx, len=%lu, DESC3=0x%08lx\n",
-                   (unsigned long)i, (unsigned long)DMARxDscrTab[i].DESC0,
-                   (unsigned long)DMARxDscrBackup[i],
-                   (unsigned long)DMARxDscrTab[i].DESC2, (unsigned long)DMARxDscrTab[i].DESC3);
-            
-            /* ETH_CODE: Update HAL internal tracking to match the new packet buffer availability */
-            heth.RxDescList.RxBuildDescCnt++;
-            heth.RxDescList.RxBuildDescIdx = (heth.RxDescList.RxBuildDescIdx + 1) % ETH_RX_DESC_CNT;
-          } else {
-            TRACE_PRINTF("ERROR: Failed to allocate buffer for RX descriptor %lu!\n", (unsigned long)i);
-          }
+    uint32_t now = sys_now();
+
+    /* ISFR clears on read; BSR link status latches low until read */
+    ETH_PHY_IO_ReadReg(LAN8742.DevAddr, LAN8742_ISFR, &isfr);
+    ETH_PHY_IO_ReadReg(LAN8742.DevAddr, LAN8742_BSR, &bsr_latched);
+    ETH_PHY_IO_ReadReg(LAN8742.DevAddr, LAN8742_BSR, &bsr);
+
+    if ((isfr & LAN8742_ENERGYON_IT) && (LinkCarrierTick == 0)) {
+      LinkCarrierTick = now;
+    }
+
+    if (LinkState == ETH_LINK_STATE_UP) {
+      if (!(bsr & LAN8742_BSR_LINK_STATUS) || !(bsr_latched & LAN8742_BSR_LINK_STATUS) ||
+          (isfr & LAN8742_LINK_DOWN_IT)) {
+        /* Link lost, even if only between two polls: restart from scratch */
+        ETH_TRACE2(PHY_LINK_DOWN, bsr, isfr);
+        stm32h7_eth_link_down(netif);
+      } else if ((isfr & LAN8742_AUTONEGO_COMPLETE_IT) &&
+                 stm32h7_eth_link_resolve(LAN8742_GetLinkState(&LAN8742), &speed, &duplex) &&
+                 ((speed != LinkSpeed) || (duplex != LinkDuplex))) {
+        /* Renegotiated to a different mode without a visible link drop */
+        TRACE_PRINTF("PHY: Link mode changed, restarting MAC\n");
+        stm32h7_eth_link_down(netif);
+        LinkCarrierTick = now;
+      }
+    }
+
+    if ((LinkState != ETH_LINK_STATE_UP) && (bsr & LAN8742_BSR_LINK_STATUS)) {
+      if (LinkState == ETH_LINK_STATE_DOWN) {
+        ETH_TRACE1(PHY_LINK, bsr);
+        LinkState = ETH_LINK_STATE_NEGOTIATING;
+        if (LinkCarrierTick == 0) {
+          LinkCarrierTick = now;
         }
-        /* ETH_CODE: Bypass HAL_ETH_Start_IT because the HAL library was compiled with
-         * ETH_RX_DESC_CNT=4 but our code uses 16, causing structure size mismatch.
-         * Manually start the Ethernet DMA instead. */
-        TRACE_PRINTF("ETH: Manually starting Ethernet (bypassing HAL_ETH_Start_IT)...\n");
-        
-        /* Enable MAC transmission and reception */
-        SET_BIT(heth.Instance->MACCR, ETH_MACCR_TE | ETH_MACCR_RE);
-        
-        /* Enable DMA transmission and reception (STM32H7 uses separate control registers) */
-        SET_BIT(heth.Instance->DMACTCR, ETH_DMACTCR_ST);  /* Start Transmission */
-        SET_BIT(heth.Instance->DMACRCR, ETH_DMACRCR_SR);  /* Start Reception */
-        
-        /* Set the Ethernet state to started */
-        heth.gState = HAL_ETH_STATE_STARTED;
-        
-        /* Initialize TX descriptor to start from beginning */
-        heth.TxDescList.CurTxDesc = 0;
-        
-        /* Kick the RX DMA tail pointer */
-        heth.Instance->DMACRDTPR = (uint32_t)(DMARxDscrTab + ETH_RX_DESC_CNT);
-        
-        /* Set TX DMA tail pointer to enable transmission */
-        heth.Instance->DMACTDTPR = (uint32_t)(DMATxDscrTab + ETH_TX_DESC_CNT);
-        
-        TRACE_PRINTF("ETH: Manual start complete\n");
-        
-        /* ETH_CODE: Manually enable DMA interrupts to ensure they are properly configured
-         * This is needed because HAL_ETH_Start_IT() might not enable all required
-         * interrupts in the RTEMS environment. */
-        TRACE_PRINTF("ETH: Enabling DMA interrupts...\n");
-        /* Enable RX DMA interrupts */
-        __HAL_ETH_DMA_ENABLE_IT(&heth, ETH_DMA_RX_IT | ETH_DMA_NORMAL_IT);
-        /* Enable TX DMA interrupts */
-        __HAL_ETH_DMA_ENABLE_IT(&heth, ETH_DMA_TX_IT | ETH_DMA_NORMAL_IT);
-        /* Enable MAC interrupts */
-        __HAL_ETH_MAC_ENABLE_IT(&heth, ETH_MAC_RX_STATUS_IT | ETH_MAC_TX_STATUS_IT);
-        TRACE_PRINTF("ETH: DMACIER = 0x%08lx, MACIER = 0x%08lx\n",
-               (unsigned long)heth.Instance->DMACIER, (unsigned long)heth.Instance->MACIER);
-        TRACE_PRINTF("ETH: DMACSR  = 0x%08lx\n", (unsigned long)heth.Instance->DMACSR);
-        TRACE_PRINTF("ETH: SYSCFG_PMCR = 0x%08lx\n", (unsigned long)SYSCFG->PMCR);
-        TRACE_PRINTF("ETH: MACCR = 0x%08lx\n", (unsigned long)heth.Instance->MACCR);
-        TRACE_PRINTF("RX Desc 0: 0x%08lx 0x%08lx 0x%08lx 0x%08lx\n",
-               (unsigned long)DMARxDscrTab[0].DESC0,
-               (unsigned long)DMARxDscrTab[0].DESC1,
-               (unsigned long)DMARxDscrTab[0].DESC2,
-               (unsigned long)DMARxDscrTab[0].DESC3);
-        
-        /* ETH_CODE: Temporarily enable Promiscuous mode and Receive All
-         * to ensure we are not missing packets due to address filtering. */
-        heth.Instance->MACPFR |= ETH_MACPFR_RA | ETH_MACPFR_PR;
-        
-        /* ETH_CODE: Explicitly disable advanced features that could trigger Context Descriptors
-         * (Timestamps, VLANs) to ensure the DMA only produces Normal descriptors. */
-        /* Disable Timestamp completely - must clear bit 0 to prevent context descriptors */
-        heth.Instance->MACTSCR = 0; /* Clear ALL timestamp settings to prevent CTXT descriptors */
-        heth.Instance->MACVTR = 0;  /* Disable VLAN tagging */
-
-        TRACE_PRINTF("ETH: MACCR = 0x%08lx, MACPFR = 0x%08lx, MACTSCR = 0x%08lx\n", 
-               (unsigned long)heth.Instance->MACCR, 
-               (unsigned long)heth.Instance->MACPFR,
-               (unsigned long)heth.Instance->MACTSCR);
-
-        netif_set_up(netif);
-        netif_set_link_up(netif);
-        UNLOCK_TCPIP_CORE();
-        TRACE_PRINTF("Ethernet link is UP\n");
       }
-    } else {
-      /* Link is Down according to hardware */
-      if (netif_is_link_up(netif)) {
-        TRACE_PRINTF("PHY: Link Down detected (BSR=0x%04lx)\n", (unsigned long)bsr);
-        LOCK_TCPIP_CORE();
-        HAL_ETH_Stop_IT(&heth);
-        netif_set_link_down(netif);
-        netif_set_down(netif);
-        UNLOCK_TCPIP_CORE();
-        TRACE_PRINTF("Ethernet link is DOWN\n");
+      if (stm32h7_eth_link_resolve(LAN8742_GetLinkState(&LAN8742), &speed, &duplex)) {
+        stm32h7_eth_link_up(netif, speed, duplex);
+      } else if ((now - LinkCarrierTick) >= ETH_LINK_AUTONEG_TIMEOUT_MS) {
+        ETH_TRACE0(PHY_AN_TIMEOUT);
+        stm32h7_eth_link_up(netif, ETH_SPEED_100M, ETH_FULLDUPLEX_MODE);
       }
+    } else if ((LinkState == ETH_LINK_STATE_NEGOTIATING) && !(bsr & LAN8742_BSR_LINK_STATUS)) {
+      LinkState = ETH_LINK_STATE_DOWN;
     }
 
-    sys_msleep(500);
+    sys_msleep(ETH_LINK_POLL_MS);
   }
 }
 
-void HAL_ETH_RxAllocateCallback(uint8_t **buff)
+/**
+ * Take an RX_POOL buffer for a descriptor.
+ *
+ * @return the DMA address (ETH_PAD_SIZE into the buffer), NULL if the pool
+ *         is empty; the caller counts the failure in its own stats group
+ */
+static uint8_t *stm32h7_eth_rx_buffer_alloc(void)
 {
-/* USER CODE BEGIN HAL ETH RxAllocateCallback */
-
-  TRACE_PRINTF("\n========== RX_ALLOCATE_CALLBACK ==========\n");
+  uint8_t *buff = NULL;
   struct pbuf_custom *p = LWIP_MEMPOOL_ALLOC(RX_POOL);
+  if (p == NULL)
+  {
+    /* ETH_CODE: A buffer freed between the failed allocation and the flag
+     * going up did not signal the RX thread, which would then wait for a
+     * free that never comes. Raise the flag first and look once more: a
+     * buffer freed after that signals, one freed before is found here. */
+    RxAllocStatus = RX_ALLOC_ERROR;
+    p = LWIP_MEMPOOL_ALLOC(RX_POOL);
+    if (p)
+    {
+      RxAllocStatus = RX_ALLOC_OK;
+    }
+  }
   if (p)
   {
-    TRACE_PRINTF("RX_ALLOC: Allocated pbuf_custom at 0x%p\n", p);
+    ETH_TRACE1(RX_ALLOC, p);
     /* Get the buff from the struct pbuf address. */
     /* ETH_CODE: Apply ETH_PAD_SIZE offset for IP header alignment */
-    *buff = (uint8_t *)p + offsetof(RxBuff_t, buff) + ETH_PAD_SIZE;
-    TRACE_PRINTF("RX_ALLOC: buff=0x%p (with +%d offset), actual buff=0x%p\n", *buff, ETH_PAD_SIZE, (uint8_t *)p + offsetof(RxBuff_t, buff));
+    buff = (uint8_t *)p + offsetof(RxBuff_t, buff) + ETH_PAD_SIZE;
     p->custom_free_function = pbuf_free_custom;
     /* Initialize the struct pbuf.
     * This must be performed whenever a buffer's allocated because it may be
     * changed by lwIP or the app, e.g., pbuf_free decrements ref. */
     /* ETH_CODE: Pass actual buffer start (without +2) so pbuf knows the true memory location */
     pbuf_alloced_custom(PBUF_RAW, 0, PBUF_REF, p, (uint8_t *)p + offsetof(RxBuff_t, buff), ETH_RX_BUFFER_SIZE);
-    TRACE_PRINTF("RX_ALLOC: pbuf initialized successfully\n");
+    /* ETH_CODE: Discard lines the previous owner may have left dirty (e.g. an
+     * ICMP echo built in place), so no write-back lands on top of DMA data. */
+    SCB_InvalidateDCache_by_Addr((uint32_t *)((uint8_t *)p + offsetof(RxBuff_t, buff)), ETH_RX_BUFFER_SIZE);
   }
   else
   {
-    TRACE_PRINTF("RX_ALLOC: FAILED - RX_POOL exhausted!\n");
-    RxAllocStatus = RX_ALLOC_ERROR;
-    *buff = NULL;
+    ETH_TRACE0(RX_ALLOC_FAIL);
+  }
+  return buff;
+}
+
+/* Refill the ring at link up (link thread, tcpip core locked) */
+static uint8_t *stm32h7_eth_rx_buffer_alloc_ctl(void)
+{
+  uint8_t *buff = stm32h7_eth_rx_buffer_alloc();
+
+  if (buff == NULL) {
+    ETH_STATS_BEGIN(ETH_STATS_CTL);
+    EthCtlStats.pool_empty++;
+    ETH_STATS_END(ETH_STATS_CTL);
+  }
+  return buff;
+}
+
+/* The RX thread's allocator */
+void HAL_ETH_RxAllocateCallback(uint8_t **buff)
+{
+/* USER CODE BEGIN HAL ETH RxAllocateCallback */
+
+  *buff = stm32h7_eth_rx_buffer_alloc();
+  if (*buff == NULL)
+  {
+    ETH_STATS_BEGIN(ETH_STATS_RX);
+    EthRxStats.pool_empty++;
+    ETH_STATS_END(ETH_STATS_RX);
   }
-  TRACE_PRINTF("========== RX_ALLOCATE_CALLBACK END ==========\n\n");
 /* USER CODE END HAL ETH RxAllocateCallback */
 }
 
@@ -1691,42 +3956,39 @@ void HAL_ETH_RxLinkCallback(void **pStart, void **pEnd, uint8_t *buff, uint16_t
   struct pbuf **ppEnd = (struct pbuf **)pEnd;
   struct pbuf *p = NULL;
 
-  /* ETH_CODE: buff points to buff+ETH_PAD_SIZE offset from HAL_ETH_RxAllocateCallback
-   * Calculate actual buffer start and adjust pbuf accordingly. */
+  /* ETH_CODE: buff is the DMA address handed out by HAL_ETH_RxAllocateCallback,
+   * i.e. ETH_PAD_SIZE bytes into the RxBuff_t data area. The first buffer of a
+   * frame keeps the padding so ethernet_input() can strip it; the following
+   * ones start right at the DMA address. */
   uint8_t *actual_buff = buff - ETH_PAD_SIZE;
-  
-  /* Get the struct pbuf from the actual buff address. */
-  p = (struct pbuf *)(actual_buff - offsetof(RxBuff_t, buff));
-  p->next = NULL;
-  p->tot_len = 0;
-  p->len = Length;
+  struct pbuf_custom *p_custom = (struct pbuf_custom *)stm32h7_get_pbuf_from_buff(actual_buff);
 
-  /* Chain the buffer. */
+  p_custom->custom_free_function = pbuf_free_custom;
   if (!*ppStart)
   {
     /* The first buffer of the packet. */
+    p = pbuf_alloced_custom(PBUF_RAW, Length + ETH_PAD_SIZE, PBUF_REF, p_custom,
+                            actual_buff, ETH_RX_BUFFER_SIZE);
     *ppStart = p;
   }
   else
   {
     /* Chain the buffer to the end of the packet. */
+    p = pbuf_alloced_custom(PBUF_RAW, Length, PBUF_REF, p_custom,
+                            buff, ETH_RX_BUFFER_SIZE - ETH_PAD_SIZE);
     (*ppEnd)->next = p;
   }
   *ppEnd  = p;
 
   /* Update the total length of all the buffers of the chain. Each pbuf in the chain should have its tot_len
    * set to its own length, plus the length of all the following pbufs in the chain. */
-  for (p = *ppStart; p != NULL; p = p->next)
+  for (p = *ppStart; p != *ppEnd; p = p->next)
   {
     p->tot_len += Length;
   }
 
-  /* ETH_CODE: Adjust pbuf payload to point to the offset region (buff+2)
-   * where the Ethernet header actually resides. */
-  p->payload = (uint8_t *)p->payload + 2;
-
-  /* ETH_CODE: Invalidate cache for the actual data region starting at actual_buff. */
-  SCB_InvalidateDCache_by_Addr((uint32_t *)actual_buff, Length);
+  /* ETH_CODE: Drop any stale lines the core may have fetched while the DMA owned the buffer */
+  SCB_InvalidateDCache_by_Addr((uint32_t *)actual_buff, Length + ETH_PAD_SIZE);
 
 /* USER CODE END HAL ETH RxLinkCallback */
 }
@@ -1735,16 +3997,149 @@ void HAL_ETH_TxFreeCallback(uint32_t * buff)
 {
 /* USER CODE BEGIN HAL ETH TxFreeCallback */
 
-  TRACE_PRINTF("\n========== TX_FREE_CALLBACK ==========\n");
-  TRACE_PRINTF("TX_FREE: buff=0x%p\n", buff);
+  ETH_TRACE1(TX_FREE, buff);
   pbuf_free((struct pbuf *)buff);
-  TRACE_PRINTF("TX_FREE: pbuf freed\n");
-  TRACE_PRINTF("========== TX_FREE_CALLBACK END ==========\n\n");
 
 /* USER CODE END HAL ETH TxFreeCallback */
 }
 
 /* USER CODE BEGIN 8 */
+/**
+  * @brief  Copy the driver's ring indices, e.g. for a heartbeat printout.
+  *         The values are read without locking and may be mid-update.
+  * @param  state: filled with the current ring indices
+  * @retval None
+  */
+void stm32h7_eth_get_ring_state(stm32h7_eth_ring_state_t *state)
+{
+  state->rx_read_idx = RxDescIdx;
+  state->rx_build_idx = RxBuildDescIdx;
+  state->rx_build_cnt = RxBuildDescCnt;
+  state->tx_head = TxDescHead;
+  state->tx_tail = TxDescTail;
+  state->tx_in_flight = TxDescInFlight;
+}
+
+/**
+ * Report the RX interrupt moderation parameters currently in effect.
+ */
+void stm32h7_eth_get_rx_coalesce(stm32h7_eth_rx_coalesce_t *coal)
+{
+  coal->level = RxCoalesceLevel;
+  coal->frames = RxCoalesceFrames;
+  coal->rwt = RxCoalesceRwt;
+  coal->rwt_us = RxCoalesceTab[RxCoalesceLevel].rwt_us;
+  coal->rx_pps = RxCoalescePps;
+}
+
+void stm32h7_eth_get_link_stats(stm32h7_eth_link_stats_t *link)
+{
+  link->state = (uint32_t)LinkState;
+  link->speed_mbps = (LinkState != ETH_LINK_STATE_UP) ? 0U :
+                     (LinkSpeed == ETH_SPEED_100M) ? 100U : 10U;
+  link->full_duplex = (LinkState == ETH_LINK_STATE_UP) && (LinkDuplex == ETH_FULLDUPLEX_MODE);
+  link->up_count = LinkUpCount;
+  link->down_count = LinkDownCount;
+  link->carrier_to_up_ms = LinkCarrierToUpMs;
+  link->up_to_first_rx_ms = LinkUpToFirstRxMs;
+}
+
+/**
+ * Copy one statistics group while its writer may be running. A copy is kept
+ * only if the group's sequence was even and unchanged across it; retries are
+ * bounded so a reader can never spin on a writer it preempted.
+ */
+static void stm32h7_eth_stats_copy(uint32_t group, void *dst, const void *src, size_t len)
+{
+  for (uint32_t tries = 0; tries < 8U; tries++) {
+    uint32_t seq = EthStatsSeq[group];
+    __DMB();
+    memcpy(dst, src, len);
+    __DMB();
+    if (((seq & 1U) == 0U) && (seq == EthStatsSeq[group])) {
+      return;
+    }
+  }
+}
+
+/**
+ * Take a snapshot of the driver statistics. The counter groups are copied
+ * under their sequence counts, so the ISR and the RX thread are never
+ * locked out; the tcpip core lock is held only to serialize the MMCCR
+ * read-modify-write and the L3/L4 filter state with the stack. The MMC
+ * counters are frozen (MMCCR CNTFREEZ) while they are read so the RX and
+ * TX counts are from the same instant.
+ */
+void stm32h7_eth_get_stats(stm32h7_eth_stats_t *st)
+{
+  EthIsrStats_t isr;
+  EthRxStats_t rx;
+  EthTxStats_t tx;
+  EthCtlStats_t ctl;
+
+  LOCK_TCPIP_CORE();
+  stm32h7_eth_stats_copy(ETH_STATS_ISR, &isr, (const void *)&EthIsrStats, sizeof(isr));
+  stm32h7_eth_stats_copy(ETH_STATS_RX, &rx, (const void *)&EthRxStats, sizeof(rx));
+  stm32h7_eth_stats_copy(ETH_STATS_TX, &tx, (const void *)&EthTxStats, sizeof(tx));
+  stm32h7_eth_stats_copy(ETH_STATS_CTL, &ctl, (const void *)&EthCtlStats, sizeof(ctl));
+
+  st->irq = isr.irq;
+  st->rx_irq = isr.rx_irq;
+  st->tx_irq = isr.tx_irq;
+  st->rx_buf_unavail = isr.rbu;
+  st->dma_error = isr.dma_error;
+
+  st->rx_packets = rx.packets;
+  st->rx_polls = rx.polls;
+  st->rx_ring_size = ETH_RX_RING_SIZE;
+  st->rx_ring_hwm = rx.ring_hwm;
+  st->rx_pool_empty = rx.pool_empty + ctl.pool_empty;
+  st->rx_alloc_error = (RxAllocStatus == RX_ALLOC_ERROR);
+#if MEMP_STATS
+  st->rx_pool_hwm = memp_stats_RX_POOL.max;
+#else
+  st->rx_pool_hwm = 0;
+#endif
+  st->rx_copybreak = rx.copybreak;
+  st->rx_split = rx.split;
+  st->rx_csum_drop = rx.csum_drop;
+  st->rx_vlan = rx.vlan;
+  st->rx_arp_dropped = rx.arp_dropped;
+  st->rx_l34_updates = ctl.l34_updates;
+  st->rx_l34_overflow = ctl.l34_overflow;
+#if ETH_L34_FILTER
+  st->rx_l34_filters = L34FilterCnt;
+#else
+  st->rx_l34_filters = 0;
+#endif
+  st->rx_fifo_overflow = rx.fifo_overflow;
+  st->rx_missed = rx.missed;
+
+  st->tx_packets = tx.packets;
+  st->tx_timeouts = tx.timeouts;
+  st->tx_bounced = tx.bounced;
+  st->tx_ring_size = ETH_TX_RING_SIZE;
+  st->tx_ring_hwm = tx.ring_hwm;
+  st->tx_bounce_size = ETH_TX_BOUNCE_CNT;
+  st->tx_bounce_hwm = tx.bounce_hwm;
+  st->tx_tso = tx.tso;
+  st->tx_tso_segs = tx.tso_segs;
+  st->tx_vlan = tx.vlan;
+
+  st->irqs_per_kpkt = (rx.packets + tx.packets) == 0 ? 0 :
+      (uint32_t)(((uint64_t)isr.irq * 1000U) / (rx.packets + tx.packets));
+
+  heth.Instance->MMCCR |= 0x00000008;                    /* CNTFREEZ */
+  st->mmc_rx_unicast = heth.Instance->MMCRUPGR;
+  st->mmc_rx_crc_error = heth.Instance->MMCRCRCEPR;
+  st->mmc_rx_align_error = heth.Instance->MMCRAEPR;
+  st->mmc_tx_packets = heth.Instance->MMCTPCGR;
+  st->mmc_tx_single_col = heth.Instance->MMCTSCGPR;
+  st->mmc_tx_multi_col = heth.Instance->MMCTMCGPR;
+  heth.Instance->MMCCR &= ~0x00000008U;
+  UNLOCK_TCPIP_CORE();
+}
+
 /* ETH_CODE: add functions needed for proper multithreading support and check */
 
 /* CMSIS-OS specific locking checks removed for RTEMS port */
@@ -1812,6 +4207,30 @@ static void MPU_Config(void)
 
   HAL_MPU_ConfigRegion(&MPU_InitStruct);
 
+#if ETH_DESC_NONCACHEABLE
+  /** Region 3: ETH DMA descriptors (0x30000000) - Normal, Non-cacheable
+   * Overrides region 2 for the two rings only. TEX=1, C=0, B=0 keeps normal
+   * memory semantics (no alignment faults, unlike Device) without caching.
+   * SIZE encodes 2^(SIZE+1) bytes.
+   */
+  uint8_t desc_region_size = MPU_REGION_SIZE_256B;
+  while ((2U << desc_region_size) < ETH_DESC_REGION_SIZE) {
+    desc_region_size++;
+  }
+  MPU_InitStruct.Number = MPU_REGION_NUMBER3;
+  MPU_InitStruct.BaseAddress = ETH_RX_DESC_ADDR;
+  MPU_InitStruct.Size = desc_region_size;
+  MPU_InitStruct.TypeExtField = MPU_TEX_LEVEL1;
+  MPU_InitStruct.IsShareable = MPU_ACCESS_SHAREABLE;
+  MPU_InitStruct.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
+  MPU_InitStruct.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+
+  HAL_MPU_ConfigRegion(&MPU_InitStruct);
+
+  /* Lines cached before the MPU change must not be written back over it */
+  SCB_CleanInvalidateDCache_by_Addr((uint32_t *)ETH_RX_DESC_ADDR, ETH_DESC_REGION_SIZE);
+#endif
+
   /* Enables the MPU */
   HAL_MPU_Enable(MPU_PRIVILEGED_DEFAULT);
   
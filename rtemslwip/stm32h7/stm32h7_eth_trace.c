@@ -0,0 +1,133 @@
+/**
+  ******************************************************************************
+  * @file    stm32h7_eth_trace.c
+  * @brief   Lock-free binary event ring for the STM32H7 Ethernet driver.
+  ******************************************************************************
+  * @attention
+  *
+  * Writers reserve a slot with an atomic increment of the ring head, fill
+  * it and publish it by writing the record's sequence number last. Nothing
+  * blocks and nothing is formatted, so events may be recorded from the ETH
+  * interrupt as well as from any thread. A writer preempted between the
+  * reservation and the publish leaves a record the reader skips; a ring
+  * that wraps simply overwrites its oldest records.
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <bsp.h>
+#include <stm32h7xx_hal.h>
+#include <stdio.h>
+#include <rtems.h>
+#include "stm32h7_eth_trace.h"
+
+#if ETH_TRACE_ENABLE
+
+/* Private variables ---------------------------------------------------------*/
+stm32h7_eth_trace_ring_t EthTraceRing[ETH_TRACE_CPU_COUNT] __attribute__((aligned(32)));
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Start the DWT cycle counter and stamp the ring headers.
+  *         Safe to call more than once; records already taken are kept.
+  * @retval None
+  */
+void stm32h7_eth_trace_init(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->LAR = 0xC5ACCE55;                                 /* unlock DWT on the M7 */
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  for (uint32_t cpu = 0; cpu < ETH_TRACE_CPU_COUNT; cpu++) {
+    stm32h7_eth_trace_ring_t *ring = &EthTraceRing[cpu];
+
+    ring->rec_size = sizeof(stm32h7_eth_trace_rec_t);
+    ring->ring_size = ETH_TRACE_RING_SIZE;
+    ring->cpu_hz = SystemCoreClock;
+    __DMB();
+    ring->magic = ETH_TRACE_MAGIC;
+  }
+}
+
+/**
+  * @brief  Record one event in the ring of the current CPU.
+  *         Use the ETH_TRACEn() macros rather than calling this directly.
+  * @retval None
+  */
+void stm32h7_eth_trace_record(uint32_t id, uint32_t nargs,
+                              uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+#if ETH_TRACE_CPU_COUNT > 1
+  stm32h7_eth_trace_ring_t *ring = &EthTraceRing[rtems_scheduler_get_processor()];
+#else
+  stm32h7_eth_trace_ring_t *ring = &EthTraceRing[0];
+#endif
+  uint32_t seq = __atomic_fetch_add(&ring->head, 1U, __ATOMIC_RELAXED);
+  stm32h7_eth_trace_rec_t *rec = &ring->rec[seq & (ETH_TRACE_RING_SIZE - 1U)];
+
+  /* Invalidate the slot first so a reader never pairs the old seq with
+   * half of the new arguments */
+  rec->seq = ~seq;
+  __DMB();
+  rec->cycles = DWT->CYCCNT;
+  rec->id = (uint16_t)id;
+  rec->nargs = (uint8_t)nargs;
+  rec->ctx = (uint8_t)__get_IPSR();
+  rec->arg[0] = a0;
+  rec->arg[1] = a1;
+  rec->arg[2] = a2;
+  rec->arg[3] = a3;
+  __DMB();
+  rec->seq = seq;
+}
+
+/**
+  * @brief  Print the published records of every ring, oldest first, as
+  *         text lines for eth_trace_decode.py. Writers keep running; a
+  *         record overwritten while it is printed is left out.
+  * @retval None
+  */
+void stm32h7_eth_trace_dump(void)
+{
+  for (uint32_t cpu = 0; cpu < ETH_TRACE_CPU_COUNT; cpu++) {
+    stm32h7_eth_trace_ring_t *ring = &EthTraceRing[cpu];
+    uint32_t head = ring->head;
+    uint32_t first = (head > ETH_TRACE_RING_SIZE) ? head - ETH_TRACE_RING_SIZE : 0U;
+
+    printf("ETT-HDR %lu %lu %lu %lu\n", (unsigned long)cpu, (unsigned long)ring->cpu_hz,
+           (unsigned long)head, (unsigned long)ETH_TRACE_RING_SIZE);
+    for (uint32_t seq = first; seq != head; seq++) {
+      volatile stm32h7_eth_trace_rec_t *slot = &ring->rec[seq & (ETH_TRACE_RING_SIZE - 1U)];
+      stm32h7_eth_trace_rec_t rec;
+
+      if (slot->seq != seq) {
+        continue;
+      }
+      __DMB();
+      rec = *slot;
+      __DMB();
+      if (slot->seq != seq) {
+        continue;
+      }
+      printf("ETT %lu %08lx %08lx %04x %x %02x %08lx %08lx %08lx %08lx\n",
+             (unsigned long)cpu, (unsigned long)rec.seq, (unsigned long)rec.cycles,
+             (unsigned int)rec.id, (unsigned int)rec.nargs, (unsigned int)rec.ctx,
+             (unsigned long)rec.arg[0], (unsigned long)rec.arg[1],
+             (unsigned long)rec.arg[2], (unsigned long)rec.arg[3]);
+    }
+  }
+}
+
+#else /* !ETH_TRACE_ENABLE */
+
+void stm32h7_eth_trace_init(void)
+{
+}
+
+void stm32h7_eth_trace_dump(void)
+{
+  printf("ETH trace disabled (ETH_TRACE_ENABLE=0)\n");
+}
+
+#endif /* ETH_TRACE_ENABLE */
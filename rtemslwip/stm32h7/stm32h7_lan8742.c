@@ -39,7 +39,11 @@
   * @{
   */
 #define LAN8742_SW_RESET_TO    ((uint32_t)500U)
-#define LAN8742_INIT_TO        ((uint32_t)2000U)
+/* Settle time after the reset. The Ethernet link state machine polls for
+ * link and autonegotiation itself, so LAN8742_Init() does not block. */
+#ifndef LAN8742_INIT_TO
+#define LAN8742_INIT_TO        ((uint32_t)0U)
+#endif
 #define LAN8742_MAX_DEV_ADDR   ((uint32_t)31U)
 /**
   * @}
@@ -170,8 +174,8 @@ int32_t  LAN8742_RegisterBusIO(lan8742_Object_t *pObj, lan8742_IOCtx_t *ioctx)
    {
      tickstart =  pObj->IO.GetTick();
      
-     /* Wait for 2s to perform initialization */
-     while((pObj->IO.GetTick() - tickstart) <= LAN8742_INIT_TO)
+     /* Wait LAN8742_INIT_TO ms to perform initialization */
+     while((LAN8742_INIT_TO > 0U) && ((pObj->IO.GetTick() - tickstart) <= LAN8742_INIT_TO))
      {
      }
      pObj->Is_Initialized = 1;
@@ -50,9 +50,15 @@ static rtems_task Init(rtems_task_argument argument)
 
   printf("Waiting for Ethernet link to come up...\n");
   while (!netif_is_link_up(&netif)) {
-    rtems_task_wake_after(RTEMS_MILLISECONDS_TO_TICKS(500));
+    rtems_task_wake_after(RTEMS_MILLISECONDS_TO_TICKS(10));
   }
 
+  stm32h7_eth_link_stats_t link;
+  stm32h7_eth_get_link_stats(&link);
+  printf("Link: %lu Mbps %s duplex, up %lu ms after carrier\n",
+         (unsigned long)link.speed_mbps, link.full_duplex ? "full" : "half",
+         (unsigned long)link.carrier_to_up_ms);
+
   printf("Interface is UP. IP: 192.168.1.10\n");
   printf("Starting lwiperf server on port 5001...\n");
 
@@ -68,14 +74,40 @@ static rtems_task Init(rtems_task_argument argument)
 
   extern __IO uint32_t EthIrqCount;
   extern __IO uint32_t RxIrqCount;
-  extern ETH_HandleTypeDef heth;
   while(1) {
-    printf("HB: IRQs=%lu Rx=%lu RxIdx=%lu/%lu/%lu TxIdx=%lu\n", 
+    stm32h7_eth_ring_state_t ring;
+    stm32h7_eth_get_ring_state(&ring);
+    printf("HB: IRQs=%lu Rx=%lu RxIdx=%lu/%lu/%lu TxIdx=%lu/%lu (%lu)\n", 
            (unsigned long)EthIrqCount, (unsigned long)RxIrqCount,
-           (unsigned long)heth.RxDescList.RxDescIdx,
-           (unsigned long)heth.RxDescList.RxBuildDescIdx,
-           (unsigned long)heth.RxDescList.RxBuildDescCnt,
-           (unsigned long)heth.TxDescList.CurTxDesc);
+           (unsigned long)ring.rx_read_idx,
+           (unsigned long)ring.rx_build_idx,
+           (unsigned long)ring.rx_build_cnt,
+           (unsigned long)ring.tx_head,
+           (unsigned long)ring.tx_tail,
+           (unsigned long)ring.tx_in_flight);
+    stm32h7_eth_rx_coalesce_t coal;
+    stm32h7_eth_get_rx_coalesce(&coal);
+    printf("HB: RxCoalesce level=%lu frames=%lu rwt=%lu (%lu us) rate=%lu pps\n",
+           (unsigned long)coal.level, (unsigned long)coal.frames,
+           (unsigned long)coal.rwt, (unsigned long)coal.rwt_us,
+           (unsigned long)coal.rx_pps);
+    stm32h7_eth_get_link_stats(&link);
+    printf("HB: Link state=%lu %lu Mbps up=%lu down=%lu carrier->up=%lu ms up->rx=%lu ms\n",
+           (unsigned long)link.state, (unsigned long)link.speed_mbps,
+           (unsigned long)link.up_count, (unsigned long)link.down_count,
+           (unsigned long)link.carrier_to_up_ms, (unsigned long)link.up_to_first_rx_ms);
+    stm32h7_eth_stats_t st;
+    stm32h7_eth_get_stats(&st);
+    printf("HB: Stats rx=%lu tx=%lu irq/kpkt=%lu rxring=%lu/%lu txring=%lu/%lu bounce=%lu/%lu "
+           "pool_empty=%lu ovf=%lu miss=%lu crc=%lu tx_to=%lu\n",
+           (unsigned long)st.rx_packets, (unsigned long)st.tx_packets,
+           (unsigned long)st.irqs_per_kpkt,
+           (unsigned long)st.rx_ring_hwm, (unsigned long)st.rx_ring_size,
+           (unsigned long)st.tx_ring_hwm, (unsigned long)st.tx_ring_size,
+           (unsigned long)st.tx_bounce_hwm, (unsigned long)st.tx_bounce_size,
+           (unsigned long)st.rx_pool_empty, (unsigned long)st.rx_fifo_overflow,
+           (unsigned long)st.rx_missed, (unsigned long)st.mmc_rx_crc_error,
+           (unsigned long)st.tx_timeouts);
     rtems_task_wake_after(RTEMS_MILLISECONDS_TO_TICKS(2000));
   }
 
@@ -1,6 +1,11 @@
 /* 
- * Uncomment the line below to ENABLE tracing.
- * Keep it commented out to DISABLE tracing (default).
+ * Uncomment the line below to ENABLE printf tracing of the one-time
+ * bring-up messages (init, PHY, MPU). Keep it commented out to DISABLE
+ * it (default).
+ *
+ * Per-packet events do not go through printf: they are recorded into the
+ * binary trace ring (ETH_TRACE_ENABLE, see stm32h7_eth_trace.h), which is
+ * cheap enough to leave on at line rate.
  */
 /* #define _TRACE_MODE_ */
 
@@ -8,4 +13,4 @@
   #define TRACE_PRINTF(...) printf(__VA_ARGS__)
 #else
   #define TRACE_PRINTF(...) do { } while (0)
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""
+STM32H7 Ethernet Trace Decoder
+==============================
+Turns the binary event ring of the STM32H7 Ethernet driver into readable
+log lines. The event names and format strings are read from the
+ETH_TRACE_EVENTS table in stm32h7_eth_trace.h, so the header must match the
+firmware that recorded the trace.
+
+Input is either
+  * console output containing the ETT-HDR/ETT lines printed by
+    stm32h7_eth_trace_dump(), or
+  * a raw memory image of EthTraceRing, e.g. from gdb:
+      dump binary memory trace.bin &EthTraceRing ((char *)&EthTraceRing + sizeof(EthTraceRing))
+
+Usage:
+  eth_trace_decode.py [--header PATH] [--hz HZ] DUMP
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+DEFAULT_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..',
+                              'rtemslwip', 'stm32h7', 'include', 'stm32h7_eth_trace.h')
+
+TRACE_MAGIC = 0x45545452
+RING_HDR = struct.Struct('<8I')
+RECORD = struct.Struct('<IIHBB4II')
+
+
+def load_events(header_path):
+    """Return [(name, fmt)] in ID order from the ETH_TRACE_EVENTS table."""
+    with open(header_path) as f:
+        text = f.read()
+    table = text[text.index('#define ETH_TRACE_EVENTS(X)'):]
+    table = table[:table.index('\n\n')]
+    return re.findall(r'X\((\w+),\s*"((?:[^"\\]|\\.)*)"\)', table)
+
+
+def parse_text(path):
+    """Yield (cpu, hz, [records]) from stm32h7_eth_trace_dump() output."""
+    rings = {}
+    with open(path, errors='replace') as f:
+        for line in f:
+            fields = line.split()
+            if not fields:
+                continue
+            # Console lines may carry a prefix; look for the tag anywhere
+            for i, tag in enumerate(fields):
+                if tag in ('ETT-HDR', 'ETT'):
+                    fields = fields[i:]
+                    break
+            else:
+                continue
+            if fields[0] == 'ETT-HDR' and len(fields) >= 5:
+                rings[int(fields[1])] = (int(fields[2]), [])
+            elif fields[0] == 'ETT' and len(fields) >= 11:
+                cpu = int(fields[1])
+                rec = (int(fields[2], 16), int(fields[3], 16), int(fields[4], 16),
+                       int(fields[5], 16), int(fields[6], 16),
+                       [int(a, 16) for a in fields[7:11]])
+                rings.setdefault(cpu, (0, []))[1].append(rec)
+    for cpu in sorted(rings):
+        hz, recs = rings[cpu]
+        yield cpu, hz, recs
+
+
+def parse_binary(path):
+    """Yield (cpu, hz, [records]) from a memory image of EthTraceRing."""
+    with open(path, 'rb') as f:
+        data = f.read()
+    off = 0
+    cpu = 0
+    while off + RING_HDR.size <= len(data):
+        magic, rec_size, ring_size, hz, head = RING_HDR.unpack_from(data, off)[:5]
+        if magic != TRACE_MAGIC or rec_size != RECORD.size:
+            break
+        recs = []
+        first = head - ring_size if head > ring_size else 0
+        base = off + RING_HDR.size
+        for seq in range(first, head):
+            pos = base + (seq % ring_size) * rec_size
+            if pos + rec_size > len(data):
+                break
+            r = RECORD.unpack_from(data, pos)
+            if r[0] != seq:
+                continue                        # overwritten while dumped
+            recs.append((r[0], r[1], r[2], r[3], r[4], list(r[5:9])))
+        yield cpu, hz, recs
+        off = base + ring_size * rec_size
+        cpu += 1
+
+
+def format_event(events, rec):
+    seq, cycles, ev_id, nargs, ctx, args = rec
+    if ev_id >= len(events):
+        return 'UNKNOWN_%d %s' % (ev_id, ' '.join('0x%08x' % a for a in args[:nargs]))
+    name, fmt = events[ev_id]
+    try:
+        msg = fmt % tuple(args[:fmt.count('%') - 2 * fmt.count('%%')])
+    except (TypeError, ValueError):
+        msg = fmt + ' ' + ' '.join('0x%08x' % a for a in args[:nargs])
+    return '%-15s %s' % (name, msg)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode an STM32H7 Ethernet trace dump')
+    parser.add_argument('dump', help='console log or binary memory image')
+    parser.add_argument('--header', default=DEFAULT_HEADER, help='stm32h7_eth_trace.h of the firmware')
+    parser.add_argument('--hz', type=int, default=0, help='cycle counter rate if the dump has none')
+    args = parser.parse_args()
+
+    events = load_events(args.header)
+    with open(args.dump, 'rb') as f:
+        is_binary = f.read(4) == struct.pack('<I', TRACE_MAGIC)
+    rings = parse_binary(args.dump) if is_binary else parse_text(args.dump)
+
+    lines = []
+    for cpu, hz, recs in rings:
+        hz = args.hz or hz or 1
+        recs.sort(key=lambda r: r[0])
+        # Unwrap the 32-bit cycle counter along the sequence order
+        wraps = 0
+        prev = None
+        for rec in recs:
+            if prev is not None and rec[1] < prev:
+                wraps += 1
+            prev = rec[1]
+            t_us = ((wraps << 32) + rec[1]) * 1e6 / hz
+            lines.append((t_us, cpu, rec))
+
+    if not lines:
+        print('no trace records found', file=sys.stderr)
+        return 1
+
+    lines.sort(key=lambda l: l[0])
+    t0 = lines[0][0]
+    for t_us, cpu, rec in lines:
+        ctx = 'thr' if rec[4] == 0 else 'x%02d' % rec[4]
+        print('%12.3f us  cpu%d %s #%-8d %s' % (t_us - t0, cpu, ctx, rec[0],
+                                                 format_event(events, rec)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,47 @@
+/*
+ * lwIP compiler/platform adaptation for the host simulation (GCC, Linux).
+ * Follows rtemslwip/include/arch/cc.h except that assertions abort, so a
+ * stress run stops at the first broken invariant, and that lwIP's static
+ * memory (heap and memp pools) is placed in the simulated D1 AXI SRAM at
+ * 0x24000000, where the Ethernet DMA can reach it as on the board.
+ */
+#ifndef SIM_ARCH_CC_H
+#define SIM_ARCH_CC_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+
+#undef LWIP_PROVIDE_ERRNO
+
+/* Use the host's struct iovec and struct timeval rather than lwIP's */
+#define iovec iovec
+#define LWIP_TIMEVAL_PRIVATE 0
+
+/* 64-bit host pointers do not fit the 8-byte IPv6 fragment header */
+#define IPV6_FRAG_COPYHEADER 1
+
+#define PACK_STRUCT_BEGIN
+#define PACK_STRUCT_STRUCT __attribute__ ((__packed__))
+#define PACK_STRUCT_END
+#define PACK_STRUCT_FIELD(x) x
+
+#ifndef LWIP_CHKSUM_ALGORITHM
+#define LWIP_CHKSUM_ALGORITHM 2
+#endif
+
+#define LWIP_PLATFORM_DIAG(expr)        printf expr
+#define LWIP_PLATFORM_ASSERT(expr)      do { printf("ASSERT: %s (%s:%d)\n", (const char *)(expr), \
+                                                    __FILE__, __LINE__); abort(); } while (0)
+
+/* Linked at 0x24000000 (Makefile: --section-start=sim_d1sram) */
+#define LWIP_DECLARE_MEMORY_ALIGNED(variable_name, size) \
+  u8_t variable_name[LWIP_MEM_ALIGN_BUFFER(size)] __attribute__((section("sim_d1sram"), aligned(32)))
+
+#define LWIP_RAND() ((uint32_t)random())
+
+#endif /* SIM_ARCH_CC_H */
@@ -0,0 +1,8 @@
+/* Host simulation: no lwIP performance hooks */
+#ifndef SIM_ARCH_PERF_H
+#define SIM_ARCH_PERF_H
+
+#define PERF_START
+#define PERF_STOP(x)
+
+#endif /* SIM_ARCH_PERF_H */
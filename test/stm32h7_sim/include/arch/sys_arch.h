@@ -0,0 +1,31 @@
+/*
+ * lwIP sys_arch types for the host simulation, implemented over POSIX
+ * threads in sys_arch.c. SYS_ARCH_PROTECT masks the simulated ETH interrupt
+ * like the RTEMS port's interrupt disable does.
+ */
+#ifndef SIM_ARCH_SYS_ARCH_H
+#define SIM_ARCH_SYS_ARCH_H
+
+#include <pthread.h>
+
+#if defined(NO_SYS) && NO_SYS
+#error "The simulation sys_arch cannot be compiled in NO_SYS variant"
+#endif
+
+struct sim_sem;
+struct sim_mbox;
+
+typedef struct sim_sem *sys_sem_t;
+typedef pthread_mutex_t *sys_mutex_t;
+typedef struct sim_mbox *sys_mbox_t;
+typedef pthread_t sys_thread_t;
+typedef int sys_prot_t;
+
+#define sys_sem_valid(sem)            ((sem) != NULL && *(sem) != NULL)
+#define sys_sem_set_invalid(sem)      do { if ((sem) != NULL) { *(sem) = NULL; } } while (0)
+#define sys_mutex_valid(mutex)        ((mutex) != NULL && *(mutex) != NULL)
+#define sys_mutex_set_invalid(mutex)  do { if ((mutex) != NULL) { *(mutex) = NULL; } } while (0)
+#define sys_mbox_valid(mbox)          ((mbox) != NULL && *(mbox) != NULL)
+#define sys_mbox_set_invalid(mbox)    do { if ((mbox) != NULL) { *(mbox) = NULL; } } while (0)
+
+#endif /* SIM_ARCH_SYS_ARCH_H */
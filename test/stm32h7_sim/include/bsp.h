@@ -0,0 +1,7 @@
+/* Host simulation stand-in for the STM32H7 BSP header */
+#ifndef SIM_BSP_H
+#define SIM_BSP_H
+
+#include <rtems.h>
+
+#endif /* SIM_BSP_H */
@@ -0,0 +1,8 @@
+/*
+ * Host simulation stand-in for the lwipconfig.h that waf generates from
+ * config.ini. Everything comes from lwipopts.h and lwipbspopts.h.
+ */
+#ifndef CONFIGURED_LWIP_BSP_OPTS_H
+#define CONFIGURED_LWIP_BSP_OPTS_H
+
+#endif /* CONFIGURED_LWIP_BSP_OPTS_H */
@@ -0,0 +1,51 @@
+/*
+ * Host simulation stand-in for <rtems.h>: the handful of Classic API calls
+ * the STM32H7 Ethernet driver makes, mapped onto POSIX threads.
+ *
+ * "Disabling interrupts" takes the simulator's interrupt mutex, which the
+ * DMA model also holds while it runs the ETH interrupt handler, so a section
+ * under rtems_interrupt_local_disable() cannot be preempted by the ISR.
+ * One clock tick is one millisecond.
+ */
+
+#ifndef SIM_RTEMS_H
+#define SIM_RTEMS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  RTEMS_SUCCESSFUL = 0,
+  RTEMS_TIMEOUT = 6,
+  RTEMS_INVALID_NUMBER = 10,
+  RTEMS_TOO_MANY = 5,
+  RTEMS_UNSATISFIED = 13
+} rtems_status_code;
+
+typedef uint32_t rtems_id;
+typedef uint32_t rtems_interval;
+typedef uint32_t rtems_vector_number;
+typedef unsigned long rtems_interrupt_level;
+
+#define RTEMS_YIELD_PROCESSOR         ((rtems_interval)0)
+#define RTEMS_MILLISECONDS_TO_TICKS(ms) ((rtems_interval)(ms))
+
+void sim_irq_lock(void);
+void sim_irq_unlock(void);
+
+#define rtems_interrupt_local_disable(level) do { (level) = 0; sim_irq_lock(); } while (0)
+#define rtems_interrupt_local_enable(level)  do { (void)(level); sim_irq_unlock(); } while (0)
+#define rtems_interrupt_disable(level)       rtems_interrupt_local_disable(level)
+#define rtems_interrupt_enable(level)        rtems_interrupt_local_enable(level)
+
+rtems_status_code rtems_task_wake_after(rtems_interval ticks);
+uint32_t rtems_scheduler_get_processor(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_RTEMS_H */
@@ -0,0 +1,33 @@
+/*
+ * Host simulation stand-in for <rtems/irq-extension.h>. The only interrupt
+ * is the ETH one; the DMA model raises it (see sim_hw.c).
+ */
+
+#ifndef SIM_RTEMS_IRQ_EXTENSION_H
+#define SIM_RTEMS_IRQ_EXTENSION_H
+
+#include <rtems.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*rtems_interrupt_handler)(void *arg);
+typedef unsigned int rtems_option;
+
+#define RTEMS_INTERRUPT_UNIQUE        ((rtems_option)0x00000001)
+#define RTEMS_INTERRUPT_SHARED        ((rtems_option)0x00000000)
+
+rtems_status_code rtems_interrupt_handler_install(rtems_vector_number vector,
+                                                  const char *info,
+                                                  rtems_option options,
+                                                  rtems_interrupt_handler handler,
+                                                  void *arg);
+rtems_status_code rtems_interrupt_vector_enable(rtems_vector_number vector);
+rtems_status_code rtems_interrupt_vector_disable(rtems_vector_number vector);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_RTEMS_IRQ_EXTENSION_H */
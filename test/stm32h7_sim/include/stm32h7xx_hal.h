@@ -0,0 +1,648 @@
+/**
+  ******************************************************************************
+  * @file    stm32h7xx_hal.h
+  * @brief   Host simulation stand-in for the STM32H7 HAL, CMSIS and device
+  *          headers, reduced to what the Ethernet driver uses.
+  ******************************************************************************
+  * @attention
+  *
+  * Register offsets, bit positions and descriptor-visible constants are the
+  * ones of the STM32H743 reference manual (RM0433) and the STM32CubeH7 HAL,
+  * so stm32h7_eth.c compiles unchanged. The ETH register block, D1 AXI SRAM
+  * and D2 SRAM are mapped at their real addresses by sim_hw.c; everything
+  * else (GPIO, RCC, MPU, SCB, SYSCFG) is plain memory or a counting stub.
+  *
+  ******************************************************************************
+  */
+
+#ifndef STM32H7XX_HAL_H
+#define STM32H7XX_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* CMSIS / device basics -----------------------------------------------------*/
+#define __IO                          volatile
+#define __I                           volatile const
+#define UNUSED(x)                     ((void)(x))
+
+#define SET_BIT(REG, BIT)             ((REG) |= (BIT))
+#define CLEAR_BIT(REG, BIT)           ((REG) &= ~(BIT))
+#define READ_BIT(REG, BIT)            ((REG) & (BIT))
+#define WRITE_REG(REG, VAL)           ((REG) = (VAL))
+#define READ_REG(REG)                 ((REG))
+#define MODIFY_REG(REG, CLEARMASK, SETMASK) WRITE_REG((REG), (((READ_REG(REG)) & (~(CLEARMASK))) | (SETMASK)))
+
+typedef enum { DISABLE = 0U, ENABLE = !DISABLE } FunctionalState;
+
+typedef enum {
+  HAL_OK       = 0x00U,
+  HAL_ERROR    = 0x01U,
+  HAL_BUSY     = 0x02U,
+  HAL_TIMEOUT  = 0x03U
+} HAL_StatusTypeDef;
+
+typedef enum {
+  ETH_IRQn = 61
+} IRQn_Type;
+
+extern uint32_t SystemCoreClock;
+
+/* Core barriers and intrinsics. Barriers are counted (sim_hw.h) since on the
+ * M7 they are a measurable part of the per-packet cost. */
+void sim_barrier(void);
+#define __DSB()                       sim_barrier()
+#define __DMB()                       sim_barrier()
+#define __ISB()                       sim_barrier()
+
+static inline uint32_t __RBIT(uint32_t v)
+{
+  v = ((v >> 1) & 0x55555555U) | ((v & 0x55555555U) << 1);
+  v = ((v >> 2) & 0x33333333U) | ((v & 0x33333333U) << 2);
+  v = ((v >> 4) & 0x0F0F0F0FU) | ((v & 0x0F0F0F0FU) << 4);
+  return __builtin_bswap32(v);
+}
+
+/* Exception number of the running handler, 0 in thread mode */
+uint32_t __get_IPSR(void);
+
+/* SCB: CCR and the D-cache maintenance by address (no cache on the host,
+ * the calls and the bytes they cover are counted) */
+typedef struct {
+  __IO uint32_t CCR;
+} SCB_Type;
+
+extern SCB_Type sim_scb;
+#define SCB                           (&sim_scb)
+#define SCB_CCR_UNALIGN_TRP_Msk       (1UL << 3)
+
+void SCB_CleanDCache_by_Addr(volatile void *addr, int32_t dsize);
+void SCB_InvalidateDCache_by_Addr(volatile void *addr, int32_t dsize);
+void SCB_CleanInvalidateDCache_by_Addr(volatile void *addr, int32_t dsize);
+
+/* DWT cycle counter, advanced by the simulator at SystemCoreClock */
+typedef struct {
+  __IO uint32_t CTRL;
+  __IO uint32_t CYCCNT;
+  uint32_t RESERVED[1002];
+  __IO uint32_t LAR;
+} DWT_Type;
+
+typedef struct {
+  __IO uint32_t DHCSR;
+  __IO uint32_t DCRSR;
+  __IO uint32_t DCRDR;
+  __IO uint32_t DEMCR;
+} CoreDebug_Type;
+
+extern DWT_Type sim_dwt;
+extern CoreDebug_Type sim_coredebug;
+#define DWT                           (&sim_dwt)
+#define CoreDebug                     (&sim_coredebug)
+#define DWT_CTRL_CYCCNTENA_Msk        (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk    (1UL << 24)
+
+/* NVIC */
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+
+/* MPU */
+typedef struct {
+  uint8_t  Enable;
+  uint8_t  Number;
+  uint32_t BaseAddress;
+  uint8_t  Size;
+  uint8_t  SubRegionDisable;
+  uint8_t  TypeExtField;
+  uint8_t  AccessPermission;
+  uint8_t  DisableExec;
+  uint8_t  IsShareable;
+  uint8_t  IsCacheable;
+  uint8_t  IsBufferable;
+} MPU_Region_InitTypeDef;
+
+#define MPU_REGION_ENABLE             ((uint8_t)0x01)
+#define MPU_REGION_DISABLE            ((uint8_t)0x00)
+#define MPU_REGION_NUMBER0            ((uint8_t)0x00)
+#define MPU_REGION_NUMBER1            ((uint8_t)0x01)
+#define MPU_REGION_NUMBER2            ((uint8_t)0x02)
+#define MPU_REGION_NUMBER3            ((uint8_t)0x03)
+#define MPU_REGION_NUMBER4            ((uint8_t)0x04)
+#define MPU_REGION_NUMBER5            ((uint8_t)0x05)
+#define MPU_REGION_SIZE_256B          ((uint8_t)0x07)
+#define MPU_REGION_SIZE_512KB         ((uint8_t)0x12)
+#define MPU_REGION_SIZE_4GB           ((uint8_t)0x1F)
+#define MPU_TEX_LEVEL0                ((uint8_t)0x00)
+#define MPU_TEX_LEVEL1                ((uint8_t)0x01)
+#define MPU_REGION_FULL_ACCESS        ((uint8_t)0x03)
+#define MPU_INSTRUCTION_ACCESS_ENABLE ((uint8_t)0x00)
+#define MPU_INSTRUCTION_ACCESS_DISABLE ((uint8_t)0x01)
+#define MPU_ACCESS_SHAREABLE          ((uint8_t)0x01)
+#define MPU_ACCESS_NOT_SHAREABLE      ((uint8_t)0x00)
+#define MPU_ACCESS_CACHEABLE          ((uint8_t)0x01)
+#define MPU_ACCESS_NOT_CACHEABLE      ((uint8_t)0x00)
+#define MPU_ACCESS_BUFFERABLE         ((uint8_t)0x01)
+#define MPU_ACCESS_NOT_BUFFERABLE     ((uint8_t)0x00)
+#define MPU_PRIVILEGED_DEFAULT        0x00000004U
+
+void HAL_MPU_Disable(void);
+void HAL_MPU_Enable(uint32_t MPU_Control);
+void HAL_MPU_ConfigRegion(MPU_Region_InitTypeDef *MPU_Init);
+
+/* RCC, SYSCFG and GPIO: clocks are always on, pins are not modelled */
+uint32_t HAL_RCC_GetHCLKFreq(void);
+uint32_t HAL_GetTick(void);
+
+#define __HAL_RCC_SYSCFG_CLK_ENABLE()   do { } while (0)
+#define __HAL_RCC_ETH1MAC_CLK_ENABLE()  do { } while (0)
+#define __HAL_RCC_ETH1TX_CLK_ENABLE()   do { } while (0)
+#define __HAL_RCC_ETH1RX_CLK_ENABLE()   do { } while (0)
+#define __HAL_RCC_ETH1MAC_CLK_DISABLE() do { } while (0)
+#define __HAL_RCC_ETH1TX_CLK_DISABLE()  do { } while (0)
+#define __HAL_RCC_ETH1RX_CLK_DISABLE()  do { } while (0)
+#define __HAL_RCC_D2SRAM1_CLK_ENABLE()  do { } while (0)
+#define __HAL_RCC_D2SRAM2_CLK_ENABLE()  do { } while (0)
+#define __HAL_RCC_D2SRAM3_CLK_ENABLE()  do { } while (0)
+#define __HAL_RCC_GPIOA_CLK_ENABLE()    do { } while (0)
+#define __HAL_RCC_GPIOB_CLK_ENABLE()    do { } while (0)
+#define __HAL_RCC_GPIOC_CLK_ENABLE()    do { } while (0)
+#define __HAL_RCC_GPIOG_CLK_ENABLE()    do { } while (0)
+
+typedef struct {
+  __IO uint32_t MEMRM;
+  __IO uint32_t PMCR;
+  __IO uint32_t EXTICR[4];
+  __IO uint32_t CFGR;
+  uint32_t RESERVED;
+  __IO uint32_t CCCSR;
+  __IO uint32_t CCVR;
+  __IO uint32_t CCCR;
+} SYSCFG_TypeDef;
+
+extern SYSCFG_TypeDef sim_syscfg;
+#define SYSCFG                        (&sim_syscfg)
+#define SYSCFG_CCCSR_READY            (1UL << 8)
+#define SYSCFG_ETH_MII                0x00000000U
+#define SYSCFG_ETH_RMII               0x00800000U
+
+void HAL_SYSCFG_ETHInterfaceSelect(uint32_t SYSCFG_ETHInterface);
+void HAL_EnableCompensationCell(void);
+
+typedef struct {
+  __IO uint32_t MODER;
+  __IO uint32_t OTYPER;
+  __IO uint32_t OSPEEDR;
+  __IO uint32_t PUPDR;
+  __IO uint32_t IDR;
+  __IO uint32_t ODR;
+  __IO uint32_t BSRR;
+  __IO uint32_t LCKR;
+  __IO uint32_t AFR[2];
+} GPIO_TypeDef;
+
+typedef struct {
+  uint32_t Pin;
+  uint32_t Mode;
+  uint32_t Pull;
+  uint32_t Speed;
+  uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+extern GPIO_TypeDef sim_gpio[8];
+#define GPIOA                         (&sim_gpio[0])
+#define GPIOB                         (&sim_gpio[1])
+#define GPIOC                         (&sim_gpio[2])
+#define GPIOG                         (&sim_gpio[6])
+#define GPIO_PIN_1                    ((uint16_t)0x0002)
+#define GPIO_PIN_2                    ((uint16_t)0x0004)
+#define GPIO_PIN_4                    ((uint16_t)0x0010)
+#define GPIO_PIN_5                    ((uint16_t)0x0020)
+#define GPIO_PIN_7                    ((uint16_t)0x0080)
+#define GPIO_PIN_11                   ((uint16_t)0x0800)
+#define GPIO_PIN_13                   ((uint16_t)0x2000)
+#define GPIO_MODE_AF_PP               0x00000002U
+#define GPIO_NOPULL                   0x00000000U
+#define GPIO_SPEED_FREQ_VERY_HIGH     0x00000003U
+#define GPIO_AF11_ETH                 ((uint8_t)0x0B)
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin);
+
+/* ETH peripheral --------------------------------------------------------------*/
+/* Value of ETH_RX_DESC_CNT / ETH_TX_DESC_CNT in stm32h7xx_hal_conf.h */
+#define ETH_RX_DESC_CNT               4U
+#define ETH_TX_DESC_CNT               4U
+#define ETH_MAX_PAYLOAD               1500U
+
+typedef struct {
+  __IO uint32_t MACCR;       /* 0x0000 */
+  __IO uint32_t MACECR;      /* 0x0004 */
+  __IO uint32_t MACPFR;      /* 0x0008 */
+  __IO uint32_t MACWTR;      /* 0x000C */
+  __IO uint32_t MACHT0R;     /* 0x0010 */
+  __IO uint32_t MACHT1R;     /* 0x0014 */
+  uint32_t      RESERVED0[14];
+  __IO uint32_t MACVTR;      /* 0x0050 */
+  uint32_t      RESERVED1[1];
+  __IO uint32_t MACVHTR;     /* 0x0058 */
+  uint32_t      RESERVED2[1];
+  __IO uint32_t MACVIR;      /* 0x0060 */
+  __IO uint32_t MACIVIR;     /* 0x0064 */
+  uint32_t      RESERVED3[2];
+  __IO uint32_t MACTFCR;     /* 0x0070 */
+  uint32_t      RESERVED4[7];
+  __IO uint32_t MACRFCR;     /* 0x0090 */
+  uint32_t      RESERVED5[7];
+  __IO uint32_t MACISR;      /* 0x00B0 */
+  __IO uint32_t MACIER;      /* 0x00B4 */
+  __IO uint32_t MACRXTXSR;   /* 0x00B8 */
+  uint32_t      RESERVED6[1];
+  __IO uint32_t MACPCSR;     /* 0x00C0 */
+  __IO uint32_t MACRWKPFR;   /* 0x00C4 */
+  uint32_t      RESERVED7[2];
+  __IO uint32_t MACLCSR;     /* 0x00D0 */
+  __IO uint32_t MACLTCR;     /* 0x00D4 */
+  __IO uint32_t MACLETR;     /* 0x00D8 */
+  __IO uint32_t MAC1USTCR;   /* 0x00DC */
+  uint32_t      RESERVED8[12];
+  __IO uint32_t MACVR;       /* 0x0110 */
+  __IO uint32_t MACDR;       /* 0x0114 */
+  uint32_t      RESERVED9[2];
+  __IO uint32_t MACHWF1R;    /* 0x0120 */
+  __IO uint32_t MACHWF2R;    /* 0x0124 */
+  uint32_t      RESERVED10[54];
+  __IO uint32_t MACMDIOAR;   /* 0x0200 */
+  __IO uint32_t MACMDIODR;   /* 0x0204 */
+  uint32_t      RESERVED11[2];
+  __IO uint32_t MACARPAR;    /* 0x0210 */
+  uint32_t      RESERVED12[59];
+  __IO uint32_t MACA0HR;     /* 0x0300 */
+  __IO uint32_t MACA0LR;     /* 0x0304 */
+  __IO uint32_t MACA1HR;     /* 0x0308 */
+  __IO uint32_t MACA1LR;     /* 0x030C */
+  __IO uint32_t MACA2HR;     /* 0x0310 */
+  __IO uint32_t MACA2LR;     /* 0x0314 */
+  __IO uint32_t MACA3HR;     /* 0x0318 */
+  __IO uint32_t MACA3LR;     /* 0x031C */
+  uint32_t      RESERVED13[248];
+  __IO uint32_t MMCCR;       /* 0x0700 */
+  __IO uint32_t MMCRIR;      /* 0x0704 */
+  __IO uint32_t MMCTIR;      /* 0x0708 */
+  __IO uint32_t MMCRIMR;     /* 0x070C */
+  __IO uint32_t MMCTIMR;     /* 0x0710 */
+  uint32_t      RESERVED14[14];
+  __IO uint32_t MMCTSCGPR;   /* 0x074C */
+  __IO uint32_t MMCTMCGPR;   /* 0x0750 */
+  uint32_t      RESERVED15[5];
+  __IO uint32_t MMCTPCGR;    /* 0x0768 */
+  uint32_t      RESERVED16[10];
+  __IO uint32_t MMCRCRCEPR;  /* 0x0794 */
+  __IO uint32_t MMCRAEPR;    /* 0x0798 */
+  uint32_t      RESERVED17[10];
+  __IO uint32_t MMCRUPGR;    /* 0x07C4 */
+  uint32_t      RESERVED18[78];
+  __IO uint32_t MACL3L4C0R;  /* 0x0900 */
+  __IO uint32_t MACL4A0R;    /* 0x0904 */
+  uint32_t      RESERVED19[2];
+  __IO uint32_t MACL3A00R;   /* 0x0910 */
+  __IO uint32_t MACL3A10R;   /* 0x0914 */
+  __IO uint32_t MACL3A20;    /* 0x0918 */
+  __IO uint32_t MACL3A30;    /* 0x091C */
+  uint32_t      RESERVED20[4];
+  __IO uint32_t MACL3L4C1R;  /* 0x0930 */
+  __IO uint32_t MACL4A1R;    /* 0x0934 */
+  uint32_t      RESERVED21[2];
+  __IO uint32_t MACL3A01R;   /* 0x0940 */
+  __IO uint32_t MACL3A11R;   /* 0x0944 */
+  __IO uint32_t MACL3A21R;   /* 0x0948 */
+  __IO uint32_t MACL3A31R;   /* 0x094C */
+  uint32_t      RESERVED22[108];
+  __IO uint32_t MACTSCR;     /* 0x0B00 */
+  __IO uint32_t MACSSIR;     /* 0x0B04 */
+  __IO uint32_t MACSTSR;     /* 0x0B08 */
+  __IO uint32_t MACSTNR;     /* 0x0B0C */
+  __IO uint32_t MACSTSUR;    /* 0x0B10 */
+  __IO uint32_t MACSTNUR;    /* 0x0B14 */
+  __IO uint32_t MACTSAR;     /* 0x0B18 */
+  uint32_t      RESERVED23[1];
+  __IO uint32_t MACTSSR;     /* 0x0B20 */
+  uint32_t      RESERVED24[3];
+  __IO uint32_t MACTxTSSNR;  /* 0x0B30 */
+  __IO uint32_t MACTxTSSSR;  /* 0x0B34 */
+  uint32_t      RESERVED25[50];
+  __IO uint32_t MTLOMR;      /* 0x0C00 */
+  uint32_t      RESERVED26[7];
+  __IO uint32_t MTLISR;      /* 0x0C20 */
+  uint32_t      RESERVED27[55];
+  __IO uint32_t MTLTQOMR;    /* 0x0D00 */
+  __IO uint32_t MTLTQUR;     /* 0x0D04 */
+  __IO uint32_t MTLTQDR;     /* 0x0D08 */
+  uint32_t      RESERVED28[8];
+  __IO uint32_t MTLQICSR;    /* 0x0D2C */
+  __IO uint32_t MTLRQOMR;    /* 0x0D30 */
+  __IO uint32_t MTLRQMPOCR;  /* 0x0D34 */
+  __IO uint32_t MTLRQDR;     /* 0x0D38 */
+  uint32_t      RESERVED29[177];
+  __IO uint32_t DMAMR;       /* 0x1000 */
+  __IO uint32_t DMASBMR;     /* 0x1004 */
+  __IO uint32_t DMAISR;      /* 0x1008 */
+  __IO uint32_t DMADSR;      /* 0x100C */
+  uint32_t      RESERVED30[60];
+  __IO uint32_t DMACCR;      /* 0x1100 */
+  __IO uint32_t DMACTCR;     /* 0x1104 */
+  __IO uint32_t DMACRCR;     /* 0x1108 */
+  uint32_t      RESERVED31[2];
+  __IO uint32_t DMACTDLAR;   /* 0x1114 */
+  uint32_t      RESERVED32[1];
+  __IO uint32_t DMACRDLAR;   /* 0x111C */
+  __IO uint32_t DMACTDTPR;   /* 0x1120 */
+  uint32_t      RESERVED33[1];
+  __IO uint32_t DMACRDTPR;   /* 0x1128 */
+  __IO uint32_t DMACTDRLR;   /* 0x112C */
+  __IO uint32_t DMACRDRLR;   /* 0x1130 */
+  __IO uint32_t DMACIER;     /* 0x1134 */
+  __IO uint32_t DMACRIWTR;   /* 0x1138 */
+  __IO uint32_t DMACSFCSR;   /* 0x113C */
+  uint32_t      RESERVED34[1];
+  __IO uint32_t DMACCATDR;   /* 0x1144 */
+  uint32_t      RESERVED35[1];
+  __IO uint32_t DMACCARDR;   /* 0x114C */
+  uint32_t      RESERVED36[1];
+  __IO uint32_t DMACCATBR;   /* 0x1154 */
+  uint32_t      RESERVED37[1];
+  __IO uint32_t DMACCARBR;   /* 0x115C */
+  __IO uint32_t DMACSR;      /* 0x1160 */
+  uint32_t      RESERVED38[2];
+  __IO uint32_t DMACMFCR;    /* 0x116C */
+} ETH_TypeDef;
+
+#define ETH_BASE                      0x40028000UL
+#define ETH                           ((ETH_TypeDef *)ETH_BASE)
+
+/* MACCR */
+#define ETH_MACCR_RE                  (1UL << 0)
+#define ETH_MACCR_TE                  (1UL << 1)
+#define ETH_MACCR_DM                  (1UL << 13)
+#define ETH_MACCR_FES                 (1UL << 14)
+#define ETH_MACCR_IPC                 (1UL << 27)
+#define ETH_MACCR_ARP                 (1UL << 31)
+/* MACPFR */
+#define ETH_MACPFR_PR                 (1UL << 0)
+#define ETH_MACPFR_HUC                (1UL << 1)
+#define ETH_MACPFR_HMC                (1UL << 2)
+#define ETH_MACPFR_DAIF               (1UL << 3)
+#define ETH_MACPFR_PM                 (1UL << 4)
+#define ETH_MACPFR_DBF                (1UL << 5)
+#define ETH_MACPFR_HPF                (1UL << 10)
+#define ETH_MACPFR_VTFE               (1UL << 16)
+#define ETH_MACPFR_IPFE               (1UL << 20)
+#define ETH_MACPFR_DNTU               (1UL << 21)
+#define ETH_MACPFR_RA                 (1UL << 31)
+
+/* MACECR */
+#define ETH_MACECR_HDSMS              (7UL << 20)
+#define ETH_MACECR_HDSMS_0            (1UL << 20)
+
+/* MACVTR / MACVIR */
+#define ETH_MACVTR_VL                 (0xFFFFUL << 0)
+#define ETH_MACVTR_ETV                (1UL << 16)
+#define ETH_MACVTR_EVLS_ALWAYSSTRIP   (3UL << 21)
+#define ETH_MACVTR_EVLRXS             (1UL << 24)
+#define ETH_MACVTR_VTHM               (1UL << 25)
+#define ETH_MACVIR_VLTI               (1UL << 20)
+/* MACTSCR */
+#define ETH_MACTSCR_TSENA             (1UL << 0)
+#define ETH_MACTSCR_TSCFUPDT          (1UL << 1)
+#define ETH_MACTSCR_TSINIT            (1UL << 2)
+#define ETH_MACTSCR_TSUPDT            (1UL << 3)
+#define ETH_MACTSCR_TSADDREG          (1UL << 5)
+#define ETH_MACTSCR_TSENALL           (1UL << 8)
+#define ETH_MACTSCR_TSCTRLSSR         (1UL << 9)
+#define ETH_MACTSCR_TSVER2ENA         (1UL << 10)
+#define ETH_MACTSCR_TSIPENA           (1UL << 11)
+#define ETH_MACTSCR_TSIPV6ENA         (1UL << 12)
+#define ETH_MACTSCR_TSIPV4ENA         (1UL << 13)
+#define ETH_MACTSCR_TSEVNTENA         (1UL << 14)
+/* MTLTQOMR */
+#define ETH_MTLTQOMR_FTQ              (1UL << 0)
+/* DMACCR / DMACTCR / DMACRCR */
+#define ETH_DMACCR_SPH                (1UL << 24)
+#define ETH_DMACTCR_ST                (1UL << 0)
+#define ETH_DMACTCR_TSE               (1UL << 12)
+#define ETH_DMACRCR_SR                (1UL << 0)
+#define ETH_DMACRCR_RBSZ              (0x3FFFUL << 1)
+/* DMACSR */
+#define ETH_DMACSR_TI                 (1UL << 0)
+#define ETH_DMACSR_TPS                (1UL << 1)
+#define ETH_DMACSR_TBU                (1UL << 2)
+#define ETH_DMACSR_RI                 (1UL << 6)
+#define ETH_DMACSR_RBU                (1UL << 7)
+#define ETH_DMACSR_RPS                (1UL << 8)
+#define ETH_DMACSR_RWT                (1UL << 9)
+#define ETH_DMACSR_ETI                (1UL << 10)
+#define ETH_DMACSR_ERI                (1UL << 11)
+#define ETH_DMACSR_FBE                (1UL << 12)
+#define ETH_DMACSR_CDE                (1UL << 13)
+#define ETH_DMACSR_AIS                (1UL << 14)
+#define ETH_DMACSR_NIS                (1UL << 15)
+/* DMACIER */
+#define ETH_DMACIER_TIE               (1UL << 0)
+#define ETH_DMACIER_TXSE              (1UL << 1)
+#define ETH_DMACIER_TBUE              (1UL << 2)
+#define ETH_DMACIER_RIE               (1UL << 6)
+#define ETH_DMACIER_RBUE              (1UL << 7)
+#define ETH_DMACIER_RSE               (1UL << 8)
+#define ETH_DMACIER_RWTE              (1UL << 9)
+#define ETH_DMACIER_ETIE              (1UL << 10)
+#define ETH_DMACIER_ERIE              (1UL << 11)
+#define ETH_DMACIER_FBEE              (1UL << 12)
+#define ETH_DMACIER_CDEE              (1UL << 13)
+#define ETH_DMACIER_AIE               (1UL << 14)
+#define ETH_DMACIER_NIE               (1UL << 15)
+
+#define ETH_DMA_NORMAL_IT             ETH_DMACIER_NIE
+#define ETH_DMA_ABNORMAL_IT           ETH_DMACIER_AIE
+#define ETH_DMA_RX_IT                 ETH_DMACIER_RIE
+#define ETH_DMA_TX_IT                 ETH_DMACIER_TIE
+#define ETH_DMA_RX_BUFFER_UNAVAILABLE_IT ETH_DMACIER_RBUE
+#define ETH_MAC_RX_STATUS_IT          (1UL << 14)
+#define ETH_MAC_TX_STATUS_IT          (1UL << 13)
+
+#define ETH_SPEED_10M                 0x00000000U
+#define ETH_SPEED_100M                ETH_MACCR_FES
+#define ETH_HALFDUPLEX_MODE           0x00000000U
+#define ETH_FULLDUPLEX_MODE           ETH_MACCR_DM
+
+#define HAL_ETH_MII_MODE              SYSCFG_ETH_MII
+#define HAL_ETH_RMII_MODE             SYSCFG_ETH_RMII
+
+/* ETH_TxPacketConfig Attributes, checksum and CRC/pad control */
+#define ETH_TX_PACKETS_FEATURES_CSUM          0x00000001U
+#define ETH_TX_PACKETS_FEATURES_SAIC          0x00000002U
+#define ETH_TX_PACKETS_FEATURES_VLANTAG       0x00000004U
+#define ETH_TX_PACKETS_FEATURES_INNERVLANTAG  0x00000008U
+#define ETH_TX_PACKETS_FEATURES_TSO           0x00000010U
+#define ETH_TX_PACKETS_FEATURES_CRCPAD        0x00000020U
+#define ETH_CHECKSUM_DISABLE                          0x00000000U
+#define ETH_CHECKSUM_IPHDR_INSERT                     0x00010000U
+#define ETH_CHECKSUM_IPHDR_PAYLOAD_INSERT             0x00020000U
+#define ETH_CHECKSUM_IPHDR_PAYLOAD_INSERT_PHDR_CALC   0x00030000U
+#define ETH_CRC_PAD_INSERT            0x00000000U
+#define ETH_CRC_INSERT                0x04000000U
+#define ETH_CRC_REPLACE               0x08000000U
+
+/* HAL handle states */
+#define HAL_ETH_STATE_RESET           0x00000000U
+#define HAL_ETH_STATE_READY           0x00000010U
+#define HAL_ETH_STATE_BUSY            0x00000023U
+#define HAL_ETH_STATE_STARTED         0x00000023U
+#define HAL_ETH_STATE_ERROR           0x000000E0U
+
+#define HAL_ETH_ERROR_NONE            0x00000000U
+#define HAL_ETH_ERROR_DMA             0x00000004U
+
+/* Interrupt enable/disable and W1C status clear, as in the HAL */
+#define __HAL_ETH_DMA_ENABLE_IT(h, it)    ((h)->Instance->DMACIER |= (it))
+#define __HAL_ETH_DMA_DISABLE_IT(h, it)   ((h)->Instance->DMACIER &= ~(it))
+#define __HAL_ETH_MAC_ENABLE_IT(h, it)    ((h)->Instance->MACIER |= (it))
+#define __HAL_ETH_MAC_DISABLE_IT(h, it)   ((h)->Instance->MACIER &= ~(it))
+#define __HAL_ETH_DMA_CLEAR_IT(h, it)     sim_eth_dmacsr_clear((it))
+void sim_eth_dmacsr_clear(uint32_t bits);
+
+typedef struct {
+  __IO uint32_t DESC0;
+  __IO uint32_t DESC1;
+  __IO uint32_t DESC2;
+  __IO uint32_t DESC3;
+  uint32_t BackupAddr0;
+  uint32_t BackupAddr1;
+} ETH_DMADescTypeDef;
+
+typedef struct {
+  uint8_t *MACAddr;
+  uint32_t MediaInterface;
+  ETH_DMADescTypeDef *TxDesc;
+  ETH_DMADescTypeDef *RxDesc;
+  uint32_t RxBuffLen;
+} ETH_InitTypeDef;
+
+typedef struct {
+  uint32_t TxDesc[ETH_TX_DESC_CNT];
+  uint32_t CurTxDesc;
+  uint32_t *PacketAddress[ETH_TX_DESC_CNT];
+  uint32_t *CurrentPacketAddress;
+  uint32_t BuffersInUse;
+  uint32_t releaseIndex;
+} ETH_TxDescListTypeDef;
+
+typedef struct {
+  uint32_t RxDesc[ETH_RX_DESC_CNT];
+  uint32_t ItMode;
+  uint32_t RxDescIdx;
+  uint32_t RxDescCnt;
+  uint32_t RxDataLength;
+  uint32_t RxBuildDescIdx;
+  uint32_t RxBuildDescCnt;
+  uint32_t pRxLastRxDesc;
+  void *pRxStart;
+  void *pRxEnd;
+} ETH_RxDescListTypeDef;
+
+typedef void (*pETH_rxAllocateCallbackTypeDef)(uint8_t **buffer);
+typedef void (*pETH_rxLinkCallbackTypeDef)(void **pStart, void **pEnd, uint8_t *buff, uint16_t Length);
+typedef void (*pETH_txFreeCallbackTypeDef)(uint32_t *buffer);
+
+typedef struct __ETH_HandleTypeDef {
+  ETH_TypeDef *Instance;
+  ETH_InitTypeDef Init;
+  ETH_TxDescListTypeDef TxDescList;
+  ETH_RxDescListTypeDef RxDescList;
+  __IO uint32_t gState;
+  __IO uint32_t ErrorCode;
+  __IO uint32_t DMAErrorCode;
+  __IO uint32_t MACErrorCode;
+  __IO uint32_t MACWakeUpEvent;
+  __IO uint32_t MACLPIEvent;
+  __IO uint32_t IsPtpConfigured;
+  pETH_rxAllocateCallbackTypeDef rxAllocateCallback;
+  pETH_rxLinkCallbackTypeDef rxLinkCallback;
+  pETH_txFreeCallbackTypeDef txFreeCallback;
+} ETH_HandleTypeDef;
+
+typedef struct {
+  uint32_t SourceAddrControl;
+  FunctionalState ChecksumOffload;
+  uint32_t InterPacketGapVal;
+  FunctionalState GiantPacketSizeLimitControl;
+  FunctionalState Support2KPacket;
+  FunctionalState CRCStripTypePacket;
+  FunctionalState AutomaticPadCRCStrip;
+  FunctionalState Watchdog;
+  FunctionalState Jabber;
+  FunctionalState JumboPacket;
+  uint32_t Speed;
+  uint32_t DuplexMode;
+  FunctionalState LoopbackMode;
+  FunctionalState CarrierSenseBeforeTransmit;
+  FunctionalState ReceiveOwn;
+  FunctionalState CarrierSenseDuringTransmit;
+  FunctionalState RetryTransmission;
+  uint32_t BackOffLimit;
+  FunctionalState DeferralCheck;
+  uint32_t PreambleLength;
+} ETH_MACConfigTypeDef;
+
+typedef struct {
+  uint8_t *buffer;
+  uint32_t len;
+  void *next;
+} ETH_BufferTypeDef;
+
+typedef struct {
+  uint32_t Attributes;
+  uint32_t Length;
+  ETH_BufferTypeDef *TxBuffer;
+  uint32_t SrcAddrCtrl;
+  uint32_t CRCPadCtrl;
+  uint32_t ChecksumCtrl;
+  uint32_t MaxSegmentSize;
+  uint32_t PayloadLen;
+  uint32_t TCPHeaderLen;
+  uint32_t VlanTag;
+  uint32_t VlanCtrl;
+  uint32_t InnerVlanTag;
+  uint32_t InnerVlanCtrl;
+  void *pData;
+} ETH_TxPacketConfigTypeDef;
+#define ETH_TxPacketConfig            ETH_TxPacketConfigTypeDef
+
+HAL_StatusTypeDef HAL_ETH_Init(ETH_HandleTypeDef *heth);
+void HAL_ETH_MspInit(ETH_HandleTypeDef *heth);
+void HAL_ETH_MspDeInit(ETH_HandleTypeDef *heth);
+HAL_StatusTypeDef HAL_ETH_RegisterRxAllocateCallback(ETH_HandleTypeDef *heth, pETH_rxAllocateCallbackTypeDef rxAllocateCallback);
+HAL_StatusTypeDef HAL_ETH_RegisterRxLinkCallback(ETH_HandleTypeDef *heth, pETH_rxLinkCallbackTypeDef rxLinkCallback);
+HAL_StatusTypeDef HAL_ETH_RegisterTxFreeCallback(ETH_HandleTypeDef *heth, pETH_txFreeCallbackTypeDef txFreeCallback);
+void HAL_ETH_IRQHandler(ETH_HandleTypeDef *heth);
+void HAL_ETH_RxCpltCallback(ETH_HandleTypeDef *heth);
+void HAL_ETH_TxCpltCallback(ETH_HandleTypeDef *heth);
+void HAL_ETH_ErrorCallback(ETH_HandleTypeDef *heth);
+void HAL_ETH_RxAllocateCallback(uint8_t **buff);
+void HAL_ETH_RxLinkCallback(void **pStart, void **pEnd, uint8_t *buff, uint16_t Length);
+void HAL_ETH_TxFreeCallback(uint32_t *buff);
+uint32_t HAL_ETH_GetDMAError(ETH_HandleTypeDef *heth);
+HAL_StatusTypeDef HAL_ETH_GetMACConfig(ETH_HandleTypeDef *heth, ETH_MACConfigTypeDef *macconf);
+HAL_StatusTypeDef HAL_ETH_SetMACConfig(ETH_HandleTypeDef *heth, ETH_MACConfigTypeDef *macconf);
+void HAL_ETH_SetMDIOClockRange(ETH_HandleTypeDef *heth);
+HAL_StatusTypeDef HAL_ETH_ReadPHYRegister(ETH_HandleTypeDef *heth, uint32_t PHYAddr, uint32_t PHYReg, uint32_t *pRegValue);
+HAL_StatusTypeDef HAL_ETH_WritePHYRegister(const ETH_HandleTypeDef *heth, uint32_t PHYAddr, uint32_t PHYReg, uint32_t RegValue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STM32H7XX_HAL_H */
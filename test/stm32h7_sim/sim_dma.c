@@ -0,0 +1,1232 @@
+/*
+ * STM32H7 Ethernet host simulator: MAC receive filter, MTL RX FIFO and the
+ * channel 0 DMA engine, run by one model thread against the descriptor
+ * rings in simulated D2 SRAM.
+ *
+ * What is modelled, following RM0433 (ETH chapter):
+ *  - RX: frames from the peer pass the address filter (MACPFR, MACA0..3,
+ *    MACHT0/1R) and, with MACPFR VTFE, the VLAN filter (MACVTR VL or the
+ *    MACVHTR hash with VTHM), then with MACPFR IPFE the L3/L4 filters
+ *    (MACL3L4CxR: IPv4 source prefix, TCP/UDP ports; an IP frame must
+ *    match one enabled filter); MACVTR EVLS strips the 802.1Q tag, which
+ *    EVLRXS reports in RDES0 with RS0V. With MACCR ARP, an ARP request for
+ *    MACARPAR is answered by the MAC itself and still passed on with RDES3
+ *    LT = ARP request. Frames then wait in the RX FIFO (store and forward, overflow drops)
+ *    and are written into the ring from the current descriptor on. With
+ *    DMACCR SPH the L2-L4 headers of a TCP/UDP frame (up to MACECR HDSMS)
+ *    go alone to buffer 1 with HL in RDES2, the rest to buffer 2. A
+ *    descriptor is used only if OWN is set and it is not the tail pointer
+ *    (DMACRDTPR); otherwise RBU is raised and the channel suspends until
+ *    the tail pointer or the poll demand register is written. Frames
+ *    longer than RBSZ span descriptors (FD ... LD, PL in the last one);
+ *    RDES1 carries the checksum status (MACCR IPC) and TSA, followed by a
+ *    timestamp context descriptor (CTXT) when MACTSCR enables it. RI is
+ *    raised for a frame whose descriptors had IOC, otherwise when the RX
+ *    interrupt watchdog (DMACRIWTR) expires.
+ *  - TX: descriptors are processed from the current one up to the tail
+ *    pointer (DMACTDTPR) while OWN is set (else TBU and suspend). Buffers
+ *    are gathered up to LD, checksums inserted per CIC, the frame padded
+ *    and handed to the peer; the descriptors are closed (OWN cleared,
+ *    TTSS with the timestamp in TDES0/1) and TI raised on IOC. With
+ *    DMACTCR TSE, a first descriptor with TSE is cut into segments of the
+ *    MSS from the last context descriptor (TCMSSV): the THL header bytes
+ *    in buffer 1 are repeated in front of each, with the IP length and ID,
+ *    TCP sequence number, PSH/FIN (last segment only) and checksums
+ *    updated per segment. A first descriptor with TDES2 VTIR = 10 and
+ *    MACVIR VLTI gets the tag of the last context descriptor with VLTV
+ *    inserted (in every segment of a TSE frame).
+ *  - DMACSR write-1-to-clear, NIS/AIS summaries and the interrupt line
+ *    (NIE/AIE), the MMC counters with CNTFREEZ, the PTP system time and
+ *    its TSINIT/TSUPDT/TSADDREG commands.
+ *
+ * Register writes by the driver are plain stores the model cannot trap,
+ * so it detects them from a marker: DMACSR always holds bit 31 (reserved)
+ * while it shows the model's value, and the tail/list address registers
+ * hold bit 0 (descriptors are 16-byte aligned). A store from the driver
+ * clears the marker and is picked up on the next pass of the model loop.
+ * Two stores to the same register between two passes look like one.
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/prctl.h>
+#include <stm32h7xx_hal.h>
+#include "sim_hw.h"
+
+#define CSR_MARK              0x80000000U
+#define REG_MARK              0x00000001U
+
+#define DESC_OWN              0x80000000U
+#define DESC_IOC_CTXT         0x40000000U   /* RX read: IOC; RX/TX write-back: CTXT */
+#define DESC_FD               0x20000000U
+#define DESC_LD               0x10000000U
+#define RDES3_BUF1V           0x01000000U
+#define RDES3_BUF2V           0x02000000U   /* read format */
+#define RDES3_RS0V            0x02000000U
+#define RDES3_LT_ARP          0x00030000U   /* LT [18:16] = 011: ARP request */
+#define RDES3_RS1V            0x04000000U
+#define RDES1_IPHE            0x00000008U
+#define RDES1_IPV4            0x00000010U
+#define RDES1_IPV6            0x00000020U
+#define RDES1_IPCB            0x00000040U
+#define RDES1_IPCE            0x00000080U
+#define RDES1_TSA             0x00004000U
+#define TDES2_IOC             0x80000000U
+#define TDES2_TTSE            0x40000000U
+#define TDES2_VTIR            0x0000C000U
+#define TDES2_VTIR_INSERT     0x00008000U
+#define TDES3_TTSS            0x00020000U
+#define TDES3_TSE             0x00040000U
+#define TDES3_TCMSSV          0x04000000U   /* context descriptor: MSS valid */
+#define TDES3_VLTV            0x00010000U   /* context descriptor: VT valid */
+#define ETHTYPE_VLAN_         0x8100U
+
+#define TSO_FRAME_MAX         (128U + 0x3FFFFU)
+
+#define CSR_NORMAL            (ETH_DMACSR_TI | ETH_DMACSR_TBU | ETH_DMACSR_RI | ETH_DMACSR_ERI)
+#define CSR_ABNORMAL          (ETH_DMACSR_TPS | ETH_DMACSR_RBU | ETH_DMACSR_RPS | ETH_DMACSR_RWT | \
+                               ETH_DMACSR_ETI | ETH_DMACSR_FBE | ETH_DMACSR_CDE)
+
+#define RX_FIFO_SLOTS         64U
+#define INJECT_SLOTS          256U
+#define GEN_BURST_MAX         256U
+#define IRQ_STORM_RUNS        64U
+
+#define POLL_DEMAND           (*(__IO uint32_t *)((uintptr_t)ETH + 0x104C))
+
+typedef struct {
+  uint32_t len;
+  uint32_t rdes1;             /* checksum status, TSA */
+  uint32_t rdes0;             /* stripped tag (OVT), valid with RS0V */
+  uint32_t rs0v;
+  uint32_t lt;                /* RDES3 LT, only ARP requests are marked */
+  uint64_t ts_ns;             /* PTP time at arrival */
+  uint8_t data[SIM_FRAME_MAX];
+} sim_frame_t;
+
+sim_config_t sim_cfg = {
+  .rx_fifo_bytes = 2048,
+  .line_rate_pace = 1,
+  .idle_sleep_ns = 20000,
+};
+sim_dma_stats_t sim_dma_stats;
+
+static pthread_t dma_thread;
+static volatile int dma_running;
+
+/* DMACSR as the hardware sees it, without the summaries; model thread only */
+static uint32_t csr_pending;
+
+/* Frames queued by other threads (sim_rx_inject), taken by the model */
+static pthread_mutex_t inject_lock = PTHREAD_MUTEX_INITIALIZER;
+static sim_frame_t inject_q[INJECT_SLOTS];
+static uint32_t inject_head, inject_cnt;
+
+/* Flood generator, configured by sim_rx_flood() */
+static struct {
+  uint32_t pps;
+  uint64_t left;
+  uint32_t payload;
+  uint32_t bad_every;
+  uint64_t seq;
+  uint64_t next_ns;
+} gen;
+
+/* MTL RX FIFO */
+static sim_frame_t rx_fifo[RX_FIFO_SLOTS];
+static uint32_t rx_fifo_head, rx_fifo_cnt, rx_fifo_bytes;
+
+/* RX and TX DMA channel state */
+static struct {
+  uint32_t cur, tail;
+  int suspended;
+  sim_frame_t *frm;           /* frame being written, at the FIFO head */
+  uint32_t off;
+  uint32_t hl;                /* split header length of frm, 0 if not split */
+  uint32_t ioc;
+  int ctx_pending;
+  uint64_t rwt_deadline;
+} rx;
+
+static struct {
+  uint32_t cur, tail;
+  int suspended;
+  uint8_t buf[2 * SIM_FRAME_MAX];
+  uint32_t len;
+  uint32_t fl, cic, ttse;
+  uint64_t busy_until;
+  uint32_t mss;               /* from the last context descriptor with TCMSSV */
+  uint32_t tse, thl, tpl, hdr_len;
+  uint32_t vlan_tag;          /* from the last context descriptor with VLTV */
+  uint32_t vlan_ins;          /* VTIR = 10 on the frame's first descriptor */
+} tx;
+
+/* TSO frame as gathered from its descriptors, before segmentation */
+static uint8_t tso_buf[TSO_FRAME_MAX];
+static uint32_t tso_len;
+
+/* MMC counters, published to the registers while CNTFREEZ is clear */
+static struct {
+  uint32_t rx_unicast;
+  uint32_t tx_good;
+} mmc;
+
+/* PTP system time */
+static struct {
+  uint64_t ns;
+  uint64_t last_host;
+  uint32_t addend;
+  double frac;
+} ptp;
+
+/* Private helpers ------------------------------------------------------------*/
+uint64_t sim_now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint32_t reg_load(__IO uint32_t *reg)
+{
+  return __atomic_load_n(reg, __ATOMIC_ACQUIRE);
+}
+
+static inline int reg_cas(__IO uint32_t *reg, uint32_t old, uint32_t val)
+{
+  return __atomic_compare_exchange_n(reg, &old, val, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+/* Take a driver store from a marked register; 1 and the value if there was one */
+static int reg_take(__IO uint32_t *reg, uint32_t *val)
+{
+  uint32_t r = reg_load(reg);
+
+  if (r & REG_MARK) {
+    return 0;
+  }
+  reg_cas(reg, r, r | REG_MARK);
+  *val = r;
+  return 1;
+}
+
+static int dma_reachable(uint32_t addr, uint32_t len)
+{
+  if (addr >= SIM_D1_BASE && addr + len <= SIM_D1_BASE + SIM_D1_SIZE) {
+    return 1;
+  }
+  return addr >= SIM_D2_BASE && addr + len <= SIM_D2_BASE + SIM_D2_SIZE;
+}
+
+static ETH_DMADescTypeDef *desc_at(uint32_t addr)
+{
+  return (ETH_DMADescTypeDef *)(uintptr_t)addr;
+}
+
+static uint32_t ring_next(uint32_t cur, uint32_t base, uint32_t len_m1)
+{
+  cur += 16U;
+  return (cur > base + len_m1 * 16U) ? base : cur;
+}
+
+static uint64_t wire_ns(uint32_t len)
+{
+  uint32_t bytes = (len < 60U ? 60U : len) + 4U + 8U + 12U;   /* FCS, preamble, IFG */
+  uint32_t ns_per_bit = (reg_load(&ETH->MACCR) & ETH_MACCR_FES) ? 10U : 100U;
+  return (uint64_t)bytes * 8U * ns_per_bit;
+}
+
+/* DMACSR --------------------------------------------------------------------*/
+static uint32_t csr_view(uint32_t pending, uint32_t ier)
+{
+  uint32_t v = pending & ~(ETH_DMACSR_NIS | ETH_DMACSR_AIS);
+
+  if (v & ier & CSR_NORMAL) {
+    v |= ETH_DMACSR_NIS;
+  }
+  if (v & ier & CSR_ABNORMAL) {
+    v |= ETH_DMACSR_AIS;
+  }
+  return v;
+}
+
+/* Apply driver write-1-to-clear stores and publish the current value */
+void sim_dma_sync_csr(void)
+{
+  for (;;) {
+    uint32_t r = reg_load(&ETH->DMACSR);
+    uint32_t v;
+
+    if (!(r & CSR_MARK)) {
+      csr_pending &= ~r;
+      sim_dma_stats.csr_w1c++;
+    }
+    v = csr_view(csr_pending, reg_load(&ETH->DMACIER)) | CSR_MARK;
+    if (r == v || reg_cas(&ETH->DMACSR, r, v)) {
+      return;
+    }
+  }
+}
+
+uint32_t sim_dma_pending_csr(void)
+{
+  sim_dma_sync_csr();
+  return csr_view(csr_pending, reg_load(&ETH->DMACIER));
+}
+
+static void csr_set(uint32_t bits)
+{
+  sim_dma_sync_csr();
+  csr_pending |= bits;
+  sim_dma_sync_csr();
+}
+
+/* HAL __HAL_ETH_DMA_CLEAR_IT(): the store, applied at once in the ISR */
+void sim_eth_dmacsr_clear(uint32_t bits)
+{
+  ETH->DMACSR = bits & ~CSR_MARK;
+  if (sim_in_isr()) {
+    sim_dma_sync_csr();
+  }
+}
+
+/* PTP system time -------------------------------------------------------------*/
+static void ptp_advance(uint64_t now)
+{
+  uint32_t tscr = reg_load(&ETH->MACTSCR);
+  uint64_t dt = now - ptp.last_host;
+  double ns_per_s;
+  double inc;
+
+  ptp.last_host = now;
+  if (!(tscr & ETH_MACTSCR_TSENA)) {
+    return;
+  }
+  /* Fine update: SSINC per overflow of the 32-bit accumulator fed with
+   * the addend every HCLK cycle; coarse: SSINC every HCLK cycle */
+  if (tscr & ETH_MACTSCR_TSCFUPDT) {
+    ns_per_s = (double)SIM_HCLK_HZ * ((double)ptp.addend / 4294967296.0) *
+               (double)((ETH->MACSSIR >> 16) & 0xFFU);
+  } else {
+    ns_per_s = (double)SIM_HCLK_HZ * (double)((ETH->MACSSIR >> 16) & 0xFFU);
+  }
+  inc = (double)dt * ns_per_s / 1e9 + ptp.frac;
+  ptp.ns += (uint64_t)inc;
+  ptp.frac = inc - (double)(uint64_t)inc;
+}
+
+static void ptp_commands(void)
+{
+  uint32_t tscr = reg_load(&ETH->MACTSCR);
+  uint32_t done = 0;
+
+  if (tscr & ETH_MACTSCR_TSINIT) {
+    ptp.ns = (uint64_t)ETH->MACSTSUR * 1000000000ULL + (ETH->MACSTNUR & 0x7FFFFFFFU);
+    done |= ETH_MACTSCR_TSINIT;
+  }
+  if (tscr & ETH_MACTSCR_TSUPDT) {
+    uint32_t nsec = ETH->MACSTNUR;
+    if (nsec & 0x80000000U) {
+      /* ADDSUB: STSUR holds -sec, STNUR 10^9 - nsec (digital rollover) */
+      uint64_t sub = (uint64_t)(0U - ETH->MACSTSUR) * 1000000000ULL;
+      nsec &= 0x7FFFFFFFU;
+      sub += nsec ? 1000000000ULL - nsec : 0U;
+      ptp.ns = (ptp.ns > sub) ? ptp.ns - sub : 0U;
+    } else {
+      ptp.ns += (uint64_t)ETH->MACSTSUR * 1000000000ULL + nsec;
+    }
+    done |= ETH_MACTSCR_TSUPDT;
+  }
+  if (tscr & ETH_MACTSCR_TSADDREG) {
+    ptp.addend = ETH->MACTSAR;
+    done |= ETH_MACTSCR_TSADDREG;
+  }
+  if (done) {
+    while (!reg_cas(&ETH->MACTSCR, tscr, tscr & ~done)) {
+      tscr = reg_load(&ETH->MACTSCR);
+    }
+  }
+
+  /* Nanoseconds first: a reader that sees the same seconds twice then
+   * never pairs new seconds with old nanoseconds */
+  ETH->MACSTNR = (uint32_t)(ptp.ns % 1000000000ULL);
+  ETH->MACSTSR = (uint32_t)(ptp.ns / 1000000000ULL);
+}
+
+/* MAC receive side --------------------------------------------------------------*/
+static uint32_t mac_hash(const uint8_t *addr)
+{
+  uint32_t crc = 0xFFFFFFFFU;
+
+  for (uint32_t i = 0; i < 6U; i++) {
+    crc ^= addr[i];
+    for (uint32_t bit = 0; bit < 8U; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+    }
+  }
+  return __RBIT(~crc) >> 26;
+}
+
+static int mac_perfect_match(const uint8_t *da, int from)
+{
+  __IO uint32_t *regs[4][2] = {
+    { &ETH->MACA0HR, &ETH->MACA0LR }, { &ETH->MACA1HR, &ETH->MACA1LR },
+    { &ETH->MACA2HR, &ETH->MACA2LR }, { &ETH->MACA3HR, &ETH->MACA3LR },
+  };
+
+  for (int i = from; i < 4; i++) {
+    uint32_t hr = *regs[i][0];
+    uint32_t lr = *regs[i][1];
+    if (i > 0 && !(hr & 0x80000000U)) {
+      continue;
+    }
+    if (da[0] == (lr & 0xFFU) && da[1] == ((lr >> 8) & 0xFFU) &&
+        da[2] == ((lr >> 16) & 0xFFU) && da[3] == (lr >> 24) &&
+        da[4] == (hr & 0xFFU) && da[5] == ((hr >> 8) & 0xFFU)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int mac_filter_pass(const uint8_t *da)
+{
+  uint32_t pfr = reg_load(&ETH->MACPFR);
+
+  if (pfr & (ETH_MACPFR_RA | ETH_MACPFR_PR)) {
+    return 1;
+  }
+  if (!(da[0] & 1U)) {
+    return mac_perfect_match(da, 0);
+  }
+  if (da[0] == 0xFF && da[1] == 0xFF && da[2] == 0xFF && da[3] == 0xFF && da[4] == 0xFF && da[5] == 0xFF) {
+    return !(pfr & ETH_MACPFR_DBF);
+  }
+  if (pfr & ETH_MACPFR_PM) {
+    return 1;
+  }
+  if (pfr & ETH_MACPFR_HMC) {
+    uint32_t h = mac_hash(da);
+    uint32_t ht = (h >> 5) ? ETH->MACHT1R : ETH->MACHT0R;
+    if (ht & (1U << (h & 31U))) {
+      return 1;
+    }
+    return (pfr & ETH_MACPFR_HPF) && mac_perfect_match(da, 1);
+  }
+  return mac_perfect_match(da, 1);
+}
+
+/* VLAN filter: the 12-bit VID (ETV) against VL or the MACVHTR hash bins */
+static int mac_vlan_pass(uint32_t tci)
+{
+  uint32_t vtr = reg_load(&ETH->MACVTR);
+  uint32_t vid = tci & 0x0FFFU;
+
+  if (!(reg_load(&ETH->MACPFR) & ETH_MACPFR_VTFE)) {
+    return 1;
+  }
+  if (vtr & ETH_MACVTR_VTHM) {
+    uint32_t crc = 0xFFFFFFFFU;
+    for (uint32_t bit = 0; bit < 12U; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320U & (0U - ((crc ^ (vid >> bit)) & 1U)));
+    }
+    return (ETH->MACVHTR >> (__RBIT(~crc) >> 28)) & 1U;
+  }
+  return vid == (vtr & 0x0FFFU);
+}
+
+/* L3/L4 filters: with IPFE, an IP frame must match one filter set in full */
+static int mac_l34_pass(const uint8_t *data, uint32_t len, uint32_t l3)
+{
+  __IO uint32_t *ctrl[2] = { &ETH->MACL3L4C0R, &ETH->MACL3L4C1R };
+  __IO uint32_t *l4[2] = { &ETH->MACL4A0R, &ETH->MACL4A1R };
+  __IO uint32_t *sa[2] = { &ETH->MACL3A00R, &ETH->MACL3A01R };
+  uint32_t type, ihl, src, ports = 0;
+  int later_frag;
+  uint8_t proto;
+
+  if (!(reg_load(&ETH->MACPFR) & ETH_MACPFR_IPFE) || len < l3 + 20U) {
+    return 1;
+  }
+  type = ((uint32_t)data[l3 - 2U] << 8) | data[l3 - 1U];
+  if (type == 0x86DDU) {
+    return 0;                             /* no IPv6 filter set up */
+  }
+  if (type != 0x0800U) {
+    return 1;
+  }
+  ihl = (data[l3] & 0x0FU) * 4U;
+  proto = data[l3 + 9U];
+  src = ((uint32_t)data[l3 + 12U] << 24) | ((uint32_t)data[l3 + 13U] << 16) |
+        ((uint32_t)data[l3 + 14U] << 8) | data[l3 + 15U];
+  /* Fragments after the first carry no L4 header: no port filter matches */
+  later_frag = ((data[l3 + 6U] & 0x1FU) | data[l3 + 7U]) != 0U;
+  if (!later_frag && len >= l3 + ihl + 4U) {
+    ports = ((uint32_t)data[l3 + ihl] << 8) | data[l3 + ihl + 1U] |
+            ((uint32_t)data[l3 + ihl + 2U] << 24) | ((uint32_t)data[l3 + ihl + 3U] << 16);
+  }
+  for (uint32_t i = 0; i < 2U; i++) {
+    uint32_t c = reg_load(ctrl[i]);
+    uint32_t want = (c & 0x00010000U) ? 17U : 6U;
+
+    if (!(c & 0x00140004U)) {
+      continue;                           /* filter not enabled */
+    }
+    if (c & 0x00000004U) {
+      uint32_t keep = ((c >> 6) & 0x1FU) ? 0xFFFFFFFFU << ((c >> 6) & 0x1FU) : 0xFFFFFFFFU;
+      if ((src & keep) != (*sa[i] & keep)) {
+        continue;
+      }
+    }
+    if ((c & 0x00140000U) && (proto != want || later_frag)) {
+      continue;
+    }
+    if ((c & 0x00040000U) && (ports & 0xFFFFU) != (*l4[i] & 0xFFFFU)) {
+      continue;
+    }
+    if ((c & 0x00100000U) && (ports >> 16) != (*l4[i] >> 16)) {
+      continue;
+    }
+    return 1;
+  }
+  return 0;
+}
+
+/* ARP offload: the MAC replies to a request for MACARPAR by itself */
+static void mac_arp_reply(const uint8_t *req)
+{
+  uint8_t reply[60];
+  uint32_t lr = ETH->MACA0LR, hr = ETH->MACA0HR;
+  uint8_t mac[6] = { (uint8_t)lr, (uint8_t)(lr >> 8), (uint8_t)(lr >> 16), (uint8_t)(lr >> 24),
+                     (uint8_t)hr, (uint8_t)(hr >> 8) };
+
+  memset(reply, 0, sizeof(reply));
+  memcpy(reply, req + 22, 6);         /* to the requester */
+  memcpy(reply + 6, mac, 6);
+  memcpy(reply + 12, req + 12, 8);    /* ethertype, htype, ptype, hlen, plen */
+  reply[20] = 0;
+  reply[21] = 2;                      /* reply */
+  memcpy(reply + 22, mac, 6);
+  memcpy(reply + 28, req + 38, 4);    /* our address */
+  memcpy(reply + 32, req + 22, 10);   /* requester MAC + IP */
+  sim_peer_receive(reply, sizeof(reply), 0);
+  sim_dma_stats.tx_arp_replies++;
+}
+
+/* RDES1 checksum status the MAC reports when MACCR IPC is set */
+static uint32_t mac_rx_csum_status(const uint8_t *frame, uint32_t len)
+{
+  int ip_bad = 0, l4_bad = 0, l4_type = 0;
+  int ipver = sim_l4_csum_check(frame, len, &ip_bad, &l4_bad, &l4_type);
+  uint32_t rdes1 = 0;
+
+  if (ipver == 0) {
+    return RDES1_IPCB;
+  }
+  rdes1 |= (ipver == 4) ? RDES1_IPV4 : RDES1_IPV6;
+  rdes1 |= (uint32_t)l4_type & 0x7U;
+  if (ip_bad) {
+    rdes1 |= RDES1_IPHE;
+  }
+  if (l4_bad) {
+    rdes1 |= RDES1_IPCE;
+  }
+  return rdes1;
+}
+
+/* A frame reaches the MAC from the wire at `now` */
+static void mac_rx_frame(const uint8_t *data, uint32_t len, uint64_t now)
+{
+  sim_frame_t *f;
+  uint32_t tscr;
+  uint32_t tagged = (len >= 18U) && (((uint32_t)data[12] << 8) | data[13]) == ETHTYPE_VLAN_;
+  uint32_t tci = tagged ? (((uint32_t)data[14] << 8) | data[15]) : 0U;
+  uint32_t evls = (reg_load(&ETH->MACVTR) & ETH_MACVTR_EVLS_ALWAYSSTRIP) >> 21;
+  int vlan_pass = 1;
+
+  (void)now;
+  sim_dma_stats.rx_offered++;
+  if (!(reg_load(&ETH->MACCR) & ETH_MACCR_RE)) {
+    sim_dma_stats.rx_mac_off++;
+    return;
+  }
+  if (!mac_filter_pass(data)) {
+    sim_dma_stats.rx_filtered++;
+    return;
+  }
+  if (tagged && !(vlan_pass = mac_vlan_pass(tci))) {
+    sim_dma_stats.rx_filtered++;
+    sim_dma_stats.rx_vlan_filtered++;
+    return;
+  }
+  if (!mac_l34_pass(data, len, tagged ? 18U : 14U)) {
+    sim_dma_stats.rx_filtered++;
+    sim_dma_stats.rx_l34_filtered++;
+    return;
+  }
+  if (!(data[0] & 1U)) {
+    mmc.rx_unicast++;
+  }
+  if (rx_fifo_cnt == RX_FIFO_SLOTS || rx_fifo_bytes + len > sim_cfg.rx_fifo_bytes) {
+    sim_dma_stats.rx_fifo_overflow++;
+    return;
+  }
+
+  f = &rx_fifo[(rx_fifo_head + rx_fifo_cnt) % RX_FIFO_SLOTS];
+  f->rdes0 = 0;
+  f->rs0v = 0;
+  /* EVLS: 01 strip if the filter passed, 10 if it failed, 11 always */
+  if (tagged && (evls == 3U || (evls == 1U && vlan_pass) || (evls == 2U && !vlan_pass))) {
+    memcpy(f->data, data, 12);
+    memcpy(f->data + 12, data + 16, len - 16U);
+    len -= 4U;
+    data = f->data;
+    sim_dma_stats.rx_vlan_stripped++;
+    if (reg_load(&ETH->MACVTR) & ETH_MACVTR_EVLRXS) {
+      f->rdes0 = tci;
+      f->rs0v = RDES3_RS0V;
+    }
+  } else {
+    memcpy(f->data, data, len);
+  }
+  f->len = len;
+  f->lt = 0;
+  if (len >= 42U && data[12] == 0x08 && data[13] == 0x06 && data[20] == 0 && data[21] == 1) {
+    uint32_t tip = ((uint32_t)data[38] << 24) | ((uint32_t)data[39] << 16) |
+                   ((uint32_t)data[40] << 8) | data[41];
+    f->lt = RDES3_LT_ARP;
+    if ((reg_load(&ETH->MACCR) & ETH_MACCR_ARP) && tip == ETH->MACARPAR) {
+      mac_arp_reply(data);
+    }
+  }
+  f->rdes1 = 0;
+  if (reg_load(&ETH->MACCR) & ETH_MACCR_IPC) {
+    f->rdes1 = mac_rx_csum_status(data, len);
+  }
+  tscr = reg_load(&ETH->MACTSCR);
+  if ((tscr & ETH_MACTSCR_TSENA) &&
+      ((tscr & ETH_MACTSCR_TSENALL) || (len > 14 && data[12] == 0x88 && data[13] == 0xF7))) {
+    f->rdes1 |= RDES1_TSA;
+    f->ts_ns = ptp.ns;
+  }
+  rx_fifo_cnt++;
+  rx_fifo_bytes += len;
+}
+
+static void rx_fifo_pop(void)
+{
+  rx_fifo_bytes -= rx_fifo[rx_fifo_head].len;
+  rx_fifo_head = (rx_fifo_head + 1U) % RX_FIFO_SLOTS;
+  rx_fifo_cnt--;
+}
+
+/* RX DMA ------------------------------------------------------------------------*/
+static void rx_raise(uint32_t ioc, uint64_t now)
+{
+  if (ioc) {
+    csr_set(ETH_DMACSR_RI);
+    sim_dma_stats.rx_ri++;
+    rx.rwt_deadline = 0;
+  } else if ((ETH->DMACRIWTR & 0xFFU) && rx.rwt_deadline == 0) {
+    /* RWT counts units of 256 HCLK cycles (RWTU = 0) */
+    rx.rwt_deadline = now + ((uint64_t)(ETH->DMACRIWTR & 0xFFU) * 256U * 1000000000ULL) / SIM_HCLK_HZ;
+  }
+}
+
+/* Split header (DMACCR SPH): length of the L2-L4 headers of a TCP or UDP
+ * frame, written alone to buffer 1; 0 if the frame is not split (other
+ * protocols, IP fragments, headers longer than MACECR HDSMS allows) */
+static uint32_t rx_split_len(const sim_frame_t *f)
+{
+  const uint8_t *p = f->data;
+  uint32_t hdsms = 64U << ((reg_load(&ETH->MACECR) & ETH_MACECR_HDSMS) >> 20);
+  uint32_t l3 = 14U, l4, hl, type;
+  uint8_t proto;
+
+  if (!(reg_load(&ETH->DMACCR) & ETH_DMACCR_SPH) || f->len < 18U) {
+    return 0;
+  }
+  type = ((uint32_t)p[12] << 8) | p[13];
+  if (type == ETHTYPE_VLAN_) {
+    l3 = 18U;
+    type = ((uint32_t)p[16] << 8) | p[17];
+  }
+  if (type == 0x0800U) {
+    if (f->len < l3 + 20U || (((p[l3 + 6U] & 0x3FU) | p[l3 + 7U]) != 0U)) {
+      return 0;
+    }
+    l4 = l3 + (p[l3] & 0x0FU) * 4U;
+    proto = p[l3 + 9U];
+  } else if (type == 0x86DDU && f->len >= l3 + 40U) {
+    l4 = l3 + 40U;
+    proto = p[l3 + 6U];
+  } else {
+    return 0;
+  }
+  if (proto == 17U) {
+    hl = l4 + 8U;
+  } else if (proto == 6U && f->len >= l4 + 13U) {
+    hl = l4 + (p[l4 + 12U] >> 4) * 4U;
+  } else {
+    return 0;
+  }
+  return (hl <= f->len && hl <= hdsms) ? hl : 0U;
+}
+
+/* Next descriptor the RX DMA may write, or NULL after raising RBU */
+static ETH_DMADescTypeDef *rx_fetch(uint32_t *desc3)
+{
+  ETH_DMADescTypeDef *d;
+
+  if (rx.cur == rx.tail) {
+    d = NULL;
+  } else {
+    d = desc_at(rx.cur);
+    *desc3 = reg_load(&d->DESC3);
+    if (!(*desc3 & DESC_OWN)) {
+      d = NULL;
+    }
+  }
+  if (d == NULL) {
+    rx.suspended = 1;
+    csr_set(ETH_DMACSR_RBU);
+    sim_dma_stats.rx_rbu++;
+  }
+  return d;
+}
+
+static void rx_close(ETH_DMADescTypeDef *d, uint32_t d0, uint32_t d1, uint32_t d2, uint32_t d3)
+{
+  d->DESC0 = d0;
+  d->DESC1 = d1;
+  d->DESC2 = d2;
+  __atomic_store_n(&d->DESC3, d3, __ATOMIC_RELEASE);
+  rx.cur = ring_next(rx.cur, reg_load(&ETH->DMACRDLAR) & ~REG_MARK, ETH->DMACRDRLR & 0x3FFU);
+  sim_dma_stats.rx_descs++;
+}
+
+static int dma_rx(uint64_t now)
+{
+  int progress = 0;
+
+  if (!(reg_load(&ETH->DMACRCR) & ETH_DMACRCR_SR) || rx.suspended) {
+    return 0;
+  }
+
+  for (;;) {
+    ETH_DMADescTypeDef *d;
+    uint32_t d3 = 0;
+
+    if (rx.ctx_pending) {
+      /* Timestamp of the frame just closed: RDES0 ns, RDES1 s, CTXT */
+      if ((d = rx_fetch(&d3)) == NULL) {
+        break;
+      }
+      rx.ioc |= d3 & DESC_IOC_CTXT;
+      rx_close(d, (uint32_t)(rx.frm->ts_ns % 1000000000ULL),
+               (uint32_t)(rx.frm->ts_ns / 1000000000ULL), 0, DESC_IOC_CTXT);
+      sim_dma_stats.rx_ctx_descs++;
+      rx.ctx_pending = 0;
+      rx.frm = NULL;
+      rx_fifo_pop();
+      rx_raise(rx.ioc, now);
+      progress = 1;
+      continue;
+    }
+
+    if (rx.frm == NULL) {
+      if (rx_fifo_cnt == 0) {
+        break;
+      }
+      rx.frm = &rx_fifo[rx_fifo_head];
+      rx.off = 0;
+      rx.ioc = 0;
+    }
+
+    if ((d = rx_fetch(&d3)) == NULL) {
+      break;
+    }
+
+    uint32_t rbsz = (reg_load(&ETH->DMACRCR) & ETH_DMACRCR_RBSZ) >> 1;
+    uint32_t sph = reg_load(&ETH->DMACCR) & ETH_DMACCR_SPH;
+    uint32_t buf1 = d->DESC0, buf2 = d->DESC2;
+    uint32_t left = rx.frm->len - rx.off;
+    uint32_t first = (rx.off == 0);
+    uint32_t len1 = 0, len2 = 0;
+    uint32_t wb3;
+
+    /* Without SPH only buffer 1 is used. With it, buffer 1 takes the split
+     * headers (or the start of an unsplit frame) of the first descriptor
+     * and buffer 2 everything else */
+    if (first) {
+      rx.hl = rx_split_len(rx.frm);
+    }
+    if (!sph || first) {
+      len1 = rx.hl ? rx.hl : (left < rbsz ? left : rbsz);
+    }
+    if (sph) {
+      len2 = (left - len1 < rbsz) ? left - len1 : rbsz;
+    }
+    if ((len1 && (!(d3 & RDES3_BUF1V) || !dma_reachable(buf1, len1))) ||
+        (len2 && (!(d3 & RDES3_BUF2V) || !dma_reachable(buf2, len2)))) {
+      /* Fatal bus error: the channel stops as the hardware does */
+      csr_set(ETH_DMACSR_FBE | ETH_DMACSR_RPS);
+      ETH->DMACRCR &= ~ETH_DMACRCR_SR;
+      break;
+    }
+    if (len1) {
+      memcpy(SIM_BUS_PTR(buf1), rx.frm->data + rx.off, len1);
+    }
+    if (len2) {
+      memcpy(SIM_BUS_PTR(buf2), rx.frm->data + rx.off + len1, len2);
+    }
+    rx.off += len1 + len2;
+    rx.ioc |= d3 & DESC_IOC_CTXT;
+
+    wb3 = (first ? DESC_FD : 0U) | (rx.off & 0x7FFFU);
+    if (rx.off == rx.frm->len) {
+      wb3 |= DESC_LD | RDES3_RS1V | rx.frm->rs0v | rx.frm->lt;
+      /* RDES2 HL [9:0]: the split header length */
+      rx_close(d, rx.frm->rdes0, rx.frm->rdes1, first ? rx.hl : 0U, wb3);
+      sim_dma_stats.rx_frames++;
+      if (rx.frm->rdes1 & RDES1_TSA) {
+        rx.ctx_pending = 1;
+      } else {
+        rx.frm = NULL;
+        rx_fifo_pop();
+        rx_raise(rx.ioc, now);
+      }
+    } else {
+      rx_close(d, 0, 0, first ? rx.hl : 0U, wb3);
+    }
+    progress = 1;
+  }
+  return progress;
+}
+
+/* Frames arriving from the peer: injected ones first, then the flood */
+static int mac_rx(uint64_t now)
+{
+  int progress = 0;
+  uint32_t burst = 0;
+
+  pthread_mutex_lock(&inject_lock);
+  while (inject_cnt > 0) {
+    sim_frame_t *f = &inject_q[inject_head];
+    mac_rx_frame(f->data, f->len, now);
+    inject_head = (inject_head + 1U) % INJECT_SLOTS;
+    inject_cnt--;
+    progress = 1;
+    dma_rx(now);
+  }
+  pthread_mutex_unlock(&inject_lock);
+
+  while (gen.left > 0 && gen.next_ns <= now && burst < GEN_BURST_MAX) {
+    uint8_t frame[SIM_FRAME_MAX];
+    int bad = gen.bad_every && ((gen.seq % gen.bad_every) == gen.bad_every - 1U);
+    uint32_t len = sim_build_udp(frame, gen.payload, (uint32_t)gen.seq, bad);
+    uint64_t interval = gen.pps ? 1000000000ULL / gen.pps : 0U;
+
+    if (sim_cfg.peer_backoff && rx_fifo_cnt > 0U) {
+      /* Lossless peer, like one honouring PAUSE: resume at the offered
+       * rate once the DMA has drained the FIFO */
+      gen.next_ns = now;
+      break;
+    }
+    if (sim_cfg.line_rate_pace && interval < wire_ns(len)) {
+      interval = wire_ns(len);
+    }
+    mac_rx_frame(frame, len, gen.next_ns);
+    /* The DMA empties the FIFO far faster than the wire fills it */
+    dma_rx(now);
+    gen.seq++;
+    gen.left--;
+    gen.next_ns += interval;
+    burst++;
+    progress = 1;
+  }
+  return progress;
+}
+
+/* TX DMA ------------------------------------------------------------------------*/
+static void tx_deliver(uint64_t now, int has_ts)
+{
+  if (tx.len != tx.fl) {
+    sim_dma_stats.tx_len_error++;
+  }
+  if (tx.cic) {
+    sim_l4_csum_insert(tx.buf, tx.len, tx.cic);
+  }
+  if (tx.vlan_ins) {
+    memmove(tx.buf + 16, tx.buf + 12, tx.len - 12U);
+    tx.buf[12] = (uint8_t)(ETHTYPE_VLAN_ >> 8);
+    tx.buf[13] = (uint8_t)ETHTYPE_VLAN_;
+    tx.buf[14] = (uint8_t)(tx.vlan_tag >> 8);
+    tx.buf[15] = (uint8_t)tx.vlan_tag;
+    tx.len += 4U;
+    sim_dma_stats.tx_vlan_inserted++;
+  }
+  if (tx.len < 60U) {
+    /* CPC = 00: pad and CRC inserted by the MAC */
+    memset(tx.buf + tx.len, 0, 60U - tx.len);
+    tx.len = 60U;
+  }
+  sim_peer_receive(tx.buf, tx.len, has_ts);
+  sim_dma_stats.tx_frames++;
+  sim_dma_stats.tx_bytes += tx.len;
+  mmc.tx_good++;
+  if (sim_cfg.line_rate_pace) {
+    tx.busy_until = (tx.busy_until > now ? tx.busy_until : now) + wire_ns(tx.len);
+  }
+}
+
+static inline uint16_t get16(const uint8_t *p)
+{
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline void put16(uint8_t *p, uint32_t v)
+{
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+/* Cut the gathered TSO frame into MSS-sized segments and send each one */
+static void tx_segment(uint64_t now, int has_ts)
+{
+  uint32_t l3 = 14U;
+  uint32_t l4 = tx.hdr_len - tx.thl * 4U;
+  uint32_t ipv4 = get16(tso_buf + 12) == 0x0800U;
+  uint32_t seq = ((uint32_t)get16(tso_buf + l4 + 4U) << 16) | get16(tso_buf + l4 + 6U);
+  uint32_t id = ipv4 ? get16(tso_buf + l3 + 4U) : 0U;
+  uint8_t flags = tso_buf[l4 + 13U];
+  uint32_t off = 0;
+
+  if (tx.mss == 0U || tx.thl < 5U || tx.hdr_len < l3 + 20U + tx.thl * 4U ||
+      tx.hdr_len + tx.mss > sizeof(tx.buf) || tso_len != tx.hdr_len + tx.tpl) {
+    sim_dma_stats.tx_len_error++;
+    return;
+  }
+  sim_dma_stats.tx_tso_frames++;
+  while (off < tx.tpl) {
+    uint32_t seg = (tx.tpl - off > tx.mss) ? tx.mss : tx.tpl - off;
+    int last = (off + seg == tx.tpl);
+    uint8_t *tcp = tx.buf + l4;
+
+    memcpy(tx.buf, tso_buf, tx.hdr_len);
+    memcpy(tx.buf + tx.hdr_len, tso_buf + tx.hdr_len + off, seg);
+    tx.len = tx.fl = tx.hdr_len + seg;
+    if (ipv4) {
+      put16(tx.buf + l3 + 2U, tx.len - l3);
+      put16(tx.buf + l3 + 4U, id++);
+    } else {
+      put16(tx.buf + l3 + 4U, tx.len - l3 - 40U);
+    }
+    put16(tcp + 4U, (seq + off) >> 16);
+    put16(tcp + 6U, seq + off);
+    tcp[13] = last ? flags : (uint8_t)(flags & ~0x09U);   /* PSH, FIN */
+    tx.cic = 3U;
+    tx_deliver(now, has_ts && last);
+    sim_dma_stats.tx_tso_segs++;
+    off += seg;
+  }
+}
+
+static int dma_tx(uint64_t now)
+{
+  int progress = 0;
+
+  if (!(reg_load(&ETH->DMACTCR) & ETH_DMACTCR_ST) || tx.suspended) {
+    return 0;
+  }
+
+  while (tx.cur != tx.tail) {
+    ETH_DMADescTypeDef *d = desc_at(tx.cur);
+    uint32_t d3 = reg_load(&d->DESC3);
+    uint32_t d2 = d->DESC2;
+    uint32_t wb0 = d->DESC0, wb1 = d->DESC1;
+    uint32_t wb3;
+    int has_ts = 0;
+
+    if (sim_cfg.line_rate_pace && now < tx.busy_until) {
+      break;
+    }
+    if (!(d3 & DESC_OWN)) {
+      tx.suspended = 1;
+      csr_set(ETH_DMACSR_TBU);
+      sim_dma_stats.tx_tbu++;
+      break;
+    }
+
+    if (d3 & DESC_IOC_CTXT) {
+      /* Context descriptor: the MSS (TCMSSV) and the VLAN tag (VLTV) */
+      if (d3 & TDES3_TCMSSV) {
+        tx.mss = d2 & 0x3FFFU;
+      }
+      if (d3 & TDES3_VLTV) {
+        tx.vlan_tag = d3 & 0xFFFFU;
+      }
+      wb3 = DESC_IOC_CTXT;
+    } else {
+      uint32_t b1 = d->DESC0, l1 = d2 & 0x3FFFU;
+      uint32_t b2 = d->DESC1, l2 = (d2 >> 16) & 0x3FFFU;
+      uint8_t *dst;
+      uint32_t *len, cap;
+
+      if (d3 & DESC_FD) {
+        tx.len = 0;
+        tx.fl = d3 & 0x7FFFU;
+        tx.cic = (d3 >> 16) & 0x3U;
+        tx.ttse = d2 & TDES2_TTSE;
+        tx.vlan_ins = ((d2 & TDES2_VTIR) == TDES2_VTIR_INSERT) &&
+                      (reg_load(&ETH->MACVIR) & ETH_MACVIR_VLTI);
+        tx.tse = (d3 & TDES3_TSE) && (reg_load(&ETH->DMACTCR) & ETH_DMACTCR_TSE);
+        if (tx.tse) {
+          tso_len = 0;
+          tx.thl = (d3 >> 19) & 0xFU;
+          tx.tpl = d3 & 0x3FFFFU;
+          tx.hdr_len = l1;
+        }
+      }
+      dst = tx.tse ? tso_buf : tx.buf;
+      len = tx.tse ? &tso_len : &tx.len;
+      cap = tx.tse ? sizeof(tso_buf) : sizeof(tx.buf);
+      if ((l1 && !dma_reachable(b1, l1)) || (l2 && !dma_reachable(b2, l2)) ||
+          *len + l1 + l2 > cap) {
+        sim_dma_stats.tx_bad_buffer++;
+        l1 = l2 = 0;
+      }
+      memcpy(dst + *len, SIM_BUS_PTR(b1), l1);
+      *len += l1;
+      memcpy(dst + *len, SIM_BUS_PTR(b2), l2);
+      *len += l2;
+
+      wb3 = d3 & (DESC_FD | DESC_LD);
+      if (d3 & DESC_LD) {
+        if (tx.ttse && (reg_load(&ETH->MACTSCR) & ETH_MACTSCR_TSENA)) {
+          wb0 = (uint32_t)(ptp.ns % 1000000000ULL);
+          wb1 = (uint32_t)(ptp.ns / 1000000000ULL);
+          wb3 |= TDES3_TTSS;
+          sim_dma_stats.tx_ts++;
+          has_ts = 1;
+        }
+        if (tx.tse) {
+          tx_segment(now, has_ts);
+        } else {
+          tx_deliver(now, has_ts);
+        }
+      }
+    }
+
+    d->DESC0 = wb0;
+    d->DESC1 = wb1;
+    __atomic_store_n(&d->DESC3, wb3, __ATOMIC_RELEASE);
+    sim_dma_stats.tx_descs++;
+    tx.cur = ring_next(tx.cur, reg_load(&ETH->DMACTDLAR) & ~REG_MARK, ETH->DMACTDRLR & 0x3FFU);
+    if (d2 & TDES2_IOC) {
+      csr_set(ETH_DMACSR_TI);
+    }
+    progress = 1;
+  }
+  return progress;
+}
+
+/* Register stores by the driver ---------------------------------------------------*/
+static int sync_regs(void)
+{
+  uint32_t v;
+  int progress = 0;
+
+  sim_dma_sync_csr();
+
+  if (reg_take(&ETH->DMACRDLAR, &v)) {
+    /* New list address: restart from its first descriptor, the frame in
+     * progress is written again from its start */
+    rx.cur = v;
+    rx.frm = NULL;
+    rx.off = 0;
+    rx.ctx_pending = 0;
+    rx.suspended = 0;
+    progress = 1;
+  }
+  if (reg_take(&ETH->DMACRDTPR, &v)) {
+    rx.tail = v;
+    rx.suspended = 0;
+    sim_dma_stats.rx_tail_writes++;
+    progress = 1;
+  }
+  if (reg_load(&POLL_DEMAND) != 1U) {
+    reg_cas(&POLL_DEMAND, reg_load(&POLL_DEMAND), 1U);
+    rx.suspended = 0;
+    sim_dma_stats.rx_poll_demands++;
+    progress = 1;
+  }
+  if (reg_take(&ETH->DMACTDLAR, &v)) {
+    tx.cur = v;
+    tx.suspended = 0;
+    progress = 1;
+  }
+  if (reg_take(&ETH->DMACTDTPR, &v)) {
+    tx.tail = v;
+    tx.suspended = 0;
+    sim_dma_stats.tx_tail_writes++;
+    progress = 1;
+  }
+  if (reg_load(&ETH->MTLTQOMR) & ETH_MTLTQOMR_FTQ) {
+    ETH->MTLTQOMR &= ~ETH_MTLTQOMR_FTQ;       /* flush completes at once */
+  }
+  return progress;
+}
+
+static void mmc_publish(void)
+{
+  if (reg_load(&ETH->MMCCR) & 0x00000008U) {    /* CNTFREEZ */
+    return;
+  }
+  ETH->MMCRUPGR = mmc.rx_unicast;
+  ETH->MMCTPCGR = mmc.tx_good;
+}
+
+/* Raise the ETH interrupt for as long as the line is asserted */
+static void irq_service(void)
+{
+  for (uint32_t runs = 0;; runs++) {
+    uint32_t ier = reg_load(&ETH->DMACIER);
+    uint32_t csr = sim_dma_pending_csr();
+
+    if (!(((csr & ETH_DMACSR_NIS) && (ier & ETH_DMACIER_NIE)) ||
+          ((csr & ETH_DMACSR_AIS) && (ier & ETH_DMACIER_AIE)))) {
+      return;
+    }
+    if (!sim_irq_ready()) {
+      return;
+    }
+    if (runs == IRQ_STORM_RUNS) {
+      /* The handler keeps returning without clearing the source */
+      sim_dma_stats.irq_storms++;
+      return;
+    }
+    sim_irq_deliver();
+  }
+}
+
+static void *sim_dma_thread(void *arg)
+{
+  (void)arg;
+  prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+
+  while (dma_running) {
+    uint64_t now = sim_now_ns();
+    int progress;
+
+    sim_dma_stats.model_loops++;
+    ptp_advance(now);
+    ptp_commands();
+    progress = sync_regs();
+    progress |= mac_rx(now);
+    progress |= dma_rx(now);
+    progress |= dma_tx(now);
+    if (rx.rwt_deadline && now >= rx.rwt_deadline) {
+      rx.rwt_deadline = 0;
+      csr_set(ETH_DMACSR_RI);
+      sim_dma_stats.rx_ri++;
+      sim_dma_stats.rx_rwt++;
+    }
+    mmc_publish();
+    if (DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) {
+      DWT->CYCCNT = (uint32_t)(now * (SIM_CPU_HZ / 1000000U) / 1000U);
+    }
+    irq_service();
+
+    if (!progress) {
+      struct timespec ts = { 0, (long)sim_cfg.idle_sleep_ns };
+      nanosleep(&ts, NULL);
+    }
+  }
+  return NULL;
+}
+
+/* Public interface ----------------------------------------------------------------*/
+void sim_dma_start(void)
+{
+  ETH->DMACSR = CSR_MARK;
+  ETH->DMACRDTPR = REG_MARK;
+  ETH->DMACTDTPR = REG_MARK;
+  ETH->DMACRDLAR = REG_MARK;
+  ETH->DMACTDLAR = REG_MARK;
+  POLL_DEMAND = 1U;
+  ptp.last_host = sim_now_ns();
+  ptp.addend = 0x80000000U;
+
+  dma_running = 1;
+  pthread_create(&dma_thread, NULL, sim_dma_thread, NULL);
+}
+
+void sim_dma_stop(void)
+{
+  dma_running = 0;
+  pthread_join(dma_thread, NULL);
+}
+
+int sim_rx_inject(const uint8_t *frame, uint32_t len)
+{
+  int ok = 0;
+
+  if (len > SIM_FRAME_MAX) {
+    return 0;
+  }
+  pthread_mutex_lock(&inject_lock);
+  if (inject_cnt < INJECT_SLOTS) {
+    sim_frame_t *f = &inject_q[(inject_head + inject_cnt) % INJECT_SLOTS];
+    memcpy(f->data, frame, len);
+    f->len = len;
+    inject_cnt++;
+    ok = 1;
+  }
+  pthread_mutex_unlock(&inject_lock);
+  return ok;
+}
+
+void sim_rx_flood(uint32_t pps, uint64_t count, uint32_t payload_len, uint32_t bad_csum_every)
+{
+  /* Handed over under the inject lock, which the model takes every pass */
+  pthread_mutex_lock(&inject_lock);
+  gen.pps = pps;
+  gen.payload = payload_len;
+  gen.bad_every = bad_csum_every;
+  gen.next_ns = sim_now_ns();
+  gen.left = count;
+  pthread_mutex_unlock(&inject_lock);
+}
+
+uint64_t sim_rx_flood_left(void)
+{
+  return __atomic_load_n(&gen.left, __ATOMIC_RELAXED);
+}
+
+uint32_t sim_rx_desc_owned_by_dma(void)
+{
+  uint32_t base = reg_load(&ETH->DMACRDLAR) & ~REG_MARK;
+  uint32_t n = (ETH->DMACRDRLR & 0x3FFU) + 1U;
+  uint32_t owned = 0;
+
+  for (uint32_t i = 0; i < n; i++) {
+    owned += (reg_load(&desc_at(base + i * 16U)->DESC3) & DESC_OWN) != 0;
+  }
+  return owned;
+}
+
+uint32_t sim_tx_desc_owned_by_dma(void)
+{
+  uint32_t base = reg_load(&ETH->DMACTDLAR) & ~REG_MARK;
+  uint32_t n = (ETH->DMACTDRLR & 0x3FFU) + 1U;
+  uint32_t owned = 0;
+
+  for (uint32_t i = 0; i < n; i++) {
+    owned += (reg_load(&desc_at(base + i * 16U)->DESC3) & DESC_OWN) != 0;
+  }
+  return owned;
+}
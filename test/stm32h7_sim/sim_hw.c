@@ -0,0 +1,527 @@
+/*
+ * STM32H7 Ethernet host simulator: memory map, HAL/CMSIS/RTEMS stubs, the
+ * ETH interrupt line and the LAN8742 PHY.
+ *
+ * D2 SRAM and the ETH register block are mapped at their real addresses so
+ * the driver's fixed D2 layout and its 32-bit address arithmetic work as on
+ * the board (the binary is linked -no-pie, everything it owns sits below
+ * 4 GB). D1 AXI SRAM is a linker section at 0x24000000 (arch/cc.h).
+ *
+ * The HAL_ETH_* functions do what the STM32CubeH7 HAL does to the registers
+ * for the calls the driver still makes; the descriptor rings are the
+ * driver's own business and the DMA model's (sim_dma.c).
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <stm32h7xx_hal.h>
+#include <rtems.h>
+#include <rtems/irq-extension.h>
+#include "sim_hw.h"
+
+uint32_t SystemCoreClock = SIM_CPU_HZ;
+SCB_Type sim_scb;
+DWT_Type sim_dwt;
+CoreDebug_Type sim_coredebug;
+SYSCFG_TypeDef sim_syscfg;
+GPIO_TypeDef sim_gpio[8];
+sim_cpu_stats_t sim_cpu_stats;
+
+static uint64_t start_ns;
+
+#define SIM_COUNT(field, n)   __atomic_fetch_add(&sim_cpu_stats.field, (n), __ATOMIC_RELAXED)
+
+/* Time --------------------------------------------------------------------------*/
+uint64_t sim_thread_cpu_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint32_t HAL_GetTick(void)
+{
+  return (uint32_t)((sim_now_ns() - start_ns) / 1000000ULL);
+}
+
+uint32_t HAL_RCC_GetHCLKFreq(void)
+{
+  return SIM_HCLK_HZ;
+}
+
+/* Core ------------------------------------------------------------------------------*/
+void sim_barrier(void)
+{
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  SIM_COUNT(barriers, 1);
+  /* The trace reads CYCCNT right after a barrier: keep it current */
+  if (DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) {
+    DWT->CYCCNT = (uint32_t)((sim_now_ns() - start_ns) * (SIM_CPU_HZ / 1000000U) / 1000U);
+  }
+}
+
+void SCB_CleanDCache_by_Addr(volatile void *addr, int32_t dsize)
+{
+  (void)addr;
+  SIM_COUNT(cache_clean, 1);
+  SIM_COUNT(cache_clean_bytes, (uint64_t)dsize);
+}
+
+void SCB_InvalidateDCache_by_Addr(volatile void *addr, int32_t dsize)
+{
+  (void)addr;
+  SIM_COUNT(cache_inval, 1);
+  SIM_COUNT(cache_inval_bytes, (uint64_t)dsize);
+}
+
+void SCB_CleanInvalidateDCache_by_Addr(volatile void *addr, int32_t dsize)
+{
+  (void)addr;
+  (void)dsize;
+  SIM_COUNT(cache_clean_inval, 1);
+}
+
+void HAL_MPU_Disable(void)
+{
+}
+
+void HAL_MPU_Enable(uint32_t MPU_Control)
+{
+  (void)MPU_Control;
+}
+
+void HAL_MPU_ConfigRegion(MPU_Region_InitTypeDef *MPU_Init)
+{
+  (void)MPU_Init;
+}
+
+void HAL_SYSCFG_ETHInterfaceSelect(uint32_t SYSCFG_ETHInterface)
+{
+  MODIFY_REG(SYSCFG->PMCR, SYSCFG_ETH_RMII, SYSCFG_ETHInterface);
+}
+
+void HAL_EnableCompensationCell(void)
+{
+  SYSCFG->CCCSR |= 1U | SYSCFG_CCCSR_READY;
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+  (void)GPIOx;
+  (void)GPIO_Init;
+}
+
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin)
+{
+  (void)GPIOx;
+  (void)GPIO_Pin;
+}
+
+void Error_Handler(void)
+{
+  fprintf(stderr, "sim: Error_Handler() called by the driver\n");
+  abort();
+}
+
+/* Interrupts ----------------------------------------------------------------------*/
+/* One recursive lock stands for "interrupts disabled": threads take it in
+ * rtems_interrupt_local_disable() and SYS_ARCH_PROTECT, the model takes it
+ * around the ETH handler. */
+static pthread_mutex_t irq_lock;
+static __thread int in_isr;
+
+static struct {
+  rtems_interrupt_handler handler;
+  void *arg;
+  int vector_enabled;
+  int nvic_enabled;
+} eth_irq;
+
+void sim_irq_lock(void)
+{
+  pthread_mutex_lock(&irq_lock);
+}
+
+void sim_irq_unlock(void)
+{
+  pthread_mutex_unlock(&irq_lock);
+}
+
+int sim_in_isr(void)
+{
+  return in_isr;
+}
+
+uint32_t __get_IPSR(void)
+{
+  return in_isr ? (16U + (uint32_t)ETH_IRQn) : 0U;
+}
+
+int sim_irq_ready(void)
+{
+  return eth_irq.handler != NULL && eth_irq.vector_enabled && eth_irq.nvic_enabled;
+}
+
+void sim_irq_deliver(void)
+{
+  uint64_t t0;
+
+  sim_irq_lock();
+  t0 = sim_thread_cpu_ns();
+  in_isr = 1;
+  eth_irq.handler(eth_irq.arg);
+  in_isr = 0;
+  sim_dma_stats.isr_ns += sim_thread_cpu_ns() - t0;
+  sim_dma_stats.irq_raised++;
+  sim_irq_unlock();
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+  (void)IRQn;
+  (void)PreemptPriority;
+  (void)SubPriority;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+  if (IRQn == ETH_IRQn) {
+    eth_irq.nvic_enabled = 1;
+  }
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+  if (IRQn == ETH_IRQn) {
+    eth_irq.nvic_enabled = 0;
+  }
+}
+
+/* RTEMS ----------------------------------------------------------------------------*/
+rtems_status_code rtems_interrupt_handler_install(rtems_vector_number vector, const char *info,
+                                                  rtems_option options,
+                                                  rtems_interrupt_handler handler, void *arg)
+{
+  (void)info;
+  (void)options;
+  if (vector != (rtems_vector_number)ETH_IRQn) {
+    return RTEMS_INVALID_NUMBER;
+  }
+  if (eth_irq.handler != NULL) {
+    return RTEMS_TOO_MANY;
+  }
+  eth_irq.arg = arg;
+  eth_irq.handler = handler;
+  return RTEMS_SUCCESSFUL;
+}
+
+rtems_status_code rtems_interrupt_vector_enable(rtems_vector_number vector)
+{
+  if (vector != (rtems_vector_number)ETH_IRQn) {
+    return RTEMS_INVALID_NUMBER;
+  }
+  eth_irq.vector_enabled = 1;
+  return RTEMS_SUCCESSFUL;
+}
+
+rtems_status_code rtems_interrupt_vector_disable(rtems_vector_number vector)
+{
+  if (vector != (rtems_vector_number)ETH_IRQn) {
+    return RTEMS_INVALID_NUMBER;
+  }
+  eth_irq.vector_enabled = 0;
+  return RTEMS_SUCCESSFUL;
+}
+
+rtems_status_code rtems_task_wake_after(rtems_interval ticks)
+{
+  if (ticks == RTEMS_YIELD_PROCESSOR) {
+    sched_yield();
+  } else {
+    struct timespec ts = { ticks / 1000U, (long)(ticks % 1000U) * 1000000L };
+    nanosleep(&ts, NULL);
+  }
+  return RTEMS_SUCCESSFUL;
+}
+
+uint32_t rtems_scheduler_get_processor(void)
+{
+  return 0;
+}
+
+/* LAN8742 at MDIO address 0 --------------------------------------------------------*/
+#define PHY_ADDR              0U
+#define PHY_BCR               0x00U
+#define PHY_BSR               0x01U
+#define PHY_SMR               0x12U
+#define PHY_ISFR              0x1DU
+#define PHY_IMR               0x1EU
+#define PHY_PHYSCSR           0x1FU
+#define BCR_RESET             0x8000U
+#define BCR_ANEN              0x1000U
+#define BCR_RESTART_AN        0x0200U
+#define BSR_ABILITIES         0x7809U   /* 100TX/10T FD+HD, AN ability, extended cap */
+#define BSR_AN_DONE           0x0020U
+#define BSR_LINK              0x0004U
+#define ISFR_ENERGYON         0x0080U   /* INT7 */
+#define ISFR_AN_DONE          0x0040U   /* INT6 */
+#define ISFR_LINK_DOWN        0x0010U   /* INT4 */
+#define PHYSCSR_AN_DONE       0x1000U
+#define PHYSCSR_100FD         0x0018U
+
+static pthread_mutex_t phy_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct {
+  int link;
+  int link_latched_low;       /* BSR link bit stays 0 until read once */
+  uint32_t bcr;
+  uint32_t isfr;
+  uint32_t imr;
+} phy = { .bcr = BCR_ANEN };
+
+void sim_phy_set_link(int up)
+{
+  pthread_mutex_lock(&phy_lock);
+  if (up && !phy.link) {
+    phy.isfr |= ISFR_ENERGYON | ISFR_AN_DONE;
+  } else if (!up && phy.link) {
+    phy.isfr |= ISFR_LINK_DOWN;
+    phy.link_latched_low = 1;
+  }
+  phy.link = up;
+  pthread_mutex_unlock(&phy_lock);
+}
+
+uint32_t sim_phy_read(uint32_t addr, uint32_t reg)
+{
+  uint32_t val = 0xFFFFU;     /* nobody drives MDIO */
+
+  if (addr != PHY_ADDR) {
+    return val;
+  }
+  pthread_mutex_lock(&phy_lock);
+  switch (reg) {
+    case PHY_BCR:
+      val = phy.bcr;
+      break;
+    case PHY_BSR:
+      val = BSR_ABILITIES;
+      if (phy.link && !phy.link_latched_low) {
+        val |= BSR_LINK | BSR_AN_DONE;
+      }
+      phy.link_latched_low = 0;
+      break;
+    case PHY_SMR:
+      val = 0x00E0U | PHY_ADDR;     /* MODE = all capable, auto-negotiation */
+      break;
+    case PHY_ISFR:
+      val = phy.isfr;
+      phy.isfr = 0;
+      break;
+    case PHY_IMR:
+      val = phy.imr;
+      break;
+    case PHY_PHYSCSR:
+      val = phy.link ? (PHYSCSR_AN_DONE | PHYSCSR_100FD) : 0U;
+      break;
+    default:
+      val = 0;
+      break;
+  }
+  pthread_mutex_unlock(&phy_lock);
+  return val;
+}
+
+void sim_phy_write(uint32_t addr, uint32_t reg, uint32_t val)
+{
+  if (addr != PHY_ADDR) {
+    return;
+  }
+  pthread_mutex_lock(&phy_lock);
+  switch (reg) {
+    case PHY_BCR:
+      /* Reset and autonegotiation restart complete at once */
+      phy.bcr = (val & BCR_RESET) ? BCR_ANEN : (val & ~(BCR_RESET | BCR_RESTART_AN));
+      if ((val & BCR_RESET) || (val & BCR_RESTART_AN)) {
+        phy.isfr = 0;
+      }
+      break;
+    case PHY_IMR:
+      phy.imr = val & 0xFFFFU;
+      break;
+    default:
+      break;
+  }
+  pthread_mutex_unlock(&phy_lock);
+}
+
+/* HAL ETH ---------------------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_ETH_Init(ETH_HandleTypeDef *heth)
+{
+  const uint8_t *mac = heth->Init.MACAddr;
+
+  if (heth->gState == HAL_ETH_STATE_RESET) {
+    HAL_ETH_MspInit(heth);
+  }
+  HAL_SYSCFG_ETHInterfaceSelect(heth->Init.MediaInterface);
+
+  /* ETH_MACDMAConfig() defaults: 100M full duplex, checksum offload */
+  heth->Instance->MACCR = ETH_MACCR_IPC | ETH_MACCR_FES | ETH_MACCR_DM;
+  heth->Instance->MACPFR = 0;
+  heth->Instance->MACA0HR = ((uint32_t)mac[5] << 8) | mac[4];
+  heth->Instance->MACA0LR = ((uint32_t)mac[3] << 24) | ((uint32_t)mac[2] << 16) |
+                            ((uint32_t)mac[1] << 8) | mac[0];
+  MODIFY_REG(heth->Instance->DMACRCR, ETH_DMACRCR_RBSZ, heth->Init.RxBuffLen << 1);
+
+  /* ETH_DMATxDescListInit() / ETH_DMARxDescListInit() for the HAL's own
+   * ETH_TX_DESC_CNT / ETH_RX_DESC_CNT descriptors */
+  for (uint32_t i = 0; i < ETH_TX_DESC_CNT; i++) {
+    volatile uint32_t *d = (volatile uint32_t *)((uintptr_t)heth->Init.TxDesc + i * 16U);
+    d[0] = d[1] = d[2] = d[3] = 0;
+  }
+  heth->Instance->DMACTDRLR = ETH_TX_DESC_CNT - 1U;
+  heth->Instance->DMACTDLAR = (uint32_t)(uintptr_t)heth->Init.TxDesc;
+  heth->Instance->DMACTDTPR = (uint32_t)(uintptr_t)heth->Init.TxDesc;
+  for (uint32_t i = 0; i < ETH_RX_DESC_CNT; i++) {
+    volatile uint32_t *d = (volatile uint32_t *)((uintptr_t)heth->Init.RxDesc + i * 16U);
+    d[0] = d[1] = d[2] = d[3] = 0;
+  }
+  heth->Instance->DMACRDRLR = ETH_RX_DESC_CNT - 1U;
+  heth->Instance->DMACRDLAR = (uint32_t)(uintptr_t)heth->Init.RxDesc;
+  heth->Instance->DMACRDTPR = (uint32_t)(uintptr_t)heth->Init.RxDesc + (ETH_RX_DESC_CNT - 1U) * 16U;
+
+  heth->ErrorCode = HAL_ETH_ERROR_NONE;
+  heth->gState = HAL_ETH_STATE_READY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ETH_RegisterRxAllocateCallback(ETH_HandleTypeDef *heth,
+                                                     pETH_rxAllocateCallbackTypeDef rxAllocateCallback)
+{
+  heth->rxAllocateCallback = rxAllocateCallback;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ETH_RegisterRxLinkCallback(ETH_HandleTypeDef *heth,
+                                                 pETH_rxLinkCallbackTypeDef rxLinkCallback)
+{
+  heth->rxLinkCallback = rxLinkCallback;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ETH_RegisterTxFreeCallback(ETH_HandleTypeDef *heth,
+                                                 pETH_txFreeCallbackTypeDef txFreeCallback)
+{
+  heth->txFreeCallback = txFreeCallback;
+  return HAL_OK;
+}
+
+/* HAL_ETH_IRQHandler() of STM32CubeH7 for the DMA channel interrupts */
+void HAL_ETH_IRQHandler(ETH_HandleTypeDef *heth)
+{
+  uint32_t csr = sim_dma_pending_csr();
+  uint32_t ier = heth->Instance->DMACIER;
+
+  if ((csr & ETH_DMACSR_RI) && (ier & ETH_DMACIER_RIE)) {
+    HAL_ETH_RxCpltCallback(heth);
+    __HAL_ETH_DMA_CLEAR_IT(heth, ETH_DMACSR_RI | ETH_DMACSR_NIS);
+  }
+  if ((csr & ETH_DMACSR_TI) && (ier & ETH_DMACIER_TIE)) {
+    HAL_ETH_TxCpltCallback(heth);
+    __HAL_ETH_DMA_CLEAR_IT(heth, ETH_DMACSR_TI | ETH_DMACSR_NIS);
+  }
+  if ((csr & ETH_DMACSR_AIS) && (ier & ETH_DMACIER_AIE)) {
+    heth->ErrorCode |= HAL_ETH_ERROR_DMA;
+    if (csr & ETH_DMACSR_FBE) {
+      heth->DMAErrorCode = csr & (ETH_DMACSR_FBE | ETH_DMACSR_TPS | ETH_DMACSR_RPS);
+      __HAL_ETH_DMA_DISABLE_IT(heth, ETH_DMACIER_NIE | ETH_DMACIER_AIE);
+      heth->gState = HAL_ETH_STATE_ERROR;
+    } else {
+      heth->DMAErrorCode = csr & (ETH_DMACSR_CDE | ETH_DMACSR_ETI | ETH_DMACSR_RWT |
+                                  ETH_DMACSR_RBU | ETH_DMACSR_AIS);
+      __HAL_ETH_DMA_CLEAR_IT(heth, ETH_DMACSR_CDE | ETH_DMACSR_ETI | ETH_DMACSR_RWT |
+                                   ETH_DMACSR_RBU | ETH_DMACSR_AIS);
+    }
+    HAL_ETH_ErrorCallback(heth);
+  }
+}
+
+uint32_t HAL_ETH_GetDMAError(ETH_HandleTypeDef *heth)
+{
+  return heth->DMAErrorCode;
+}
+
+HAL_StatusTypeDef HAL_ETH_GetMACConfig(ETH_HandleTypeDef *heth, ETH_MACConfigTypeDef *macconf)
+{
+  uint32_t maccr = heth->Instance->MACCR;
+
+  macconf->Speed = maccr & ETH_MACCR_FES;
+  macconf->DuplexMode = maccr & ETH_MACCR_DM;
+  macconf->ChecksumOffload = (maccr & ETH_MACCR_IPC) ? ENABLE : DISABLE;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ETH_SetMACConfig(ETH_HandleTypeDef *heth, ETH_MACConfigTypeDef *macconf)
+{
+  MODIFY_REG(heth->Instance->MACCR, ETH_MACCR_FES | ETH_MACCR_DM | ETH_MACCR_IPC,
+             macconf->Speed | macconf->DuplexMode |
+             ((macconf->ChecksumOffload == ENABLE) ? ETH_MACCR_IPC : 0U));
+  return HAL_OK;
+}
+
+void HAL_ETH_SetMDIOClockRange(ETH_HandleTypeDef *heth)
+{
+  (void)heth;
+}
+
+HAL_StatusTypeDef HAL_ETH_ReadPHYRegister(ETH_HandleTypeDef *heth, uint32_t PHYAddr, uint32_t PHYReg,
+                                          uint32_t *pRegValue)
+{
+  (void)heth;
+  *pRegValue = sim_phy_read(PHYAddr, PHYReg);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ETH_WritePHYRegister(const ETH_HandleTypeDef *heth, uint32_t PHYAddr, uint32_t PHYReg,
+                                           uint32_t RegValue)
+{
+  (void)heth;
+  sim_phy_write(PHYAddr, PHYReg, RegValue);
+  return HAL_OK;
+}
+
+/* Bring-up ---------------------------------------------------------------------------*/
+static void map_fixed(uintptr_t addr, size_t size, const char *what)
+{
+  void *p = mmap((void *)addr, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+  if (p != (void *)addr) {
+    fprintf(stderr, "sim: cannot map %s at 0x%08lx\n", what, (unsigned long)addr);
+    exit(2);
+  }
+}
+
+void sim_hw_init(void)
+{
+  pthread_mutexattr_t attr;
+
+  start_ns = sim_now_ns();
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&irq_lock, &attr);
+  pthread_mutexattr_destroy(&attr);
+
+  map_fixed(SIM_D2_BASE, SIM_D2_SIZE, "D2 SRAM");
+  map_fixed(ETH_BASE, SIM_ETH_SIZE, "the ETH registers");
+
+  /* Reset values the driver relies on */
+  ETH->MACSSIR = 0;
+  SYSCFG->CCCSR = SYSCFG_CCCSR_READY;
+  sim_phy_set_link(1);
+}
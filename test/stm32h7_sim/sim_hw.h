@@ -0,0 +1,195 @@
+/*
+ * STM32H7 Ethernet host simulator: the hardware side shared by the HAL
+ * stubs (sim_hw.c), the DMA model (sim_dma.c) and the harness (sim_main.c).
+ *
+ * The simulated part of the chip is the ETH MAC/MTL/DMA register block at
+ * its real address (0x40028000), D1 AXI SRAM (0x24000000) and D2 SRAM
+ * (0x30000000), the LAN8742 behind MDIO and a link partner ("peer") that
+ * answers ARP, generates traffic and checks every frame the MAC transmits.
+ */
+
+#ifndef SIM_HW_H
+#define SIM_HW_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+#define SIM_D1_BASE           0x24000000UL
+#define SIM_D1_SIZE           0x00080000UL
+#define SIM_D2_BASE           0x30000000UL
+#define SIM_D2_SIZE           0x00048000UL
+#define SIM_ETH_SIZE          0x00002000UL
+
+#define SIM_HCLK_HZ           240000000U
+#define SIM_CPU_HZ            480000000U
+
+#define SIM_FRAME_MAX         1536U
+
+/* Peer and device addresses used by the harness */
+#define SIM_PEER_IP           0xC0A80101U   /* 192.168.1.1 */
+#define SIM_DEV_IP            0xC0A8010AU   /* 192.168.1.10 */
+#define SIM_UDP_PORT          5001U
+#define SIM_TCP_PORT          5003U   /* peer's TCP sink */
+
+extern const uint8_t sim_peer_mac[6];
+
+/* Model configuration, set by the harness before sim_dma_start() */
+typedef struct {
+  uint32_t rx_fifo_bytes;     /* MTL RX FIFO size */
+  uint32_t line_rate_pace;    /* hold TX/RX to the negotiated wire speed */
+  uint32_t peer_backoff;      /* flood holds off while the RX FIFO is occupied */
+  uint32_t idle_sleep_ns;     /* model thread sleep when it has nothing to do */
+  uint32_t verbose;
+} sim_config_t;
+
+extern sim_config_t sim_cfg;
+
+/* Counters kept by the model; plain fields, written by the model thread */
+typedef struct {
+  uint64_t rx_offered;        /* frames that reached the MAC */
+  uint64_t rx_filtered;       /* dropped by the address, VLAN or L3/L4 filter */
+  uint64_t rx_vlan_filtered;  /* ... of which by the VLAN filter */
+  uint64_t rx_l34_filtered;   /* ... of which by the L3/L4 filters */
+  uint64_t rx_vlan_stripped;  /* tags removed by MACVTR EVLS */
+  uint64_t rx_mac_off;        /* dropped while MACCR RE was clear */
+  uint64_t rx_fifo_overflow;  /* dropped with the RX FIFO full */
+  uint64_t rx_frames;         /* frames written to the ring (LD) */
+  uint64_t rx_descs;          /* RX descriptors closed, incl. context */
+  uint64_t rx_ctx_descs;      /* timestamp context descriptors */
+  uint64_t rx_ri;             /* RI raised (IOC or watchdog) */
+  uint64_t rx_rwt;            /* ... of which by the RX watchdog */
+  uint64_t rx_rbu;            /* RX DMA suspended on an unavailable descriptor */
+  uint64_t rx_tail_writes;    /* DMACRDTPR writes seen */
+  uint64_t rx_poll_demands;   /* RX poll demand writes seen */
+
+  uint64_t tx_frames;         /* frames taken off the ring */
+  uint64_t tx_descs;
+  uint64_t tx_bytes;
+  uint64_t tx_tail_writes;
+  uint64_t tx_tbu;            /* TX DMA suspended on a descriptor it did not own */
+  uint64_t tx_ts;             /* transmit timestamps written back */
+  uint64_t tx_len_error;      /* FL [14:0] disagrees with the buffer lengths */
+  uint64_t tx_bad_buffer;     /* buffer outside DMA-reachable SRAM */
+  uint64_t tx_tso_frames;     /* TSE frames segmented */
+  uint64_t tx_tso_segs;       /* ... into this many segments */
+  uint64_t tx_vlan_inserted;  /* tags inserted from a context descriptor */
+  uint64_t tx_arp_replies;    /* ARP replies sent by the MAC (ARP offload) */
+
+  uint64_t irq_raised;        /* handler invocations */
+  uint64_t irq_storms;        /* line still asserted after too many handler runs */
+  uint64_t csr_w1c;           /* DMACSR write-1-to-clear operations */
+  uint64_t isr_ns;            /* CPU time spent in the ETH handler */
+  uint64_t model_loops;
+} sim_dma_stats_t;
+
+extern sim_dma_stats_t sim_dma_stats;
+
+/* Counters of the CPU-side operations the driver performs */
+typedef struct {
+  uint64_t cache_clean;
+  uint64_t cache_clean_bytes;
+  uint64_t cache_inval;
+  uint64_t cache_inval_bytes;
+  uint64_t cache_clean_inval;
+  uint64_t barriers;
+} sim_cpu_stats_t;
+
+extern sim_cpu_stats_t sim_cpu_stats;
+
+/* Peer: what it saw on the wire */
+typedef struct {
+  uint64_t frames;
+  uint64_t arp_requests;
+  uint64_t arp_replies_sent;
+  uint64_t arp_replies;       /* ARP replies from the device */
+  uint64_t udp;
+  uint64_t udp_bad_csum;
+  uint64_t udp_frag_ok;       /* fragmented datagrams with a valid checksum */
+  uint64_t udp_frag_bad;      /* ... with a bad or no checksum, or out of order */
+  uint64_t ip_bad_csum;
+  uint64_t icmp_echo_replies;
+  uint64_t icmp_bad_csum;
+  uint64_t short_frames;      /* shorter than 60 bytes, padding missing */
+  uint64_t other;
+  uint64_t ptp_ts;            /* frames that came with a TX timestamp */
+  uint64_t oversize;          /* L3 part longer than 1500 bytes */
+  uint64_t tcp_segs;          /* TCP segments to the sink */
+  uint64_t tcp_bytes;         /* stream bytes taken in order */
+  uint64_t tcp_ooo;           /* segments not at the next expected sequence */
+  uint64_t tcp_bad_csum;
+  uint64_t tcp_data_err;      /* stream bytes not matching sim_tcp_pattern() */
+  uint64_t tcp_fin;
+  uint64_t vlan;              /* 802.1Q tagged frames */
+  uint32_t vlan_last_tci;     /* ... and the tag of the last one */
+} sim_peer_stats_t;
+
+extern sim_peer_stats_t sim_peer_stats;
+
+/* Time */
+uint64_t sim_now_ns(void);
+uint64_t sim_thread_cpu_ns(void);
+
+/* Hardware bring-up and the DMA model thread */
+void sim_hw_init(void);
+void sim_dma_start(void);
+void sim_dma_stop(void);
+
+/* Frames towards the device. sim_rx_inject() queues one frame now; the
+ * flood generator produces UDP frames to SIM_DEV_IP:SIM_UDP_PORT at `pps`
+ * (0 = as fast as the wire allows) until `count` frames were offered. */
+int sim_rx_inject(const uint8_t *frame, uint32_t len);
+void sim_rx_flood(uint32_t pps, uint64_t count, uint32_t payload_len, uint32_t bad_csum_every);
+uint64_t sim_rx_flood_left(void);
+
+/* Build a UDP/IPv4 frame from the peer to the device into buf (ETH_FRAME_MAX) */
+uint32_t sim_build_udp(uint8_t *buf, uint32_t payload_len, uint32_t seq, int bad_csum);
+/* Fragment `index` of such a datagram (up to 8192 bytes of payload) cut
+ * into 1480-byte pieces; 0 past the last fragment */
+uint32_t sim_build_udp_frag(uint8_t *buf, uint32_t payload_len, uint32_t seq, int bad_csum, uint32_t index);
+uint32_t sim_build_icmp_echo(uint8_t *buf, uint32_t payload_len, uint16_t seq);
+/* TCP/IPv4 segment without options or payload, window 65535 */
+uint32_t sim_build_tcp(uint8_t *buf, uint16_t src_port, uint16_t dst_port, uint32_t seq, uint32_t ack,
+                       uint8_t flags);
+/* ARP request (op 1, broadcast) or reply (op 2, to the device) from the peer */
+uint32_t sim_build_arp(uint8_t *buf, uint32_t op, uint32_t sender_ip, uint32_t target_ip);
+/* Insert an 802.1Q tag into a built frame of len bytes; returns the new length */
+uint32_t sim_vlan_tag(uint8_t *buf, uint32_t len, uint16_t tci);
+
+/* Byte `off` of the stream the device sends to the TCP sink. The sink
+ * accepts one connection at a time and ACKs every in-order segment with a
+ * 64 KB window; a new SYN starts the stream over at offset 0. */
+static inline uint8_t sim_tcp_pattern(uint64_t off)
+{
+  return (uint8_t)(off % 251U);
+}
+
+/* Called by the model for each transmitted frame (after checksum insertion) */
+void sim_peer_receive(const uint8_t *frame, uint32_t len, int has_ts);
+
+/* PHY */
+void sim_phy_set_link(int up);
+uint32_t sim_phy_read(uint32_t addr, uint32_t reg);
+void sim_phy_write(uint32_t addr, uint32_t reg, uint32_t val);
+
+/* Interrupt plumbing between the stubs and the model */
+void sim_irq_deliver(void);
+int sim_irq_ready(void);
+int sim_in_isr(void);
+void sim_dma_sync_csr(void);
+uint32_t sim_dma_pending_csr(void);
+
+/* DMA ring inspection for the harness checks */
+uint32_t sim_rx_desc_owned_by_dma(void);
+uint32_t sim_tx_desc_owned_by_dma(void);
+
+/* Internet checksum helpers shared by the DMA model and the peer */
+uint32_t sim_csum_add(uint32_t sum, const uint8_t *data, uint32_t len);
+uint16_t sim_csum_fold(uint32_t sum);
+int sim_l4_csum_check(const uint8_t *frame, uint32_t len, int *ip_bad, int *l4_bad, int *l4_type);
+void sim_l4_csum_insert(uint8_t *frame, uint32_t len, uint32_t cic);
+
+/* Ethernet DMA-visible pointer from a 32-bit bus address */
+#define SIM_BUS_PTR(addr)     ((uint8_t *)(uintptr_t)(addr))
+
+#endif /* SIM_HW_H */
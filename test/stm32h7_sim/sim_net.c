@@ -0,0 +1,626 @@
+/*
+ * STM32H7 Ethernet host simulator: the link partner ("peer") and the frame
+ * helpers shared with the DMA model.
+ *
+ * The peer owns 192.168.1.1. It answers ARP requests for that address,
+ * builds the UDP and ICMP frames the harness sends to the device, runs a
+ * TCP sink on SIM_TCP_PORT, and checks every frame the MAC puts on the
+ * wire: minimum and maximum length, IPv4 header checksum and UDP/ICMP/TCP
+ * checksums after the MAC's checksum insertion. Frames here carry no FCS.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include "sim_hw.h"
+
+#define ETHTYPE_IP            0x0800U
+#define ETHTYPE_ARP           0x0806U
+#define ETHTYPE_VLAN          0x8100U
+#define ETHTYPE_IPV6          0x86DDU
+#define IPPROTO_ICMP_         1U
+#define IPPROTO_TCP_          6U
+#define IPPROTO_UDP_          17U
+#define IPPROTO_ICMPV6_       58U
+#define PEER_UDP_PORT         5002U
+
+const uint8_t sim_peer_mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+/* stm32h7_eth.c low_level_init() */
+static const uint8_t sim_dev_mac[6] = { 0x00, 0x80, 0xE1, 0x00, 0x00, 0x00 };
+
+sim_peer_stats_t sim_peer_stats;
+
+/* UDP fragments being summed, model thread only */
+static struct {
+  uint16_t id;
+  uint16_t next;              /* byte offset of the next fragment expected */
+  uint16_t csum;              /* checksum field of the first fragment */
+  uint32_t sum;
+} frag;
+
+/* TCP sink, model thread only */
+static struct {
+  int open;
+  uint16_t dev_port;
+  uint32_t rcv_nxt;           /* next device sequence number expected */
+  uint32_t snd_nxt;
+  uint64_t off;               /* stream offset of rcv_nxt */
+} sink;
+
+static inline uint16_t get16(const uint8_t *p)
+{
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline void put16(uint8_t *p, uint32_t v)
+{
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+static inline void put32(uint8_t *p, uint32_t v)
+{
+  put16(p, v >> 16);
+  put16(p + 2, v);
+}
+
+/* Internet checksum ------------------------------------------------------------*/
+uint32_t sim_csum_add(uint32_t sum, const uint8_t *data, uint32_t len)
+{
+  uint32_t i;
+
+  for (i = 0; i + 1U < len; i += 2U) {
+    sum += get16(data + i);
+  }
+  if (len & 1U) {
+    sum += (uint32_t)data[len - 1U] << 8;
+  }
+  return sum;
+}
+
+uint16_t sim_csum_fold(uint32_t sum)
+{
+  while (sum >> 16) {
+    sum = (sum & 0xFFFFU) + (sum >> 16);
+  }
+  return (uint16_t)~sum;
+}
+
+/* Offset of the L3 header and its ethertype, skipping one VLAN tag */
+static uint32_t l3_offset(const uint8_t *frame, uint32_t len, uint32_t *type)
+{
+  uint32_t off = 14U;
+
+  if (len < 14U) {
+    *type = 0;
+    return 0;
+  }
+  *type = get16(frame + 12);
+  if (*type == ETHTYPE_VLAN && len >= 18U) {
+    *type = get16(frame + 16);
+    off = 18U;
+  }
+  return off;
+}
+
+/* Locate the L4 header; returns the IP version or 0 if not checksummed */
+static int l4_locate(const uint8_t *frame, uint32_t len, uint32_t *l3, uint32_t *l4,
+                     uint32_t *l4_len, uint32_t *proto)
+{
+  uint32_t type;
+  uint32_t off = l3_offset(frame, len, &type);
+
+  *l3 = off;
+  if (type == ETHTYPE_IP && len >= off + 20U) {
+    const uint8_t *ip = frame + off;
+    uint32_t ihl = (ip[0] & 0x0FU) * 4U;
+    uint32_t tot = get16(ip + 2);
+    if ((ip[0] >> 4) != 4U || ihl < 20U || tot < ihl || off + tot > len) {
+      return 0;
+    }
+    *proto = ip[9];
+    *l4 = off + ihl;
+    *l4_len = tot - ihl;
+    /* Fragments are not checksummed by the MAC */
+    if (get16(ip + 6) & 0x3FFFU) {
+      *proto = 0;
+    }
+    return 4;
+  }
+  if (type == ETHTYPE_IPV6 && len >= off + 40U) {
+    const uint8_t *ip = frame + off;
+    uint32_t plen = get16(ip + 4);
+    if ((ip[0] >> 4) != 6U || off + 40U + plen > len) {
+      return 0;
+    }
+    *proto = ip[6];
+    *l4 = off + 40U;
+    *l4_len = plen;
+    return 6;
+  }
+  return 0;
+}
+
+static uint32_t pseudo_sum(const uint8_t *frame, uint32_t l3, int ver, uint32_t proto, uint32_t l4_len)
+{
+  uint32_t sum = proto + l4_len;
+
+  if (ver == 4) {
+    sum = sim_csum_add(sum, frame + l3 + 12U, 8U);
+  } else {
+    sum = sim_csum_add(sum, frame + l3 + 8U, 32U);
+  }
+  return sum;
+}
+
+static uint32_t l4_csum_offset(uint32_t proto)
+{
+  switch (proto) {
+    case IPPROTO_UDP_:   return 6U;
+    case IPPROTO_TCP_:   return 16U;
+    case IPPROTO_ICMP_:
+    case IPPROTO_ICMPV6_: return 2U;
+    default:             return 0U;
+  }
+}
+
+int sim_l4_csum_check(const uint8_t *frame, uint32_t len, int *ip_bad, int *l4_bad, int *l4_type)
+{
+  uint32_t l3, l4, l4_len, proto = 0;
+  int ver = l4_locate(frame, len, &l3, &l4, &l4_len, &proto);
+  uint32_t sum;
+
+  *ip_bad = *l4_bad = *l4_type = 0;
+  if (ver == 0) {
+    return 0;
+  }
+  if (ver == 4) {
+    *ip_bad = sim_csum_fold(sim_csum_add(0, frame + l3, (frame[l3] & 0x0FU) * 4U)) != 0;
+  }
+  switch (proto) {
+    case IPPROTO_UDP_:
+      *l4_type = 1;
+      if (ver == 4 && get16(frame + l4 + 6U) == 0U) {
+        return ver;               /* no checksum */
+      }
+      break;
+    case IPPROTO_TCP_:
+      *l4_type = 2;
+      break;
+    case IPPROTO_ICMP_:
+    case IPPROTO_ICMPV6_:
+      *l4_type = 3;
+      break;
+    default:
+      return ver;
+  }
+  sum = (proto == IPPROTO_ICMP_) ? 0U : pseudo_sum(frame, l3, ver, proto, l4_len);
+  *l4_bad = sim_csum_fold(sim_csum_add(sum, frame + l4, l4_len)) != 0;
+  return ver;
+}
+
+void sim_l4_csum_insert(uint8_t *frame, uint32_t len, uint32_t cic)
+{
+  uint32_t l3, l4, l4_len, proto = 0;
+  int ver = l4_locate(frame, len, &l3, &l4, &l4_len, &proto);
+  uint32_t field, sum;
+  uint16_t csum;
+
+  if (ver == 0) {
+    return;
+  }
+  if (ver == 4) {
+    uint32_t ihl = (frame[l3] & 0x0FU) * 4U;
+    put16(frame + l3 + 10U, 0);
+    put16(frame + l3 + 10U, sim_csum_fold(sim_csum_add(0, frame + l3, ihl)));
+  }
+  field = l4_csum_offset(proto);
+  if (cic < 2U || field == 0U || l4_len < field + 2U) {
+    return;
+  }
+  /* CIC = 2: the field holds the pseudo-header sum computed by software */
+  sum = 0;
+  if (cic == 3U) {
+    put16(frame + l4 + field, 0);
+    if (proto != IPPROTO_ICMP_) {
+      sum = pseudo_sum(frame, l3, ver, proto, l4_len);
+    }
+  }
+  csum = sim_csum_fold(sim_csum_add(sum, frame + l4, l4_len));
+  if (proto == IPPROTO_UDP_ && csum == 0U) {
+    csum = 0xFFFFU;
+  }
+  put16(frame + l4 + field, csum);
+}
+
+/* Frames from the peer ----------------------------------------------------------*/
+static uint32_t build_ipv4(uint8_t *buf, uint32_t proto, uint32_t l4_len, uint32_t id)
+{
+  uint8_t *ip = buf + 14;
+
+  memcpy(buf, sim_dev_mac, 6);
+  memcpy(buf + 6, sim_peer_mac, 6);
+  put16(buf + 12, ETHTYPE_IP);
+  ip[0] = 0x45;
+  ip[1] = 0;
+  put16(ip + 2, 20U + l4_len);
+  put16(ip + 4, id);
+  put16(ip + 6, 0x4000);      /* DF */
+  ip[8] = 64;
+  ip[9] = (uint8_t)proto;
+  put16(ip + 10, 0);
+  put32(ip + 12, SIM_PEER_IP);
+  put32(ip + 16, SIM_DEV_IP);
+  put16(ip + 10, sim_csum_fold(sim_csum_add(0, ip, 20)));
+  return 14U + 20U + l4_len;
+}
+
+static uint32_t pad_frame(uint8_t *buf, uint32_t len)
+{
+  if (len < 60U) {
+    memset(buf + len, 0, 60U - len);
+    len = 60U;
+  }
+  return len;
+}
+
+uint32_t sim_build_udp(uint8_t *buf, uint32_t payload_len, uint32_t seq, int bad_csum)
+{
+  uint8_t *udp = buf + 34;
+  uint32_t len;
+
+  if (payload_len < 4U) {
+    payload_len = 4U;
+  }
+  if (payload_len > SIM_FRAME_MAX - 42U) {
+    payload_len = SIM_FRAME_MAX - 42U;
+  }
+  put16(udp, PEER_UDP_PORT);
+  put16(udp + 2, SIM_UDP_PORT);
+  put16(udp + 4, 8U + payload_len);
+  put16(udp + 6, 0);
+  put32(udp + 8, seq);
+  for (uint32_t i = 4; i < payload_len; i++) {
+    udp[8 + i] = (uint8_t)(seq + i);
+  }
+  len = build_ipv4(buf, IPPROTO_UDP_, 8U + payload_len, seq);
+  sim_l4_csum_insert(buf, len, 3U);
+  if (bad_csum) {
+    udp[6] ^= 0x5A;
+  }
+  return pad_frame(buf, len);
+}
+
+uint32_t sim_build_udp_frag(uint8_t *buf, uint32_t payload_len, uint32_t seq, int bad_csum, uint32_t index)
+{
+  uint8_t dgram[14U + 20U + 8U + 8192U];
+  uint8_t *udp = dgram + 34;
+  uint32_t l4_len, off, n;
+  uint8_t *ip = buf + 14;
+
+  if (payload_len < 4U) {
+    payload_len = 4U;
+  }
+  if (payload_len > 8192U) {
+    payload_len = 8192U;
+  }
+  l4_len = 8U + payload_len;
+  off = index * 1480U;
+  if (off >= l4_len) {
+    return 0;
+  }
+  put16(udp, PEER_UDP_PORT);
+  put16(udp + 2, SIM_UDP_PORT);
+  put16(udp + 4, l4_len);
+  put16(udp + 6, 0);
+  put32(udp + 8, seq);
+  for (uint32_t i = 4; i < payload_len; i++) {
+    udp[8 + i] = (uint8_t)(seq + i);
+  }
+  sim_l4_csum_insert(dgram, build_ipv4(dgram, IPPROTO_UDP_, l4_len, seq), 3U);
+  if (bad_csum) {
+    udp[6] ^= 0x5A;
+  }
+
+  n = (l4_len - off > 1480U) ? 1480U : l4_len - off;
+  build_ipv4(buf, IPPROTO_UDP_, n, seq);
+  put16(ip + 6, (off / 8U) | ((off + n < l4_len) ? 0x2000U : 0U));    /* offset, MF */
+  put16(ip + 10, 0);
+  put16(ip + 10, sim_csum_fold(sim_csum_add(0, ip, 20)));
+  memcpy(buf + 34, udp + off, n);
+  return pad_frame(buf, 34U + n);
+}
+
+uint32_t sim_build_tcp(uint8_t *buf, uint16_t src_port, uint16_t dst_port, uint32_t seq, uint32_t ack,
+                       uint8_t flags)
+{
+  uint8_t *tcp = buf + 34;
+  uint32_t len;
+
+  put16(tcp, src_port);
+  put16(tcp + 2, dst_port);
+  put32(tcp + 4, seq);
+  put32(tcp + 8, ack);
+  tcp[12] = 5U << 4;
+  tcp[13] = flags;
+  put16(tcp + 14, 0xFFFFU);
+  put16(tcp + 16, 0);
+  put16(tcp + 18, 0);
+  len = build_ipv4(buf, IPPROTO_TCP_, 20U, seq);
+  sim_l4_csum_insert(buf, len, 3U);
+  return pad_frame(buf, len);
+}
+
+uint32_t sim_build_icmp_echo(uint8_t *buf, uint32_t payload_len, uint16_t seq)
+{
+  uint8_t *icmp = buf + 34;
+  uint32_t len;
+
+  if (payload_len > SIM_FRAME_MAX - 42U) {
+    payload_len = SIM_FRAME_MAX - 42U;
+  }
+  icmp[0] = 8;                /* echo request */
+  icmp[1] = 0;
+  put16(icmp + 2, 0);
+  put16(icmp + 4, 0x5348);
+  put16(icmp + 6, seq);
+  for (uint32_t i = 0; i < payload_len; i++) {
+    icmp[8 + i] = (uint8_t)i;
+  }
+  len = build_ipv4(buf, IPPROTO_ICMP_, 8U + payload_len, seq);
+  sim_l4_csum_insert(buf, len, 3U);
+  return pad_frame(buf, len);
+}
+
+uint32_t sim_build_arp(uint8_t *buf, uint32_t op, uint32_t sender_ip, uint32_t target_ip)
+{
+  memset(buf, 0, 60);
+  if (op == 1U) {
+    memset(buf, 0xFF, 6);
+  } else {
+    memcpy(buf, sim_dev_mac, 6);
+    memcpy(buf + 32, sim_dev_mac, 6);
+  }
+  memcpy(buf + 6, sim_peer_mac, 6);
+  put16(buf + 12, ETHTYPE_ARP);
+  put16(buf + 14, 1);                 /* Ethernet */
+  put16(buf + 16, ETHTYPE_IP);
+  buf[18] = 6;
+  buf[19] = 4;
+  put16(buf + 20, op);
+  memcpy(buf + 22, sim_peer_mac, 6);
+  put32(buf + 28, sender_ip);
+  put32(buf + 38, target_ip);
+  return 60U;
+}
+
+uint32_t sim_vlan_tag(uint8_t *buf, uint32_t len, uint16_t tci)
+{
+  memmove(buf + 16, buf + 12, len - 12U);
+  put16(buf + 12, ETHTYPE_VLAN);
+  put16(buf + 14, tci);
+  return len + 4U;
+}
+
+/* Frames from the device ---------------------------------------------------------*/
+static void peer_arp(const uint8_t *frame, uint32_t len, uint32_t l3)
+{
+  const uint8_t *arp = frame + l3;
+  uint8_t reply[60];
+
+  if (len >= l3 + 28U && get16(arp + 6) == 2U) {
+    sim_peer_stats.arp_replies++;
+    return;
+  }
+  if (len < l3 + 28U || get16(arp + 6) != 1U) {
+    sim_peer_stats.other++;
+    return;
+  }
+  sim_peer_stats.arp_requests++;
+  if (get16(arp + 24) != (SIM_PEER_IP >> 16) || get16(arp + 26) != (SIM_PEER_IP & 0xFFFFU)) {
+    return;
+  }
+  memset(reply, 0, sizeof(reply));
+  memcpy(reply, arp + 8, 6);
+  memcpy(reply + 6, sim_peer_mac, 6);
+  put16(reply + 12, ETHTYPE_ARP);
+  put16(reply + 14, 1);               /* Ethernet */
+  put16(reply + 16, ETHTYPE_IP);
+  reply[18] = 6;
+  reply[19] = 4;
+  put16(reply + 20, 2);               /* reply */
+  memcpy(reply + 22, sim_peer_mac, 6);
+  put32(reply + 28, SIM_PEER_IP);
+  memcpy(reply + 32, arp + 8, 10);    /* sender MAC + IP of the request */
+  if (sim_rx_inject(reply, sizeof(reply))) {
+    sim_peer_stats.arp_replies_sent++;
+  }
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+  return ((uint32_t)get16(p) << 16) | get16(p + 2);
+}
+
+static void sink_send(uint8_t flags)
+{
+  uint8_t buf[64];
+  uint8_t *tcp = buf + 34;
+  uint32_t hlen = (flags & 0x02U) ? 24U : 20U;
+  uint32_t len;
+
+  put16(tcp, SIM_TCP_PORT);
+  put16(tcp + 2, sink.dev_port);
+  put32(tcp + 4, sink.snd_nxt);
+  put32(tcp + 8, sink.rcv_nxt);
+  tcp[12] = (uint8_t)((hlen / 4U) << 4);
+  tcp[13] = flags;
+  put16(tcp + 14, 0xFFFFU);           /* window, no scaling */
+  put16(tcp + 16, 0);
+  put16(tcp + 18, 0);
+  if (hlen > 20U) {
+    tcp[20] = 2;                      /* MSS */
+    tcp[21] = 4;
+    put16(tcp + 22, 1460U);
+  }
+  len = build_ipv4(buf, IPPROTO_TCP_, hlen, sink.snd_nxt);
+  sim_l4_csum_insert(buf, len, 3U);
+  sim_rx_inject(buf, pad_frame(buf, len));
+}
+
+static void peer_tcp(const uint8_t *frame, uint32_t l3)
+{
+  uint32_t ihl = (frame[l3] & 0x0FU) * 4U;
+  const uint8_t *tcp = frame + l3 + ihl;
+  uint32_t thl = (tcp[12] >> 4) * 4U;
+  uint32_t plen = get16(frame + l3 + 2) - ihl - thl;
+  uint32_t seq = get32(tcp + 4);
+  uint8_t flags = tcp[13];
+
+  if (get16(tcp + 2) != SIM_TCP_PORT) {
+    sim_peer_stats.other++;
+    return;
+  }
+  sim_peer_stats.tcp_segs++;
+  if (flags & 0x04U) {                /* RST */
+    sink.open = 0;
+    return;
+  }
+  if (flags & 0x02U) {                /* SYN: new stream */
+    sink.open = 1;
+    sink.dev_port = get16(tcp);
+    sink.rcv_nxt = seq + 1U;
+    sink.snd_nxt = 0x53494D00U;
+    sink.off = 0;
+    sink_send(0x12U);                 /* SYN | ACK */
+    sink.snd_nxt++;
+    return;
+  }
+  if (!sink.open || get16(tcp) != sink.dev_port || (plen == 0U && !(flags & 0x01U))) {
+    return;
+  }
+  if (seq != sink.rcv_nxt) {
+    sim_peer_stats.tcp_ooo++;
+  } else {
+    for (uint32_t i = 0; i < plen; i++) {
+      if (tcp[thl + i] != sim_tcp_pattern(sink.off + i)) {
+        sim_peer_stats.tcp_data_err++;
+        break;
+      }
+    }
+    sink.rcv_nxt += plen;
+    sink.off += plen;
+    sim_peer_stats.tcp_bytes += plen;
+    if (flags & 0x01U) {              /* FIN: close our side too */
+      sim_peer_stats.tcp_fin++;
+      sink.rcv_nxt++;
+      sink_send(0x11U);               /* FIN | ACK */
+      sink.snd_nxt++;
+      sink.open = 0;
+      return;
+    }
+  }
+  sink_send(0x10U);                   /* ACK */
+}
+
+/* Fragments of one UDP/IPv4 datagram, in order: the checksum of the first
+ * covers the whole datagram, so it is verified when the last one arrives */
+static void peer_udp_frag(const uint8_t *frame, uint32_t l3)
+{
+  const uint8_t *ip = frame + l3;
+  uint32_t ihl = (ip[0] & 0x0FU) * 4U;
+  uint32_t plen = get16(ip + 2) - ihl;
+  uint32_t off = (get16(ip + 6) & 0x1FFFU) * 8U;
+
+  if (off == 0U) {
+    frag.id = get16(ip + 4);
+    frag.next = 0;
+    frag.csum = get16(ip + ihl + 6U);
+    frag.sum = sim_csum_add(0, ip + 12, 8U);
+  } else if (get16(ip + 4) != frag.id || off != frag.next) {
+    sim_peer_stats.udp_frag_bad++;
+    frag.next = 0xFFFFU;
+    return;
+  }
+  frag.sum = sim_csum_add(frag.sum, ip + ihl, plen);
+  frag.next = (uint16_t)(off + plen);
+  if (get16(ip + 6) & 0x2000U) {      /* MF */
+    return;
+  }
+  frag.sum += IPPROTO_UDP_ + frag.next;
+  if (frag.csum == 0U || sim_csum_fold(frag.sum) != 0U) {
+    sim_peer_stats.udp_frag_bad++;
+  } else {
+    sim_peer_stats.udp_frag_ok++;
+  }
+}
+
+void sim_peer_receive(const uint8_t *frame, uint32_t len, int has_ts)
+{
+  uint32_t type;
+  uint32_t l3 = l3_offset(frame, len, &type);
+  int ip_bad, l4_bad, l4_type;
+
+  sim_peer_stats.frames++;
+  if (has_ts) {
+    sim_peer_stats.ptp_ts++;
+  }
+  if (len < 60U) {
+    sim_peer_stats.short_frames++;
+  }
+  if (len > l3 + 1500U) {
+    sim_peer_stats.oversize++;
+  }
+  if (l3 == 0) {
+    sim_peer_stats.other++;
+    return;
+  }
+  if (l3 > 14U) {
+    sim_peer_stats.vlan++;
+    sim_peer_stats.vlan_last_tci = get16(frame + 14);
+  }
+  if (type == ETHTYPE_ARP) {
+    peer_arp(frame, len, l3);
+    return;
+  }
+  if (type != ETHTYPE_IP) {
+    sim_peer_stats.other++;
+    return;
+  }
+
+  sim_l4_csum_check(frame, len, &ip_bad, &l4_bad, &l4_type);
+  if (ip_bad) {
+    sim_peer_stats.ip_bad_csum++;
+  }
+  if ((get16(frame + l3 + 6) & 0x3FFFU) && frame[l3 + 9] == IPPROTO_UDP_) {
+    peer_udp_frag(frame, l3);
+    return;
+  }
+  switch (l4_type) {
+    case 1:
+      sim_peer_stats.udp++;
+      if (l4_bad) {
+        sim_peer_stats.udp_bad_csum++;
+      }
+      break;
+    case 2:
+      if (l4_bad) {
+        sim_peer_stats.tcp_bad_csum++;
+      } else {
+        peer_tcp(frame, l3);
+      }
+      break;
+    case 3:
+      if (l4_bad) {
+        sim_peer_stats.icmp_bad_csum++;
+      } else if (frame[l3 + ((frame[l3] & 0x0FU) * 4U)] == 0U) {
+        sim_peer_stats.icmp_echo_replies++;
+      }
+      break;
+    default:
+      sim_peer_stats.other++;
+      break;
+  }
+  if (sim_cfg.verbose) {
+    printf("peer: %u byte frame, type 0x%04x\n", (unsigned int)len, (unsigned int)type);
+  }
+}
@@ -0,0 +1,23 @@
+/*
+ * STM32H7 Ethernet host simulator: what sys_arch.c keeps about the lwIP
+ * threads, for the harness's per-thread CPU accounting.
+ */
+
+#ifndef SIM_SYS_H
+#define SIM_SYS_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define SIM_MAX_THREADS       16U
+
+typedef struct {
+  char name[16];
+  clockid_t clock;
+  int valid;
+} sim_thread_info_t;
+
+/* CPU time consumed so far by the lwIP thread created under `name`, 0 if none */
+uint64_t sim_thread_cpu_ns_by_name(const char *name);
+
+#endif /* SIM_SYS_H */
@@ -0,0 +1,344 @@
+/*
+ * lwIP sys_arch for the host simulation, over POSIX threads.
+ *
+ * Semaphores and mailboxes are a mutex + condition variable each; every
+ * thread created through sys_thread_new() is registered so the harness can
+ * report its CPU time (the per-packet cost of EthIf and tcpip_thread).
+ * SYS_ARCH_PROTECT takes the simulator's interrupt lock, as the RTEMS port
+ * disables interrupts.
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "lwip/opt.h"
+#include "lwip/sys.h"
+#include "lwip/err.h"
+#include <rtems.h>
+#include "stm32h7xx_hal.h"
+#include "sim_hw.h"
+#include "sim_sys.h"
+
+struct sim_sem {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  uint32_t count;
+};
+
+struct sim_mbox {
+  pthread_mutex_t lock;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+  uint32_t size, head, cnt;
+  void **msgs;
+};
+
+static sim_thread_info_t threads[SIM_MAX_THREADS];
+static uint32_t thread_cnt;
+static pthread_mutex_t threads_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void sys_init(void)
+{
+}
+
+u32_t sys_now(void)
+{
+  return HAL_GetTick();
+}
+
+/* Absolute CLOCK_MONOTONIC deadline `ms` from now, for the timed waits */
+static void deadline(struct timespec *ts, u32_t ms)
+{
+  clock_gettime(CLOCK_MONOTONIC, ts);
+  ts->tv_sec += ms / 1000U;
+  ts->tv_nsec += (long)(ms % 1000U) * 1000000L;
+  if (ts->tv_nsec >= 1000000000L) {
+    ts->tv_sec++;
+    ts->tv_nsec -= 1000000000L;
+  }
+}
+
+static void cond_init(pthread_cond_t *cond)
+{
+  pthread_condattr_t attr;
+
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(cond, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+/* Semaphores ---------------------------------------------------------------------*/
+err_t sys_sem_new(sys_sem_t *sem, u8_t count)
+{
+  struct sim_sem *s = calloc(1, sizeof(*s));
+
+  if (s == NULL) {
+    return ERR_MEM;
+  }
+  pthread_mutex_init(&s->lock, NULL);
+  cond_init(&s->cond);
+  s->count = count;
+  *sem = s;
+  return ERR_OK;
+}
+
+void sys_sem_free(sys_sem_t *sem)
+{
+  struct sim_sem *s = *sem;
+
+  pthread_cond_destroy(&s->cond);
+  pthread_mutex_destroy(&s->lock);
+  free(s);
+  *sem = NULL;
+}
+
+void sys_sem_signal(sys_sem_t *sem)
+{
+  struct sim_sem *s = *sem;
+
+  pthread_mutex_lock(&s->lock);
+  s->count++;
+  pthread_cond_signal(&s->cond);
+  pthread_mutex_unlock(&s->lock);
+}
+
+u32_t sys_arch_sem_wait(sys_sem_t *sem, u32_t timeout)
+{
+  struct sim_sem *s = *sem;
+  u32_t start = sys_now();
+  struct timespec ts;
+  int rc = 0;
+
+  if (timeout != 0U) {
+    deadline(&ts, timeout);
+  }
+  pthread_mutex_lock(&s->lock);
+  while (s->count == 0U && rc != ETIMEDOUT) {
+    rc = (timeout == 0U) ? pthread_cond_wait(&s->cond, &s->lock)
+                         : pthread_cond_timedwait(&s->cond, &s->lock, &ts);
+  }
+  if (s->count == 0U) {
+    pthread_mutex_unlock(&s->lock);
+    return SYS_ARCH_TIMEOUT;
+  }
+  s->count--;
+  pthread_mutex_unlock(&s->lock);
+  return sys_now() - start;
+}
+
+/* Mutexes ---------------------------------------------------------------------------*/
+err_t sys_mutex_new(sys_mutex_t *mutex)
+{
+  pthread_mutex_t *m = malloc(sizeof(*m));
+
+  if (m == NULL) {
+    return ERR_MEM;
+  }
+  pthread_mutex_init(m, NULL);
+  *mutex = m;
+  return ERR_OK;
+}
+
+void sys_mutex_free(sys_mutex_t *mutex)
+{
+  pthread_mutex_destroy(*mutex);
+  free(*mutex);
+  *mutex = NULL;
+}
+
+void sys_mutex_lock(sys_mutex_t *mutex)
+{
+  pthread_mutex_lock(*mutex);
+}
+
+void sys_mutex_unlock(sys_mutex_t *mutex)
+{
+  pthread_mutex_unlock(*mutex);
+}
+
+/* Mailboxes -------------------------------------------------------------------------*/
+err_t sys_mbox_new(sys_mbox_t *mbox, int size)
+{
+  struct sim_mbox *mb = calloc(1, sizeof(*mb));
+
+  if (mb == NULL) {
+    return ERR_MEM;
+  }
+  mb->size = (size > 0) ? (uint32_t)size : 64U;
+  mb->msgs = calloc(mb->size, sizeof(void *));
+  if (mb->msgs == NULL) {
+    free(mb);
+    return ERR_MEM;
+  }
+  pthread_mutex_init(&mb->lock, NULL);
+  cond_init(&mb->not_empty);
+  cond_init(&mb->not_full);
+  *mbox = mb;
+  return ERR_OK;
+}
+
+void sys_mbox_free(sys_mbox_t *mbox)
+{
+  struct sim_mbox *mb = *mbox;
+
+  pthread_cond_destroy(&mb->not_empty);
+  pthread_cond_destroy(&mb->not_full);
+  pthread_mutex_destroy(&mb->lock);
+  free(mb->msgs);
+  free(mb);
+  *mbox = NULL;
+}
+
+static void mbox_put(struct sim_mbox *mb, void *msg)
+{
+  mb->msgs[(mb->head + mb->cnt) % mb->size] = msg;
+  mb->cnt++;
+  pthread_cond_signal(&mb->not_empty);
+}
+
+void sys_mbox_post(sys_mbox_t *mbox, void *msg)
+{
+  struct sim_mbox *mb = *mbox;
+
+  pthread_mutex_lock(&mb->lock);
+  while (mb->cnt == mb->size) {
+    pthread_cond_wait(&mb->not_full, &mb->lock);
+  }
+  mbox_put(mb, msg);
+  pthread_mutex_unlock(&mb->lock);
+}
+
+err_t sys_mbox_trypost(sys_mbox_t *mbox, void *msg)
+{
+  struct sim_mbox *mb = *mbox;
+  err_t err = ERR_MEM;
+
+  pthread_mutex_lock(&mb->lock);
+  if (mb->cnt < mb->size) {
+    mbox_put(mb, msg);
+    err = ERR_OK;
+  }
+  pthread_mutex_unlock(&mb->lock);
+  return err;
+}
+
+err_t sys_mbox_trypost_fromisr(sys_mbox_t *mbox, void *msg)
+{
+  return sys_mbox_trypost(mbox, msg);
+}
+
+u32_t sys_arch_mbox_fetch(sys_mbox_t *mbox, void **msg, u32_t timeout)
+{
+  struct sim_mbox *mb = *mbox;
+  u32_t start = sys_now();
+  struct timespec ts;
+  int rc = 0;
+
+  if (timeout != 0U) {
+    deadline(&ts, timeout);
+  }
+  pthread_mutex_lock(&mb->lock);
+  while (mb->cnt == 0U && rc != ETIMEDOUT) {
+    rc = (timeout == 0U) ? pthread_cond_wait(&mb->not_empty, &mb->lock)
+                         : pthread_cond_timedwait(&mb->not_empty, &mb->lock, &ts);
+  }
+  if (mb->cnt == 0U) {
+    pthread_mutex_unlock(&mb->lock);
+    return SYS_ARCH_TIMEOUT;
+  }
+  if (msg != NULL) {
+    *msg = mb->msgs[mb->head];
+  }
+  mb->head = (mb->head + 1U) % mb->size;
+  mb->cnt--;
+  pthread_cond_signal(&mb->not_full);
+  pthread_mutex_unlock(&mb->lock);
+  return sys_now() - start;
+}
+
+u32_t sys_arch_mbox_tryfetch(sys_mbox_t *mbox, void **msg)
+{
+  struct sim_mbox *mb = *mbox;
+  u32_t ret = SYS_MBOX_EMPTY;
+
+  pthread_mutex_lock(&mb->lock);
+  if (mb->cnt > 0U) {
+    if (msg != NULL) {
+      *msg = mb->msgs[mb->head];
+    }
+    mb->head = (mb->head + 1U) % mb->size;
+    mb->cnt--;
+    pthread_cond_signal(&mb->not_full);
+    ret = 0;
+  }
+  pthread_mutex_unlock(&mb->lock);
+  return ret;
+}
+
+/* Threads ---------------------------------------------------------------------------*/
+typedef struct {
+  lwip_thread_fn fn;
+  void *arg;
+  sim_thread_info_t *info;
+} thread_start_t;
+
+static void *thread_entry(void *p)
+{
+  thread_start_t start = *(thread_start_t *)p;
+
+  free(p);
+  pthread_getcpuclockid(pthread_self(), &start.info->clock);
+  __atomic_store_n(&start.info->valid, 1, __ATOMIC_RELEASE);
+  start.fn(start.arg);
+  return NULL;
+}
+
+sys_thread_t sys_thread_new(const char *name, lwip_thread_fn thread, void *arg, int stacksize, int prio)
+{
+  thread_start_t *start = malloc(sizeof(*start));
+  pthread_t tid;
+
+  (void)stacksize;
+  (void)prio;
+  pthread_mutex_lock(&threads_lock);
+  LWIP_ASSERT("too many simulator threads", thread_cnt < SIM_MAX_THREADS);
+  start->info = &threads[thread_cnt++];
+  pthread_mutex_unlock(&threads_lock);
+  strncpy(start->info->name, name, sizeof(start->info->name) - 1U);
+  start->fn = thread;
+  start->arg = arg;
+  if (pthread_create(&tid, NULL, thread_entry, start) != 0) {
+    LWIP_ASSERT("pthread_create failed", 0);
+  }
+  pthread_setname_np(tid, name);
+  return tid;
+}
+
+uint64_t sim_thread_cpu_ns_by_name(const char *name)
+{
+  for (uint32_t i = 0; i < thread_cnt; i++) {
+    struct timespec ts;
+    if (__atomic_load_n(&threads[i].valid, __ATOMIC_ACQUIRE) && strcmp(threads[i].name, name) == 0 &&
+        clock_gettime(threads[i].clock, &ts) == 0) {
+      return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    }
+  }
+  return 0;
+}
+
+/* Critical sections -------------------------------------------------------------------*/
+sys_prot_t sys_arch_protect(void)
+{
+  sim_irq_lock();
+  return 0;
+}
+
+void sys_arch_unprotect(sys_prot_t pval)
+{
+  (void)pval;
+  sim_irq_unlock();
+}